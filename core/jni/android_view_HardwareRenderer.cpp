@@ -22,7 +22,11 @@
 
 #include <EGL/egl_cache.h>
 
+#include <utils/String8.h>
+
 #ifdef USE_OPENGL_RENDERER
+    #include <ProgramCache.h>
+
     EGLAPI void EGLAPIENTRY eglBeginFrame(EGLDisplay dpy, EGLSurface surface);
 #endif
 
@@ -42,6 +46,9 @@ namespace android {
 // Debug
 #define DEBUG_RENDERER 0
 
+// Name of the file that records the programs generated by the renderer
+#define PROGRAMS_CACHE_FILE "com.android.hwui.programs_cache"
+
 // Debug
 #if DEBUG_RENDERER
     #define RENDERER_LOGD(...) ALOGD(__VA_ARGS__)
@@ -133,6 +140,13 @@ static void android_view_HardwareRenderer_setupShadersDiskCache(JNIEnv* env, job
 
     const char* cacheArray = env->GetStringUTFChars(diskCachePath, NULL);
     egl_cache_t::get()->setCacheFilename(cacheArray);
+#ifdef USE_OPENGL_RENDERER
+    // The list of programs used by the renderer is kept next to the
+    // shaders compiled by the driver
+    String8 programsPath(String8(cacheArray).getPathDir());
+    programsPath.appendPath(PROGRAMS_CACHE_FILE);
+    uirenderer::ProgramCache::setPersistentCacheFile(programsPath.string());
+#endif
     env->ReleaseStringUTFChars(diskCachePath, cacheArray);
 }
 
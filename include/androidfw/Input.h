@@ -451,6 +451,11 @@ public:
 
     float getHistoricalAxisValue(int32_t axis, size_t pointerIndex, size_t historicalIndex) const;
 
+    /* Gets the value of an axis for a pointer in every sample, oldest first, including
+     * the current sample.  outValues must have room for getHistorySize() + 1 values.
+     * This is much cheaper than calling getHistoricalAxisValue() for each sample. */
+    void getHistoricalAxisValues(int32_t axis, size_t pointerIndex, float* outValues) const;
+
     inline float getHistoricalX(size_t pointerIndex, size_t historicalIndex) const {
         return getHistoricalAxisValue(
                 AMOTION_EVENT_AXIS_X, pointerIndex, historicalIndex);
@@ -522,6 +527,13 @@ public:
             nsecs_t eventTime,
             const PointerCoords* pointerCoords);
 
+    /* Appends several samples at once.  pointerCoords holds getPointerCount() coordinates
+     * for each sample. */
+    void addSamples(
+            size_t sampleCount,
+            const nsecs_t* eventTimes,
+            const PointerCoords* pointerCoords);
+
     void offsetLocation(float xOffset, float yOffset);
 
     void scale(float scaleFactor);
@@ -563,6 +575,48 @@ protected:
     Vector<PointerCoords> mSamplePointerCoords;
 };
 
+/*
+ * Structure-of-arrays copy of the samples of a motion event.
+ *
+ * The values of a fixed set of commonly used axes are stored in one contiguous array
+ * per axis and pointer, oldest sample first, so that consumers that walk entire batches
+ * can read them without decoding each PointerCoords.  Other axes must still be read
+ * from the motion event.  X and Y include the offset of the event just like
+ * MotionEvent::getHistoricalAxisValue().
+ *
+ * This is only a view for reading, the motion event keeps its own layout which is
+ * also the layout used to parcel it.
+ */
+class MotionEventSamples {
+public:
+    MotionEventSamples();
+
+    /* Copies the samples of a motion event, reusing the storage of earlier copies. */
+    void setTo(const MotionEvent* event);
+
+    inline size_t getSampleCount() const { return mEventTimes.size(); }
+    inline size_t getPointerCount() const { return mPointerCount; }
+    inline const nsecs_t* getEventTimes() const { return mEventTimes.array(); }
+
+    /* Returns true if the values of the axis are stored. */
+    static bool hasAxis(int32_t axis);
+
+    /* Gets the values of an axis for a pointer in every sample, oldest first,
+     * or NULL if the axis is not stored. */
+    const float* getAxisValues(int32_t axis, size_t pointerIndex) const;
+
+private:
+    enum { AXIS_COUNT = 9 };
+
+    size_t mPointerCount;
+    Vector<nsecs_t> mEventTimes;
+
+    // Values indexed by axis slot, then pointer, then sample.
+    Vector<float> mValues;
+
+    static int32_t getAxisSlot(int32_t axis);
+};
+
 /*
  * Input event factory.
  */
@@ -410,6 +410,11 @@ private:
     };
     Vector<SeqChain> mSeqChains;
 
+    // Scratch space for the samples that are appended to a motion event as a batch
+    // is consumed.  Kept around so their storage is reused.
+    Vector<nsecs_t> mBatchEventTimes;
+    Vector<PointerCoords> mBatchPointerCoords;
+
     status_t consumeBatch(InputEventFactoryInterface* factory,
             nsecs_t frameTime, uint32_t* outSeq, InputEvent** outEvent);
     status_t consumeSamples(InputEventFactoryInterface* factory,
@@ -427,7 +432,7 @@ private:
 
     static void initializeKeyEvent(KeyEvent* event, const InputMessage* msg);
     static void initializeMotionEvent(MotionEvent* event, const InputMessage* msg);
-    static void addSample(MotionEvent* event, const InputMessage* msg);
+    void appendSample(MotionEvent* event, const InputMessage* msg);
     static bool canAddSample(const Batch& batch, const InputMessage* msg);
     static ssize_t findSampleNoLaterThan(const Batch& batch, nsecs_t time);
     static bool shouldResampleTool(int32_t toolType);
@@ -33,6 +33,9 @@
 
 namespace android {
 
+class CompiledKeymapReader;
+class CompiledKeymapWriter;
+
 /**
  * Describes a mapping from Android key codes to characters.
  * Also specifies other functions of the keyboard such as the keyboard type
@@ -75,6 +78,21 @@ public:
     static status_t loadContents(const String8& filename,
             const char* contents, Format format, sp<KeyCharacterMap>* outMap);
 
+    /* Loads a key character map from its compiled form, provided that the compiled form
+     * is still up to date with the source file.  See KeymapCache.h. */
+    static status_t loadCompiled(const String8& path, const String8& sourceFilename,
+            Format format, sp<KeyCharacterMap>* outMap);
+
+    /* Writes the compiled form of a key character map that was loaded from a source file. */
+    status_t writeCompiled(const String8& path, const String8& sourceFilename) const;
+
+    /* Loads a key character map from the words of its compiled form, without a header.
+     * Used to restore maps captured with getCompiledWords, such as in input traces. */
+    static status_t loadCompiledWords(const Vector<int32_t>& words, sp<KeyCharacterMap>* outMap);
+
+    /* Gets the words of the compiled form of this key character map. */
+    void getCompiledWords(Vector<int32_t>* outWords) const;
+
     /* Combines a base key character map and an overlay. */
     static sp<KeyCharacterMap> combine(const sp<KeyCharacterMap>& base,
             const sp<KeyCharacterMap>& overlay);
@@ -169,6 +187,12 @@ private:
         Behavior* firstBehavior;
     };
 
+    /* The key and meta state that generate a character. */
+    struct CharacterKey {
+        int32_t keyCode;
+        int32_t metaState;
+    };
+
     class Parser {
         enum State {
             STATE_TOP = 0,
@@ -219,6 +243,9 @@ private:
     KeyedVector<int32_t, int32_t> mKeysByScanCode;
     KeyedVector<int32_t, int32_t> mKeysByUsageCode;
 
+    // Reverse index of mKeys used by findKey.  Rebuilt whenever mKeys changes.
+    KeyedVector<char16_t, CharacterKey> mKeysByCharacter;
+
     KeyCharacterMap();
     KeyCharacterMap(const KeyCharacterMap& other);
 
@@ -228,9 +255,14 @@ private:
     static bool matchesMetaState(int32_t eventMetaState, int32_t behaviorMetaState);
 
     bool findKey(char16_t ch, int32_t* outKeyCode, int32_t* outMetaState) const;
+    void buildCharacterIndex();
 
     static status_t load(Tokenizer* tokenizer, Format format, sp<KeyCharacterMap>* outMap);
 
+    static status_t readCompiled(CompiledKeymapReader& reader, Format format,
+            sp<KeyCharacterMap>* outMap);
+    void writeCompiled(CompiledKeymapWriter& writer) const;
+
     static void addKey(Vector<KeyEvent>& outEvents,
             int32_t deviceId, int32_t keyCode, int32_t metaState, bool down, nsecs_t time);
     static void addMetaKeys(Vector<KeyEvent>& outEvents,
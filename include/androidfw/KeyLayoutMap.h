@@ -64,6 +64,14 @@ class KeyLayoutMap : public RefBase {
 public:
     static status_t load(const String8& filename, sp<KeyLayoutMap>* outMap);
 
+    /* Loads a key layout map from its compiled form, provided that the compiled form
+     * is still up to date with the source file.  See KeymapCache.h. */
+    static status_t loadCompiled(const String8& path, const String8& sourceFilename,
+            sp<KeyLayoutMap>* outMap);
+
+    /* Writes the compiled form of a key layout map that was loaded from a source file. */
+    status_t writeCompiled(const String8& path, const String8& sourceFilename) const;
+
     status_t mapKey(int32_t scanCode, int32_t usageCode,
             int32_t* outKeyCode, uint32_t* outFlags) const;
     status_t findScanCodesForKey(int32_t keyCode, Vector<int32_t>* outScanCodes) const;
@@ -83,9 +91,13 @@ private:
     KeyedVector<int32_t, Key> mKeysByUsageCode;
     KeyedVector<int32_t, AxisInfo> mAxes;
 
+    // Reverse index of mKeysByScanCode used by findScanCodesForKey.
+    KeyedVector<int32_t, Vector<int32_t> > mScanCodesByKeyCode;
+
     KeyLayoutMap();
 
     const Key* getKey(int32_t scanCode, int32_t usageCode) const;
+    void buildScanCodeIndex();
 
     class Parser {
         KeyLayoutMap* mMap;
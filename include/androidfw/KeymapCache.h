@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ANDROIDFW_KEYMAP_CACHE_H
+#define _ANDROIDFW_KEYMAP_CACHE_H
+
+#include <stdint.h>
+#include <utils/Errors.h>
+#include <utils/FileMap.h>
+#include <utils/String8.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+/*
+ * Compiled keymaps are a binary form of key layout (.kl) and key character map (.kcm)
+ * files that can be loaded without tokenizing and parsing the source text.
+ *
+ * A compiled keymap is a fixed size header followed by a stream of 32-bit words in
+ * host byte order whose meaning depends on the kind of keymap.  The header records
+ * the content hash of the source file it was compiled from.  A compiled keymap is only
+ * used while the source file still has the same content hash, so keymaps that were
+ * compiled at build time remain valid after the source file is copied.
+ *
+ * Compiled keymaps are looked up in two directories: keymaps compiled at build time
+ * by validatekeymaps are installed in $ANDROID_ROOT/usr/keymapcache, and keymaps that
+ * are compiled the first time a source file is parsed go in $ANDROID_DATA/system/keymapcache.
+ */
+
+enum CompiledKeymapKind {
+    COMPILED_KEYMAP_KIND_KEY_LAYOUT = 1,
+    COMPILED_KEYMAP_KIND_KEY_CHARACTER_MAP = 2,
+};
+
+/* Accumulates the words of a compiled keymap and writes them to a file. */
+class CompiledKeymapWriter {
+public:
+    CompiledKeymapWriter(CompiledKeymapKind kind);
+
+    inline void writeInt32(int32_t value) { mWords.push(value); }
+
+    inline const Vector<int32_t>& getWords() const { return mWords; }
+
+    /* Writes the compiled keymap for a source file.  The file is replaced atomically
+     * and its directory and any missing parents are created if needed. */
+    status_t writeToFile(const String8& path, const String8& sourcePath) const;
+
+private:
+    CompiledKeymapKind mKind;
+    Vector<int32_t> mWords;
+};
+
+/* Reads a compiled keymap that has been mapped into memory. */
+class CompiledKeymapReader {
+public:
+    CompiledKeymapReader();
+    ~CompiledKeymapReader();
+
+    /* Maps a compiled keymap of the given kind.  Returns NAME_NOT_FOUND if there is
+     * no such file and INVALID_OPERATION if it is stale or malformed. */
+    status_t open(const String8& path, CompiledKeymapKind kind, const String8& sourcePath);
+
+    /* Reads compiled keymap words held in memory, without a header.  The words must
+     * outlive the reader. */
+    void openWords(const int32_t* words, size_t wordCount);
+
+    /* Reads the next word, returning false once the end of the keymap is reached. */
+    inline bool readInt32(int32_t* outValue) {
+        if (mNext == mEnd) {
+            return false;
+        }
+        *outValue = *(mNext++);
+        return true;
+    }
+
+    inline bool isEof() const { return mNext == mEnd; }
+
+private:
+    FileMap* mFileMap;
+    const int32_t* mNext;
+    const int32_t* mEnd;
+};
+
+/* Gets the path of the compiled keymap for a source file within a directory,
+ * or an empty string if the directory is empty. */
+String8 getCompiledKeymapPath(const String8& directory, const String8& sourcePath);
+
+/* Gets the directory that holds keymaps compiled at build time. */
+String8 getPrebuiltCompiledKeymapDirectory();
+
+/* Gets the directory that holds keymaps compiled at runtime. */
+String8 getCompiledKeymapDirectory();
+
+} // namespace android
+
+#endif // _ANDROIDFW_KEYMAP_CACHE_H
@@ -109,6 +109,9 @@ private:
     int32_t mActivePointerId;
     VelocityTrackerStrategy* mStrategy;
 
+    // Scratch copy of the samples of the last motion event, reused across events.
+    MotionEventSamples mSamples;
+
     bool configureStrategy(const char* strategy);
 
     static VelocityTrackerStrategy* createStrategy(const char* strategy);
@@ -36,6 +36,7 @@ commonUiSources:= \
     Keyboard.cpp \
     KeyCharacterMap.cpp \
     KeyLayoutMap.cpp \
+    KeymapCache.cpp \
     VelocityControl.cpp \
     VelocityTracker.cpp \
     VirtualKeyMap.cpp
@@ -19,6 +19,7 @@
 
 #include <math.h>
 #include <limits.h>
+#include <string.h>
 
 #include <androidfw/Input.h>
 
@@ -349,6 +350,14 @@ void MotionEvent::addSample(
     mSamplePointerCoords.appendArray(pointerCoords, getPointerCount());
 }
 
+void MotionEvent::addSamples(
+        size_t sampleCount,
+        const nsecs_t* eventTimes,
+        const PointerCoords* pointerCoords) {
+    mSampleEventTimes.appendArray(eventTimes, sampleCount);
+    mSamplePointerCoords.appendArray(pointerCoords, sampleCount * getPointerCount());
+}
+
 const PointerCoords* MotionEvent::getRawPointerCoords(size_t pointerIndex) const {
     return &mSamplePointerCoords[getHistorySize() * getPointerCount() + pointerIndex];
 }
@@ -390,6 +399,44 @@ float MotionEvent::getHistoricalAxisValue(int32_t axis, size_t pointerIndex,
     return value;
 }
 
+void MotionEvent::getHistoricalAxisValues(int32_t axis, size_t pointerIndex,
+        float* outValues) const {
+    size_t sampleCount = mSampleEventTimes.size();
+    if (axis < 0 || axis > 63) {
+        memset(outValues, 0, sampleCount * sizeof(float));
+        return;
+    }
+
+    float offset = 0;
+    switch (axis) {
+    case AMOTION_EVENT_AXIS_X:
+        offset = mXOffset;
+        break;
+    case AMOTION_EVENT_AXIS_Y:
+        offset = mYOffset;
+        break;
+    }
+
+    // The axes present usually stay the same across samples, so only count the
+    // bits again when they change.
+    uint64_t axisBit = 1LL << axis;
+    uint64_t lastBits = 0;
+    uint32_t index = 0;
+    size_t pointerCount = getPointerCount();
+    const PointerCoords* coords = mSamplePointerCoords.array() + pointerIndex;
+    for (size_t h = 0; h < sampleCount; h++, coords += pointerCount) {
+        if (!(coords->bits & axisBit)) {
+            outValues[h] = offset;
+            continue;
+        }
+        if (coords->bits != lastBits) {
+            lastBits = coords->bits;
+            index = __builtin_popcountll(lastBits & (axisBit - 1LL));
+        }
+        outValues[h] = coords->values[index] + offset;
+    }
+}
+
 ssize_t MotionEvent::findPointerIndex(int32_t pointerId) const {
     size_t pointerCount = mPointerProperties.size();
     for (size_t i = 0; i < pointerCount; i++) {
@@ -576,6 +623,89 @@ bool MotionEvent::isTouchEvent(int32_t source, int32_t action) {
 }
 
 
+// --- MotionEventSamples ---
+
+MotionEventSamples::MotionEventSamples() :
+        mPointerCount(0) {
+}
+
+int32_t MotionEventSamples::getAxisSlot(int32_t axis) {
+    switch (axis) {
+    case AMOTION_EVENT_AXIS_X:
+        return 0;
+    case AMOTION_EVENT_AXIS_Y:
+        return 1;
+    case AMOTION_EVENT_AXIS_PRESSURE:
+        return 2;
+    case AMOTION_EVENT_AXIS_SIZE:
+        return 3;
+    case AMOTION_EVENT_AXIS_TOUCH_MAJOR:
+        return 4;
+    case AMOTION_EVENT_AXIS_TOUCH_MINOR:
+        return 5;
+    case AMOTION_EVENT_AXIS_TOOL_MAJOR:
+        return 6;
+    case AMOTION_EVENT_AXIS_TOOL_MINOR:
+        return 7;
+    case AMOTION_EVENT_AXIS_ORIENTATION:
+        return 8;
+    }
+    return -1;
+}
+
+bool MotionEventSamples::hasAxis(int32_t axis) {
+    return getAxisSlot(axis) >= 0;
+}
+
+void MotionEventSamples::setTo(const MotionEvent* event) {
+    size_t sampleCount = event->getHistorySize() + 1;
+    mPointerCount = event->getPointerCount();
+
+    mEventTimes.clear();
+    mEventTimes.appendArray(event->getSampleEventTimes(), sampleCount);
+
+    size_t valueCount = AXIS_COUNT * mPointerCount * sampleCount;
+    mValues.clear();
+    mValues.insertAt(0.0f, 0, valueCount);
+    float* values = mValues.editArray();
+
+    // Decode each PointerCoords once, scattering the values of its axes.
+    const PointerCoords* coords = event->getSamplePointerCoords();
+    for (size_t h = 0; h < sampleCount; h++) {
+        for (size_t i = 0; i < mPointerCount; i++) {
+            uint64_t bits = coords->bits;
+            for (uint32_t index = 0; bits; index++) {
+                int32_t axis = __builtin_ctzll(bits);
+                bits &= bits - 1;
+
+                int32_t slot = getAxisSlot(axis);
+                if (slot >= 0) {
+                    values[(slot * mPointerCount + i) * sampleCount + h] = coords->values[index];
+                }
+            }
+            coords += 1;
+        }
+    }
+
+    float xOffset = event->getXOffset();
+    float yOffset = event->getYOffset();
+    float* xValues = values;
+    float* yValues = values + mPointerCount * sampleCount;
+    for (size_t j = 0; j < mPointerCount * sampleCount; j++) {
+        xValues[j] += xOffset;
+        yValues[j] += yOffset;
+    }
+}
+
+const float* MotionEventSamples::getAxisValues(int32_t axis, size_t pointerIndex) const {
+    int32_t slot = getAxisSlot(axis);
+    if (slot < 0) {
+        return NULL;
+    }
+    return mValues.array() + (slot * mPointerCount + pointerIndex) * getSampleCount();
+}
+
+
 // --- PooledInputEventFactory ---
 
 PooledInputEventFactory::PooledInputEventFactory(size_t maxPoolSize) :
@@ -541,6 +541,8 @@ status_t InputConsumer::consumeSamples(InputEventFactoryInterface* factory,
     if (! motionEvent) return NO_MEMORY;
 
     uint32_t chain = 0;
+    mBatchEventTimes.clear();
+    mBatchPointerCoords.clear();
     for (size_t i = 0; i < count; i++) {
         InputMessage& msg = batch.samples.editItemAt(i);
         updateTouchState(&msg);
@@ -549,7 +551,7 @@ status_t InputConsumer::consumeSamples(InputEventFactoryInterface* factory,
             seqChain.seq = msg.body.motion.seq;
             seqChain.chain = chain;
             mSeqChains.push(seqChain);
-            addSample(motionEvent, &msg);
+            appendSample(motionEvent, &msg);
         } else {
             initializeMotionEvent(motionEvent, &msg);
         }
@@ -557,6 +559,10 @@ status_t InputConsumer::consumeSamples(InputEventFactoryInterface* factory,
     }
     batch.samples.removeItemsAt(0, count);
 
+    // Add the rest of the samples all at once.
+    motionEvent->addSamples(mBatchEventTimes.size(),
+            mBatchEventTimes.array(), mBatchPointerCoords.array());
+
     *outSeq = chain;
     *outEvent = motionEvent;
     return OK;
@@ -912,15 +918,15 @@ void InputConsumer::initializeMotionEvent(MotionEvent* event, const InputMessage
             pointerCoords);
 }
 
-void InputConsumer::addSample(MotionEvent* event, const InputMessage* msg) {
+void InputConsumer::appendSample(MotionEvent* event, const InputMessage* msg) {
     size_t pointerCount = msg->body.motion.pointerCount;
-    PointerCoords pointerCoords[pointerCount];
     for (size_t i = 0; i < pointerCount; i++) {
-        pointerCoords[i].copyFrom(msg->body.motion.pointers[i].coords);
+        mBatchPointerCoords.push();
+        mBatchPointerCoords.editTop().copyFrom(msg->body.motion.pointers[i].coords);
     }
 
     event->setMetaState(event->getMetaState() | msg->body.motion.metaState);
-    event->addSample(msg->body.motion.eventTime, pointerCoords);
+    mBatchEventTimes.push(msg->body.motion.eventTime);
 }
 
 bool InputConsumer::canAddSample(const Batch& batch, const InputMessage *msg) {
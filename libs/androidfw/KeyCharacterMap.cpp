@@ -21,6 +21,7 @@
 #include <android/keycodes.h>
 #include <androidfw/Keyboard.h>
 #include <androidfw/KeyCharacterMap.h>
+#include <androidfw/KeymapCache.h>
 
 #if HAVE_ANDROID_OS
 #include <binder/Parcel.h>
@@ -91,7 +92,7 @@ KeyCharacterMap::KeyCharacterMap() :
 
 KeyCharacterMap::KeyCharacterMap(const KeyCharacterMap& other) :
     RefBase(), mType(other.mType), mKeysByScanCode(other.mKeysByScanCode),
-    mKeysByUsageCode(other.mKeysByUsageCode) {
+    mKeysByUsageCode(other.mKeysByUsageCode), mKeysByCharacter(other.mKeysByCharacter) {
     for (size_t i = 0; i < other.mKeys.size(); i++) {
         mKeys.add(other.mKeys.keyAt(i), new Key(*other.mKeys.valueAt(i)));
     }
@@ -154,12 +155,164 @@ status_t KeyCharacterMap::load(Tokenizer* tokenizer,
                 elapsedTime / 1000000.0);
 #endif
         if (!status) {
+            map->buildCharacterIndex();
             *outMap = map;
         }
     }
     return status;
 }
 
+status_t KeyCharacterMap::loadCompiled(const String8& path, const String8& sourceFilename,
+        Format format, sp<KeyCharacterMap>* outMap) {
+    outMap->clear();
+
+    CompiledKeymapReader reader;
+    status_t status = reader.open(path, COMPILED_KEYMAP_KIND_KEY_CHARACTER_MAP, sourceFilename);
+    if (status) {
+        return status;
+    }
+
+#if DEBUG_PARSER_PERFORMANCE
+    nsecs_t startTime = systemTime(SYSTEM_TIME_MONOTONIC);
+#endif
+    status = readCompiled(reader, format, outMap);
+#if DEBUG_PARSER_PERFORMANCE
+    nsecs_t elapsedTime = systemTime(SYSTEM_TIME_MONOTONIC) - startTime;
+    ALOGD("Loaded compiled key character map '%s' in %0.3fms.",
+            path.string(), elapsedTime / 1000000.0);
+#endif
+    return status;
+}
+
+status_t KeyCharacterMap::loadCompiledWords(const Vector<int32_t>& words,
+        sp<KeyCharacterMap>* outMap) {
+    outMap->clear();
+
+    CompiledKeymapReader reader;
+    reader.openWords(words.array(), words.size());
+    return readCompiled(reader, FORMAT_ANY, outMap);
+}
+
+status_t KeyCharacterMap::readCompiled(CompiledKeymapReader& reader, Format format,
+        sp<KeyCharacterMap>* outMap) {
+    sp<KeyCharacterMap> map = new KeyCharacterMap();
+    int32_t numKeys;
+    if (!reader.readInt32(&map->mType) || !reader.readInt32(&numKeys)) {
+        return INVALID_OPERATION;
+    }
+
+    // The format only restricts the keyboard type, check it the same way the parser does.
+    if (map->mType == KEYBOARD_TYPE_UNKNOWN
+            || (format == FORMAT_BASE && map->mType == KEYBOARD_TYPE_OVERLAY)
+            || (format == FORMAT_OVERLAY && map->mType != KEYBOARD_TYPE_OVERLAY)) {
+        return INVALID_OPERATION;
+    }
+
+    while (numKeys-- > 0) {
+        int32_t keyCode, label, number, numBehaviors;
+        if (!reader.readInt32(&keyCode) || !reader.readInt32(&label)
+                || !reader.readInt32(&number) || !reader.readInt32(&numBehaviors)) {
+            return INVALID_OPERATION;
+        }
+
+        Key* key = new Key();
+        key->label = label;
+        key->number = number;
+        map->mKeys.add(keyCode, key);
+
+        Behavior* lastBehavior = NULL;
+        while (numBehaviors-- > 0) {
+            int32_t metaState, character, fallbackKeyCode;
+            if (!reader.readInt32(&metaState) || !reader.readInt32(&character)
+                    || !reader.readInt32(&fallbackKeyCode)) {
+                return INVALID_OPERATION;
+            }
+
+            Behavior* behavior = new Behavior();
+            behavior->metaState = metaState;
+            behavior->character = character;
+            behavior->fallbackKeyCode = fallbackKeyCode;
+            if (lastBehavior) {
+                lastBehavior->next = behavior;
+            } else {
+                key->firstBehavior = behavior;
+            }
+            lastBehavior = behavior;
+        }
+    }
+
+    KeyedVector<int32_t, int32_t>* keyMaps[] = { &map->mKeysByScanCode, &map->mKeysByUsageCode };
+    for (size_t i = 0; i < sizeof(keyMaps) / sizeof(keyMaps[0]); i++) {
+        int32_t count;
+        if (!reader.readInt32(&count)) {
+            return INVALID_OPERATION;
+        }
+        while (count-- > 0) {
+            int32_t code, keyCode;
+            if (!reader.readInt32(&code) || !reader.readInt32(&keyCode)) {
+                return INVALID_OPERATION;
+            }
+            keyMaps[i]->add(code, keyCode);
+        }
+    }
+    if (!reader.isEof()) {
+        return INVALID_OPERATION;
+    }
+
+    map->buildCharacterIndex();
+    *outMap = map;
+    return OK;
+}
+
+status_t KeyCharacterMap::writeCompiled(const String8& path,
+        const String8& sourceFilename) const {
+    CompiledKeymapWriter writer(COMPILED_KEYMAP_KIND_KEY_CHARACTER_MAP);
+    writeCompiled(writer);
+    return writer.writeToFile(path, sourceFilename);
+}
+
+void KeyCharacterMap::getCompiledWords(Vector<int32_t>* outWords) const {
+    CompiledKeymapWriter writer(COMPILED_KEYMAP_KIND_KEY_CHARACTER_MAP);
+    writeCompiled(writer);
+    *outWords = writer.getWords();
+}
+
+void KeyCharacterMap::writeCompiled(CompiledKeymapWriter& writer) const {
+    writer.writeInt32(mType);
+
+    size_t numKeys = mKeys.size();
+    writer.writeInt32(numKeys);
+    for (size_t i = 0; i < numKeys; i++) {
+        const Key* key = mKeys.valueAt(i);
+        size_t numBehaviors = 0;
+        for (const Behavior* behavior = key->firstBehavior; behavior;
+                behavior = behavior->next) {
+            numBehaviors += 1;
+        }
+
+        writer.writeInt32(mKeys.keyAt(i));
+        writer.writeInt32(key->label);
+        writer.writeInt32(key->number);
+        writer.writeInt32(numBehaviors);
+        for (const Behavior* behavior = key->firstBehavior; behavior;
+                behavior = behavior->next) {
+            writer.writeInt32(behavior->metaState);
+            writer.writeInt32(behavior->character);
+            writer.writeInt32(behavior->fallbackKeyCode);
+        }
+    }
+
+    const KeyedVector<int32_t, int32_t>* keyMaps[] = { &mKeysByScanCode, &mKeysByUsageCode };
+    for (size_t i = 0; i < sizeof(keyMaps) / sizeof(keyMaps[0]); i++) {
+        size_t count = keyMaps[i]->size();
+        writer.writeInt32(count);
+        for (size_t j = 0; j < count; j++) {
+            writer.writeInt32(keyMaps[i]->keyAt(j));
+            writer.writeInt32(keyMaps[i]->valueAt(j));
+        }
+    }
+}
+
 sp<KeyCharacterMap> KeyCharacterMap::combine(const sp<KeyCharacterMap>& base,
         const sp<KeyCharacterMap>& overlay) {
     if (overlay == NULL) {
@@ -191,6 +344,8 @@ sp<KeyCharacterMap> KeyCharacterMap::combine(const sp<KeyCharacterMap>& base,
         map->mKeysByUsageCode.replaceValueFor(overlay->mKeysByUsageCode.keyAt(i),
                 overlay->mKeysByUsageCode.valueAt(i));
     }
+
+    map->buildCharacterIndex();
     return map;
 }
 
@@ -419,24 +574,44 @@ bool KeyCharacterMap::findKey(char16_t ch, int32_t* outKeyCode, int32_t* outMeta
         return false;
     }
 
+    ssize_t index = mKeysByCharacter.indexOfKey(ch);
+    if (index < 0) {
+        return false;
+    }
+
+    const CharacterKey& characterKey = mKeysByCharacter.valueAt(index);
+    *outKeyCode = characterKey.keyCode;
+    *outMetaState = characterKey.metaState;
+    return true;
+}
+
+void KeyCharacterMap::buildCharacterIndex() {
+    mKeysByCharacter.clear();
+
     for (size_t i = 0; i < mKeys.size(); i++) {
+        int32_t keyCode = mKeys.keyAt(i);
         const Key* key = mKeys.valueAt(i);
 
-        // Try to find the most general behavior that maps to this character.
-        // For example, the base key behavior will usually be last in the list.
-        const Behavior* found = NULL;
+        // A character maps to the first key that generates it, using the most general
+        // behavior of that key.  For example, the base key behavior will usually be last
+        // in the list so it replaces any more specific behavior of the same key.
         for (const Behavior* behavior = key->firstBehavior; behavior; behavior = behavior->next) {
-            if (behavior->character == ch) {
-                found = behavior;
+            if (!behavior->character) {
+                continue;
+            }
+
+            CharacterKey characterKey;
+            characterKey.keyCode = keyCode;
+            characterKey.metaState = behavior->metaState;
+
+            ssize_t index = mKeysByCharacter.indexOfKey(behavior->character);
+            if (index < 0) {
+                mKeysByCharacter.add(behavior->character, characterKey);
+            } else if (mKeysByCharacter.valueAt(index).keyCode == keyCode) {
+                mKeysByCharacter.replaceValueAt(index, characterKey);
             }
-        }
-        if (found) {
-            *outKeyCode = mKeys.keyAt(i);
-            *outMetaState = found->metaState;
-            return true;
         }
     }
-    return false;
 }
 
 void KeyCharacterMap::addKey(Vector<KeyEvent>& outEvents,
@@ -602,6 +777,8 @@ sp<KeyCharacterMap> KeyCharacterMap::readFromParcel(Parcel* parcel) {
             return NULL;
         }
     }
+
+    map->buildCharacterIndex();
     return map;
 }
 
@@ -20,6 +20,7 @@
 #include <android/keycodes.h>
 #include <androidfw/Keyboard.h>
 #include <androidfw/KeyLayoutMap.h>
+#include <androidfw/KeymapCache.h>
 #include <utils/Log.h>
 #include <utils/Errors.h>
 #include <utils/Tokenizer.h>
@@ -72,6 +73,7 @@ status_t KeyLayoutMap::load(const String8& filename, sp<KeyLayoutMap>* outMap) {
                     elapsedTime / 1000000.0);
 #endif
             if (!status) {
+                map->buildScanCodeIndex();
                 *outMap = map;
             }
         }
@@ -80,6 +82,97 @@ status_t KeyLayoutMap::load(const String8& filename, sp<KeyLayoutMap>* outMap) {
     return status;
 }
 
+status_t KeyLayoutMap::loadCompiled(const String8& path, const String8& sourceFilename,
+        sp<KeyLayoutMap>* outMap) {
+    outMap->clear();
+
+    CompiledKeymapReader reader;
+    status_t status = reader.open(path, COMPILED_KEYMAP_KIND_KEY_LAYOUT, sourceFilename);
+    if (status) {
+        return status;
+    }
+
+#if DEBUG_PARSER_PERFORMANCE
+    nsecs_t startTime = systemTime(SYSTEM_TIME_MONOTONIC);
+#endif
+    sp<KeyLayoutMap> map = new KeyLayoutMap();
+    KeyedVector<int32_t, Key>* keyMaps[] = { &map->mKeysByScanCode, &map->mKeysByUsageCode };
+    for (size_t i = 0; i < sizeof(keyMaps) / sizeof(keyMaps[0]); i++) {
+        int32_t count;
+        if (!reader.readInt32(&count)) {
+            return INVALID_OPERATION;
+        }
+        while (count-- > 0) {
+            int32_t code, keyCode, flags;
+            if (!reader.readInt32(&code) || !reader.readInt32(&keyCode)
+                    || !reader.readInt32(&flags)) {
+                return INVALID_OPERATION;
+            }
+            Key key;
+            key.keyCode = keyCode;
+            key.flags = uint32_t(flags);
+            keyMaps[i]->add(code, key);
+        }
+    }
+
+    int32_t axisCount;
+    if (!reader.readInt32(&axisCount)) {
+        return INVALID_OPERATION;
+    }
+    while (axisCount-- > 0) {
+        int32_t scanCode, mode;
+        AxisInfo axisInfo;
+        if (!reader.readInt32(&scanCode) || !reader.readInt32(&mode)
+                || !reader.readInt32(&axisInfo.axis) || !reader.readInt32(&axisInfo.highAxis)
+                || !reader.readInt32(&axisInfo.splitValue)
+                || !reader.readInt32(&axisInfo.flatOverride)) {
+            return INVALID_OPERATION;
+        }
+        axisInfo.mode = AxisInfo::Mode(mode);
+        map->mAxes.add(scanCode, axisInfo);
+    }
+    if (!reader.isEof()) {
+        return INVALID_OPERATION;
+    }
+#if DEBUG_PARSER_PERFORMANCE
+    nsecs_t elapsedTime = systemTime(SYSTEM_TIME_MONOTONIC) - startTime;
+    ALOGD("Loaded compiled key layout map '%s' in %0.3fms.",
+            path.string(), elapsedTime / 1000000.0);
+#endif
+
+    map->buildScanCodeIndex();
+    *outMap = map;
+    return NO_ERROR;
+}
+
+status_t KeyLayoutMap::writeCompiled(const String8& path, const String8& sourceFilename) const {
+    CompiledKeymapWriter writer(COMPILED_KEYMAP_KIND_KEY_LAYOUT);
+    const KeyedVector<int32_t, Key>* keyMaps[] = { &mKeysByScanCode, &mKeysByUsageCode };
+    for (size_t i = 0; i < sizeof(keyMaps) / sizeof(keyMaps[0]); i++) {
+        size_t count = keyMaps[i]->size();
+        writer.writeInt32(count);
+        for (size_t j = 0; j < count; j++) {
+            const Key& key = keyMaps[i]->valueAt(j);
+            writer.writeInt32(keyMaps[i]->keyAt(j));
+            writer.writeInt32(key.keyCode);
+            writer.writeInt32(key.flags);
+        }
+    }
+
+    size_t axisCount = mAxes.size();
+    writer.writeInt32(axisCount);
+    for (size_t i = 0; i < axisCount; i++) {
+        const AxisInfo& axisInfo = mAxes.valueAt(i);
+        writer.writeInt32(mAxes.keyAt(i));
+        writer.writeInt32(axisInfo.mode);
+        writer.writeInt32(axisInfo.axis);
+        writer.writeInt32(axisInfo.highAxis);
+        writer.writeInt32(axisInfo.splitValue);
+        writer.writeInt32(axisInfo.flatOverride);
+    }
+    return writer.writeToFile(path, sourceFilename);
+}
+
 status_t KeyLayoutMap::mapKey(int32_t scanCode, int32_t usageCode,
         int32_t* outKeyCode, uint32_t* outFlags) const {
     const Key* key = getKey(scanCode, usageCode);
@@ -119,13 +212,26 @@ const KeyLayoutMap::Key* KeyLayoutMap::getKey(int32_t scanCode, int32_t usageCod
 }
 
 status_t KeyLayoutMap::findScanCodesForKey(int32_t keyCode, Vector<int32_t>* outScanCodes) const {
+    ssize_t index = mScanCodesByKeyCode.indexOfKey(keyCode);
+    if (index >= 0) {
+        outScanCodes->appendVector(mScanCodesByKeyCode.valueAt(index));
+    }
+    return NO_ERROR;
+}
+
+void KeyLayoutMap::buildScanCodeIndex() {
+    mScanCodesByKeyCode.clear();
+
+    // Scan codes are visited in ascending order so each list ends up sorted.
     const size_t N = mKeysByScanCode.size();
     for (size_t i=0; i<N; i++) {
-        if (mKeysByScanCode.valueAt(i).keyCode == keyCode) {
-            outScanCodes->add(mKeysByScanCode.keyAt(i));
+        int32_t keyCode = mKeysByScanCode.valueAt(i).keyCode;
+        ssize_t index = mScanCodesByKeyCode.indexOfKey(keyCode);
+        if (index < 0) {
+            index = mScanCodesByKeyCode.add(keyCode, Vector<int32_t>());
         }
+        mScanCodesByKeyCode.editValueAt(index).push(mKeysByScanCode.keyAt(i));
     }
-    return NO_ERROR;
 }
 
 status_t KeyLayoutMap::mapAxis(int32_t scanCode, AxisInfo* outAxisInfo) const {
@@ -24,6 +24,7 @@
 #include <androidfw/KeycodeLabels.h>
 #include <androidfw/KeyLayoutMap.h>
 #include <androidfw/KeyCharacterMap.h>
+#include <androidfw/KeymapCache.h>
 #include <androidfw/InputDevice.h>
 #include <utils/Errors.h>
 #include <utils/Log.h>
@@ -31,6 +32,15 @@
 
 namespace android {
 
+static String8 getPrebuiltCompiledKeymapPath(const String8& path) {
+    return getCompiledKeymapPath(getPrebuiltCompiledKeymapDirectory(), path);
+}
+
+static String8 getRuntimeCompiledKeymapPath(const String8& path) {
+    return getCompiledKeymapPath(getCompiledKeymapDirectory(), path);
+}
+
+
 // --- KeyMap ---
 
 KeyMap::KeyMap() {
@@ -112,9 +122,20 @@ status_t KeyMap::loadKeyLayout(const InputDeviceIdentifier& deviceIdentifier,
         return NAME_NOT_FOUND;
     }
 
-    status_t status = KeyLayoutMap::load(path, &keyLayoutMap);
+    // Prefer a compiled key layout, then fall back on parsing the source and
+    // compiling it for next time.
+    status_t status = KeyLayoutMap::loadCompiled(getPrebuiltCompiledKeymapPath(path),
+            path, &keyLayoutMap);
     if (status) {
-        return status;
+        status = KeyLayoutMap::loadCompiled(getRuntimeCompiledKeymapPath(path),
+                path, &keyLayoutMap);
+    }
+    if (status) {
+        status = KeyLayoutMap::load(path, &keyLayoutMap);
+        if (status) {
+            return status;
+        }
+        keyLayoutMap->writeCompiled(getRuntimeCompiledKeymapPath(path), path);
     }
 
     keyLayoutFile.setTo(path);
@@ -129,10 +150,21 @@ status_t KeyMap::loadKeyCharacterMap(const InputDeviceIdentifier& deviceIdentifi
         return NAME_NOT_FOUND;
     }
 
-    status_t status = KeyCharacterMap::load(path,
-            KeyCharacterMap::FORMAT_BASE, &keyCharacterMap);
+    // Prefer a compiled key character map, then fall back on parsing the source and
+    // compiling it for next time.
+    status_t status = KeyCharacterMap::loadCompiled(getPrebuiltCompiledKeymapPath(path),
+            path, KeyCharacterMap::FORMAT_BASE, &keyCharacterMap);
     if (status) {
-        return status;
+        status = KeyCharacterMap::loadCompiled(getRuntimeCompiledKeymapPath(path),
+                path, KeyCharacterMap::FORMAT_BASE, &keyCharacterMap);
+    }
+    if (status) {
+        status = KeyCharacterMap::load(path,
+                KeyCharacterMap::FORMAT_BASE, &keyCharacterMap);
+        if (status) {
+            return status;
+        }
+        keyCharacterMap->writeCompiled(getRuntimeCompiledKeymapPath(path), path);
     }
 
     keyCharacterMapFile.setTo(path);
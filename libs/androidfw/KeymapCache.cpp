@@ -0,0 +1,303 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "KeymapCache"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <androidfw/KeymapCache.h>
+#include <utils/Log.h>
+
+// Enables debug output for the cache.
+#define DEBUG_CACHE 0
+
+
+namespace android {
+
+static const char COMPILED_KEYMAP_MAGIC[4] = { 'A', 'K', 'M', 'C' };
+
+// Must be incremented whenever the layout of any kind of compiled keymap changes.
+static const uint32_t COMPILED_KEYMAP_VERSION = 2;
+
+struct CompiledKeymapHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t kind;
+    uint32_t wordCount;
+    uint64_t sourceContentHash;
+};
+
+// 64-bit FNV-1a.
+static const uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ULL;
+static const uint64_t FNV_PRIME = 0x100000001b3ULL;
+
+static status_t hashFile(const String8& path, uint64_t* outHash) {
+    int fd = open(path.string(), O_RDONLY);
+    if (fd < 0) {
+        return -errno;
+    }
+
+    uint64_t hash = FNV_OFFSET_BASIS;
+    uint8_t buffer[4096];
+    status_t status = OK;
+    for (;;) {
+        ssize_t count = read(fd, buffer, sizeof(buffer));
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            status = -errno;
+            break;
+        }
+        if (count == 0) {
+            break;
+        }
+        for (ssize_t i = 0; i < count; i++) {
+            hash = (hash ^ buffer[i]) * FNV_PRIME;
+        }
+    }
+    close(fd);
+
+    *outHash = hash;
+    return status;
+}
+
+// Creates a directory and any missing parent directories, like mkdir -p.
+static status_t createDirectories(const String8& path) {
+    String8 partialPath;
+    const char* start = path.string();
+    for (const char* c = start; ; c++) {
+        if ((*c == '/' || !*c) && c != start) {
+            partialPath.setTo(start, c - start);
+            if (mkdir(partialPath.string(), 0771) && errno != EEXIST) {
+                return -errno;
+            }
+        }
+        if (!*c) {
+            break;
+        }
+    }
+    return OK;
+}
+
+
+// --- CompiledKeymapWriter ---
+
+CompiledKeymapWriter::CompiledKeymapWriter(CompiledKeymapKind kind) :
+        mKind(kind) {
+}
+
+status_t CompiledKeymapWriter::writeToFile(const String8& path,
+        const String8& sourcePath) const {
+    if (path.isEmpty()) {
+        return BAD_VALUE;
+    }
+
+    uint64_t sourceContentHash;
+    status_t status = hashFile(sourcePath, &sourceContentHash);
+    if (status) {
+        ALOGW("Could not read keymap source file '%s' to compile it.", sourcePath.string());
+        return status;
+    }
+
+    CompiledKeymapHeader header;
+    memcpy(header.magic, COMPILED_KEYMAP_MAGIC, sizeof(header.magic));
+    header.version = COMPILED_KEYMAP_VERSION;
+    header.kind = mKind;
+    header.wordCount = mWords.size();
+    header.sourceContentHash = sourceContentHash;
+
+    String8 directory(path.getPathDir());
+    if (!directory.isEmpty()) {
+        status = createDirectories(directory);
+        if (status) {
+            ALOGW("Could not create compiled keymap directory '%s', errno=%d.",
+                    directory.string(), -status);
+            return status;
+        }
+    }
+
+    // Write to a temporary file first so that readers never see a partial keymap.
+    // The name is unique so that concurrent writers do not clobber each other's file.
+    String8 tempPath(path);
+    tempPath.append(".XXXXXX");
+    char* tempPathBuffer = tempPath.lockBuffer(tempPath.size());
+    int fd = mkstemp(tempPathBuffer);
+    tempPath.unlockBuffer();
+    if (fd < 0) {
+        status = -errno;
+        ALOGW("Could not create compiled keymap '%s', errno=%d.", tempPath.string(), -status);
+        return status;
+    }
+    fchmod(fd, 0644);
+    FILE* file = fdopen(fd, "wb");
+    if (!file) {
+        status = -errno;
+        ALOGW("Could not create compiled keymap '%s', errno=%d.", tempPath.string(), -status);
+        close(fd);
+        unlink(tempPath.string());
+        return status;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    if (ok && header.wordCount) {
+        ok = fwrite(mWords.array(), sizeof(int32_t), header.wordCount, file)
+                == header.wordCount;
+    }
+    ok = !fclose(file) && ok;
+    if (!ok || rename(tempPath.string(), path.string())) {
+        ALOGW("Could not write compiled keymap '%s', errno=%d.", path.string(), errno);
+        unlink(tempPath.string());
+        return UNKNOWN_ERROR;
+    }
+
+#if DEBUG_CACHE
+    ALOGD("Compiled keymap '%s' to '%s', %d words.", sourcePath.string(), path.string(),
+            header.wordCount);
+#endif
+    return OK;
+}
+
+
+// --- CompiledKeymapReader ---
+
+CompiledKeymapReader::CompiledKeymapReader() :
+        mFileMap(NULL), mNext(NULL), mEnd(NULL) {
+}
+
+CompiledKeymapReader::~CompiledKeymapReader() {
+    if (mFileMap) {
+        mFileMap->release();
+    }
+}
+
+status_t CompiledKeymapReader::open(const String8& path, CompiledKeymapKind kind,
+        const String8& sourcePath) {
+    if (path.isEmpty()) {
+        return NAME_NOT_FOUND;
+    }
+
+    int fd = ::open(path.string(), O_RDONLY);
+    if (fd < 0) {
+        return NAME_NOT_FOUND;
+    }
+
+    status_t status = INVALID_OPERATION;
+    struct stat st;
+    if (!fstat(fd, &st) && size_t(st.st_size) >= sizeof(CompiledKeymapHeader)) {
+        FileMap* fileMap = new FileMap();
+        if (fileMap->create(NULL, fd, 0, st.st_size, true)) {
+            mFileMap = fileMap;
+            status = OK;
+        } else {
+            fileMap->release();
+        }
+    }
+    close(fd);
+    if (status) {
+        return status;
+    }
+
+    const CompiledKeymapHeader* header =
+            static_cast<const CompiledKeymapHeader*>(mFileMap->getDataPtr());
+    size_t wordCount = (mFileMap->getDataLength() - sizeof(CompiledKeymapHeader))
+            / sizeof(int32_t);
+    if (memcmp(header->magic, COMPILED_KEYMAP_MAGIC, sizeof(header->magic))
+            || header->version != COMPILED_KEYMAP_VERSION
+            || header->kind != uint32_t(kind)
+            || header->wordCount != wordCount) {
+        ALOGW("Ignoring malformed or outdated compiled keymap '%s'.", path.string());
+        return INVALID_OPERATION;
+    }
+
+    // Only the contents of the source file matter.  Its modification time is not
+    // preserved when it is copied, and a size and time check could miss an edit.
+    uint64_t sourceContentHash;
+    if (hashFile(sourcePath, &sourceContentHash)
+            || sourceContentHash != header->sourceContentHash) {
+#if DEBUG_CACHE
+        ALOGD("Compiled keymap '%s' is stale.", path.string());
+#endif
+        return INVALID_OPERATION;
+    }
+
+    mNext = reinterpret_cast<const int32_t*>(header + 1);
+    mEnd = mNext + wordCount;
+    return OK;
+}
+
+void CompiledKeymapReader::openWords(const int32_t* words, size_t wordCount) {
+    mNext = words;
+    mEnd = words + wordCount;
+}
+
+
+// --- Global functions ---
+
+String8 getCompiledKeymapPath(const String8& directory, const String8& sourcePath) {
+    if (directory.isEmpty()) {
+        return String8();
+    }
+
+    // Flatten the source path like the dalvik-cache does.
+    const char* name = sourcePath.string();
+    while (*name == '/') {
+        name += 1;
+    }
+    String8 flattenedName(name);
+    char* buffer = flattenedName.lockBuffer(flattenedName.size());
+    for (char* c = buffer; *c; c++) {
+        if (*c == '/') {
+            *c = '@';
+        }
+    }
+    flattenedName.unlockBuffer();
+
+    String8 path(directory);
+    path.append("/");
+    path.append(flattenedName);
+    path.append("@compiled");
+    return path;
+}
+
+String8 getPrebuiltCompiledKeymapDirectory() {
+    const char* root = getenv("ANDROID_ROOT");
+    if (!root) {
+        return String8();
+    }
+    String8 path(root);
+    path.append("/usr/keymapcache");
+    return path;
+}
+
+String8 getCompiledKeymapDirectory() {
+    const char* data = getenv("ANDROID_DATA");
+    if (!data) {
+        return String8();
+    }
+    String8 path(data);
+    path.append("/system/keymapcache");
+    return path;
+}
+
+} // namespace android
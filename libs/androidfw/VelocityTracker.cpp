@@ -33,6 +33,12 @@
 
 #include <cutils/properties.h>
 
+#if defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
 namespace android {
 
 // Nanoseconds per milliseconds.
@@ -45,21 +51,84 @@ static const nsecs_t NANOS_PER_MS = 1000000;
 static const nsecs_t ASSUME_POINTER_STOPPED_TIME = 40 * NANOS_PER_MS;
 
 
+// The vector functions below operate on vectors whose length is a multiple of
+// VECTOR_LANES, padded with zeroes as needed, so that they need no scalar tail.
+// The lanes are summed in the same order on every architecture so that NEON, SSE
+// and the scalar fallback produce identical results.
+static const uint32_t VECTOR_LANES = 4;
+
+static inline uint32_t padToVectorLanes(uint32_t m) {
+    return (m + VECTOR_LANES - 1) & ~(VECTOR_LANES - 1);
+}
+
 static float vectorDot(const float* a, const float* b, uint32_t m) {
-    float r = 0;
-    while (m--) {
-        r += *(a++) * *(b++);
-    }
-    return r;
+#if defined(__ARM_NEON__)
+    float32x4_t sum = vdupq_n_f32(0);
+    for (uint32_t h = 0; h < m; h += VECTOR_LANES) {
+        sum = vmlaq_f32(sum, vld1q_f32(a + h), vld1q_f32(b + h));
+    }
+    float32x2_t pair = vadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+    return vget_lane_f32(vpadd_f32(pair, pair), 0);
+#elif defined(__SSE__)
+    __m128 sum = _mm_setzero_ps();
+    for (uint32_t h = 0; h < m; h += VECTOR_LANES) {
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(a + h), _mm_loadu_ps(b + h)));
+    }
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+#else
+    float r0 = 0, r1 = 0, r2 = 0, r3 = 0;
+    for (uint32_t h = 0; h < m; h += VECTOR_LANES) {
+        r0 += a[h] * b[h];
+        r1 += a[h + 1] * b[h + 1];
+        r2 += a[h + 2] * b[h + 2];
+        r3 += a[h + 3] * b[h + 3];
+    }
+    return (r0 + r2) + (r1 + r3);
+#endif
 }
 
 static float vectorNorm(const float* a, uint32_t m) {
-    float r = 0;
-    while (m--) {
-        float t = *(a++);
-        r += t * t;
+    return sqrtf(vectorDot(a, a, m));
+}
+
+// Computes a -= s * b.
+static void vectorMultiplySubtract(float* a, const float* b, float s, uint32_t m) {
+#if defined(__ARM_NEON__)
+    float32x4_t sv = vdupq_n_f32(s);
+    for (uint32_t h = 0; h < m; h += VECTOR_LANES) {
+        vst1q_f32(a + h, vmlsq_f32(vld1q_f32(a + h), vld1q_f32(b + h), sv));
+    }
+#elif defined(__SSE__)
+    __m128 sv = _mm_set1_ps(s);
+    for (uint32_t h = 0; h < m; h += VECTOR_LANES) {
+        _mm_storeu_ps(a + h, _mm_sub_ps(_mm_loadu_ps(a + h),
+                _mm_mul_ps(_mm_loadu_ps(b + h), sv)));
     }
-    return sqrtf(r);
+#else
+    for (uint32_t h = 0; h < m; h++) {
+        a[h] -= s * b[h];
+    }
+#endif
+}
+
+// Computes a *= s.
+static void vectorScale(float* a, float s, uint32_t m) {
+#if defined(__ARM_NEON__)
+    for (uint32_t h = 0; h < m; h += VECTOR_LANES) {
+        vst1q_f32(a + h, vmulq_n_f32(vld1q_f32(a + h), s));
+    }
+#elif defined(__SSE__)
+    __m128 sv = _mm_set1_ps(s);
+    for (uint32_t h = 0; h < m; h += VECTOR_LANES) {
+        _mm_storeu_ps(a + h, _mm_mul_ps(_mm_loadu_ps(a + h), sv));
+    }
+#else
+    for (uint32_t h = 0; h < m; h++) {
+        a[h] *= s;
+    }
+#endif
 }
 
 #if DEBUG_STRATEGY || DEBUG_VELOCITY
@@ -310,27 +379,27 @@ void VelocityTracker::addMovement(const MotionEvent* event) {
         pointerIndex[i] = idBits.getIndexOfBit(event->getPointerId(i));
     }
 
-    nsecs_t eventTime;
-    Position positions[pointerCount];
+    // Read the coordinates of each pointer for all samples at once.  The copy is
+    // kept in a member so that long batches do not need any stack space.
+    mSamples.setTo(event);
+    const float* x[MAX_POINTERS];
+    const float* y[MAX_POINTERS];
+    for (size_t i = 0; i < pointerCount; i++) {
+        x[i] = mSamples.getAxisValues(AMOTION_EVENT_AXIS_X, i);
+        y[i] = mSamples.getAxisValues(AMOTION_EVENT_AXIS_Y, i);
+    }
 
-    size_t historySize = event->getHistorySize();
-    for (size_t h = 0; h < historySize; h++) {
-        eventTime = event->getHistoricalEventTime(h);
+    size_t sampleCount = mSamples.getSampleCount();
+    const nsecs_t* eventTimes = mSamples.getEventTimes();
+    Position positions[MAX_POINTERS];
+    for (size_t h = 0; h < sampleCount; h++) {
         for (size_t i = 0; i < pointerCount; i++) {
             uint32_t index = pointerIndex[i];
-            positions[index].x = event->getHistoricalX(i, h);
-            positions[index].y = event->getHistoricalY(i, h);
+            positions[index].x = x[i][h];
+            positions[index].y = y[i][h];
         }
-        addMovement(eventTime, idBits, positions);
-    }
-
-    eventTime = event->getEventTime();
-    for (size_t i = 0; i < pointerCount; i++) {
-        uint32_t index = pointerIndex[i];
-        positions[index].x = event->getX(i);
-        positions[index].y = event->getY(i);
+        addMovement(eventTimes[h], idBits, positions);
     }
-    addMovement(eventTime, idBits, positions);
 }
 
 bool VelocityTracker::getVelocity(uint32_t id, float* outVx, float* outVy) const {
@@ -389,6 +458,40 @@ void LeastSquaresVelocityTrackerStrategy::addMovement(nsecs_t eventTime, BitSet3
     }
 }
 
+/*
+ * Calculates the coefficient of determination as 1 - (SSerr / SStot) where
+ * SSerr is the residual sum of squares (variance of the error),
+ * and SStot is the total sum of squares (variance of the data) where each
+ * has been weighted.
+ */
+static float computeCoefficientOfDetermination(const float* x, const float* y,
+        const float* w, uint32_t m, uint32_t n, const float* b) {
+    float ymean = 0;
+    for (uint32_t h = 0; h < m; h++) {
+        ymean += y[h];
+    }
+    ymean /= m;
+
+    float sserr = 0;
+    float sstot = 0;
+    for (uint32_t h = 0; h < m; h++) {
+        float err = y[h] - b[0];
+        float term = 1;
+        for (uint32_t i = 1; i < n; i++) {
+            term *= x[h];
+            err -= term * b[i];
+        }
+        sserr += w[h] * w[h] * err * err;
+        float var = y[h] - ymean;
+        sstot += w[h] * w[h] * var * var;
+    }
+#if DEBUG_STRATEGY
+    ALOGD("  - sserr=%f", sserr);
+    ALOGD("  - sstot=%f", sstot);
+#endif
+    return sstot > 0.000001f ? 1.0f - (sserr / sstot) : 1;
+}
+
 /**
  * Solves a linear least squares problem to obtain a N degree polynomial that fits
  * the specified input data as nearly as possible.
@@ -433,46 +536,52 @@ void LeastSquaresVelocityTrackerStrategy::addMovement(nsecs_t eventTime, BitSet3
  * to find B.
  *
  * For efficiency, we lay out A and Q column-wise in memory because we frequently
- * operate on the column vectors.  Conversely, we lay out R row-wise.
+ * operate on the column vectors.  Conversely, we lay out R row-wise.  The columns
+ * are padded with zeroes to a multiple of VECTOR_LANES so they can be processed
+ * with SIMD instructions.
+ *
+ * Since A only depends on X and W, its decomposition is shared by all of the Y
+ * vectors that are fitted against the same X, so this function solves for the
+ * polynomials of the two vectors Y0 and Y1 at once.
  *
  * http://en.wikipedia.org/wiki/Numerical_methods_for_linear_least_squares
  * http://en.wikipedia.org/wiki/Gram-Schmidt
  */
-static bool solveLeastSquares(const float* x, const float* y,
-        const float* w, uint32_t m, uint32_t n, float* outB, float* outDet) {
+static bool solveLeastSquares(const float* x, const float* y0, const float* y1,
+        const float* w, uint32_t m, uint32_t n,
+        float* outB0, float* outB1, float* outDet0, float* outDet1) {
 #if DEBUG_STRATEGY
-    ALOGD("solveLeastSquares: m=%d, n=%d, x=%s, y=%s, w=%s", int(m), int(n),
-            vectorToString(x, m).string(), vectorToString(y, m).string(),
-            vectorToString(w, m).string());
+    ALOGD("solveLeastSquares: m=%d, n=%d, x=%s, y0=%s, y1=%s, w=%s", int(m), int(n),
+            vectorToString(x, m).string(), vectorToString(y0, m).string(),
+            vectorToString(y1, m).string(), vectorToString(w, m).string());
 #endif
 
     // Expand the X vector to a matrix A, pre-multiplied by the weights.
-    float a[n][m]; // column-major order
-    for (uint32_t h = 0; h < m; h++) {
-        a[0][h] = w[h];
+    const uint32_t mp = padToVectorLanes(m);
+    float a[n][mp]; // column-major order
+    for (uint32_t h = 0; h < mp; h++) {
+        a[0][h] = h < m ? w[h] : 0;
         for (uint32_t i = 1; i < n; i++) {
-            a[i][h] = a[i - 1][h] * x[h];
+            a[i][h] = h < m ? a[i - 1][h] * x[h] : 0;
         }
     }
 #if DEBUG_STRATEGY
-    ALOGD("  - a=%s", matrixToString(&a[0][0], m, n, false /*rowMajor*/).string());
+    ALOGD("  - a=%s", matrixToString(&a[0][0], mp, n, false /*rowMajor*/).string());
 #endif
 
     // Apply the Gram-Schmidt process to A to obtain its QR decomposition.
-    float q[n][m]; // orthonormal basis, column-major order
+    float q[n][mp]; // orthonormal basis, column-major order
     float r[n][n]; // upper triangular matrix, row-major order
     for (uint32_t j = 0; j < n; j++) {
-        for (uint32_t h = 0; h < m; h++) {
+        for (uint32_t h = 0; h < mp; h++) {
             q[j][h] = a[j][h];
         }
         for (uint32_t i = 0; i < j; i++) {
-            float dot = vectorDot(&q[j][0], &q[i][0], m);
-            for (uint32_t h = 0; h < m; h++) {
-                q[j][h] -= dot * q[i][h];
-            }
+            float dot = vectorDot(&q[j][0], &q[i][0], mp);
+            vectorMultiplySubtract(&q[j][0], &q[i][0], dot, mp);
         }
 
-        float norm = vectorNorm(&q[j][0], m);
+        float norm = vectorNorm(&q[j][0], mp);
         if (norm < 0.000001f) {
             // vectors are linearly dependent or zero so no solution
 #if DEBUG_STRATEGY
@@ -481,21 +590,18 @@ static bool solveLeastSquares(const float* x, const float* y,
             return false;
         }
 
-        float invNorm = 1.0f / norm;
-        for (uint32_t h = 0; h < m; h++) {
-            q[j][h] *= invNorm;
-        }
+        vectorScale(&q[j][0], 1.0f / norm, mp);
         for (uint32_t i = 0; i < n; i++) {
-            r[j][i] = i < j ? 0 : vectorDot(&q[j][0], &a[i][0], m);
+            r[j][i] = i < j ? 0 : vectorDot(&q[j][0], &a[i][0], mp);
         }
     }
 #if DEBUG_STRATEGY
-    ALOGD("  - q=%s", matrixToString(&q[0][0], m, n, false /*rowMajor*/).string());
+    ALOGD("  - q=%s", matrixToString(&q[0][0], mp, n, false /*rowMajor*/).string());
     ALOGD("  - r=%s", matrixToString(&r[0][0], n, n, true /*rowMajor*/).string());
 
     // calculate QR, if we factored A correctly then QR should equal A
-    float qr[n][m];
-    for (uint32_t h = 0; h < m; h++) {
+    float qr[n][mp];
+    for (uint32_t h = 0; h < mp; h++) {
         for (uint32_t i = 0; i < n; i++) {
             qr[i][h] = 0;
             for (uint32_t j = 0; j < n; j++) {
@@ -503,54 +609,36 @@ static bool solveLeastSquares(const float* x, const float* y,
             }
         }
     }
-    ALOGD("  - qr=%s", matrixToString(&qr[0][0], m, n, false /*rowMajor*/).string());
+    ALOGD("  - qr=%s", matrixToString(&qr[0][0], mp, n, false /*rowMajor*/).string());
 #endif
 
     // Solve R B = Qt W Y to find B.  This is easy because R is upper triangular.
     // We just work from bottom-right to top-left calculating B's coefficients.
-    float wy[m];
-    for (uint32_t h = 0; h < m; h++) {
-        wy[h] = y[h] * w[h];
+    float wy0[mp];
+    float wy1[mp];
+    for (uint32_t h = 0; h < mp; h++) {
+        wy0[h] = h < m ? y0[h] * w[h] : 0;
+        wy1[h] = h < m ? y1[h] * w[h] : 0;
     }
     for (uint32_t i = n; i-- != 0; ) {
-        outB[i] = vectorDot(&q[i][0], wy, m);
+        outB0[i] = vectorDot(&q[i][0], wy0, mp);
+        outB1[i] = vectorDot(&q[i][0], wy1, mp);
         for (uint32_t j = n - 1; j > i; j--) {
-            outB[i] -= r[i][j] * outB[j];
+            outB0[i] -= r[i][j] * outB0[j];
+            outB1[i] -= r[i][j] * outB1[j];
         }
-        outB[i] /= r[i][i];
+        outB0[i] /= r[i][i];
+        outB1[i] /= r[i][i];
     }
 #if DEBUG_STRATEGY
-    ALOGD("  - b=%s", vectorToString(outB, n).string());
+    ALOGD("  - b0=%s", vectorToString(outB0, n).string());
+    ALOGD("  - b1=%s", vectorToString(outB1, n).string());
 #endif
 
-    // Calculate the coefficient of determination as 1 - (SSerr / SStot) where
-    // SSerr is the residual sum of squares (variance of the error),
-    // and SStot is the total sum of squares (variance of the data) where each
-    // has been weighted.
-    float ymean = 0;
-    for (uint32_t h = 0; h < m; h++) {
-        ymean += y[h];
-    }
-    ymean /= m;
-
-    float sserr = 0;
-    float sstot = 0;
-    for (uint32_t h = 0; h < m; h++) {
-        float err = y[h] - outB[0];
-        float term = 1;
-        for (uint32_t i = 1; i < n; i++) {
-            term *= x[h];
-            err -= term * outB[i];
-        }
-        sserr += w[h] * w[h] * err * err;
-        float var = y[h] - ymean;
-        sstot += w[h] * w[h] * var * var;
-    }
-    *outDet = sstot > 0.000001f ? 1.0f - (sserr / sstot) : 1;
+    *outDet0 = computeCoefficientOfDetermination(x, y0, w, m, n, outB0);
+    *outDet1 = computeCoefficientOfDetermination(x, y1, w, m, n, outB1);
 #if DEBUG_STRATEGY
-    ALOGD("  - sserr=%f", sserr);
-    ALOGD("  - sstot=%f", sstot);
-    ALOGD("  - det=%f", *outDet);
+    ALOGD("  - det0=%f, det1=%f", *outDet0, *outDet1);
 #endif
     return true;
 }
@@ -598,8 +686,8 @@ bool LeastSquaresVelocityTrackerStrategy::getEstimator(uint32_t id,
     if (degree >= 1) {
         float xdet, ydet;
         uint32_t n = degree + 1;
-        if (solveLeastSquares(time, x, w, m, n, outEstimator->xCoeff, &xdet)
-                && solveLeastSquares(time, y, w, m, n, outEstimator->yCoeff, &ydet)) {
+        if (solveLeastSquares(time, x, y, w, m, n,
+                outEstimator->xCoeff, outEstimator->yCoeff, &xdet, &ydet)) {
             outEstimator->time = newestMovement.eventTime;
             outEstimator->degree = degree;
             outEstimator->confidence = xdet * ydet;
@@ -7,7 +7,10 @@ test_src_files := \
     InputChannel_test.cpp \
     InputEvent_test.cpp \
     InputPublisherAndConsumer_test.cpp \
-    ObbFile_test.cpp
+    KeyCharacterMap_test.cpp \
+    KeymapCache_test.cpp \
+    ObbFile_test.cpp \
+    VelocityTracker_test.cpp
 
 shared_libraries := \
 	libandroidfw \
@@ -42,5 +45,19 @@ $(foreach file,$(test_src_files), \
     $(eval include $(BUILD_EXECUTABLE)) \
 )
 
+# Build the benchmarks.
+benchmark_src_files := \
+    VelocityTracker_benchmark.cpp
+
+$(foreach file,$(benchmark_src_files), \
+    $(eval include $(CLEAR_VARS)) \
+    $(eval LOCAL_SHARED_LIBRARIES := $(shared_libraries)) \
+    $(eval LOCAL_C_INCLUDES := $(c_includes)) \
+    $(eval LOCAL_SRC_FILES := $(file)) \
+    $(eval LOCAL_MODULE := $(notdir $(file:%.cpp=%))) \
+    $(eval LOCAL_MODULE_TAGS := $(module_tags)) \
+    $(eval include $(BUILD_EXECUTABLE)) \
+)
+
 # Build the manual test programs.
 include $(call all-makefiles-under, $(LOCAL_PATH))
@@ -519,6 +519,105 @@ TEST_F(MotionEventTest, Parcel) {
     ASSERT_NO_FATAL_FAILURE(assertEqualsEventWithHistory(&outEvent));
 }
 
+TEST_F(MotionEventTest, AddSamples) {
+    MotionEvent event;
+    initializeEventWithHistory(&event);
+
+    PointerCoords pointerCoords[4];
+    nsecs_t eventTimes[2] = { ARBITRARY_EVENT_TIME + 3, ARBITRARY_EVENT_TIME + 4 };
+    for (size_t i = 0; i < 4; i++) {
+        pointerCoords[i].clear();
+        pointerCoords[i].setAxisValue(AMOTION_EVENT_AXIS_X, 300 + i);
+        pointerCoords[i].setAxisValue(AMOTION_EVENT_AXIS_Y, 400 + i);
+    }
+    event.addSamples(2, eventTimes, pointerCoords);
+
+    ASSERT_EQ(4U, event.getHistorySize());
+    ASSERT_EQ(ARBITRARY_EVENT_TIME + 3, event.getHistoricalEventTime(3));
+    ASSERT_EQ(ARBITRARY_EVENT_TIME + 4, event.getEventTime());
+    ASSERT_EQ(301, event.getHistoricalRawX(1, 3));
+    ASSERT_EQ(402, event.getRawY(0));
+    ASSERT_EQ(403, event.getRawY(1));
+}
+
+TEST_F(MotionEventTest, GetHistoricalAxisValues) {
+    MotionEvent event;
+    initializeEventWithHistory(&event);
+
+    // The last sample has no pressure so the axes present change between samples.
+    PointerCoords pointerCoords[2];
+    pointerCoords[0].clear();
+    pointerCoords[0].setAxisValue(AMOTION_EVENT_AXIS_X, 310);
+    pointerCoords[0].setAxisValue(AMOTION_EVENT_AXIS_SIZE, 313);
+    pointerCoords[1].clear();
+    pointerCoords[1].setAxisValue(AMOTION_EVENT_AXIS_X, 320);
+    pointerCoords[1].setAxisValue(AMOTION_EVENT_AXIS_SIZE, 323);
+    event.addSample(ARBITRARY_EVENT_TIME + 3, pointerCoords);
+
+    const int32_t axes[] = { AMOTION_EVENT_AXIS_X, AMOTION_EVENT_AXIS_Y,
+            AMOTION_EVENT_AXIS_PRESSURE, AMOTION_EVENT_AXIS_SIZE,
+            AMOTION_EVENT_AXIS_VSCROLL };
+    float values[4];
+    for (size_t a = 0; a < sizeof(axes) / sizeof(axes[0]); a++) {
+        for (size_t i = 0; i < 2; i++) {
+            event.getHistoricalAxisValues(axes[a], i, values);
+            for (size_t h = 0; h < 4; h++) {
+                ASSERT_EQ(event.getHistoricalAxisValue(axes[a], i, h), values[h])
+                        << "axis=" << axes[a] << ", pointer=" << i << ", sample=" << h;
+            }
+        }
+    }
+}
+
+TEST_F(MotionEventTest, MotionEventSamples) {
+    Parcel parcel;
+
+    // Build the samples from a parceled event to check that they agree with
+    // the layout that is sent across processes.
+    MotionEvent inEvent;
+    initializeEventWithHistory(&inEvent);
+    inEvent.writeToParcel(&parcel);
+    parcel.setDataPosition(0);
+    MotionEvent event;
+    event.readFromParcel(&parcel);
+
+    MotionEventSamples samples;
+    samples.setTo(&event);
+
+    ASSERT_EQ(3U, samples.getSampleCount());
+    ASSERT_EQ(2U, samples.getPointerCount());
+    ASSERT_EQ(ARBITRARY_EVENT_TIME + 2, samples.getEventTimes()[2]);
+
+    const int32_t axes[] = { AMOTION_EVENT_AXIS_X, AMOTION_EVENT_AXIS_Y,
+            AMOTION_EVENT_AXIS_PRESSURE, AMOTION_EVENT_AXIS_SIZE,
+            AMOTION_EVENT_AXIS_TOUCH_MAJOR, AMOTION_EVENT_AXIS_TOUCH_MINOR,
+            AMOTION_EVENT_AXIS_TOOL_MAJOR, AMOTION_EVENT_AXIS_TOOL_MINOR,
+            AMOTION_EVENT_AXIS_ORIENTATION };
+    for (size_t a = 0; a < sizeof(axes) / sizeof(axes[0]); a++) {
+        ASSERT_TRUE(MotionEventSamples::hasAxis(axes[a]));
+        for (size_t i = 0; i < 2; i++) {
+            const float* values = samples.getAxisValues(axes[a], i);
+            ASSERT_TRUE(values != NULL);
+            for (size_t h = 0; h < 3; h++) {
+                ASSERT_EQ(event.getHistoricalAxisValue(axes[a], i, h), values[h])
+                        << "axis=" << axes[a] << ", pointer=" << i << ", sample=" << h;
+            }
+        }
+    }
+
+    ASSERT_FALSE(MotionEventSamples::hasAxis(AMOTION_EVENT_AXIS_VSCROLL));
+    ASSERT_TRUE(samples.getAxisValues(AMOTION_EVENT_AXIS_VSCROLL, 0) == NULL);
+
+    // Reusing the samples for a smaller event.
+    MotionEvent copy;
+    copy.copyFrom(&event, false /*keepHistory*/);
+    samples.setTo(&copy);
+    ASSERT_EQ(1U, samples.getSampleCount());
+    ASSERT_EQ(copy.getX(1), samples.getAxisValues(AMOTION_EVENT_AXIS_X, 1)[0]);
+    ASSERT_EQ(copy.getPressure(0),
+            samples.getAxisValues(AMOTION_EVENT_AXIS_PRESSURE, 0)[0]);
+}
+
 TEST_F(MotionEventTest, Transform) {
     // Generate some points on a circle.
     // Each point 'i' is a point on a circle of radius ROTATION centered at (3,2) at an angle
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <androidfw/KeyCharacterMap.h>
+#include <gtest/gtest.h>
+
+namespace android {
+
+static const char* BASE_SOURCE =
+        "type FULL\n"
+        "key A {\n"
+        "    label: 'A'\n"
+        "    base: 'a'\n"
+        "    shift, capslock: 'A'\n"
+        "}\n"
+        "key B {\n"
+        "    label: 'B'\n"
+        "    base: 'b'\n"
+        "    shift, capslock: 'B'\n"
+        "    alt: 'a'\n"
+        "}\n"
+        "key SPACE {\n"
+        "    label: ' '\n"
+        "    base: ' '\n"
+        "}\n";
+
+static const char* OVERLAY_SOURCE =
+        "type OVERLAY\n"
+        "key A {\n"
+        "    label: 'Q'\n"
+        "    base: 'q'\n"
+        "    shift, capslock: 'Q'\n"
+        "}\n";
+
+
+// --- KeyCharacterMapTest ---
+
+class KeyCharacterMapTest : public testing::Test {
+protected:
+    sp<KeyCharacterMap> mBase;
+    sp<KeyCharacterMap> mOverlay;
+
+    virtual void SetUp() {
+        KeyCharacterMap::loadContents(String8("base"), BASE_SOURCE,
+                KeyCharacterMap::FORMAT_BASE, &mBase);
+        KeyCharacterMap::loadContents(String8("overlay"), OVERLAY_SOURCE,
+                KeyCharacterMap::FORMAT_OVERLAY, &mOverlay);
+    }
+
+    static void assertKeyDown(const KeyEvent& event, int32_t keyCode, int32_t metaState) {
+        ASSERT_EQ(AKEY_EVENT_ACTION_DOWN, event.getAction());
+        ASSERT_EQ(keyCode, event.getKeyCode());
+        ASSERT_EQ(metaState, event.getMetaState());
+    }
+};
+
+TEST_F(KeyCharacterMapTest, GetEvents_UsesMostGeneralBehaviorOfFirstKey) {
+    ASSERT_TRUE(mBase != NULL);
+
+    const char16_t chars[] = { 'a', 'B' };
+    Vector<KeyEvent> events;
+    ASSERT_TRUE(mBase->getEvents(1, chars, 2, events));
+
+    // 'a' is generated by A and by alt+B, the lower key code wins.
+    ASSERT_EQ(size_t(6), events.size());
+    assertKeyDown(events[0], AKEYCODE_A, 0);
+    assertKeyDown(events[2], AKEYCODE_SHIFT_LEFT, AMETA_SHIFT_ON | AMETA_SHIFT_LEFT_ON);
+    assertKeyDown(events[3], AKEYCODE_B, AMETA_SHIFT_ON | AMETA_SHIFT_LEFT_ON);
+}
+
+TEST_F(KeyCharacterMapTest, GetEvents_WhenCharacterNotMapped_ReturnsFalse) {
+    ASSERT_TRUE(mBase != NULL);
+
+    const char16_t chars[] = { 'a', 'z' };
+    Vector<KeyEvent> events;
+    ASSERT_FALSE(mBase->getEvents(1, chars, 2, events));
+}
+
+TEST_F(KeyCharacterMapTest, GetEvents_AfterCombine_UsesOverlayKeys) {
+    ASSERT_TRUE(mBase != NULL);
+    ASSERT_TRUE(mOverlay != NULL);
+
+    sp<KeyCharacterMap> map = KeyCharacterMap::combine(mBase, mOverlay);
+    const char16_t chars[] = { 'q' };
+    Vector<KeyEvent> events;
+    ASSERT_TRUE(map->getEvents(1, chars, 1, events));
+    ASSERT_EQ(size_t(2), events.size());
+    assertKeyDown(events[0], AKEYCODE_A, 0);
+
+    // 'a' is now only generated by alt+B.
+    const char16_t otherChars[] = { 'a' };
+    events.clear();
+    ASSERT_TRUE(map->getEvents(1, otherChars, 1, events));
+    assertKeyDown(events[1], AKEYCODE_B, AMETA_ALT_ON | AMETA_ALT_LEFT_ON);
+}
+
+} // namespace android
@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <androidfw/KeyCharacterMap.h>
+#include <androidfw/KeyLayoutMap.h>
+#include <androidfw/KeymapCache.h>
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+namespace android {
+
+static const char* KEY_LAYOUT_SOURCE =
+        "key 16 Q\n"
+        "key 30 A VIRTUAL\n"
+        "key 42 SHIFT_LEFT\n"
+        "key usage 0x0c0067 POWER WAKE\n"
+        "axis 0x00 X\n"
+        "axis 0x01 invert Y\n"
+        "axis 0x02 split 0x7f LTRIGGER RTRIGGER flat 4\n";
+
+static const char* KEY_CHARACTER_MAP_SOURCE =
+        "type FULL\n"
+        "key A {\n"
+        "    label: 'A'\n"
+        "    base: 'a'\n"
+        "    shift, capslock: 'A'\n"
+        "}\n"
+        "key Q {\n"
+        "    label: 'Q'\n"
+        "    number: '1'\n"
+        "    base: 'q'\n"
+        "    shift, capslock: 'Q'\n"
+        "    alt: fallback ESCAPE\n"
+        "}\n"
+        "map key 86 BACKSLASH\n";
+
+
+// --- KeymapCacheTest ---
+
+class KeymapCacheTest : public testing::Test {
+protected:
+    String8 mDirectory;
+
+    virtual void SetUp() {
+        const char* tmpDir = getenv("TMPDIR");
+        mDirectory.setTo(tmpDir ? tmpDir : "/data/local/tmp");
+        mDirectory.appendPath("KeymapCache_test");
+    }
+
+    virtual void TearDown() {
+        rmdir(mDirectory.string());
+    }
+
+    String8 writeSource(const char* name, const char* contents) {
+        String8 path(mDirectory);
+        path.appendPath(name);
+        mkdir(mDirectory.string(), 0771);
+        FILE* file = fopen(path.string(), "w");
+        if (file) {
+            fputs(contents, file);
+            fclose(file);
+        }
+        return path;
+    }
+
+    String8 getCompiledPath(const String8& sourcePath) {
+        return getCompiledKeymapPath(mDirectory, sourcePath);
+    }
+};
+
+TEST_F(KeymapCacheTest, KeyLayoutMap_WriteThenLoadCompiled_PreservesMappings) {
+    String8 sourcePath(writeSource("Test.kl", KEY_LAYOUT_SOURCE));
+    String8 compiledPath(getCompiledPath(sourcePath));
+
+    sp<KeyLayoutMap> map;
+    ASSERT_EQ(OK, KeyLayoutMap::load(sourcePath, &map));
+    ASSERT_EQ(OK, map->writeCompiled(compiledPath, sourcePath));
+
+    sp<KeyLayoutMap> compiledMap;
+    ASSERT_EQ(OK, KeyLayoutMap::loadCompiled(compiledPath, sourcePath, &compiledMap));
+
+    const int32_t scanCodes[] = { 16, 30, 42, 99 };
+    for (size_t i = 0; i < sizeof(scanCodes) / sizeof(scanCodes[0]); i++) {
+        int32_t keyCode, compiledKeyCode;
+        uint32_t flags, compiledFlags;
+        status_t status = map->mapKey(scanCodes[i], 0, &keyCode, &flags);
+        ASSERT_EQ(status, compiledMap->mapKey(scanCodes[i], 0,
+                &compiledKeyCode, &compiledFlags));
+        if (!status) {
+            ASSERT_EQ(keyCode, compiledKeyCode);
+            ASSERT_EQ(flags, compiledFlags);
+        }
+    }
+
+    int32_t keyCode;
+    uint32_t flags;
+    ASSERT_EQ(OK, compiledMap->mapKey(0, 0x0c0067, &keyCode, &flags));
+    ASSERT_EQ(AKEYCODE_POWER, keyCode);
+    ASSERT_EQ(uint32_t(POLICY_FLAG_WAKE), flags);
+
+    for (int32_t scanCode = 0; scanCode < 4; scanCode++) {
+        AxisInfo info, compiledInfo;
+        status_t status = map->mapAxis(scanCode, &info);
+        ASSERT_EQ(status, compiledMap->mapAxis(scanCode, &compiledInfo));
+        if (!status) {
+            ASSERT_EQ(info.mode, compiledInfo.mode);
+            ASSERT_EQ(info.axis, compiledInfo.axis);
+            ASSERT_EQ(info.highAxis, compiledInfo.highAxis);
+            ASSERT_EQ(info.splitValue, compiledInfo.splitValue);
+            ASSERT_EQ(info.flatOverride, compiledInfo.flatOverride);
+        }
+    }
+
+    unlink(compiledPath.string());
+    unlink(sourcePath.string());
+}
+
+TEST_F(KeymapCacheTest, KeyCharacterMap_WriteThenLoadCompiled_PreservesMappings) {
+    String8 sourcePath(writeSource("Test.kcm", KEY_CHARACTER_MAP_SOURCE));
+    String8 compiledPath(getCompiledPath(sourcePath));
+
+    sp<KeyCharacterMap> map;
+    ASSERT_EQ(OK, KeyCharacterMap::load(sourcePath, KeyCharacterMap::FORMAT_BASE, &map));
+    ASSERT_EQ(OK, map->writeCompiled(compiledPath, sourcePath));
+
+    sp<KeyCharacterMap> compiledMap;
+    ASSERT_EQ(OK, KeyCharacterMap::loadCompiled(compiledPath, sourcePath,
+            KeyCharacterMap::FORMAT_BASE, &compiledMap));
+    ASSERT_EQ(map->getKeyboardType(), compiledMap->getKeyboardType());
+
+    const int32_t keyCodes[] = { AKEYCODE_A, AKEYCODE_Q, AKEYCODE_Z };
+    const int32_t metaStates[] = { 0, AMETA_SHIFT_ON, AMETA_CAPS_LOCK_ON, AMETA_ALT_ON };
+    for (size_t i = 0; i < sizeof(keyCodes) / sizeof(keyCodes[0]); i++) {
+        ASSERT_EQ(map->getDisplayLabel(keyCodes[i]), compiledMap->getDisplayLabel(keyCodes[i]));
+        ASSERT_EQ(map->getNumber(keyCodes[i]), compiledMap->getNumber(keyCodes[i]));
+        for (size_t j = 0; j < sizeof(metaStates) / sizeof(metaStates[0]); j++) {
+            ASSERT_EQ(map->getCharacter(keyCodes[i], metaStates[j]),
+                    compiledMap->getCharacter(keyCodes[i], metaStates[j]));
+        }
+    }
+
+    int32_t keyCode;
+    ASSERT_EQ(OK, compiledMap->mapKey(86, 0, &keyCode));
+    ASSERT_EQ(AKEYCODE_BACKSLASH, keyCode);
+
+    // A base key character map cannot be loaded as an overlay.
+    ASSERT_EQ(INVALID_OPERATION, KeyCharacterMap::loadCompiled(compiledPath, sourcePath,
+            KeyCharacterMap::FORMAT_OVERLAY, &compiledMap));
+
+    unlink(compiledPath.string());
+    unlink(sourcePath.string());
+}
+
+TEST_F(KeymapCacheTest, LoadCompiled_WhenSourceChanged_ReturnsInvalidOperation) {
+    String8 sourcePath(writeSource("Test.kl", KEY_LAYOUT_SOURCE));
+    String8 compiledPath(getCompiledPath(sourcePath));
+
+    sp<KeyLayoutMap> map;
+    ASSERT_EQ(OK, KeyLayoutMap::load(sourcePath, &map));
+    ASSERT_EQ(OK, map->writeCompiled(compiledPath, sourcePath));
+
+    String8 modifiedSource(KEY_LAYOUT_SOURCE);
+    modifiedSource.append("key 17 W\n");
+    writeSource("Test.kl", modifiedSource.string());
+
+    ASSERT_EQ(INVALID_OPERATION, KeyLayoutMap::loadCompiled(compiledPath, sourcePath, &map));
+    ASSERT_TRUE(map == NULL);
+
+    unlink(compiledPath.string());
+    unlink(sourcePath.string());
+}
+
+TEST_F(KeymapCacheTest, LoadCompiled_WhenOnlyModifiedTimeChanged_LoadsCompiledFile) {
+    String8 sourcePath(writeSource("Test.kl", KEY_LAYOUT_SOURCE));
+    String8 compiledPath(getCompiledPath(sourcePath));
+
+    sp<KeyLayoutMap> map;
+    ASSERT_EQ(OK, KeyLayoutMap::load(sourcePath, &map));
+    ASSERT_EQ(OK, map->writeCompiled(compiledPath, sourcePath));
+
+    // Copying the source file changes its modification time but not its contents.
+    struct timeval times[2];
+    times[0].tv_sec = times[1].tv_sec = 1000;
+    times[0].tv_usec = times[1].tv_usec = 0;
+    ASSERT_EQ(0, utimes(sourcePath.string(), times));
+
+    ASSERT_EQ(OK, KeyLayoutMap::loadCompiled(compiledPath, sourcePath, &map));
+
+    unlink(compiledPath.string());
+    unlink(sourcePath.string());
+}
+
+TEST_F(KeymapCacheTest, WriteCompiled_WhenDirectoryIsMissing_CreatesParentDirectories) {
+    String8 sourcePath(writeSource("Test.kl", KEY_LAYOUT_SOURCE));
+    String8 parentDirectory(mDirectory);
+    parentDirectory.appendPath("parent");
+    String8 cacheDirectory(parentDirectory);
+    cacheDirectory.appendPath("cache");
+    String8 compiledPath(getCompiledKeymapPath(cacheDirectory, sourcePath));
+
+    sp<KeyLayoutMap> map;
+    ASSERT_EQ(OK, KeyLayoutMap::load(sourcePath, &map));
+    ASSERT_EQ(OK, map->writeCompiled(compiledPath, sourcePath));
+    ASSERT_EQ(OK, KeyLayoutMap::loadCompiled(compiledPath, sourcePath, &map));
+
+    unlink(compiledPath.string());
+    rmdir(cacheDirectory.string());
+    rmdir(parentDirectory.string());
+    unlink(sourcePath.string());
+}
+
+TEST_F(KeymapCacheTest, LoadCompiled_WhenNoCompiledFile_ReturnsNameNotFound) {
+    String8 sourcePath(writeSource("Test.kl", KEY_LAYOUT_SOURCE));
+
+    sp<KeyLayoutMap> map;
+    ASSERT_EQ(NAME_NOT_FOUND, KeyLayoutMap::loadCompiled(getCompiledPath(sourcePath),
+            sourcePath, &map));
+
+    unlink(sourcePath.string());
+}
+
+} // namespace android
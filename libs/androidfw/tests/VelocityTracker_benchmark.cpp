@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Measures how long the velocity tracker strategies take to estimate the
+ * velocity of every pointer after each movement of a fling.
+ *
+ * Usage: VelocityTracker_benchmark [--pointers N] [--flings N] [--strategy NAME] [FILE]
+ *
+ * FILE is an optional recorded fling with one movement per line, each line
+ * holding the event time in nanoseconds followed by the x and y coordinates of
+ * every pointer.  Without it, synthetic flings are generated.
+ */
+
+#include <androidfw/VelocityTracker.h>
+#include <utils/Timers.h>
+#include <utils/Vector.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace android;
+
+struct Movement {
+    nsecs_t eventTime;
+    VelocityTracker::Position positions[MAX_POINTERS];
+};
+
+typedef Vector<Movement> Fling;
+
+static bool loadFling(const char* path, uint32_t* outPointerCount, Fling* outFling) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+
+    uint32_t pointerCount = 0;
+    char line[4096];
+    while (fgets(line, sizeof(line), file)) {
+        Movement movement;
+        char* next = line;
+        movement.eventTime = strtoll(next, &next, 10);
+
+        uint32_t count = 0;
+        for (char* end; count < MAX_POINTERS; count++) {
+            movement.positions[count].x = strtof(next, &end);
+            if (end == next) {
+                break;
+            }
+            movement.positions[count].y = strtof(end, &next);
+        }
+        if (!count) {
+            continue;
+        }
+        if (pointerCount && count != pointerCount) {
+            fprintf(stderr, "Every movement of '%s' must have the same number of pointers.\n",
+                    path);
+            fclose(file);
+            return false;
+        }
+        pointerCount = count;
+        outFling->push(movement);
+    }
+    fclose(file);
+
+    *outPointerCount = pointerCount;
+    return pointerCount != 0;
+}
+
+// Synthesizes a fling at 60Hz where the fingers accelerate then lift off.
+static void makeFling(uint32_t pointerCount, Fling* outFling) {
+    float vx[MAX_POINTERS], vy[MAX_POINTERS], ax[MAX_POINTERS];
+    for (uint32_t j = 0; j < pointerCount; j++) {
+        vx[j] = float(drand48() - 0.5) * 4000;
+        vy[j] = float(drand48() - 0.5) * 4000;
+        ax[j] = float(drand48() - 0.5) * 40000;
+    }
+
+    nsecs_t eventTime = 0;
+    for (uint32_t i = 0; i < 30; i++) {
+        eventTime += 16666667 + nsecs_t(drand48() * 2000000);
+        float t = eventTime * 0.000000001f;
+
+        Movement movement;
+        movement.eventTime = eventTime;
+        for (uint32_t j = 0; j < pointerCount; j++) {
+            movement.positions[j].x = 100 * j + vx[j] * t + ax[j] * t * t + float(drand48());
+            movement.positions[j].y = 500 + vy[j] * t + float(drand48());
+        }
+        outFling->push(movement);
+    }
+}
+
+static void runStrategy(const char* strategy, uint32_t pointerCount,
+        const Vector<Fling>& flings) {
+    BitSet32 idBits;
+    for (uint32_t j = 0; j < pointerCount; j++) {
+        idBits.markBit(j);
+    }
+
+    VelocityTracker tracker(strategy);
+    nsecs_t totalTime = 0;
+    size_t estimateCount = 0;
+    float checksum = 0;
+    for (size_t f = 0; f < flings.size(); f++) {
+        const Fling& fling = flings[f];
+        tracker.clear();
+        for (size_t i = 0; i < fling.size(); i++) {
+            tracker.addMovement(fling[i].eventTime, idBits, fling[i].positions);
+
+            nsecs_t startTime = systemTime(SYSTEM_TIME_MONOTONIC);
+            for (uint32_t j = 0; j < pointerCount; j++) {
+                float vx, vy;
+                if (tracker.getVelocity(j, &vx, &vy)) {
+                    checksum += vx + vy;
+                }
+            }
+            totalTime += systemTime(SYSTEM_TIME_MONOTONIC) - startTime;
+            estimateCount += pointerCount;
+        }
+    }
+
+    printf("%s: %d estimates, %0.3fus per estimate (checksum %g)\n", strategy,
+            estimateCount, estimateCount ? totalTime * 0.001 / estimateCount : 0.0,
+            checksum);
+}
+
+static void usage(const char* program) {
+    fprintf(stderr, "Usage: %s [--pointers N] [--flings N] [--strategy NAME] [FILE]\n",
+            program);
+}
+
+int main(int argc, char** argv) {
+    uint32_t pointerCount = 10;
+    uint32_t flingCount = 2000;
+    const char* strategy = NULL;
+    const char* path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--pointers") && i + 1 < argc) {
+            pointerCount = uint32_t(atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--flings") && i + 1 < argc) {
+            flingCount = uint32_t(atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--strategy") && i + 1 < argc) {
+            strategy = argv[++i];
+        } else if (argv[i][0] != '-' && !path) {
+            path = argv[i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (pointerCount < 1 || pointerCount > MAX_POINTERS || flingCount < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    Vector<Fling> flings;
+    if (path) {
+        // Replay the recorded fling as many times as requested.
+        Fling fling;
+        if (!loadFling(path, &pointerCount, &fling)) {
+            fprintf(stderr, "Could not load fling '%s'.\n", path);
+            return 1;
+        }
+        for (uint32_t i = 0; i < flingCount; i++) {
+            flings.push(fling);
+        }
+    } else {
+        srand48(1);
+        for (uint32_t i = 0; i < flingCount; i++) {
+            flings.push();
+            makeFling(pointerCount, &flings.editTop());
+        }
+    }
+
+    printf("%d pointers, %d flings\n", pointerCount, flingCount);
+    if (strategy) {
+        runStrategy(strategy, pointerCount, flings);
+    } else {
+        runStrategy("lsq1", pointerCount, flings);
+        runStrategy("lsq2", pointerCount, flings);
+        runStrategy("lsq3", pointerCount, flings);
+    }
+    return 0;
+}
@@ -0,0 +1,249 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <androidfw/VelocityTracker.h>
+#include <utils/Vector.h>
+#include <gtest/gtest.h>
+
+#include <math.h>
+#include <stdlib.h>
+
+namespace android {
+
+// Must match the constants of LeastSquaresVelocityTrackerStrategy.
+static const nsecs_t HORIZON = 100 * 1000000;
+static const uint32_t HISTORY_SIZE = 20;
+
+static const uint32_t POINTER_COUNT = 3;
+
+// Tolerances for the differences between the reference solver and the tracker,
+// which sum the terms of its dot products in a different order.
+static const float POSITION_TOLERANCE = 0.05f; // px
+static const float VELOCITY_TOLERANCE = 1.0f; // px/s
+static const float CONFIDENCE_TOLERANCE = 0.001f;
+
+
+/*
+ * The scalar least squares solver that the tracker used before it was vectorized,
+ * kept here as a reference.  It fits a single vector Y at a time.
+ */
+static float referenceDot(const float* a, const float* b, uint32_t m) {
+    float r = 0;
+    while (m--) {
+        r += *(a++) * *(b++);
+    }
+    return r;
+}
+
+static bool referenceSolveLeastSquares(const float* x, const float* y,
+        const float* w, uint32_t m, uint32_t n, float* outB, float* outDet) {
+    float a[n][m];
+    for (uint32_t h = 0; h < m; h++) {
+        a[0][h] = w[h];
+        for (uint32_t i = 1; i < n; i++) {
+            a[i][h] = a[i - 1][h] * x[h];
+        }
+    }
+
+    float q[n][m];
+    float r[n][n];
+    for (uint32_t j = 0; j < n; j++) {
+        for (uint32_t h = 0; h < m; h++) {
+            q[j][h] = a[j][h];
+        }
+        for (uint32_t i = 0; i < j; i++) {
+            float dot = referenceDot(&q[j][0], &q[i][0], m);
+            for (uint32_t h = 0; h < m; h++) {
+                q[j][h] -= dot * q[i][h];
+            }
+        }
+
+        float norm = sqrtf(referenceDot(&q[j][0], &q[j][0], m));
+        if (norm < 0.000001f) {
+            return false;
+        }
+
+        float invNorm = 1.0f / norm;
+        for (uint32_t h = 0; h < m; h++) {
+            q[j][h] *= invNorm;
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            r[j][i] = i < j ? 0 : referenceDot(&q[j][0], &a[i][0], m);
+        }
+    }
+
+    float wy[m];
+    for (uint32_t h = 0; h < m; h++) {
+        wy[h] = y[h] * w[h];
+    }
+    for (uint32_t i = n; i-- != 0; ) {
+        outB[i] = referenceDot(&q[i][0], wy, m);
+        for (uint32_t j = n - 1; j > i; j--) {
+            outB[i] -= r[i][j] * outB[j];
+        }
+        outB[i] /= r[i][i];
+    }
+
+    float ymean = 0;
+    for (uint32_t h = 0; h < m; h++) {
+        ymean += y[h];
+    }
+    ymean /= m;
+
+    float sserr = 0;
+    float sstot = 0;
+    for (uint32_t h = 0; h < m; h++) {
+        float err = y[h] - outB[0];
+        float term = 1;
+        for (uint32_t i = 1; i < n; i++) {
+            term *= x[h];
+            err -= term * outB[i];
+        }
+        sserr += w[h] * w[h] * err * err;
+        float var = y[h] - ymean;
+        sstot += w[h] * w[h] * var * var;
+    }
+    *outDet = sstot > 0.000001f ? 1.0f - (sserr / sstot) : 1;
+    return true;
+}
+
+
+// --- VelocityTrackerTest ---
+
+class VelocityTrackerTest : public testing::Test {
+protected:
+    struct Sample {
+        nsecs_t eventTime;
+        VelocityTracker::Position positions[POINTER_COUNT];
+    };
+
+    Vector<Sample> mSamples;
+
+    // Synthesizes a fling of all pointers: each pointer accelerates along its own
+    // direction while the samples arrive with some jitter.
+    void makeFling(uint32_t sampleCount, nsecs_t interval) {
+        mSamples.clear();
+        float vx[POINTER_COUNT], vy[POINTER_COUNT], ax[POINTER_COUNT];
+        for (uint32_t j = 0; j < POINTER_COUNT; j++) {
+            vx[j] = float(drand48() - 0.5) * 6000;
+            vy[j] = float(drand48() - 0.5) * 6000;
+            ax[j] = float(drand48() - 0.5) * 20000;
+        }
+
+        nsecs_t eventTime = 0;
+        for (uint32_t i = 0; i < sampleCount; i++) {
+            eventTime += interval + nsecs_t(drand48() * interval / 4);
+            float t = eventTime * 0.000000001f;
+
+            Sample sample;
+            sample.eventTime = eventTime;
+            for (uint32_t j = 0; j < POINTER_COUNT; j++) {
+                sample.positions[j].x = 100 * j + vx[j] * t + ax[j] * t * t
+                        + float(drand48());
+                sample.positions[j].y = 200 + vy[j] * t + float(drand48());
+            }
+            mSamples.push(sample);
+        }
+    }
+
+    // Computes the estimate of a pointer the same way as LeastSquaresVelocityTrackerStrategy.
+    bool getReferenceEstimator(uint32_t index, uint32_t degree,
+            VelocityTracker::Estimator* outEstimator) {
+        outEstimator->clear();
+
+        float x[HISTORY_SIZE], y[HISTORY_SIZE], w[HISTORY_SIZE], time[HISTORY_SIZE];
+        const Sample& newestSample = mSamples.top();
+        uint32_t m = 0;
+        for (size_t i = mSamples.size(); i-- != 0 && m < HISTORY_SIZE; m++) {
+            nsecs_t age = newestSample.eventTime - mSamples[i].eventTime;
+            if (age > HORIZON) {
+                break;
+            }
+            x[m] = mSamples[i].positions[index].x;
+            y[m] = mSamples[i].positions[index].y;
+            w[m] = 1.0f;
+            time[m] = -age * 0.000000001f;
+        }
+
+        if (degree > m - 1) {
+            degree = m - 1;
+        }
+        float xdet, ydet;
+        uint32_t n = degree + 1;
+        if (degree < 1
+                || !referenceSolveLeastSquares(time, x, w, m, n, outEstimator->xCoeff, &xdet)
+                || !referenceSolveLeastSquares(time, y, w, m, n, outEstimator->yCoeff, &ydet)) {
+            return false;
+        }
+        outEstimator->time = newestSample.eventTime;
+        outEstimator->degree = degree;
+        outEstimator->confidence = xdet * ydet;
+        return true;
+    }
+
+    void checkAgainstReference(const char* strategy, uint32_t degree) {
+        VelocityTracker tracker(strategy);
+        BitSet32 idBits;
+        for (uint32_t j = 0; j < POINTER_COUNT; j++) {
+            idBits.markBit(j);
+        }
+        for (size_t i = 0; i < mSamples.size(); i++) {
+            tracker.addMovement(mSamples[i].eventTime, idBits, mSamples[i].positions);
+        }
+
+        for (uint32_t j = 0; j < POINTER_COUNT; j++) {
+            VelocityTracker::Estimator expected, actual;
+            ASSERT_TRUE(getReferenceEstimator(j, degree, &expected));
+            ASSERT_TRUE(tracker.getEstimator(j, &actual));
+
+            ASSERT_EQ(expected.time, actual.time);
+            ASSERT_EQ(expected.degree, actual.degree);
+            ASSERT_NEAR(expected.xCoeff[0], actual.xCoeff[0], POSITION_TOLERANCE);
+            ASSERT_NEAR(expected.yCoeff[0], actual.yCoeff[0], POSITION_TOLERANCE);
+            ASSERT_NEAR(expected.xCoeff[1], actual.xCoeff[1], VELOCITY_TOLERANCE);
+            ASSERT_NEAR(expected.yCoeff[1], actual.yCoeff[1], VELOCITY_TOLERANCE);
+            ASSERT_NEAR(expected.confidence, actual.confidence, CONFIDENCE_TOLERANCE);
+        }
+    }
+};
+
+TEST_F(VelocityTrackerTest, LeastSquares_MatchesReferenceSolver) {
+    srand48(1);
+    for (uint32_t round = 0; round < 200; round++) {
+        // Vary the number of samples so that the history is sometimes partly filled,
+        // sometimes limited by the horizon and sometimes full.
+        makeFling(2 + round % 30, 4000000 + (round % 3) * 4000000);
+        checkAgainstReference("lsq1", 1);
+        checkAgainstReference("lsq2", 2);
+    }
+}
+
+TEST_F(VelocityTrackerTest, LeastSquares_WhenSinglePoint_ReturnsPosition) {
+    makeFling(1, 8000000);
+
+    VelocityTracker tracker("lsq2");
+    BitSet32 idBits;
+    idBits.markBit(0);
+    tracker.addMovement(mSamples[0].eventTime, idBits, mSamples[0].positions);
+
+    VelocityTracker::Estimator estimator;
+    ASSERT_TRUE(tracker.getEstimator(0, &estimator));
+    ASSERT_EQ(0U, estimator.degree);
+    ASSERT_EQ(mSamples[0].positions[0].x, estimator.xCoeff[0]);
+    ASSERT_EQ(mSamples[0].positions[0].y, estimator.yCoeff[0]);
+}
+
+} // namespace android
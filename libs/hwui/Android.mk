@@ -4,13 +4,15 @@ include $(CLEAR_VARS)
 # Only build libhwui when USE_OPENGL_RENDERER is
 # defined in the current device/board configuration
 ifeq ($(USE_OPENGL_RENDERER),true)
-	LOCAL_SRC_FILES:= \
+	hwui_src_files := \
+		utils/Blur.cpp \
 		utils/SortedListImpl.cpp \
 		font/CacheTexture.cpp \
 		font/Font.cpp \
 		FontRenderer.cpp \
 		GammaFontRenderer.cpp \
 		Caches.cpp \
+		DeferredDisplayList.cpp \
 		DisplayListLogBuffer.cpp \
 		DisplayListRenderer.cpp \
 		Dither.cpp \
@@ -29,14 +31,16 @@ ifeq ($(USE_OPENGL_RENDERER),true)
 		ProgramCache.cpp \
 		ResourceCache.cpp \
 		ShapeCache.cpp \
+		ShapeRasterizer.cpp \
 		SkiaColorFilter.cpp \
 		SkiaShader.cpp \
 		Snapshot.cpp \
 		Stencil.cpp \
+		TessellationCache.cpp \
 		TextureCache.cpp \
 		TextDropShadowCache.cpp
 
-	LOCAL_C_INCLUDES += \
+	hwui_c_includes := \
 		$(JNI_H_INCLUDE) \
 		$(LOCAL_PATH)/../../include/utils \
 		external/skia/include/core \
@@ -45,21 +49,54 @@ ifeq ($(USE_OPENGL_RENDERER),true)
 		external/skia/src/ports \
 		external/skia/include/utils
 
-	LOCAL_CFLAGS += -DUSE_OPENGL_RENDERER -DGL_GLEXT_PROTOTYPES
-	LOCAL_MODULE_CLASS := SHARED_LIBRARIES
-	LOCAL_SHARED_LIBRARIES := libcutils libutils libGLESv2 libskia libui
-	LOCAL_MODULE := libhwui
-	LOCAL_MODULE_TAGS := optional
+	hwui_cflags := -DUSE_OPENGL_RENDERER -DGL_GLEXT_PROTOTYPES
 
 	ifndef HWUI_COMPILE_SYMBOLS
-		LOCAL_CFLAGS += -fvisibility=hidden
+		hwui_cflags += -fvisibility=hidden
 	endif
 
 	ifdef HWUI_COMPILE_FOR_PERF
-		LOCAL_CFLAGS += -fno-omit-frame-pointer -marm -mapcs
+		hwui_cflags += -fno-omit-frame-pointer -marm -mapcs
 	endif
 
+	LOCAL_SRC_FILES := $(hwui_src_files)
+	LOCAL_C_INCLUDES += $(hwui_c_includes)
+	LOCAL_CFLAGS += $(hwui_cflags)
+	LOCAL_MODULE_CLASS := SHARED_LIBRARIES
+	LOCAL_SHARED_LIBRARIES := libcutils libutils libGLESv2 libskia libui
+	LOCAL_MODULE := libhwui
+	LOCAL_MODULE_TAGS := optional
+
 	include $(BUILD_SHARED_LIBRARY)
 
+	# libhwui_null is libhwui linked against a no-op GLES 2.0 implementation
+	# that only counts calls, uploads and state changes. It is used to measure
+	# the CPU cost of the renderer without a GPU, see nullgl/NullGLES.h.
+	include $(CLEAR_VARS)
+
+	LOCAL_SRC_FILES := $(hwui_src_files) nullgl/NullGLES.cpp
+	LOCAL_C_INCLUDES += $(hwui_c_includes)
+	LOCAL_CFLAGS += $(hwui_cflags) -DHWUI_NULL_GPU
+	LOCAL_MODULE_CLASS := SHARED_LIBRARIES
+	LOCAL_SHARED_LIBRARIES := libcutils libutils libskia libui
+	LOCAL_MODULE := libhwui_null
+	LOCAL_MODULE_TAGS := optional
+
+	include $(BUILD_SHARED_LIBRARY)
+
+	# Host version of libhwui_null, for benchmarking on a workstation.
+	# Executables linking it also need host builds of libskia and libui.
+	ifeq ($(HWUI_NULL_GPU_HOST),true)
+		include $(CLEAR_VARS)
+
+		LOCAL_SRC_FILES := $(hwui_src_files) nullgl/NullGLES.cpp
+		LOCAL_C_INCLUDES += $(hwui_c_includes) frameworks/native/opengl/include
+		LOCAL_CFLAGS += $(filter-out -marm -mapcs,$(hwui_cflags)) -DHWUI_NULL_GPU
+		LOCAL_MODULE := libhwui_null
+		LOCAL_MODULE_TAGS := optional
+
+		include $(BUILD_HOST_STATIC_LIBRARY)
+	endif
+
     include $(call all-makefiles-under,$(LOCAL_PATH))
 endif
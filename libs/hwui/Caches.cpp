@@ -24,6 +24,10 @@
 #include "Properties.h"
 #include "LayerRenderer.h"
 
+#ifdef HWUI_NULL_GPU
+    #include "nullgl/NullGLES.h"
+#endif
+
 namespace android {
 
 #ifdef USE_OPENGL_RENDERER
@@ -89,6 +93,8 @@ void Caches::init() {
 
     mFunctorsCount = 0;
 
+    programCache.warmUp();
+
     mInitialized = true;
 }
 
@@ -155,6 +161,7 @@ void Caches::terminate() {
 
     fboCache.clear();
 
+    programCache.savePersistentKeys();
     programCache.clear();
     currentProgram = NULL;
 
@@ -191,6 +198,10 @@ void Caches::dumpMemoryUsage(String8 &log) {
             rectShapeCache.getSize(), rectShapeCache.getMaxSize());
     log.appendFormat("  ArcShapeCache        %8d / %8d\n",
             arcShapeCache.getSize(), arcShapeCache.getMaxSize());
+    log.appendFormat("  TessellationCache    %8d / %8d\n",
+            tessellationCache.getSize(), tessellationCache.getMaxSize());
+    log.appendFormat("  PatchCache           %8d / %8d\n",
+            patchCache.getSize(), patchCache.getMaxSize());
     log.appendFormat("  TextDropShadowCache  %8d / %8d\n", dropShadowCache.getSize(),
             dropShadowCache.getMaxSize());
     for (uint32_t i = 0; i < fontRenderer->getFontRendererCount(); i++) {
@@ -200,10 +211,18 @@ void Caches::dumpMemoryUsage(String8 &log) {
     log.appendFormat("Other:\n");
     log.appendFormat("  FboCache             %8d / %8d\n",
             fboCache.getSize(), fboCache.getMaxSize());
-    log.appendFormat("  PatchCache           %8d / %8d\n",
-            patchCache.getSize(), patchCache.getMaxSize());
-
-    uint32_t total = 0;
+    log.appendFormat("  PatchCache           %d hits, %d misses, %d evictions\n",
+            patchCache.getHitCount(), patchCache.getMissCount(),
+            patchCache.getEvictionCount());
+    log.appendFormat("  TessellationCache    %d hits, %d misses\n",
+            tessellationCache.getHitCount(), tessellationCache.getMissCount());
+    ShapeRasterizer::getInstance().dumpStats(log);
+    const uint32_t queuedShapesSize = pathCache.getPendingSize() +
+            roundRectShapeCache.getPendingSize() + circleShapeCache.getPendingSize() +
+            ovalShapeCache.getPendingSize() + arcShapeCache.getPendingSize();
+    log.appendFormat("  QueuedShapes         %8d\n", queuedShapesSize);
+
+    uint32_t total = queuedShapesSize;
     total += textureCache.getSize();
     total += layerCache.getSize();
     total += gradientCache.getSize();
@@ -214,12 +233,18 @@ void Caches::dumpMemoryUsage(String8 &log) {
     total += ovalShapeCache.getSize();
     total += rectShapeCache.getSize();
     total += arcShapeCache.getSize();
+    total += tessellationCache.getSize();
+    total += patchCache.getSize();
     for (uint32_t i = 0; i < fontRenderer->getFontRendererCount(); i++) {
         total += fontRenderer->getFontRendererSize(i);
     }
 
     log.appendFormat("Total memory usage:\n");
     log.appendFormat("  %d bytes, %.2f MB\n", total, total / 1024.0f / 1024.0f);
+
+#ifdef HWUI_NULL_GPU
+    dumpNullGLStats(log);
+#endif
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -276,6 +301,9 @@ void Caches::flush(FlushMode mode) {
             gradientCache.clear();
             fontRenderer->clear();
             dither.clear();
+            // The application is likely in the background, remember
+            // which programs it used
+            programCache.savePersistentKeys();
             // fall through
         case kFlushMode_Moderate:
             fontRenderer->flush();
@@ -286,8 +314,15 @@ void Caches::flush(FlushMode mode) {
             ovalShapeCache.clear();
             rectShapeCache.clear();
             arcShapeCache.clear();
+            tessellationCache.clear();
             // fall through
         case kFlushMode_Layers:
+            // Shapes rasterized ahead of time that were not drawn yet
+            pathCache.clearPendingTasks();
+            roundRectShapeCache.clearPendingTasks();
+            circleShapeCache.clearPendingTasks();
+            ovalShapeCache.clearPendingTasks();
+            arcShapeCache.clearPendingTasks();
             layerCache.clear();
             break;
     }
@@ -35,6 +35,7 @@
 #include "ProgramCache.h"
 #include "ShapeCache.h"
 #include "PathCache.h"
+#include "TessellationCache.h"
 #include "TextDropShadowCache.h"
 #include "FboCache.h"
 #include "ResourceCache.h"
@@ -257,6 +258,7 @@ public:
     OvalShapeCache ovalShapeCache;
     RectShapeCache rectShapeCache;
     ArcShapeCache arcShapeCache;
+    TessellationCache tessellationCache;
     PatchCache patchCache;
     TextDropShadowCache dropShadowCache;
     FboCache fboCache;
@@ -0,0 +1,386 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "OpenGLRenderer"
+
+#include <math.h>
+
+#include <SkCanvas.h>
+
+#include <utils/Log.h>
+
+#include <private/hwui/DrawGlInfo.h>
+
+#include "DeferredDisplayList.h"
+#include "OpenGLRenderer.h"
+
+namespace android {
+namespace uirenderer {
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructors/destructor
+///////////////////////////////////////////////////////////////////////////////
+
+DeferredDisplayList::DeferredDisplayList(): mOps(NULL), mCount(0) {
+}
+
+DeferredDisplayList::~DeferredDisplayList() {
+    delete[] mOps;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Recording
+///////////////////////////////////////////////////////////////////////////////
+
+DeferredDisplayList::DeferredDrawOp* DeferredDisplayList::obtainOp(OpenGLRenderer& renderer,
+        OpType type, SkPaint* paint) {
+    if (mCount >= MAX_DEFERRED_OPS) {
+        return NULL;
+    }
+
+    if (!mOps) {
+        mOps = new DeferredDrawOp[MAX_DEFERRED_OPS];
+    }
+
+    DeferredDrawOp* op = &mOps[mCount];
+    if (!renderer.storeDisplayState(op->state)) {
+        return NULL;
+    }
+
+    op->type = type;
+    op->pureTranslate = op->state.transform.isPureTranslate();
+    op->paint = paint;
+    op->bitmap = NULL;
+    op->text = NULL;
+    op->positions = NULL;
+
+    return op;
+}
+
+/**
+ * Computes the area touched by the specified operation and appends it to the
+ * list. bounds is a conservative estimate of the pixels the operation may
+ * touch and drawBounds is the rectangle the renderer will test against the
+ * clip when drawing it, both in local coordinates.
+ */
+bool DeferredDisplayList::commitOp(DeferredDrawOp* op, const Rect& bounds,
+        const Rect& drawBounds) {
+    Rect clip(op->state.clip);
+    clip.snapToPixelBoundaries();
+
+    Rect r(drawBounds);
+    op->state.transform.mapRect(r);
+    r.snapToPixelBoundaries();
+
+    // The renderer would reject this operation, there is nothing to draw
+    if (!clip.intersects(r)) {
+        return true;
+    }
+
+    op->unclipped = clip.contains(r);
+    op->drawn = false;
+
+    // Outset by one pixel to account for antialiasing and filtering
+    op->bounds.set(bounds);
+    op->state.transform.mapRect(op->bounds);
+    op->bounds.snapToPixelBoundaries();
+    op->bounds.set(op->bounds.left - 1.0f, op->bounds.top - 1.0f,
+            op->bounds.right + 1.0f, op->bounds.bottom + 1.0f);
+    op->bounds.intersect(clip);
+
+    mCount++;
+    mStats.deferredOps++;
+
+    return true;
+}
+
+bool DeferredDisplayList::addDrawBitmap(OpenGLRenderer& renderer, SkBitmap* bitmap,
+        float left, float top, SkPaint* paint) {
+    DeferredDrawOp* op = obtainOp(renderer, kOpBitmap, paint);
+    if (!op) return false;
+
+    op->bitmap = bitmap;
+    op->left = left;
+    op->top = top;
+    op->right = left + bitmap->width();
+    op->bottom = top + bitmap->height();
+
+    const Rect bounds(op->left, op->top, op->right, op->bottom);
+    return commitOp(op, bounds, bounds);
+}
+
+bool DeferredDisplayList::addDrawRect(OpenGLRenderer& renderer, float left, float top,
+        float right, float bottom, SkPaint* paint) {
+    DeferredDrawOp* op = obtainOp(renderer, kOpRect, paint);
+    if (!op) return false;
+
+    op->left = left;
+    op->top = top;
+    op->right = right;
+    op->bottom = bottom;
+
+    Rect drawBounds(left, top, right, bottom);
+    Rect bounds(drawBounds);
+    if (paint->getStyle() != SkPaint::kFill_Style) {
+        // See quickRejectPreStroke() in OpenGLRenderer and the offset
+        // of the textures generated by the shape caches
+        const float strokeWidth = paint->getStrokeWidth();
+        const float outset = fmax(strokeWidth, 1.0f) * 1.5f;
+        drawBounds.set(left - strokeWidth * 0.5f, top - strokeWidth * 0.5f,
+                right + strokeWidth * 0.5f, bottom + strokeWidth * 0.5f);
+        bounds.set(left - outset, top - outset, right + outset, bottom + outset);
+    }
+
+    return commitOp(op, bounds, drawBounds);
+}
+
+bool DeferredDisplayList::addDrawText(OpenGLRenderer& renderer, const char* text,
+        int bytesCount, int count, float x, float y, const float* positions,
+        SkPaint* paint, float length) {
+    if (text == NULL || count == 0) {
+        return true;
+    }
+
+    DeferredDrawOp* op = obtainOp(renderer, kOpText, paint);
+    if (!op) return false;
+
+    // Keep the measurement so the renderer does not have to do it again
+    if (length < 0.0f) length = paint->measureText(text, bytesCount);
+
+    op->text = text;
+    op->bytesCount = bytesCount;
+    op->count = count;
+    op->left = x;
+    op->top = y;
+    op->positions = positions;
+    op->length = length;
+
+    // Same bounds as the ones used by drawText() to reject text
+    switch (paint->getTextAlign()) {
+        case SkPaint::kCenter_Align:
+            x -= length / 2.0f;
+            break;
+        case SkPaint::kRight_Align:
+            x -= length;
+            break;
+        default:
+            break;
+    }
+
+    SkPaint::FontMetrics metrics;
+    paint->getFontMetrics(&metrics, 0.0f);
+
+    const Rect drawBounds(x, y + metrics.fTop, x + length, y + metrics.fBottom);
+
+    // Glyphs can extend past their advance (italic or fake bold text for instance)
+    const float padding = paint->getTextSize() * 0.5f;
+    const Rect bounds(drawBounds.left - padding, drawBounds.top,
+            drawBounds.right + padding, drawBounds.bottom);
+
+    return commitOp(op, bounds, drawBounds);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Grouping
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Returns true if the two operations use the same program and texture and
+ * should therefore be drawn one after the other.
+ */
+bool DeferredDisplayList::canBatch(const DeferredDrawOp& a, const DeferredDrawOp& b) {
+    if (a.type != b.type) return false;
+
+    switch (a.type) {
+        case kOpBitmap:
+            return a.bitmap == b.bitmap;
+        case kOpText:
+            return a.paint == b.paint;
+        default:
+            return true;
+    }
+}
+
+/**
+ * Returns true if the two operations can be drawn with a single draw call.
+ * Merged operations ignore the clip and are positioned in window coordinates,
+ * which requires both of them to be unclipped and translated only.
+ */
+bool DeferredDisplayList::canMerge(const DeferredDrawOp& a, const DeferredDrawOp& b) {
+    if (a.type != b.type || a.paint != b.paint || a.state.alpha != b.state.alpha) {
+        return false;
+    }
+
+    if (!a.pureTranslate || !b.pureTranslate || !a.unclipped || !b.unclipped) {
+        return false;
+    }
+
+    switch (a.type) {
+        case kOpBitmap:
+            // Alpha bitmaps are drawn with the paint's color
+            return a.bitmap == b.bitmap && a.bitmap->getConfig() != SkBitmap::kA8_Config;
+        case kOpText:
+            // Text decorations are drawn as separate rectangles
+            return !(a.paint->getFlags() &
+                    (SkPaint::kUnderlineText_Flag | SkPaint::kStrikeThruText_Flag));
+        default:
+            return false;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Drawing
+///////////////////////////////////////////////////////////////////////////////
+
+status_t DeferredDisplayList::flush(OpenGLRenderer& renderer) {
+    status_t status = DrawGlInfo::kStatusDone;
+    if (mCount == 0) return status;
+
+    DEFER_LOGD("Flushing %d deferred operations", mCount);
+    mStats.flushes++;
+
+    int restoreTo = renderer.save(SkCanvas::kMatrix_SaveFlag | SkCanvas::kClip_SaveFlag);
+
+    for (uint32_t i = 0; i < mCount; i++) {
+        DeferredDrawOp& op = mOps[i];
+        if (op.drawn) continue;
+
+        uint32_t count = 0;
+        mBatch[count++] = i;
+        op.drawn = true;
+
+        for (uint32_t j = i + 1; j < mCount; j++) {
+            DeferredDrawOp& candidate = mOps[j];
+            if (candidate.drawn || !canBatch(op, candidate)) continue;
+
+            // An operation can only be drawn ahead of the operations it does not overlap
+            bool overlaps = false;
+            bool reordered = false;
+            for (uint32_t k = i + 1; k < j; k++) {
+                const DeferredDrawOp& other = mOps[k];
+                if (other.drawn) continue;
+                if (other.bounds.intersects(candidate.bounds)) {
+                    overlaps = true;
+                    break;
+                }
+                reordered = true;
+            }
+            if (overlaps) continue;
+
+            mBatch[count++] = j;
+            candidate.drawn = true;
+            if (reordered) mStats.reorderedOps++;
+        }
+
+        status |= drawBatch(renderer, mBatch, count);
+    }
+
+    renderer.restoreToCount(restoreTo);
+    mCount = 0;
+
+    return status;
+}
+
+status_t DeferredDisplayList::drawBatch(OpenGLRenderer& renderer, const uint32_t* indices,
+        uint32_t count) {
+    status_t status = DrawGlInfo::kStatusDone;
+    mStats.batches++;
+
+    uint32_t start = 0;
+    while (start < count) {
+        const DeferredDrawOp& first = mOps[indices[start]];
+
+        uint32_t end = start + 1;
+        while (end < count && canMerge(first, mOps[indices[end]]) &&
+                (first.type != kOpBitmap || end - start < MAX_MERGED_BITMAPS)) {
+            end++;
+        }
+
+        const uint32_t mergedCount = end - start;
+        if (mergedCount > 1) {
+            if (first.type == kOpBitmap) {
+                status |= drawMergedBitmaps(renderer, indices + start, mergedCount);
+            } else {
+                status |= drawMergedText(renderer, indices + start, mergedCount);
+            }
+        } else {
+            status |= drawOp(renderer, mOps[indices[start]]);
+        }
+
+        start = end;
+    }
+
+    return status;
+}
+
+status_t DeferredDisplayList::drawOp(OpenGLRenderer& renderer, DeferredDrawOp& op) {
+    renderer.restoreDisplayState(op.state);
+
+    switch (op.type) {
+        case kOpBitmap:
+            return renderer.drawBitmap(op.bitmap, op.left, op.top, op.paint);
+        case kOpRect:
+            return renderer.drawRect(op.left, op.top, op.right, op.bottom, op.paint);
+        case kOpText:
+            return renderer.drawText(op.text, op.bytesCount, op.count, op.left, op.top,
+                    op.positions, op.paint, op.length);
+    }
+
+    return DrawGlInfo::kStatusDone;
+}
+
+status_t DeferredDisplayList::drawMergedBitmaps(OpenGLRenderer& renderer,
+        const uint32_t* indices, uint32_t count) {
+    DeferredDrawOp& first = mOps[indices[0]];
+    renderer.restoreDisplayState(first.state);
+
+    // Same snapping as OpenGLRenderer::drawTextureRect()
+    float positions[MAX_MERGED_BITMAPS * 2];
+    for (uint32_t i = 0; i < count; i++) {
+        DeferredDrawOp& op = mOps[indices[i]];
+        positions[i * 2] = floorf(op.left + op.state.transform.getTranslateX() + 0.5f);
+        positions[i * 2 + 1] = floorf(op.top + op.state.transform.getTranslateY() + 0.5f);
+    }
+
+    mStats.mergedOps += count;
+    mStats.mergedDraws++;
+
+    return renderer.drawBitmaps(first.bitmap, positions, count, first.paint);
+}
+
+status_t DeferredDisplayList::drawMergedText(OpenGLRenderer& renderer,
+        const uint32_t* indices, uint32_t count) {
+    status_t status = DrawGlInfo::kStatusDone;
+
+    SkPaint* paint = mOps[indices[0]].paint;
+    const bool merged = renderer.startTextBatch(paint);
+
+    for (uint32_t i = 0; i < count; i++) {
+        status |= drawOp(renderer, mOps[indices[i]]);
+    }
+
+    if (merged) {
+        renderer.endTextBatch(paint);
+
+        mStats.mergedOps += count;
+        mStats.mergedDraws++;
+    }
+
+    return status;
+}
+
+}; // namespace uirenderer
+}; // namespace android
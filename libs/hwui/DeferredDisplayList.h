@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HWUI_DEFERRED_DISPLAY_LIST_H
+#define ANDROID_HWUI_DEFERRED_DISPLAY_LIST_H
+
+#include <SkBitmap.h>
+#include <SkPaint.h>
+
+#include <utils/Errors.h>
+
+#include "Debug.h"
+#include "Matrix.h"
+#include "Rect.h"
+
+namespace android {
+namespace uirenderer {
+
+///////////////////////////////////////////////////////////////////////////////
+// Defines
+///////////////////////////////////////////////////////////////////////////////
+
+// Maximum number of drawing operations deferred before they are drawn
+#define MAX_DEFERRED_OPS 64
+
+// Maximum number of bitmaps drawn with a single draw call
+#define MAX_MERGED_BITMAPS 32
+
+// Debug
+#if DEBUG_DEFER
+    #define DEFER_LOGD(...) ALOGD(__VA_ARGS__)
+#else
+    #define DEFER_LOGD(...)
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// Deferred display list
+///////////////////////////////////////////////////////////////////////////////
+
+class OpenGLRenderer;
+
+/**
+ * State of the renderer a deferred drawing operation must be drawn with.
+ */
+struct DeferredDisplayState {
+    mat4 transform;
+    // Clip, in the coordinates of the render target
+    Rect clip;
+    float alpha;
+}; // struct DeferredDisplayState
+
+/**
+ * Collects drawing operations during the replay of a display list tree and
+ * draws them later on, grouped by program, texture and paint whenever the
+ * visual result remains the same.
+ *
+ * Operations only move ahead of the operations they do not overlap. Bitmaps
+ * and text that share a texture and a paint, and need no clipping, are then
+ * merged into a single draw call.
+ */
+class DeferredDisplayList {
+public:
+    DeferredDisplayList();
+    ~DeferredDisplayList();
+
+    /**
+     * Statistics about the operations drawn during a frame.
+     */
+    struct Stats {
+        Stats() {
+            reset();
+        }
+
+        void reset() {
+            deferredOps = 0;
+            flushes = 0;
+            batches = 0;
+            reorderedOps = 0;
+            mergedOps = 0;
+            mergedDraws = 0;
+        }
+
+        // Number of operations that were deferred
+        uint32_t deferredOps;
+        // Number of times the deferred operations were drawn
+        uint32_t flushes;
+        // Number of groups of compatible operations drawn
+        uint32_t batches;
+        // Number of operations drawn before an operation recorded earlier
+        uint32_t reorderedOps;
+        // Number of operations drawn as part of a merged draw, and number of merged draws
+        uint32_t mergedOps;
+        uint32_t mergedDraws;
+    }; // struct Stats
+
+    bool isEmpty() const {
+        return mCount == 0;
+    }
+
+    /**
+     * The following methods defer a drawing operation. They return false if
+     * the operation cannot be deferred in the current state of the renderer,
+     * in which case the caller must flush the deferred operations and draw it
+     * immediately.
+     */
+    bool addDrawBitmap(OpenGLRenderer& renderer, SkBitmap* bitmap, float left, float top,
+            SkPaint* paint);
+    bool addDrawRect(OpenGLRenderer& renderer, float left, float top, float right, float bottom,
+            SkPaint* paint);
+    bool addDrawText(OpenGLRenderer& renderer, const char* text, int bytesCount, int count,
+            float x, float y, const float* positions, SkPaint* paint, float length);
+
+    /**
+     * Draws all the deferred operations with the specified renderer and empties the list.
+     */
+    status_t flush(OpenGLRenderer& renderer);
+
+    /**
+     * Discards the deferred operations without drawing them.
+     */
+    void clear() {
+        mCount = 0;
+    }
+
+    const Stats& getStats() const {
+        return mStats;
+    }
+
+    void resetStats() {
+        mStats.reset();
+    }
+
+private:
+    enum OpType {
+        kOpBitmap,
+        kOpRect,
+        kOpText
+    };
+
+    struct DeferredDrawOp {
+        OpType type;
+        DeferredDisplayState state;
+
+        // Area touched by the operation, in the coordinates of the render target
+        Rect bounds;
+        bool pureTranslate;
+        // True if the operation lies entirely within its clip
+        bool unclipped;
+        // Set once the operation has been picked for drawing during a flush
+        bool drawn;
+
+        SkPaint* paint;
+        SkBitmap* bitmap;
+        float left, top, right, bottom;
+        const char* text;
+        int bytesCount;
+        int count;
+        const float* positions;
+        float length;
+    }; // struct DeferredDrawOp
+
+    DeferredDrawOp* obtainOp(OpenGLRenderer& renderer, OpType type, SkPaint* paint);
+    bool commitOp(DeferredDrawOp* op, const Rect& bounds, const Rect& drawBounds);
+
+    static bool canBatch(const DeferredDrawOp& a, const DeferredDrawOp& b);
+    static bool canMerge(const DeferredDrawOp& a, const DeferredDrawOp& b);
+
+    status_t drawBatch(OpenGLRenderer& renderer, const uint32_t* indices, uint32_t count);
+    status_t drawOp(OpenGLRenderer& renderer, DeferredDrawOp& op);
+    status_t drawMergedBitmaps(OpenGLRenderer& renderer, const uint32_t* indices,
+            uint32_t count);
+    status_t drawMergedText(OpenGLRenderer& renderer, const uint32_t* indices, uint32_t count);
+
+    // Allocated the first time an operation is deferred
+    DeferredDrawOp* mOps;
+    uint32_t mCount;
+
+    // Indices of the operations drawn in the current batch
+    uint32_t mBatch[MAX_DEFERRED_OPS];
+
+    Stats mStats;
+}; // class DeferredDisplayList
+
+}; // namespace uirenderer
+}; // namespace android
+
+#endif // ANDROID_HWUI_DEFERRED_DISPLAY_LIST_H
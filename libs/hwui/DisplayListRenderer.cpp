@@ -132,9 +132,8 @@ void DisplayList::clearResources() {
     caches.unregisterFunctors(mFunctorCount);
     caches.resourceCache.lock();
 
-    for (size_t i = 0; i < mBitmapResources.size(); i++) {
-        caches.resourceCache.decrementRefcountLocked(mBitmapResources.itemAt(i));
-    }
+    caches.resourceCache.decrementRefcountsLocked(mBitmapResources.array(),
+            mBitmapResources.size());
 
     for (size_t i = 0; i < mOwnedBitmapResources.size(); i++) {
         SkBitmap* bitmap = mOwnedBitmapResources.itemAt(i);
@@ -142,22 +141,16 @@ void DisplayList::clearResources() {
         caches.resourceCache.destructorLocked(bitmap);
     }
 
-    for (size_t i = 0; i < mFilterResources.size(); i++) {
-        caches.resourceCache.decrementRefcountLocked(mFilterResources.itemAt(i));
-    }
+    caches.resourceCache.decrementRefcountsLocked(mFilterResources.array(),
+            mFilterResources.size());
 
     for (size_t i = 0; i < mShaders.size(); i++) {
         caches.resourceCache.decrementRefcountLocked(mShaders.itemAt(i));
         caches.resourceCache.destructorLocked(mShaders.itemAt(i));
     }
 
-    for (size_t i = 0; i < mSourcePaths.size(); i++) {
-        caches.resourceCache.decrementRefcountLocked(mSourcePaths.itemAt(i));
-    }
-
-    for (size_t i = 0; i < mLayers.size(); i++) {
-        caches.resourceCache.decrementRefcountLocked(mLayers.itemAt(i));
-    }
+    caches.resourceCache.decrementRefcountsLocked(mSourcePaths.array(), mSourcePaths.size());
+    caches.resourceCache.decrementRefcountsLocked(mLayers.array(), mLayers.size());
 
     caches.resourceCache.unlock();
 
@@ -217,44 +210,33 @@ void DisplayList::initFromDisplayListRenderer(const DisplayListRenderer& recorde
     caches.resourceCache.lock();
 
     const Vector<SkBitmap*>& bitmapResources = recorder.getBitmapResources();
-    for (size_t i = 0; i < bitmapResources.size(); i++) {
-        SkBitmap* resource = bitmapResources.itemAt(i);
-        mBitmapResources.add(resource);
-        caches.resourceCache.incrementRefcountLocked(resource);
-    }
+    mBitmapResources.appendVector(bitmapResources);
+    caches.resourceCache.incrementRefcountsLocked(bitmapResources.array(),
+            bitmapResources.size());
 
     const Vector<SkBitmap*> &ownedBitmapResources = recorder.getOwnedBitmapResources();
-    for (size_t i = 0; i < ownedBitmapResources.size(); i++) {
-        SkBitmap* resource = ownedBitmapResources.itemAt(i);
-        mOwnedBitmapResources.add(resource);
-        caches.resourceCache.incrementRefcountLocked(resource);
-    }
+    mOwnedBitmapResources.appendVector(ownedBitmapResources);
+    caches.resourceCache.incrementRefcountsLocked(ownedBitmapResources.array(),
+            ownedBitmapResources.size());
 
     const Vector<SkiaColorFilter*>& filterResources = recorder.getFilterResources();
-    for (size_t i = 0; i < filterResources.size(); i++) {
-        SkiaColorFilter* resource = filterResources.itemAt(i);
-        mFilterResources.add(resource);
-        caches.resourceCache.incrementRefcountLocked(resource);
-    }
+    mFilterResources.appendVector(filterResources);
+    caches.resourceCache.incrementRefcountsLocked(filterResources.array(),
+            filterResources.size());
 
     const Vector<SkiaShader*>& shaders = recorder.getShaders();
-    for (size_t i = 0; i < shaders.size(); i++) {
-        SkiaShader* resource = shaders.itemAt(i);
-        mShaders.add(resource);
-        caches.resourceCache.incrementRefcountLocked(resource);
-    }
+    mShaders.appendVector(shaders);
+    caches.resourceCache.incrementRefcountsLocked(shaders.array(), shaders.size());
 
     const SortedVector<SkPath*>& sourcePaths = recorder.getSourcePaths();
     for (size_t i = 0; i < sourcePaths.size(); i++) {
         mSourcePaths.add(sourcePaths.itemAt(i));
-        caches.resourceCache.incrementRefcountLocked(sourcePaths.itemAt(i));
     }
+    caches.resourceCache.incrementRefcountsLocked(sourcePaths.array(), sourcePaths.size());
 
     const Vector<Layer*>& layers = recorder.getLayers();
-    for (size_t i = 0; i < layers.size(); i++) {
-        mLayers.add(layers.itemAt(i));
-        caches.resourceCache.incrementRefcountLocked(layers.itemAt(i));
-    }
+    mLayers.appendVector(layers);
+    caches.resourceCache.incrementRefcountsLocked(layers.array(), layers.size());
 
     caches.resourceCache.unlock();
 
@@ -899,6 +881,11 @@ status_t DisplayList::replay(OpenGLRenderer& renderer, Rect& dirty, int32_t flag
     DisplayListLogBuffer& logBuffer = DisplayListLogBuffer::getInstance();
     int saveCount = renderer.getSaveCount() - 1;
 
+    // Bitmaps, rectangles and text can be deferred to be reordered and merged
+    // Any other drawing operation, or change of draw modifiers, must first
+    // draw the operations deferred so far
+    DeferredDisplayList* deferredList = renderer.getDeferredDisplayList();
+
     while (!mReader.eof()) {
         int op = mReader.readInt();
         if (op & OP_MAY_BE_SKIPPED_MASK) {
@@ -918,6 +905,11 @@ status_t DisplayList::replay(OpenGLRenderer& renderer, Rect& dirty, int32_t flag
         Caches::getInstance().eventMark(strlen(OP_NAMES[op]), OP_NAMES[op]);
 #endif
 
+        if (deferredList && op > DrawDisplayList &&
+                op != DrawBitmap && op != DrawRect && op != DrawText) {
+            drawGlStatus |= renderer.flushDeferredOps();
+        }
+
         switch (op) {
             case DrawGLFunction: {
                 Functor *functor = (Functor *) getInt();
@@ -1061,7 +1053,12 @@ status_t DisplayList::replay(OpenGLRenderer& renderer, Rect& dirty, int32_t flag
                 }
                 DISPLAY_LIST_LOGD("%s%s %p, %.2f, %.2f, %p", (char*) indent, OP_NAMES[op],
                         bitmap, x, y, paint);
-                drawGlStatus |= renderer.drawBitmap(bitmap, x, y, paint);
+                // The paint is only modified for the duration of the call
+                if (!deferredList || oldAlpha >= 0 ||
+                        !deferredList->addDrawBitmap(renderer, bitmap, x, y, paint)) {
+                    drawGlStatus |= renderer.flushDeferredOps();
+                    drawGlStatus |= renderer.drawBitmap(bitmap, x, y, paint);
+                }
                 if (oldAlpha >= 0) {
                     paint->setAlpha(oldAlpha);
                 }
@@ -1163,7 +1160,10 @@ status_t DisplayList::replay(OpenGLRenderer& renderer, Rect& dirty, int32_t flag
                 SkPaint* paint = getPaint(renderer);
                 DISPLAY_LIST_LOGD("%s%s %.2f, %.2f, %.2f, %.2f, %p", (char*) indent, OP_NAMES[op],
                         f1, f2, f3, f4, paint);
-                drawGlStatus |= renderer.drawRect(f1, f2, f3, f4, paint);
+                if (!deferredList || !deferredList->addDrawRect(renderer, f1, f2, f3, f4, paint)) {
+                    drawGlStatus |= renderer.flushDeferredOps();
+                    drawGlStatus |= renderer.drawRect(f1, f2, f3, f4, paint);
+                }
             }
             break;
             case DrawRoundRect: {
@@ -1273,8 +1273,12 @@ status_t DisplayList::replay(OpenGLRenderer& renderer, Rect& dirty, int32_t flag
                 float length = getFloat();
                 DISPLAY_LIST_LOGD("%s%s %s, %d, %d, %.2f, %.2f, %p, %.2f", (char*) indent,
                         OP_NAMES[op], text.text(), text.length(), count, x, y, paint, length);
-                drawGlStatus |= renderer.drawText(text.text(), text.length(), count,
-                        x, y, positions, paint, length);
+                if (!deferredList || !deferredList->addDrawText(renderer, text.text(),
+                        text.length(), count, x, y, positions, paint, length)) {
+                    drawGlStatus |= renderer.flushDeferredOps();
+                    drawGlStatus |= renderer.drawText(text.text(), text.length(), count,
+                            x, y, positions, paint, length);
+                }
             }
             break;
             case ResetShader: {
@@ -1362,29 +1366,15 @@ void DisplayListRenderer::reset() {
 
     mCaches.resourceCache.lock();
 
-    for (size_t i = 0; i < mBitmapResources.size(); i++) {
-        mCaches.resourceCache.decrementRefcountLocked(mBitmapResources.itemAt(i));
-    }
-
-    for (size_t i = 0; i < mOwnedBitmapResources.size(); i++) {
-        mCaches.resourceCache.decrementRefcountLocked(mOwnedBitmapResources.itemAt(i));
-    }
-
-    for (size_t i = 0; i < mFilterResources.size(); i++) {
-        mCaches.resourceCache.decrementRefcountLocked(mFilterResources.itemAt(i));
-    }
-
-    for (size_t i = 0; i < mShaders.size(); i++) {
-        mCaches.resourceCache.decrementRefcountLocked(mShaders.itemAt(i));
-    }
-
-    for (size_t i = 0; i < mSourcePaths.size(); i++) {
-        mCaches.resourceCache.decrementRefcountLocked(mSourcePaths.itemAt(i));
-    }
-
-    for (size_t i = 0; i < mLayers.size(); i++) {
-        mCaches.resourceCache.decrementRefcountLocked(mLayers.itemAt(i));
-    }
+    mCaches.resourceCache.decrementRefcountsLocked(mBitmapResources.array(),
+            mBitmapResources.size());
+    mCaches.resourceCache.decrementRefcountsLocked(mOwnedBitmapResources.array(),
+            mOwnedBitmapResources.size());
+    mCaches.resourceCache.decrementRefcountsLocked(mFilterResources.array(),
+            mFilterResources.size());
+    mCaches.resourceCache.decrementRefcountsLocked(mShaders.array(), mShaders.size());
+    mCaches.resourceCache.decrementRefcountsLocked(mSourcePaths.array(), mSourcePaths.size());
+    mCaches.resourceCache.decrementRefcountsLocked(mLayers.array(), mLayers.size());
 
     mCaches.resourceCache.unlock();
 
@@ -1437,7 +1427,7 @@ void DisplayListRenderer::setViewport(int width, int height) {
 
 status_t DisplayListRenderer::prepareDirty(float left, float top,
         float right, float bottom, bool opaque) {
-    mSnapshot = new Snapshot(mFirstSnapshot,
+    mSnapshot = new (mSnapshotPool) Snapshot(mFirstSnapshot,
             SkCanvas::kMatrix_SaveFlag | SkCanvas::kClip_SaveFlag);
     mSaveCount = 1;
 
@@ -1691,6 +1681,13 @@ status_t DisplayListRenderer::drawRoundRect(float left, float top, float right,
     addPoint(rx, ry);
     addPaint(paint);
     addSkip(location);
+
+    // The shape caches are only used by OpenGLRenderer for the shapes it
+    // cannot tessellate; let the shape rasterizer draw those in advance
+    if (!reject && paint->getPathEffect() != 0) {
+        mCaches.roundRectShapeCache.precacheRoundRect(right - left, bottom - top, rx, ry, paint);
+    }
+
     return DrawGlInfo::kStatusDone;
 }
 
@@ -1699,6 +1696,11 @@ status_t DisplayListRenderer::drawCircle(float x, float y, float radius, SkPaint
     addPoint(x, y);
     addFloat(radius);
     addPaint(paint);
+
+    if (paint->getPathEffect() != 0) {
+        mCaches.circleShapeCache.precacheCircle(radius, paint);
+    }
+
     return DrawGlInfo::kStatusDone;
 }
 
@@ -1707,6 +1709,11 @@ status_t DisplayListRenderer::drawOval(float left, float top, float right, float
     addOp(DisplayList::DrawOval);
     addBounds(left, top, right, bottom);
     addPaint(paint);
+
+    if (paint->getPathEffect() != 0) {
+        mCaches.ovalShapeCache.precacheOval(right - left, bottom - top, paint);
+    }
+
     return DrawGlInfo::kStatusDone;
 }
 
@@ -1717,6 +1724,15 @@ status_t DisplayListRenderer::drawArc(float left, float top, float right, float
     addPoint(startAngle, sweepAngle);
     addInt(useCenter ? 1 : 0);
     addPaint(paint);
+
+    // See OpenGLRenderer::drawArc()
+    if (fabs(sweepAngle) < 360.0f && (paint->getStyle() != SkPaint::kStroke_Style ||
+            paint->getPathEffect() != 0 || paint->getStrokeCap() != SkPaint::kButt_Cap ||
+            useCenter)) {
+        mCaches.arcShapeCache.precacheArc(right - left, bottom - top,
+                startAngle, sweepAngle, useCenter, paint);
+    }
+
     return DrawGlInfo::kStatusDone;
 }
 
@@ -1733,6 +1749,11 @@ status_t DisplayListRenderer::drawPath(SkPath* path, SkPaint* paint) {
     addPath(path);
     addPaint(paint);
     addSkip(location);
+
+    if (!reject) {
+        mCaches.pathCache.precache(path, paint);
+    }
+
     return DrawGlInfo::kStatusDone;
 }
 
@@ -45,6 +45,9 @@ FontRenderer::FontRenderer() {
     mInitialized = false;
     mMaxNumberOfQuads = 1024;
     mCurrentQuadIndex = 0;
+    mBatching = false;
+    mRenderStartQuad = 0;
+    mGlyphClock = 0;
 
     mTextMesh = NULL;
     mCurrentCacheTexture = NULL;
@@ -153,12 +156,14 @@ void FontRenderer::flushLargeCaches() {
             cacheTexture->releaseTexture();
         }
     }
+
+    mBlur.releaseScratch();
 }
 
 CacheTexture* FontRenderer::cacheBitmapInTexture(const SkGlyph& glyph,
-        uint32_t* startX, uint32_t* startY) {
+        uint32_t* startX, uint32_t* startY, uint16_t* shelf) {
     for (uint32_t i = 0; i < mCacheTextures.size(); i++) {
-        if (mCacheTextures[i]->fitBitmap(glyph, startX, startY)) {
+        if (mCacheTextures[i]->fitBitmap(glyph, startX, startY, shelf)) {
             return mCacheTextures[i];
         }
     }
@@ -166,6 +171,42 @@ CacheTexture* FontRenderer::cacheBitmapInTexture(const SkGlyph& glyph,
     return NULL;
 }
 
+CacheTexture* FontRenderer::evictAndCacheBitmap(const SkGlyph& glyph,
+        uint32_t* startX, uint32_t* startY, uint16_t* shelf) {
+    CacheTexture* victim = NULL;
+    ssize_t victimShelf = -1;
+
+    for (uint32_t i = 0; i < mCacheTextures.size(); i++) {
+        CacheTexture* cacheTexture = mCacheTextures[i];
+        // Textures without memory are empty, the glyph would have fit
+        if (!cacheTexture->getTexture()) continue;
+
+        ssize_t index = cacheTexture->findEvictableShelf(glyph);
+        if (index >= 0 && (!victim || cacheTexture->getShelfLastUse(index) <
+                victim->getShelfLastUse(victimShelf))) {
+            victim = cacheTexture;
+            victimShelf = index;
+        }
+    }
+
+    if (!victim) {
+        return NULL;
+    }
+
+    // The quads that were not drawn yet may use the glyphs we are about to evict
+    if (mCurrentQuadIndex != 0) {
+        issueDrawCommand();
+        mCurrentQuadIndex = 0;
+    }
+
+    victim->evictShelf(victimShelf);
+    for (uint32_t i = 0; i < mActiveFonts.size(); i++) {
+        mActiveFonts[i]->invalidateTextureCache(victim, victimShelf);
+    }
+
+    return victim->fitBitmap(glyph, startX, startY, shelf) ? victim : NULL;
+}
+
 void FontRenderer::cacheBitmap(const SkGlyph& glyph, CachedGlyphInfo* cachedGlyph,
         uint32_t* retOriginX, uint32_t* retOriginY, bool precaching) {
     checkInit();
@@ -181,15 +222,20 @@ void FontRenderer::cacheBitmap(const SkGlyph& glyph, CachedGlyphInfo* cachedGlyp
     // Now copy the bitmap into the cache texture
     uint32_t startX = 0;
     uint32_t startY = 0;
+    uint16_t shelf = 0;
 
-    CacheTexture* cacheTexture = cacheBitmapInTexture(glyph, &startX, &startY);
+    CacheTexture* cacheTexture = cacheBitmapInTexture(glyph, &startX, &startY, &shelf);
 
     if (!cacheTexture) {
         if (!precaching) {
             // If the new glyph didn't fit and we are not just trying to precache it,
-            // clear out the cache and try again
-            flushAllAndInvalidate();
-            cacheTexture = cacheBitmapInTexture(glyph, &startX, &startY);
+            // evict the glyphs that were used the least recently and try again
+            cacheTexture = evictAndCacheBitmap(glyph, &startX, &startY, &shelf);
+            if (!cacheTexture) {
+                // No shelf can hold the glyph, clear out the cache
+                flushAllAndInvalidate();
+                cacheTexture = cacheBitmapInTexture(glyph, &startX, &startY, &shelf);
+            }
         }
 
         if (!cacheTexture) {
@@ -199,6 +245,8 @@ void FontRenderer::cacheBitmap(const SkGlyph& glyph, CachedGlyphInfo* cachedGlyp
     }
 
     cachedGlyph->mCacheTexture = cacheTexture;
+    cachedGlyph->mShelf = shelf;
+    touchGlyph(cachedGlyph);
 
     *retOriginX = startX;
     *retOriginY = startY;
@@ -521,7 +569,7 @@ FontRenderer::DropShadow FontRenderer::renderDropShadow(SkPaint* paint, const ch
 
     mCurrentFont->render(paint, text, startIndex, len, numGlyphs, penX, penY,
             Font::BITMAP, dataBuffer, paddedWidth, paddedHeight, NULL, positions);
-    blurImage(dataBuffer, paddedWidth, paddedHeight, radius);
+    mBlur.blurImage(dataBuffer, paddedWidth, paddedHeight, radius);
 
     DropShadow image;
     image.width = paddedWidth;
@@ -539,13 +587,34 @@ void FontRenderer::initRender(const Rect* clip, Rect* bounds) {
     mDrawn = false;
     mBounds = bounds;
     mClip = clip;
+    mRenderStartQuad = mCurrentQuadIndex;
 }
 
 void FontRenderer::finishRender() {
     mBounds = NULL;
     mClip = NULL;
 
+    if (mBatching) {
+        // The quads are drawn by endBatch()
+        if (mCurrentQuadIndex != mRenderStartQuad) {
+            mDrawn = true;
+        }
+        return;
+    }
+
+    if (mCurrentQuadIndex != 0) {
+        issueDrawCommand();
+        mCurrentQuadIndex = 0;
+    }
+}
+
+void FontRenderer::endBatch() {
+    mBatching = false;
+
     if (mCurrentQuadIndex != 0) {
+        // Other draw calls may have changed the vertex pointers since the
+        // quads were appended
+        mDrawn = false;
         issueDrawCommand();
         mCurrentQuadIndex = 0;
     }
@@ -627,144 +696,5 @@ void FontRenderer::removeFont(const Font* font) {
     }
 }
 
-void FontRenderer::computeGaussianWeights(float* weights, int32_t radius) {
-    // Compute gaussian weights for the blur
-    // e is the euler's number
-    float e = 2.718281828459045f;
-    float pi = 3.1415926535897932f;
-    // g(x) = ( 1 / sqrt( 2 * pi ) * sigma) * e ^ ( -x^2 / 2 * sigma^2 )
-    // x is of the form [-radius .. 0 .. radius]
-    // and sigma varies with radius.
-    // Based on some experimental radius values and sigma's
-    // we approximately fit sigma = f(radius) as
-    // sigma = radius * 0.3  + 0.6
-    // The larger the radius gets, the more our gaussian blur
-    // will resemble a box blur since with large sigma
-    // the gaussian curve begins to lose its shape
-    float sigma = 0.3f * (float) radius + 0.6f;
-
-    // Now compute the coefficints
-    // We will store some redundant values to save some math during
-    // the blur calculations
-    // precompute some values
-    float coeff1 = 1.0f / (sqrt( 2.0f * pi ) * sigma);
-    float coeff2 = - 1.0f / (2.0f * sigma * sigma);
-
-    float normalizeFactor = 0.0f;
-    for (int32_t r = -radius; r <= radius; r ++) {
-        float floatR = (float) r;
-        weights[r + radius] = coeff1 * pow(e, floatR * floatR * coeff2);
-        normalizeFactor += weights[r + radius];
-    }
-
-    //Now we need to normalize the weights because all our coefficients need to add up to one
-    normalizeFactor = 1.0f / normalizeFactor;
-    for (int32_t r = -radius; r <= radius; r ++) {
-        weights[r + radius] *= normalizeFactor;
-    }
-}
-
-void FontRenderer::horizontalBlur(float* weights, int32_t radius,
-        const uint8_t* source, uint8_t* dest, int32_t width, int32_t height) {
-    float blurredPixel = 0.0f;
-    float currentPixel = 0.0f;
-
-    for (int32_t y = 0; y < height; y ++) {
-
-        const uint8_t* input = source + y * width;
-        uint8_t* output = dest + y * width;
-
-        for (int32_t x = 0; x < width; x ++) {
-            blurredPixel = 0.0f;
-            const float* gPtr = weights;
-            // Optimization for non-border pixels
-            if (x > radius && x < (width - radius)) {
-                const uint8_t *i = input + (x - radius);
-                for (int r = -radius; r <= radius; r ++) {
-                    currentPixel = (float) (*i);
-                    blurredPixel += currentPixel * gPtr[0];
-                    gPtr++;
-                    i++;
-                }
-            } else {
-                for (int32_t r = -radius; r <= radius; r ++) {
-                    // Stepping left and right away from the pixel
-                    int validW = x + r;
-                    if (validW < 0) {
-                        validW = 0;
-                    }
-                    if (validW > width - 1) {
-                        validW = width - 1;
-                    }
-
-                    currentPixel = (float) input[validW];
-                    blurredPixel += currentPixel * gPtr[0];
-                    gPtr++;
-                }
-            }
-            *output = (uint8_t)blurredPixel;
-            output ++;
-        }
-    }
-}
-
-void FontRenderer::verticalBlur(float* weights, int32_t radius,
-        const uint8_t* source, uint8_t* dest, int32_t width, int32_t height) {
-    float blurredPixel = 0.0f;
-    float currentPixel = 0.0f;
-
-    for (int32_t y = 0; y < height; y ++) {
-        uint8_t* output = dest + y * width;
-
-        for (int32_t x = 0; x < width; x ++) {
-            blurredPixel = 0.0f;
-            const float* gPtr = weights;
-            const uint8_t* input = source + x;
-            // Optimization for non-border pixels
-            if (y > radius && y < (height - radius)) {
-                const uint8_t *i = input + ((y - radius) * width);
-                for (int32_t r = -radius; r <= radius; r ++) {
-                    currentPixel = (float)(*i);
-                    blurredPixel += currentPixel * gPtr[0];
-                    gPtr++;
-                    i += width;
-                }
-            } else {
-                for (int32_t r = -radius; r <= radius; r ++) {
-                    int validH = y + r;
-                    // Clamp to zero and width
-                    if (validH < 0) {
-                        validH = 0;
-                    }
-                    if (validH > height - 1) {
-                        validH = height - 1;
-                    }
-
-                    const uint8_t *i = input + validH * width;
-                    currentPixel = (float) (*i);
-                    blurredPixel += currentPixel * gPtr[0];
-                    gPtr++;
-                }
-            }
-            *output = (uint8_t) blurredPixel;
-            output++;
-        }
-    }
-}
-
-
-void FontRenderer::blurImage(uint8_t *image, int32_t width, int32_t height, int32_t radius) {
-    float *gaussian = new float[2 * radius + 1];
-    computeGaussianWeights(gaussian, radius);
-
-    uint8_t* scratch = new uint8_t[width * height];
-
-    horizontalBlur(gaussian, radius, image, scratch, width, height);
-    verticalBlur(gaussian, radius, scratch, image, width, height);
-
-    delete[] gaussian;
-    delete[] scratch;
-}
-
 }; // namespace uirenderer
 }; // namespace android
@@ -27,6 +27,7 @@
 #include "font/CacheTexture.h"
 #include "font/CachedGlyphInfo.h"
 #include "font/Font.h"
+#include "utils/Blur.h"
 #include "Properties.h"
 
 namespace android {
@@ -61,6 +62,14 @@ public:
     bool renderTextOnPath(SkPaint* paint, const Rect* clip, const char *text, uint32_t startIndex,
             uint32_t len, int numGlyphs, SkPath* path, float hOffset, float vOffset, Rect* bounds);
 
+    // Between startBatch() and endBatch(), the glyphs of successive render calls are
+    // accumulated and drawn together by endBatch(). The GL state set up for the last
+    // render call is used to draw the whole batch.
+    void startBatch() {
+        mBatching = true;
+    }
+    void endBatch();
+
     struct DropShadow {
         DropShadow() { };
 
@@ -113,7 +122,10 @@ private:
     CacheTexture* createCacheTexture(int width, int height, bool allocate);
     void cacheBitmap(const SkGlyph& glyph, CachedGlyphInfo* cachedGlyph,
             uint32_t *retOriginX, uint32_t *retOriginY, bool precaching);
-    CacheTexture* cacheBitmapInTexture(const SkGlyph& glyph, uint32_t* startX, uint32_t* startY);
+    CacheTexture* cacheBitmapInTexture(const SkGlyph& glyph, uint32_t* startX, uint32_t* startY,
+            uint16_t* shelf);
+    CacheTexture* evictAndCacheBitmap(const SkGlyph& glyph, uint32_t* startX, uint32_t* startY,
+            uint16_t* shelf);
 
     void flushAllAndInvalidate();
     void initVertexArrayBuffers();
@@ -144,6 +156,13 @@ private:
         mUploadTexture = true;
     }
 
+    /**
+     * Marks the shelf holding the specified glyph as the most recently used one.
+     */
+    void touchGlyph(CachedGlyphInfo* glyph) {
+        glyph->mCacheTexture->touchShelf(glyph->mShelf, ++mGlyphClock);
+    }
+
     uint32_t mSmallCacheWidth;
     uint32_t mSmallCacheHeight;
     uint32_t mLargeCacheWidth;
@@ -159,6 +178,11 @@ private:
 
     bool mUploadTexture;
 
+    // Incremented every time a glyph is used, orders the shelves of the cache
+    // textures from the least to the most recently used. 64 bits so that it
+    // never wraps around, which would make the busiest shelves look unused
+    uint64_t mGlyphClock;
+
     // Pointer to vertex data to speed up frame to frame work
     float* mTextMesh;
     uint32_t mCurrentQuadIndex;
@@ -170,17 +194,16 @@ private:
     Rect* mBounds;
     bool mDrawn;
 
+    bool mBatching;
+    // Index of the first quad appended by the current render call
+    uint32_t mRenderStartQuad;
+
     bool mInitialized;
 
     bool mLinearFiltering;
 
-    /** We should consider multi-threading this code or using Renderscript **/
-    static void computeGaussianWeights(float* weights, int32_t radius);
-    static void horizontalBlur(float* weights, int32_t radius, const uint8_t *source, uint8_t *dest,
-            int32_t width, int32_t height);
-    static void verticalBlur(float* weights, int32_t radius, const uint8_t *source, uint8_t *dest,
-            int32_t width, int32_t height);
-    static void blurImage(uint8_t* image, int32_t width, int32_t height, int32_t radius);
+    // Keeps the blur weights and buffers between drop shadows
+    Blur mBlur;
 };
 
 }; // namespace uirenderer
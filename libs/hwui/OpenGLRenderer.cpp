@@ -117,9 +117,11 @@ OpenGLRenderer::OpenGLRenderer(): mCaches(Caches::getInstance()) {
 
     memcpy(mMeshVertices, gMeshVertices, sizeof(gMeshVertices));
 
-    mFirstSnapshot = new Snapshot;
+    mFirstSnapshot = new (mSnapshotPool) Snapshot;
 
     mScissorOptimizationDisabled = false;
+    mDeferredReplayEnabled = false;
+    mDeferringOps = false;
 }
 
 OpenGLRenderer::~OpenGLRenderer() {
@@ -136,6 +138,12 @@ void OpenGLRenderer::initProperties() {
     } else {
         INIT_LOGD("  Scissor optimization enabled");
     }
+
+    if (property_get(PROPERTY_DEFERRED_REPLAY, property, "false")) {
+        mDeferredReplayEnabled = !strcasecmp(property, "true");
+    }
+    INIT_LOGD("  Deferred display list replay %s",
+            mDeferredReplayEnabled ? "enabled" : "disabled");
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -172,8 +180,9 @@ status_t OpenGLRenderer::prepare(bool opaque) {
 status_t OpenGLRenderer::prepareDirty(float left, float top, float right, float bottom,
         bool opaque) {
     mCaches.clearGarbage();
+    mDeferredDisplayList.resetStats();
 
-    mSnapshot = new Snapshot(mFirstSnapshot,
+    mSnapshot = new (mSnapshotPool) Snapshot(mFirstSnapshot,
             SkCanvas::kMatrix_SaveFlag | SkCanvas::kClip_SaveFlag);
     mSnapshot->fbo = getTargetFbo();
     mSaveCount = 1;
@@ -270,6 +279,15 @@ void OpenGLRenderer::finish() {
     renderOverdraw();
     endTiling();
 
+#if DEBUG_DEFER
+    if (mDeferredReplayEnabled) {
+        const DeferredDisplayList::Stats& stats = mDeferredDisplayList.getStats();
+        DEFER_LOGD("Deferred %d ops in %d flushes, %d batches, %d reordered, "
+                "%d merged into %d draws", stats.deferredOps, stats.flushes, stats.batches,
+                stats.reorderedOps, stats.mergedOps, stats.mergedDraws);
+    }
+#endif
+
     if (!suppressErrorChecks()) {
 #if DEBUG_OPENGL
         GLenum status = GL_NO_ERROR;
@@ -581,7 +599,7 @@ void OpenGLRenderer::restoreToCount(int saveCount) {
 }
 
 int OpenGLRenderer::saveSnapshot(int flags) {
-    mSnapshot = new Snapshot(mSnapshot, flags);
+    mSnapshot = new (mSnapshotPool) Snapshot(mSnapshot, flags);
     return mSaveCount++;
 }
 
@@ -590,6 +608,11 @@ bool OpenGLRenderer::restoreSnapshot() {
     bool restoreLayer = mSnapshot->flags & Snapshot::kFlagIsLayer;
     bool restoreOrtho = mSnapshot->flags & Snapshot::kFlagDirtyOrtho;
 
+    // Deferred operations must be drawn into the layer before it is composed
+    if (restoreLayer) {
+        flushDeferredOps();
+    }
+
     sp<Snapshot> current = mSnapshot;
     sp<Snapshot> previous = mSnapshot->previous;
 
@@ -619,6 +642,8 @@ bool OpenGLRenderer::restoreSnapshot() {
 
 int OpenGLRenderer::saveLayer(float left, float top, float right, float bottom,
         SkPaint* p, int flags) {
+    flushDeferredOps();
+
     const GLuint previousFbo = mSnapshot->fbo;
     const int count = saveSnapshot(flags);
 
@@ -1189,26 +1214,26 @@ void OpenGLRenderer::clearLayerRegions() {
 ///////////////////////////////////////////////////////////////////////////////
 
 void OpenGLRenderer::translate(float dx, float dy) {
-    mSnapshot->transform->translate(dx, dy, 0.0f);
+    mSnapshot->editTransform()->translate(dx, dy, 0.0f);
 }
 
 void OpenGLRenderer::rotate(float degrees) {
-    mSnapshot->transform->rotate(degrees, 0.0f, 0.0f, 1.0f);
+    mSnapshot->editTransform()->rotate(degrees, 0.0f, 0.0f, 1.0f);
 }
 
 void OpenGLRenderer::scale(float sx, float sy) {
-    mSnapshot->transform->scale(sx, sy, 1.0f);
+    mSnapshot->editTransform()->scale(sx, sy, 1.0f);
 }
 
 void OpenGLRenderer::skew(float sx, float sy) {
-    mSnapshot->transform->skew(sx, sy);
+    mSnapshot->editTransform()->skew(sx, sy);
 }
 
 void OpenGLRenderer::setMatrix(SkMatrix* matrix) {
     if (matrix) {
-        mSnapshot->transform->load(*matrix);
+        mSnapshot->editTransform()->load(*matrix);
     } else {
-        mSnapshot->transform->loadIdentity();
+        mSnapshot->editTransform()->loadIdentity();
     }
 }
 
@@ -1220,7 +1245,7 @@ void OpenGLRenderer::concatMatrix(SkMatrix* matrix) {
     SkMatrix transform;
     mSnapshot->transform->copyTo(transform);
     transform.preConcat(*matrix);
-    mSnapshot->transform->load(transform);
+    mSnapshot->editTransform()->load(transform);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -1455,6 +1480,22 @@ void OpenGLRenderer::setupDrawModelViewTranslate(float left, float top, float ri
     }
 }
 
+void OpenGLRenderer::setupDrawModelViewTranslate(float translateX, float translateY,
+        const SkRect& bounds, bool ignoreTransform) {
+    mModelView.loadTranslate(translateX, translateY, 0.0f);
+    float left = translateX + bounds.fLeft;
+    float top = translateY + bounds.fTop;
+    float right = translateX + bounds.fRight;
+    float bottom = translateY + bounds.fBottom;
+    if (!ignoreTransform) {
+        mCaches.currentProgram->set(mOrthoMatrix, mModelView, *mSnapshot->transform);
+        if (mTrackDirtyRegions) dirtyLayer(left, top, right, bottom, *mSnapshot->transform);
+    } else {
+        mCaches.currentProgram->set(mOrthoMatrix, mModelView, mIdentity);
+        if (mTrackDirtyRegions) dirtyLayer(left, top, right, bottom);
+    }
+}
+
 void OpenGLRenderer::setupDrawModelViewIdentity(bool offset) {
     mCaches.currentProgram->set(mOrthoMatrix, mIdentity, *mSnapshot->transform, offset);
 }
@@ -1626,6 +1667,13 @@ status_t OpenGLRenderer::drawDisplayList(DisplayList* displayList,
     // All the usual checks and setup operations (quickReject, setupDraw, etc.)
     // will be performed by the display list itself
     if (displayList && displayList->isRenderable()) {
+        if (level == 0 && mDeferredReplayEnabled && !mDeferringOps) {
+            mDeferringOps = true;
+            status_t status = displayList->replay(*this, dirty, flags, level);
+            status |= flushDeferredOps();
+            mDeferringOps = false;
+            return status;
+        }
         return displayList->replay(*this, dirty, flags, level);
     }
 
@@ -1638,6 +1686,132 @@ void OpenGLRenderer::outputDisplayList(DisplayList* displayList, uint32_t level)
     }
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Deferred drawing
+///////////////////////////////////////////////////////////////////////////////
+
+status_t OpenGLRenderer::flushDeferredOps() {
+    if (!mDeferringOps || mDeferredDisplayList.isEmpty()) {
+        return DrawGlInfo::kStatusDone;
+    }
+
+    // Drawing the deferred operations must not defer them again
+    mDeferringOps = false;
+    status_t status = mDeferredDisplayList.flush(*this);
+    mDeferringOps = true;
+
+    return status;
+}
+
+bool OpenGLRenderer::storeDisplayState(DeferredDisplayState& state) {
+    if (mSnapshot->isIgnored()) {
+        return false;
+    }
+
+    // The draw modifiers are set and reset by the display list itself,
+    // they might not have the same value when the operation is drawn
+    if (mShader || mColorFilter || mHasShadow || mHasDrawFilter) {
+        return false;
+    }
+
+#if STENCIL_BUFFER_SIZE
+    if (mSnapshot->clipRegion) {
+        return false;
+    }
+#endif
+
+    if (mSnapshot->transform->isPerspective()) {
+        return false;
+    }
+
+    state.transform.load(*mSnapshot->transform);
+    state.clip.set(*mSnapshot->clipRect);
+    state.alpha = mSnapshot->alpha;
+
+    return true;
+}
+
+void OpenGLRenderer::restoreDisplayState(const DeferredDisplayState& state) {
+    mSnapshot->editTransform()->load(state.transform);
+
+    const Rect& clip = state.clip;
+    Rect* currentClip = mSnapshot->clipRect;
+    if (currentClip->left != clip.left || currentClip->top != clip.top ||
+            currentClip->right != clip.right || currentClip->bottom != clip.bottom) {
+        mSnapshot->setClip(clip.left, clip.top, clip.right, clip.bottom);
+        dirtyClip();
+    }
+
+    mSnapshot->alpha = state.alpha;
+}
+
+status_t OpenGLRenderer::drawBitmaps(SkBitmap* bitmap, const float* positions, int count,
+        SkPaint* paint) {
+    mCaches.activeTexture(0);
+    Texture* texture = mCaches.textureCache.get(bitmap);
+    if (!texture) return DrawGlInfo::kStatusDone;
+    const AutoTexture autoCleanup(texture);
+
+    int alpha;
+    SkXfermode::Mode mode;
+    getAlphaAndMode(paint, &alpha, &mode);
+
+    texture->setWrap(GL_CLAMP_TO_EDGE, true);
+    texture->setFilter(GL_NEAREST, true);
+
+    const float width = texture->width;
+    const float height = texture->height;
+
+    Rect bounds(positions[0], positions[1], positions[0] + width, positions[1] + height);
+    for (int i = 1; i < count; i++) {
+        bounds.unionWith(Rect(positions[i * 2], positions[i * 2 + 1],
+                positions[i * 2] + width, positions[i * 2 + 1] + height));
+    }
+
+    // The mesh is positioned relative to the bounds of the batch
+    TextureVertex mesh[count * 6];
+    TextureVertex* vertex = &mesh[0];
+
+    for (int i = 0; i < count; i++) {
+        const float left = positions[i * 2] - bounds.left;
+        const float top = positions[i * 2 + 1] - bounds.top;
+        const float right = left + width;
+        const float bottom = top + height;
+
+        TextureVertex::set(vertex++, left, bottom, 0.0f, 1.0f);
+        TextureVertex::set(vertex++, left, top, 0.0f, 0.0f);
+        TextureVertex::set(vertex++, right, top, 1.0f, 0.0f);
+
+        TextureVertex::set(vertex++, left, bottom, 0.0f, 1.0f);
+        TextureVertex::set(vertex++, right, top, 1.0f, 0.0f);
+        TextureVertex::set(vertex++, right, bottom, 1.0f, 1.0f);
+    }
+
+    // The deferred list only merges bitmaps that are entirely within their clip
+    mCaches.setScissorEnabled(false);
+
+    drawTextureMesh(bounds.left, bounds.top, bounds.right, bounds.bottom, texture->id,
+            alpha / 255.0f, mode, texture->blend, &mesh[0].position[0], &mesh[0].texture[0],
+            GL_TRIANGLES, count * 6, false, true, 0, true);
+
+    return DrawGlInfo::kStatusDrew;
+}
+
+bool OpenGLRenderer::startTextBatch(SkPaint* paint) {
+    // Batched text is drawn without scissor
+    if (mScissorOptimizationDisabled) {
+        return false;
+    }
+
+    mCaches.fontRenderer->getFontRenderer(paint).startBatch();
+    return true;
+}
+
+void OpenGLRenderer::endTextBatch(SkPaint* paint) {
+    mCaches.setScissorEnabled(false);
+    mCaches.fontRenderer->getFontRenderer(paint).endBatch();
+}
+
 void OpenGLRenderer::drawAlphaBitmap(Texture* texture, float left, float top, SkPaint* paint) {
     int alpha;
     SkXfermode::Mode mode;
@@ -1957,18 +2131,18 @@ status_t OpenGLRenderer::drawPatch(SkBitmap* bitmap, const int32_t* xDivs, const
  * translucency of the color from its position, we simply use a varying parameter to define how far
  * a given pixel is from the edge. For non-AA paths, the expansion and alpha varying are not used.
  *
+ * The tessellation is done by TessellationCache, relative to the top-left corner of the shape,
+ * so that identical shapes drawn at different positions share their vertices.
+ *
  * Doesn't yet support joins, caps, or path effects.
  */
-void OpenGLRenderer::drawConvexPath(const SkPath& path, SkPaint* paint) {
+void OpenGLRenderer::drawConvexShape(float left, float top, const Tessellation* tessellation,
+        SkPaint* paint) {
     int color = paint->getColor();
-    SkPaint::Style style = paint->getStyle();
     SkXfermode::Mode mode = getXfermode(paint->getXfermode());
     bool isAA = paint->isAntiAlias();
 
-    VertexBuffer vertexBuffer;
-    // TODO: try clipping large paths to viewport
-    PathRenderer::convexPathVertices(path, paint, mSnapshot->transform, vertexBuffer);
-
+    const VertexBuffer& vertexBuffer = tessellation->vertexBuffer;
     if (!vertexBuffer.getSize()) {
         // no vertices to draw
         return;
@@ -1983,10 +2157,10 @@ void OpenGLRenderer::drawConvexPath(const SkPath& path, SkPaint* paint) {
     setupDrawShader();
     setupDrawBlending(isAA, mode);
     setupDrawProgram();
-    setupDrawModelViewIdentity();
+    setupDrawModelViewTranslate(left, top, tessellation->bounds);
     setupDrawColorUniforms();
     setupDrawColorFilterUniforms();
-    setupDrawShaderIdentityUniforms();
+    setupDrawShaderUniforms();
 
     void* vertices = vertexBuffer.getBuffer();
     bool force = mCaches.unbindMeshBuffer();
@@ -2004,9 +2178,6 @@ void OpenGLRenderer::drawConvexPath(const SkPath& path, SkPaint* paint) {
         glVertexAttribPointer(alphaSlot, 1, GL_FLOAT, GL_FALSE, gAlphaVertexStride, alphaCoords);
     }
 
-    SkRect bounds = PathRenderer::computePathBounds(path, paint);
-    dirtyLayer(bounds.fLeft, bounds.fTop, bounds.fRight, bounds.fBottom, *mSnapshot->transform);
-
     glDrawArrays(GL_TRIANGLE_STRIP, 0, vertexBuffer.getSize());
 
     if (isAA) {
@@ -2351,7 +2522,7 @@ status_t OpenGLRenderer::drawColor(int color, SkXfermode::Mode mode) {
     // No need to check against the clip, we fill the clip region
     if (mSnapshot->isIgnored()) return DrawGlInfo::kStatusDone;
 
-    Rect& clip(*mSnapshot->clipRect);
+    Rect& clip(*mSnapshot->editClipRect());
     clip.snapToPixelBoundaries();
 
     drawColorRect(clip.left, clip.top, clip.right, clip.bottom, color, mode, true);
@@ -2385,16 +2556,9 @@ status_t OpenGLRenderer::drawRoundRect(float left, float top, float right, float
         return drawShape(left, top, texture, p);
     }
 
-    SkPath path;
-    SkRect rect = SkRect::MakeLTRB(left, top, right, bottom);
-    if (p->getStyle() == SkPaint::kStrokeAndFill_Style) {
-        float outset = p->getStrokeWidth() / 2;
-        rect.outset(outset, outset);
-        rx += outset;
-        ry += outset;
-    }
-    path.addRoundRect(rect, rx, ry);
-    drawConvexPath(path, p);
+    const Tessellation* tessellation = mCaches.tessellationCache.getRoundRect(
+            right - left, bottom - top, rx, ry, p, mSnapshot->transform);
+    drawConvexShape(left, top, tessellation, p);
 
     return DrawGlInfo::kStatusDrew;
 }
@@ -2410,13 +2574,9 @@ status_t OpenGLRenderer::drawCircle(float x, float y, float radius, SkPaint* p)
         return drawShape(x - radius, y - radius, texture, p);
     }
 
-    SkPath path;
-    if (p->getStyle() == SkPaint::kStrokeAndFill_Style) {
-        path.addCircle(x, y, radius + p->getStrokeWidth() / 2);
-    } else {
-        path.addCircle(x, y, radius);
-    }
-    drawConvexPath(path, p);
+    const Tessellation* tessellation = mCaches.tessellationCache.getCircle(radius, p,
+            mSnapshot->transform);
+    drawConvexShape(x - radius, y - radius, tessellation, p);
 
     return DrawGlInfo::kStatusDrew;
 }
@@ -2433,13 +2593,9 @@ status_t OpenGLRenderer::drawOval(float left, float top, float right, float bott
         return drawShape(left, top, texture, p);
     }
 
-    SkPath path;
-    SkRect rect = SkRect::MakeLTRB(left, top, right, bottom);
-    if (p->getStyle() == SkPaint::kStrokeAndFill_Style) {
-        rect.outset(p->getStrokeWidth() / 2, p->getStrokeWidth() / 2);
-    }
-    path.addOval(rect);
-    drawConvexPath(path, p);
+    const Tessellation* tessellation = mCaches.tessellationCache.getOval(
+            right - left, bottom - top, p, mSnapshot->transform);
+    drawConvexShape(left, top, tessellation, p);
 
     return DrawGlInfo::kStatusDrew;
 }
@@ -2462,20 +2618,10 @@ status_t OpenGLRenderer::drawArc(float left, float top, float right, float botto
         return drawShape(left, top, texture, p);
     }
 
-    SkRect rect = SkRect::MakeLTRB(left, top, right, bottom);
-    if (p->getStyle() == SkPaint::kStrokeAndFill_Style) {
-        rect.outset(p->getStrokeWidth() / 2, p->getStrokeWidth() / 2);
-    }
-
-    SkPath path;
-    if (useCenter) {
-        path.moveTo(rect.centerX(), rect.centerY());
-    }
-    path.arcTo(rect, startAngle, sweepAngle, !useCenter);
-    if (useCenter) {
-        path.close();
-    }
-    drawConvexPath(path, p);
+    const Tessellation* tessellation = mCaches.tessellationCache.getArc(
+            right - left, bottom - top, startAngle, sweepAngle, useCenter, p,
+            mSnapshot->transform);
+    drawConvexShape(left, top, tessellation, p);
 
     return DrawGlInfo::kStatusDrew;
 }
@@ -2489,7 +2635,7 @@ status_t OpenGLRenderer::drawRect(float left, float top, float right, float bott
     }
 
     if (p->getStyle() != SkPaint::kFill_Style) {
-        // only fill style is supported by drawConvexPath, since others have to handle joins
+        // only fill style is supported by drawConvexShape, since others have to handle joins
         if (p->getPathEffect() != 0 || p->getStrokeJoin() != SkPaint::kMiter_Join ||
                 p->getStrokeMiter() != SkPaintDefaults_MiterLimit) {
             mCaches.activeTexture(0);
@@ -2498,21 +2644,17 @@ status_t OpenGLRenderer::drawRect(float left, float top, float right, float bott
             return drawShape(left, top, texture, p);
         }
 
-        SkPath path;
-        SkRect rect = SkRect::MakeLTRB(left, top, right, bottom);
-        if (p->getStyle() == SkPaint::kStrokeAndFill_Style) {
-            rect.outset(p->getStrokeWidth() / 2, p->getStrokeWidth() / 2);
-        }
-        path.addRect(rect);
-        drawConvexPath(path, p);
+        const Tessellation* tessellation = mCaches.tessellationCache.getRect(
+                right - left, bottom - top, p, mSnapshot->transform);
+        drawConvexShape(left, top, tessellation, p);
 
         return DrawGlInfo::kStatusDrew;
     }
 
     if (p->isAntiAlias() && !mSnapshot->transform->isSimple()) {
-        SkPath path;
-        path.addRect(left, top, right, bottom);
-        drawConvexPath(path, p);
+        const Tessellation* tessellation = mCaches.tessellationCache.getRect(
+                right - left, bottom - top, p, mSnapshot->transform);
+        drawConvexShape(left, top, tessellation, p);
     } else {
         drawColorRect(left, top, right, bottom, p->getColor(), getXfermode(p->getXfermode()));
     }
@@ -2814,7 +2956,7 @@ status_t OpenGLRenderer::drawLayer(Layer* layer, float x, float y, SkPaint* pain
         transform = &layer->getTransform();
         if (!transform->isIdentity()) {
             save(0);
-            mSnapshot->transform->multiply(*transform);
+            mSnapshot->editTransform()->multiply(*transform);
         }
     }
 
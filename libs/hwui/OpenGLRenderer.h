@@ -35,6 +35,7 @@
 #include <cutils/compiler.h>
 
 #include "Debug.h"
+#include "DeferredDisplayList.h"
 #include "Extensions.h"
 #include "Matrix.h"
 #include "Program.h"
@@ -216,6 +217,52 @@ public:
 
     SkPaint* filterPaint(SkPaint* paint);
 
+    /**
+     * Returns the list drawing operations must be added to when replaying a
+     * display list, or NULL if they must be drawn immediately. Operations are
+     * only deferred when PROPERTY_DEFERRED_REPLAY is set.
+     */
+    DeferredDisplayList* getDeferredDisplayList() {
+        return mDeferringOps ? &mDeferredDisplayList : NULL;
+    }
+
+    /**
+     * Draws the deferred drawing operations, if any. This method must be
+     * invoked before drawing anything that was not deferred.
+     */
+    status_t flushDeferredOps();
+
+    /**
+     * Copies the state a deferred operation must be drawn with. Returns false
+     * if the current state cannot be captured, in which case the operation
+     * must be drawn immediately.
+     */
+    bool storeDisplayState(DeferredDisplayState& state);
+
+    /**
+     * Restores a state previously captured with storeDisplayState().
+     */
+    void restoreDisplayState(const DeferredDisplayState& state);
+
+    /**
+     * Draws the same bitmap at several positions with a single draw call.
+     * The positions are expressed in the coordinates of the render target
+     * and the bitmaps are not clipped.
+     */
+    status_t drawBitmaps(SkBitmap* bitmap, const float* positions, int count, SkPaint* paint);
+
+    /**
+     * Starts accumulating the glyphs of the text drawn with the specified
+     * paint so they can be drawn with a single draw call by endTextBatch().
+     * Returns false if the text cannot be batched.
+     */
+    bool startTextBatch(SkPaint* paint);
+    void endTextBatch(SkPaint* paint);
+
+    const DeferredDisplayList::Stats& getDeferredStats() const {
+        return mDeferredDisplayList.getStats();
+    }
+
     /**
      * Sets the alpha on the current snapshot. This alpha value will be modulated
      * with other alpha values when drawing primitives.
@@ -524,12 +571,15 @@ private:
     void drawAlphaBitmap(Texture* texture, float left, float top, SkPaint* paint);
 
     /**
-     * Renders the convex hull defined by the specified path as a strip of polygons.
+     * Renders a tessellated convex shape as a strip of polygons.
      *
-     * @param path The hull of the path to draw
+     * @param left The left coordinate of the shape
+     * @param top The top coordinate of the shape
+     * @param tessellation The vertices of the shape, relative to left and top
      * @param paint The paint to render with
      */
-    void drawConvexPath(const SkPath& path, SkPaint* paint);
+    void drawConvexShape(float left, float top, const Tessellation* tessellation,
+            SkPaint* paint);
 
     /**
      * Draws a textured rectangle with the specified texture. The specified coordinates
@@ -711,6 +761,8 @@ private:
             bool ignoreTransform = false, bool ignoreModelView = false);
     void setupDrawModelViewTranslate(float left, float top, float right, float bottom,
             bool ignoreTransform = false);
+    void setupDrawModelViewTranslate(float translateX, float translateY, const SkRect& bounds,
+            bool ignoreTransform = false);
     void setupDrawPointUniforms();
     void setupDrawColorUniforms();
     void setupDrawPureColorUniforms();
@@ -762,6 +814,8 @@ private:
 
     // Number of saved states
     int mSaveCount;
+    // Storage of the snapshots, must be declared before them
+    SnapshotPool mSnapshotPool;
     // Base state
     sp<Snapshot> mFirstSnapshot;
     // Current state
@@ -826,6 +880,12 @@ private:
     // Properties.h
     bool mScissorOptimizationDisabled;
 
+    // See PROPERTY_DEFERRED_REPLAY in Properties.h
+    bool mDeferredReplayEnabled;
+    // True while replaying a display list tree with deferred operations
+    bool mDeferringOps;
+    DeferredDisplayList mDeferredDisplayList;
+
     // No-ops start/endTiling when set
     bool mSuppressTiling;
 
@@ -35,9 +35,9 @@ Patch::Patch(const uint32_t xCount, const uint32_t yCount, const int8_t emptyQua
         mXCount(xCount), mYCount(yCount), mEmptyQuads(emptyQuads) {
     // Initialized with the maximum number of vertices we will need
     // 2 triangles per patch, 3 vertices per triangle
-    uint32_t maxVertices = ((xCount + 1) * (yCount + 1) - emptyQuads) * 2 * 3;
-    mVertices = new TextureVertex[maxVertices];
-    mUploaded = false;
+    mMaxVertices = ((xCount + 1) * (yCount + 1) - emptyQuads) * 2 * 3;
+    mVertices = new TextureVertex[mMaxVertices];
+    mUploadedVertices = 0;
 
     verticesCount = 0;
     hasEmptyQuads = emptyQuads > 0;
@@ -47,7 +47,7 @@ Patch::Patch(const uint32_t xCount, const uint32_t yCount, const int8_t emptyQua
     mYDivs = new int32_t[mYCount];
 
     PATCH_LOGD("    patch: xCount = %d, yCount = %d, emptyQuads = %d, max vertices = %d",
-            xCount, yCount, emptyQuads, maxVertices);
+            xCount, yCount, emptyQuads, mMaxVertices);
 
     glGenBuffers(1, &meshBuffer);
 }
@@ -102,6 +102,11 @@ bool Patch::matches(const int32_t* xDivs, const int32_t* yDivs, const uint32_t c
     return true;
 }
 
+uint32_t Patch::getSize() const {
+    return (mMaxVertices + mUploadedVertices) * sizeof(TextureVertex) +
+            (mXCount + mYCount) * sizeof(int32_t);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Vertices management
 ///////////////////////////////////////////////////////////////////////////////
@@ -203,10 +208,12 @@ void Patch::updateVertices(const float bitmapWidth, const float bitmapHeight,
     if (verticesCount > 0) {
         Caches& caches = Caches::getInstance();
         caches.bindMeshBuffer(meshBuffer);
-        if (!mUploaded) {
+        if (verticesCount > mUploadedVertices) {
+            // New divs can turn degenerate quads into visible ones,
+            // the buffer must then grow to hold the extra vertices
             glBufferData(GL_ARRAY_BUFFER, sizeof(TextureVertex) * verticesCount,
                     mVertices, GL_DYNAMIC_DRAW);
-            mUploaded = true;
+            mUploadedVertices = verticesCount;
         } else {
             glBufferSubData(GL_ARRAY_BUFFER, 0,
                     sizeof(TextureVertex) * verticesCount, mVertices);
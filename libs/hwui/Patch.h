@@ -55,6 +55,12 @@ struct Patch {
     void copy(const int32_t* xDivs, const int32_t* yDivs);
     bool matches(const int32_t* xDivs, const int32_t* yDivs, const uint32_t colorKey);
 
+    /**
+     * Returns the number of bytes used by the vertices and divs of this
+     * patch, in system memory and in its mesh buffer.
+     */
+    uint32_t getSize() const;
+
     GLuint meshBuffer;
     uint32_t verticesCount;
     bool hasEmptyQuads;
@@ -62,7 +68,9 @@ struct Patch {
 
 private:
     TextureVertex* mVertices;
-    bool mUploaded;
+    uint32_t mMaxVertices;
+    // Number of vertices the mesh buffer can hold, 0 until the first upload
+    uint32_t mUploadedVertices;
 
     int32_t* mXDivs;
     int32_t* mYDivs;
@@ -28,14 +28,52 @@ namespace uirenderer {
 // Constructors/destructor
 ///////////////////////////////////////////////////////////////////////////////
 
-PatchCache::PatchCache(): mMaxEntries(DEFAULT_PATCH_CACHE_SIZE) {
+PatchCache::PatchCache():
+        mCache(GenerationCache<PatchDescription, Patch*>::kUnlimitedCapacity),
+        mSize(0), mMaxSize(MB(DEFAULT_PATCH_CACHE_SIZE)),
+        mHits(0), mMisses(0), mEvictions(0) {
+    char property[PROPERTY_VALUE_MAX];
+    if (property_get(PROPERTY_PATCH_CACHE_SIZE, property, NULL) > 0) {
+        INIT_LOGD("  Setting patch cache size to %sMB", property);
+        setMaxSize(MB(atof(property)));
+    } else {
+        INIT_LOGD("  Using default patch cache size of %.2fMB", DEFAULT_PATCH_CACHE_SIZE);
+    }
+
+    mCache.setOnEntryRemovedListener(this);
 }
 
-PatchCache::PatchCache(uint32_t maxEntries): mMaxEntries(maxEntries) {
+PatchCache::PatchCache(uint32_t maxByteSize):
+        mCache(GenerationCache<PatchDescription, Patch*>::kUnlimitedCapacity),
+        mSize(0), mMaxSize(maxByteSize), mHits(0), mMisses(0), mEvictions(0) {
+    mCache.setOnEntryRemovedListener(this);
 }
 
 PatchCache::~PatchCache() {
-    clear();
+    mCache.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Size management
+///////////////////////////////////////////////////////////////////////////////
+
+void PatchCache::setMaxSize(uint32_t maxSize) {
+    mMaxSize = maxSize;
+    while (mSize > mMaxSize) {
+        mCache.removeOldest();
+        mEvictions++;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Callbacks
+///////////////////////////////////////////////////////////////////////////////
+
+void PatchCache::operator()(PatchDescription& description, Patch*& mesh) {
+    if (mesh) {
+        mSize -= mesh->getSize();
+        delete mesh;
+    }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -43,10 +81,6 @@ PatchCache::~PatchCache() {
 ///////////////////////////////////////////////////////////////////////////////
 
 void PatchCache::clear() {
-    size_t count = mCache.size();
-    for (size_t i = 0; i < count; i++) {
-        delete mCache.valueAt(i);
-    }
     mCache.clear();
 }
 
@@ -75,13 +109,11 @@ Patch* PatchCache::get(const float bitmapWidth, const float bitmapHeight,
     const PatchDescription description(bitmapWidth, bitmapHeight,
             pixelWidth, pixelHeight, width, height, transparentQuads, colorKey);
 
-    ssize_t index = mCache.indexOfKey(description);
-    Patch* mesh = NULL;
-    if (index >= 0) {
-        mesh = mCache.valueAt(index);
-    }
+    Patch* mesh = mCache.get(description);
 
     if (!mesh) {
+        mMisses++;
+
         PATCH_LOGD("New patch mesh "
                 "xCount=%d yCount=%d, w=%.2f h=%.2f, bw=%.2f bh=%.2f",
                 width, height, pixelWidth, pixelHeight, bitmapWidth, bitmapHeight);
@@ -91,15 +123,26 @@ Patch* PatchCache::get(const float bitmapWidth, const float bitmapHeight,
         mesh->copy(xDivs, yDivs);
         mesh->updateVertices(bitmapWidth, bitmapHeight, 0.0f, 0.0f, pixelWidth, pixelHeight);
 
-        if (mCache.size() >= mMaxEntries) {
-            delete mCache.valueAt(mCache.size() - 1);
-            mCache.removeItemsAt(mCache.size() - 1, 1);
+        const uint32_t size = mesh->getSize();
+        while (mSize + size > mMaxSize && mCache.size() > 0) {
+            mCache.removeOldest();
+            mEvictions++;
         }
 
-        mCache.add(description, mesh);
-    } else if (!mesh->matches(xDivs, yDivs, colorKey)) {
-        PATCH_LOGD("Patch mesh does not match, refreshing vertices");
-        mesh->updateVertices(bitmapWidth, bitmapHeight, 0.0f, 0.0f, pixelWidth, pixelHeight);
+        // A mesh larger than the cache is kept until the next miss
+        mSize += size;
+        mCache.put(description, mesh);
+    } else {
+        mHits++;
+
+        if (!mesh->matches(xDivs, yDivs, colorKey)) {
+            PATCH_LOGD("Patch mesh does not match, refreshing vertices");
+            // The mesh buffer grows if the new divs produce more vertices
+            mSize -= mesh->getSize();
+            mesh->updateVertices(bitmapWidth, bitmapHeight, 0.0f, 0.0f,
+                    pixelWidth, pixelHeight);
+            mSize += mesh->getSize();
+        }
     }
 
     return mesh;
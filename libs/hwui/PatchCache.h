@@ -17,7 +17,7 @@
 #ifndef ANDROID_HWUI_PATCH_CACHE_H
 #define ANDROID_HWUI_PATCH_CACHE_H
 
-#include <utils/KeyedVector.h>
+#include <utils/GenerationCache.h>
 
 #include "utils/Compare.h"
 #include "Debug.h"
@@ -37,82 +37,128 @@ namespace uirenderer {
     #define PATCH_LOGD(...)
 #endif
 
+///////////////////////////////////////////////////////////////////////////////
+// Classes
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Description of a patch.
+ */
+struct PatchDescription {
+    PatchDescription(): bitmapWidth(0), bitmapHeight(0), pixelWidth(0), pixelHeight(0),
+            xCount(0), yCount(0), emptyCount(0), colorKey(0) {
+    }
+
+    PatchDescription(const float bitmapWidth, const float bitmapHeight,
+            const float pixelWidth, const float pixelHeight,
+            const uint32_t xCount, const uint32_t yCount,
+            const int8_t emptyCount, const uint32_t colorKey):
+            bitmapWidth(bitmapWidth), bitmapHeight(bitmapHeight),
+            pixelWidth(pixelWidth), pixelHeight(pixelHeight),
+            xCount(xCount), yCount(yCount),
+            emptyCount(emptyCount), colorKey(colorKey) {
+    }
+
+    bool operator<(const PatchDescription& rhs) const {
+        LTE_FLOAT(bitmapWidth) {
+            LTE_FLOAT(bitmapHeight) {
+                LTE_FLOAT(pixelWidth) {
+                    LTE_FLOAT(pixelHeight) {
+                        LTE_INT(xCount) {
+                            LTE_INT(yCount) {
+                                LTE_INT(emptyCount) {
+                                    LTE_INT(colorKey) return false;
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+private:
+    float bitmapWidth;
+    float bitmapHeight;
+    float pixelWidth;
+    float pixelHeight;
+    uint32_t xCount;
+    uint32_t yCount;
+    int8_t emptyCount;
+    uint32_t colorKey;
+
+}; // struct PatchDescription
+
 ///////////////////////////////////////////////////////////////////////////////
 // Cache
 ///////////////////////////////////////////////////////////////////////////////
 
-class PatchCache {
+/**
+ * A LRU cache of 9-patch meshes. The cache has a maximum size expressed
+ * in bytes, see Patch::getSize().
+ */
+class PatchCache: public OnEntryRemoved<PatchDescription, Patch*> {
 public:
     PatchCache();
-    PatchCache(uint32_t maxCapacity);
+    PatchCache(uint32_t maxByteSize);
     ~PatchCache();
 
+    /**
+     * Used as a callback when an entry is removed from the cache.
+     * Do not invoke directly.
+     */
+    void operator()(PatchDescription& description, Patch*& mesh);
+
+    /**
+     * Returns the mesh for the specified 9-patch. The returned mesh is owned
+     * by the cache and remains valid until the next call to get().
+     */
     Patch* get(const float bitmapWidth, const float bitmapHeight,
             const float pixelWidth, const float pixelHeight,
             const int32_t* xDivs, const int32_t* yDivs, const uint32_t* colors,
             const uint32_t width, const uint32_t height, const int8_t numColors);
     void clear();
 
-    uint32_t getSize() const {
-        return mCache.size();
-    }
+    /**
+     * Sets the maximum size of the cache in bytes.
+     */
+    void setMaxSize(uint32_t maxSize);
 
-    uint32_t getMaxSize() const {
-        return mMaxEntries;
+    /**
+     * Returns the current size of the cache in bytes.
+     */
+    uint32_t getSize() const {
+        return mSize;
     }
 
-private:
     /**
-     * Description of a patch.
+     * Returns the maximum size of the cache in bytes.
      */
-    struct PatchDescription {
-        PatchDescription(): bitmapWidth(0), bitmapHeight(0), pixelWidth(0), pixelHeight(0),
-                xCount(0), yCount(0), emptyCount(0), colorKey(0) {
-        }
+    uint32_t getMaxSize() const {
+        return mMaxSize;
+    }
 
-        PatchDescription(const float bitmapWidth, const float bitmapHeight,
-                const float pixelWidth, const float pixelHeight,
-                const uint32_t xCount, const uint32_t yCount,
-                const int8_t emptyCount, const uint32_t colorKey):
-                bitmapWidth(bitmapWidth), bitmapHeight(bitmapHeight),
-                pixelWidth(pixelWidth), pixelHeight(pixelHeight),
-                xCount(xCount), yCount(yCount),
-                emptyCount(emptyCount), colorKey(colorKey) {
-        }
+    uint32_t getHitCount() const {
+        return mHits;
+    }
 
-        bool operator<(const PatchDescription& rhs) const {
-            LTE_FLOAT(bitmapWidth) {
-                LTE_FLOAT(bitmapHeight) {
-                    LTE_FLOAT(pixelWidth) {
-                        LTE_FLOAT(pixelHeight) {
-                            LTE_INT(xCount) {
-                                LTE_INT(yCount) {
-                                    LTE_INT(emptyCount) {
-                                        LTE_INT(colorKey) return false;
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
-            }
-            return false;
-        }
+    uint32_t getMissCount() const {
+        return mMisses;
+    }
 
-    private:
-        float bitmapWidth;
-        float bitmapHeight;
-        float pixelWidth;
-        float pixelHeight;
-        uint32_t xCount;
-        uint32_t yCount;
-        int8_t emptyCount;
-        uint32_t colorKey;
+    uint32_t getEvictionCount() const {
+        return mEvictions;
+    }
 
-    }; // struct PatchDescription
+private:
+    GenerationCache<PatchDescription, Patch*> mCache;
+    uint32_t mSize;
+    uint32_t mMaxSize;
 
-    uint32_t mMaxEntries;
-    KeyedVector<PatchDescription, Patch*> mCache;
+    uint32_t mHits;
+    uint32_t mMisses;
+    uint32_t mEvictions;
 
 }; // class PatchCache
 
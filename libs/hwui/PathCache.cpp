@@ -71,6 +71,15 @@ void PathCache::remove(SkPath* path) {
         mCache.removeAt(pathsToRemove.itemAt(i) - i);
     }
     mCache.setOnEntryRemovedListener(this);
+
+    for (size_t i = 0; i < mPendingTasks.size(); ) {
+        if (mPendingTasks.keyAt(i).path == path) {
+            // Also gives back the size of the task to mPendingSize
+            removePendingTaskAt(i, true);
+        } else {
+            i++;
+        }
+    }
 }
 
 void PathCache::removeDeferred(SkPath* path) {
@@ -87,11 +96,23 @@ void PathCache::clearGarbage() {
     mGarbage.clear();
 }
 
-PathTexture* PathCache::get(SkPath* path, SkPaint* paint) {
+SkPath* PathCache::getSourcePath(SkPath* path) {
     const SkPath* sourcePath = path->getSourcePath();
     if (sourcePath && sourcePath->getGenerationID() == path->getGenerationID()) {
-        path = const_cast<SkPath*>(sourcePath);
+        return const_cast<SkPath*>(sourcePath);
     }
+    return path;
+}
+
+void PathCache::precache(SkPath* path, SkPaint* paint) {
+    path = getSourcePath(path);
+
+    PathCacheEntry entry(path, paint);
+    precacheTexture(entry, path, paint);
+}
+
+PathTexture* PathCache::get(SkPath* path, SkPaint* paint) {
+    path = getSourcePath(path);
 
     PathCacheEntry entry(path, paint);
     PathTexture* texture = mCache.get(entry);
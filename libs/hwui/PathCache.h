@@ -67,6 +67,11 @@ public:
      * cannot be found in the cache, a new texture is generated.
      */
     PathTexture* get(SkPath* path, SkPaint* paint);
+    /**
+     * Rasterizes the specified path in the background so that a later call
+     * to get() only needs to upload the texture.
+     */
+    void precache(SkPath* path, SkPaint* paint);
     /**
      * Removes an entry.
      */
@@ -82,6 +87,11 @@ public:
     void clearGarbage();
 
 private:
+    /**
+     * Returns the path whose pointer is used as a key for the specified path.
+     */
+    static SkPath* getSourcePath(SkPath* path);
+
     Vector<SkPath*> mGarbage;
     mutable Mutex mLock;
 }; // class PathCache
@@ -49,7 +49,8 @@ SkRect PathRenderer::computePathBounds(const SkPath& path, const SkPaint* paint)
     return bounds;
 }
 
-void computeInverseScales(const mat4 *transform, float &inverseScaleX, float& inverseScaleY) {
+void PathRenderer::computeInverseScales(const mat4 *transform,
+        float &inverseScaleX, float& inverseScaleY) {
     if (CC_UNLIKELY(!transform->isPureTranslate())) {
         float m00 = transform->data[Matrix4::kScaleX];
         float m01 = transform->data[Matrix4::kSkewY];
@@ -98,7 +99,7 @@ inline void scaleOffsetForStrokeWidth(vec2& offset, float halfStrokeWidth,
     }
 }
 
-void getFillVerticesFromPerimeter(const Vector<Vertex>& perimeter, VertexBuffer& vertexBuffer) {
+void getFillVerticesFromPerimeter(const PerimeterVertices& perimeter, VertexBuffer& vertexBuffer) {
     Vertex* buffer = vertexBuffer.alloc<Vertex>(perimeter.size());
 
     int currentIndex = 0;
@@ -115,7 +116,7 @@ void getFillVerticesFromPerimeter(const Vector<Vertex>& perimeter, VertexBuffer&
     }
 }
 
-void getStrokeVerticesFromPerimeter(const Vector<Vertex>& perimeter, float halfStrokeWidth,
+void getStrokeVerticesFromPerimeter(const PerimeterVertices& perimeter, float halfStrokeWidth,
         VertexBuffer& vertexBuffer, float inverseScaleX, float inverseScaleY) {
     Vertex* buffer = vertexBuffer.alloc<Vertex>(perimeter.size() * 2 + 2);
 
@@ -152,7 +153,7 @@ void getStrokeVerticesFromPerimeter(const Vector<Vertex>& perimeter, float halfS
     copyVertex(&buffer[currentIndex++], &buffer[1]);
 }
 
-void getStrokeVerticesFromUnclosedVertices(const Vector<Vertex>& vertices, float halfStrokeWidth,
+void getStrokeVerticesFromUnclosedVertices(const PerimeterVertices& vertices, float halfStrokeWidth,
         VertexBuffer& vertexBuffer, float inverseScaleX, float inverseScaleY) {
     Vertex* buffer = vertexBuffer.alloc<Vertex>(vertices.size() * 2);
 
@@ -201,7 +202,7 @@ void getStrokeVerticesFromUnclosedVertices(const Vector<Vertex>& vertices, float
 #endif
 }
 
-void getFillVerticesFromPerimeterAA(const Vector<Vertex>& perimeter, VertexBuffer& vertexBuffer,
+void getFillVerticesFromPerimeterAA(const PerimeterVertices& perimeter, VertexBuffer& vertexBuffer,
          float inverseScaleX, float inverseScaleY) {
     AlphaVertex* buffer = vertexBuffer.alloc<AlphaVertex>(perimeter.size() * 3 + 2);
 
@@ -264,7 +265,7 @@ void getFillVerticesFromPerimeterAA(const Vector<Vertex>& perimeter, VertexBuffe
 }
 
 
-void getStrokeVerticesFromUnclosedVerticesAA(const Vector<Vertex>& vertices, float halfStrokeWidth,
+void getStrokeVerticesFromUnclosedVerticesAA(const PerimeterVertices& vertices, float halfStrokeWidth,
         VertexBuffer& vertexBuffer, float inverseScaleX, float inverseScaleY) {
     AlphaVertex* buffer = vertexBuffer.alloc<AlphaVertex>(6 * vertices.size() + 2);
 
@@ -419,7 +420,7 @@ void getStrokeVerticesFromUnclosedVerticesAA(const Vector<Vertex>& vertices, flo
 }
 
 
-void getStrokeVerticesFromPerimeterAA(const Vector<Vertex>& perimeter, float halfStrokeWidth,
+void getStrokeVerticesFromPerimeterAA(const PerimeterVertices& perimeter, float halfStrokeWidth,
         VertexBuffer& vertexBuffer, float inverseScaleX, float inverseScaleY) {
     AlphaVertex* buffer = vertexBuffer.alloc<AlphaVertex>(6 * perimeter.size() + 8);
 
@@ -511,16 +512,16 @@ void getStrokeVerticesFromPerimeterAA(const Vector<Vertex>& perimeter, float hal
 }
 
 void PathRenderer::convexPathVertices(const SkPath &path, const SkPaint* paint,
-        const mat4 *transform, VertexBuffer& vertexBuffer) {
+        float inverseScaleX, float inverseScaleY, PerimeterVertices& tempVertices,
+        VertexBuffer& vertexBuffer) {
     ATRACE_CALL();
 
     SkPaint::Style style = paint->getStyle();
     bool isAA = paint->isAntiAlias();
 
-    float inverseScaleX, inverseScaleY;
-    computeInverseScales(transform, inverseScaleX, inverseScaleY);
+    tempVertices.clear();
+    vertexBuffer.clear();
 
-    Vector<Vertex> tempVertices;
     float threshInvScaleX = inverseScaleX;
     float threshInvScaleY = inverseScaleY;
     if (style == SkPaint::kStroke_Style) {
@@ -580,15 +581,15 @@ void PathRenderer::convexPathVertices(const SkPath &path, const SkPaint* paint,
 }
 
 
-void pushToVector(Vector<Vertex>& vertices, float x, float y) {
-    // TODO: make this not yuck
-    vertices.push();
-    Vertex* newVertex = &(vertices.editArray()[vertices.size() - 1]);
-    Vertex::set(newVertex, x, y);
+void PerimeterVertices::grow() {
+    // Paths rarely need more than a few dozen vertices, the array is kept
+    // between paths so it only grows during the first few frames
+    mCapacity = mCapacity ? mCapacity * 2 : 64;
+    mVertices = (Vertex*) realloc(mVertices, mCapacity * sizeof(Vertex));
 }
 
 bool PathRenderer::convexPathPerimeterVertices(const SkPath& path, bool forceClose,
-        float sqrInvScaleX, float sqrInvScaleY, Vector<Vertex>& outputVertices) {
+        float sqrInvScaleX, float sqrInvScaleY, PerimeterVertices& outputVertices) {
     ATRACE_CALL();
 
     // TODO: to support joins other than sharp miter, join vertices should be labelled in the
@@ -600,7 +601,7 @@ bool PathRenderer::convexPathPerimeterVertices(const SkPath& path, bool forceClo
     while (SkPath::kDone_Verb != (v = iter.next(pts))) {
             switch (v) {
                 case SkPath::kMove_Verb:
-                    pushToVector(outputVertices, pts[0].x(), pts[0].y());
+                    outputVertices.push(pts[0].x(), pts[0].y());
                     ALOGV("Move to pos %f %f", pts[0].x(), pts[0].y());
                     break;
                 case SkPath::kClose_Verb:
@@ -611,7 +612,7 @@ bool PathRenderer::convexPathPerimeterVertices(const SkPath& path, bool forceClo
                             pts[0].x(), pts[0].y(),
                             pts[1].x(), pts[1].y());
 
-                    pushToVector(outputVertices, pts[1].x(), pts[1].y());
+                    outputVertices.push(pts[1].x(), pts[1].y());
                     break;
                 case SkPath::kQuad_Verb:
                     ALOGV("kQuad_Verb");
@@ -647,7 +648,7 @@ bool PathRenderer::convexPathPerimeterVertices(const SkPath& path, bool forceClo
 void PathRenderer::recursiveCubicBezierVertices(
         float p1x, float p1y, float c1x, float c1y,
         float p2x, float p2y, float c2x, float c2y,
-        float sqrInvScaleX, float sqrInvScaleY, Vector<Vertex>& outputVertices) {
+        float sqrInvScaleX, float sqrInvScaleY, PerimeterVertices& outputVertices) {
     float dx = p2x - p1x;
     float dy = p2y - p1y;
     float d1 = fabs((c1x - p2x) * dy - (c1y - p2y) * dx);
@@ -658,7 +659,7 @@ void PathRenderer::recursiveCubicBezierVertices(
 
     if (d * d < THRESHOLD * THRESHOLD * (dx * dx * sqrInvScaleY + dy * dy * sqrInvScaleX)) {
         // below thresh, draw line by adding endpoint
-        pushToVector(outputVertices, p2x, p2y);
+        outputVertices.push(p2x, p2y);
     } else {
         float p1c1x = (p1x + c1x) * 0.5f;
         float p1c1y = (p1y + c1y) * 0.5f;
@@ -692,14 +693,14 @@ void PathRenderer::recursiveQuadraticBezierVertices(
         float ax, float ay,
         float bx, float by,
         float cx, float cy,
-        float sqrInvScaleX, float sqrInvScaleY, Vector<Vertex>& outputVertices) {
+        float sqrInvScaleX, float sqrInvScaleY, PerimeterVertices& outputVertices) {
     float dx = bx - ax;
     float dy = by - ay;
     float d = (cx - bx) * dy - (cy - by) * dx;
 
     if (d * d < THRESHOLD * THRESHOLD * (dx * dx * sqrInvScaleY + dy * dy * sqrInvScaleX)) {
         // below thresh, draw line by adding endpoint
-        pushToVector(outputVertices, bx, by);
+        outputVertices.push(bx, by);
     } else {
         float acx = (ax + cx) * 0.5f;
         float bcx = (bx + cx) * 0.5f;
@@ -17,7 +17,10 @@
 #ifndef ANDROID_HWUI_PATH_RENDERER_H
 #define ANDROID_HWUI_PATH_RENDERER_H
 
-#include <utils/Vector.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cutils/compiler.h>
 
 #include "Vertex.h"
 
@@ -27,52 +30,124 @@ namespace uirenderer {
 class Matrix4;
 typedef Matrix4 mat4;
 
+/**
+ * Array of vertices or alpha vertices. The memory is kept when the buffer is
+ * allocated again with a size that fits, which lets a buffer be reused from
+ * one path to the next without allocations.
+ */
 class VertexBuffer {
 public:
     VertexBuffer():
         mBuffer(0),
         mSize(0),
-        mCleanupMethod(0)
+        mByteSize(0),
+        mCapacity(0)
     {}
 
     ~VertexBuffer() {
-        if (mCleanupMethod)
-            mCleanupMethod(mBuffer);
+        free(mBuffer);
     }
 
     template <class TYPE>
     TYPE* alloc(int size) {
         mSize = size;
-        mBuffer = (void*)new TYPE[size];
-        mCleanupMethod = &(cleanup<TYPE>);
+        mByteSize = size * sizeof(TYPE);
+        if (mByteSize > mCapacity) {
+            free(mBuffer);
+            mBuffer = malloc(mByteSize);
+            mCapacity = mByteSize;
+        }
 
         return (TYPE*)mBuffer;
     }
 
-    void* getBuffer() { return mBuffer; }
-    unsigned int getSize() { return mSize; }
+    /**
+     * Replaces the content of this buffer with a copy of the specified buffer.
+     */
+    void copy(const VertexBuffer& buffer) {
+        if (buffer.mByteSize > mCapacity) {
+            free(mBuffer);
+            mBuffer = malloc(buffer.mByteSize);
+            mCapacity = buffer.mByteSize;
+        }
+        memcpy(mBuffer, buffer.mBuffer, buffer.mByteSize);
+        mSize = buffer.mSize;
+        mByteSize = buffer.mByteSize;
+    }
+
+    void clear() { mSize = 0; mByteSize = 0; }
+
+    void* getBuffer() const { return mBuffer; }
+    unsigned int getSize() const { return mSize; }
+    unsigned int getByteSize() const { return mByteSize; }
 
 private:
-    template <class TYPE>
-    static void cleanup(void* buffer) {
-        delete[] (TYPE*)buffer;
+    void* mBuffer;
+    unsigned int mSize;
+    unsigned int mByteSize;
+    unsigned int mCapacity;
+};
+
+/**
+ * Vertices along the perimeter of a path, before they are expanded into a
+ * vertex buffer. The memory is kept from one path to the next.
+ */
+class PerimeterVertices {
+public:
+    PerimeterVertices(): mVertices(0), mSize(0), mCapacity(0) {
     }
 
-    void* mBuffer;
+    ~PerimeterVertices() {
+        free(mVertices);
+    }
+
+    void clear() {
+        mSize = 0;
+    }
+
+    void push(float x, float y) {
+        if (CC_UNLIKELY(mSize == mCapacity)) grow();
+        Vertex::set(&mVertices[mSize++], x, y);
+    }
+
+    void pop() {
+        mSize--;
+    }
+
+    unsigned int size() const {
+        return mSize;
+    }
+
+    const Vertex& operator[](unsigned int index) const {
+        return mVertices[index];
+    }
+
+private:
+    void grow();
+
+    Vertex* mVertices;
     unsigned int mSize;
-    void (*mCleanupMethod)(void*);
+    unsigned int mCapacity;
 };
 
 class PathRenderer {
 public:
     static SkRect computePathBounds(const SkPath& path, const SkPaint* paint);
 
+    static void computeInverseScales(const mat4* transform,
+            float& inverseScaleX, float& inverseScaleY);
+
+    /**
+     * Tessellates the specified convex path. The perimeter is only used as
+     * temporary storage. The vertex buffer is left empty if the path is empty.
+     */
     static void convexPathVertices(const SkPath& path, const SkPaint* paint,
-            const mat4 *transform, VertexBuffer& vertexBuffer);
+            float inverseScaleX, float inverseScaleY, PerimeterVertices& perimeter,
+            VertexBuffer& vertexBuffer);
 
 private:
     static bool convexPathPerimeterVertices(const SkPath &path, bool forceClose,
-        float sqrInvScaleX, float sqrInvScaleY, Vector<Vertex> &outputVertices);
+        float sqrInvScaleX, float sqrInvScaleY, PerimeterVertices &outputVertices);
 
 /*
   endpoints a & b,
@@ -83,7 +158,7 @@ private:
             float bx, float by,
             float cx, float cy,
             float sqrInvScaleX, float sqrInvScaleY,
-            Vector<Vertex> &outputVertices);
+            PerimeterVertices &outputVertices);
 
 /*
   endpoints p1, p2
@@ -95,7 +170,7 @@ private:
             float p2x, float p2y,
             float c2x, float c2y,
             float sqrInvScaleX, float sqrInvScaleY,
-            Vector<Vertex> &outputVertices);
+            PerimeterVertices &outputVertices);
 };
 
 }; // namespace uirenderer
@@ -267,6 +267,57 @@ struct ProgramDescription {
         return key;
     }
 
+    /**
+     * Initializes this description from a key returned by key(). Returns
+     * false if the key does not describe a program.
+     */
+    bool load(programid key) {
+        reset();
+
+        hasTexture = key & PROGRAM_KEY_TEXTURE;
+        hasAlpha8Texture = key & PROGRAM_KEY_A8_TEXTURE;
+        hasBitmap = key & PROGRAM_KEY_BITMAP;
+        if (hasBitmap) {
+            isBitmapNpot = key & PROGRAM_KEY_BITMAP_NPOT;
+            if (isBitmapNpot) {
+                bitmapWrapS = getWrapForEnum(
+                        (key & PROGRAM_KEY_BITMAP_WRAPS_MASK) >> PROGRAM_BITMAP_WRAPS_SHIFT);
+                bitmapWrapT = getWrapForEnum(
+                        (key & PROGRAM_KEY_BITMAP_WRAPT_MASK) >> PROGRAM_BITMAP_WRAPT_SHIFT);
+            }
+        }
+        hasGradient = key & PROGRAM_KEY_GRADIENT;
+        gradientType = Gradient((key >> PROGRAM_GRADIENT_TYPE_SHIFT) & 0x3);
+        isBitmapFirst = key & PROGRAM_KEY_BITMAP_FIRST;
+        if (hasBitmap && hasGradient) {
+            shadersMode = SkXfermode::Mode(
+                    (key >> PROGRAM_XFERMODE_SHADER_SHIFT) & PROGRAM_MAX_XFERMODE);
+        }
+        if (key & PROGRAM_KEY_COLOR_MATRIX) {
+            colorOp = kColorMatrix;
+        } else if (key & PROGRAM_KEY_COLOR_LIGHTING) {
+            colorOp = kColorLighting;
+        } else if (key & PROGRAM_KEY_COLOR_BLEND) {
+            colorOp = kColorBlend;
+            colorMode = SkXfermode::Mode(
+                    (key >> PROGRAM_XFERMODE_COLOR_OP_SHIFT) & PROGRAM_MAX_XFERMODE);
+        }
+        framebufferMode = SkXfermode::Mode(
+                (key >> PROGRAM_XFERMODE_FRAMEBUFFER_SHIFT) & PROGRAM_MAX_XFERMODE);
+        swapSrcDst = key & PROGRAM_KEY_SWAP_SRC_DST;
+        modulate = (key >> PROGRAM_MODULATE_SHIFT) & 0x1;
+        isPoint = (key >> PROGRAM_IS_POINT_SHIFT) & 0x1;
+        isAA = (key >> PROGRAM_HAS_AA_SHIFT) & 0x1;
+        hasExternalTexture = (key >> PROGRAM_HAS_EXTERNAL_TEXTURE_SHIFT) & 0x1;
+        hasTextureTransform = (key >> PROGRAM_HAS_TEXTURE_TRANSFORM_SHIFT) & 0x1;
+        hasGammaCorrection = (key >> PROGRAM_HAS_GAMMA_CORRECTION) & 0x1;
+        isSimpleGradient = (key >> PROGRAM_IS_SIMPLE_GRADIENT) & 0x1;
+        isVertexShape = (key >> PROGRAM_IS_VERTEX_SHAPE_SHIFT) & 0x1;
+
+        // Rejects the bits and the combinations key() never produces
+        return this->key() == key;
+    }
+
     /**
      * Logs the specified message followed by the key identifying this program.
      */
@@ -291,6 +342,16 @@ private:
         return 0;
     }
 
+    static inline GLenum getWrapForEnum(uint32_t wrap) {
+        switch (wrap) {
+            case 1:
+                return GL_REPEAT;
+            case 2:
+                return GL_MIRRORED_REPEAT;
+        }
+        return GL_CLAMP_TO_EDGE;
+    }
+
 }; // struct ProgramDescription
 
 /**
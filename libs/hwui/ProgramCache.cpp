@@ -16,7 +16,15 @@
 
 #define LOG_TAG "OpenGLRenderer"
 
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
 #include <utils/String8.h>
+#include <utils/threads.h>
+#include <utils/Timers.h>
 
 #include "Caches.h"
 #include "ProgramCache.h"
@@ -32,6 +40,35 @@ namespace uirenderer {
 #define MODULATE_OP_MODULATE 1
 #define MODULATE_OP_MODULATE_A8 2
 
+// The persistent cache file starts with this magic number and version,
+// followed by the keys of the programs, most recently used first. Keys of
+// programs generated since the file was last saved are appended. The version
+// must be incremented whenever the meaning of the keys or the generated
+// shaders change
+#define PROGRAM_CACHE_FILE_MAGIC 0x43505748 // 'HWPC'
+#define PROGRAM_CACHE_FILE_VERSION 1
+
+// Maximum number of keys stored in the persistent cache file
+#define MAX_PERSISTENT_PROGRAMS 256
+
+// Maximum number of programs generated by warmUp(), and time after which it
+// stops generating programs. Compiling a program takes a few milliseconds
+// on most GPUs and delays the first frame by as much
+#define MAX_WARM_UP_PROGRAMS 32
+#define WARM_UP_TIME_BUDGET_MS 20
+
+///////////////////////////////////////////////////////////////////////////////
+// Persistent cache file
+///////////////////////////////////////////////////////////////////////////////
+
+static Mutex sPersistentCacheLock;
+static String8 sPersistentCacheFile;
+
+struct ProgramCacheFileHeader {
+    uint32_t magic;
+    uint32_t version;
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 // Vertex shaders snippets
 ///////////////////////////////////////////////////////////////////////////////
@@ -415,7 +452,7 @@ const char* gBlendOps[18] = {
 // Constructors/destructors
 ///////////////////////////////////////////////////////////////////////////////
 
-ProgramCache::ProgramCache() {
+ProgramCache::ProgramCache(): mPersistentKeysLoaded(false), mUsedKeysChanged(false) {
 }
 
 ProgramCache::~ProgramCache() {
@@ -434,6 +471,12 @@ void ProgramCache::clear() {
         delete mCache.valueAt(i);
     }
     mCache.clear();
+
+    count = mWarmedUpPrograms.size();
+    for (size_t i = 0; i < count; i++) {
+        delete mWarmedUpPrograms.valueAt(i);
+    }
+    mWarmedUpPrograms.clear();
 }
 
 Program* ProgramCache::get(const ProgramDescription& description) {
@@ -441,15 +484,180 @@ Program* ProgramCache::get(const ProgramDescription& description) {
     ssize_t index = mCache.indexOfKey(key);
     Program* program = NULL;
     if (index < 0) {
-        description.log("Could not find program");
-        program = generateProgram(description, key);
+        index = mWarmedUpPrograms.indexOfKey(key);
+        if (index >= 0) {
+            program = mWarmedUpPrograms.valueAt(index);
+            mWarmedUpPrograms.removeItemsAt(index);
+        } else {
+            description.log("Could not find program");
+            program = generateProgram(description, key);
+            recordKey(key);
+        }
         mCache.add(key, program);
+        recordUse(key);
     } else {
         program = mCache.valueAt(index);
     }
     return program;
 }
 
+void ProgramCache::warmUp() {
+    loadPersistentKeys();
+
+    const nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+    const nsecs_t deadline = start + milliseconds_to_nanoseconds(WARM_UP_TIME_BUDGET_MS);
+
+    uint32_t count = 0;
+    ProgramDescription description;
+    for (size_t i = 0; i < mPersistentKeys.size() && count < MAX_WARM_UP_PROGRAMS; i++) {
+        const programid key = mPersistentKeys.itemAt(i);
+        if (mCache.indexOfKey(key) < 0 && mWarmedUpPrograms.indexOfKey(key) < 0 &&
+                description.load(key)) {
+            mWarmedUpPrograms.add(key, generateProgram(description, key));
+            count++;
+
+            if (systemTime(SYSTEM_TIME_MONOTONIC) >= deadline) break;
+        }
+    }
+
+    if (count > 0) {
+        INIT_LOGD("  Generated %d of %d programs from the persistent cache in %.2fms",
+                count, mPersistentKeys.size(),
+                (systemTime(SYSTEM_TIME_MONOTONIC) - start) / 1000000.0f);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Persistent cache
+///////////////////////////////////////////////////////////////////////////////
+
+static bool containsKey(const Vector<programid>& keys, programid key) {
+    for (size_t i = 0; i < keys.size(); i++) {
+        if (keys.itemAt(i) == key) return true;
+    }
+    return false;
+}
+
+/**
+ * Replaces the content of the persistent cache file with the specified keys.
+ * The keys are written to a temporary file first and renamed over the cache
+ * file, readers and other processes never see a partially written file.
+ * Must be invoked with sPersistentCacheLock held.
+ */
+static bool writePersistentKeysLocked(const Vector<programid>& keys) {
+    String8 tempPath(sPersistentCacheFile);
+    tempPath.append(".XXXXXX");
+    char* tempPathBuffer = tempPath.lockBuffer(tempPath.size());
+    int fd = mkstemp(tempPathBuffer);
+    tempPath.unlockBuffer();
+    if (fd < 0) {
+        ALOGW("Could not create the persistent program cache %s: %s",
+                tempPath.string(), strerror(errno));
+        return false;
+    }
+
+    ProgramCacheFileHeader header;
+    header.magic = PROGRAM_CACHE_FILE_MAGIC;
+    header.version = PROGRAM_CACHE_FILE_VERSION;
+    bool written = write(fd, &header, sizeof(header)) == sizeof(header);
+
+    const ssize_t size = keys.size() * sizeof(programid);
+    written = written && write(fd, keys.array(), size) == size;
+    written = !close(fd) && written;
+
+    if (!written || rename(tempPath.string(), sPersistentCacheFile.string())) {
+        ALOGW("Could not write the persistent program cache %s: %s",
+                sPersistentCacheFile.string(), strerror(errno));
+        unlink(tempPath.string());
+        return false;
+    }
+    return true;
+}
+
+void ProgramCache::setPersistentCacheFile(const char* path) {
+    Mutex::Autolock _l(sPersistentCacheLock);
+    sPersistentCacheFile.setTo(path);
+}
+
+void ProgramCache::loadPersistentKeys() {
+    if (mPersistentKeysLoaded) return;
+    mPersistentKeysLoaded = true;
+
+    Mutex::Autolock _l(sPersistentCacheLock);
+    if (sPersistentCacheFile.isEmpty()) return;
+
+    int fd = open(sPersistentCacheFile.string(), O_RDONLY);
+    if (fd < 0) return;
+
+    ProgramCacheFileHeader header;
+    if (read(fd, &header, sizeof(header)) == sizeof(header) &&
+            header.magic == PROGRAM_CACHE_FILE_MAGIC &&
+            header.version == PROGRAM_CACHE_FILE_VERSION) {
+        programid key;
+        while (read(fd, &key, sizeof(key)) == sizeof(key) &&
+                mPersistentKeys.size() < MAX_PERSISTENT_PROGRAMS) {
+            if (!containsKey(mPersistentKeys, key)) {
+                mPersistentKeys.push(key);
+            }
+        }
+    }
+
+    close(fd);
+
+    PROGRAM_LOGD("Loaded %d keys from the persistent program cache",
+            mPersistentKeys.size());
+}
+
+void ProgramCache::recordKey(programid key) {
+    loadPersistentKeys();
+
+    if (containsKey(mPersistentKeys, key) ||
+            mPersistentKeys.size() >= MAX_PERSISTENT_PROGRAMS) {
+        return;
+    }
+
+    Vector<programid> keys(mPersistentKeys);
+    keys.push(key);
+
+    Mutex::Autolock _l(sPersistentCacheLock);
+    if (sPersistentCacheFile.isEmpty()) return;
+
+    if (writePersistentKeysLocked(keys)) {
+        mPersistentKeys = keys;
+    }
+}
+
+void ProgramCache::recordUse(programid key) {
+    if (mUsedKeys.size() < MAX_PERSISTENT_PROGRAMS && !containsKey(mUsedKeys, key)) {
+        mUsedKeys.push(key);
+        mUsedKeysChanged = true;
+    }
+}
+
+void ProgramCache::savePersistentKeys() {
+    if (!mUsedKeysChanged) return;
+
+    loadPersistentKeys();
+
+    // The programs used by this process come first, followed by the ones
+    // that were only used by previous runs
+    Vector<programid> keys(mUsedKeys);
+    for (size_t i = 0; i < mPersistentKeys.size() && keys.size() < MAX_PERSISTENT_PROGRAMS; i++) {
+        const programid key = mPersistentKeys.itemAt(i);
+        if (!containsKey(mUsedKeys, key)) {
+            keys.push(key);
+        }
+    }
+
+    Mutex::Autolock _l(sPersistentCacheLock);
+    if (sPersistentCacheFile.isEmpty()) return;
+
+    if (writePersistentKeysLocked(keys)) {
+        mPersistentKeys = keys;
+        mUsedKeysChanged = false;
+    }
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Program generation
 ///////////////////////////////////////////////////////////////////////////////
@@ -23,6 +23,8 @@
 
 #include <GLES2/gl2.h>
 
+#include <cutils/compiler.h>
+
 #include "Debug.h"
 #include "Program.h"
 #include "Properties.h"
@@ -56,9 +58,34 @@ public:
 
     Program* get(const ProgramDescription& description);
 
+    /**
+     * Generates the programs recorded in the persistent cache file, see
+     * setPersistentCacheFile(). Must be invoked with a current GL context.
+     * Only the most recently used programs are generated, within a time
+     * budget. The others are generated when they are first used.
+     */
+    void warmUp();
+
+    /**
+     * Rewrites the persistent cache file with the programs used since the
+     * cache was created first, in the order they were first used.
+     */
+    void savePersistentKeys();
+
     void clear();
 
+    /**
+     * Sets the file used to remember the programs generated by the
+     * application from one run to the next. This method can be invoked
+     * before the cache is created.
+     */
+    ANDROID_API static void setPersistentCacheFile(const char* path);
+
 private:
+    void loadPersistentKeys();
+    void recordKey(programid key);
+    void recordUse(programid key);
+
     Program* generateProgram(const ProgramDescription& description, programid key);
     String8 generateVertexShader(const ProgramDescription& description);
     String8 generateFragmentShader(const ProgramDescription& description);
@@ -68,6 +95,18 @@ private:
     void printLongString(const String8& shader) const;
 
     KeyedVector<programid, Program*> mCache;
+
+    // Programs generated by warmUp() that were not used yet
+    KeyedVector<programid, Program*> mWarmedUpPrograms;
+
+    // Keys stored in the persistent cache file, most recently used first
+    Vector<programid> mPersistentKeys;
+    bool mPersistentKeysLoaded;
+
+    // Keys of the programs used since the cache was created, in the order
+    // they were first used
+    Vector<programid> mUsedKeys;
+    bool mUsedKeysChanged;
 }; // class ProgramCache
 
 }; // namespace uirenderer
@@ -82,12 +82,35 @@ enum DebugLevel {
  */
 #define PROPERTY_DISABLE_SCISSOR_OPTIMIZATION "ro.hwui.disable_scissor_opt"
 
+/**
+ * Used to enable/disable the deferred replay of display lists. The accepted
+ * values are "true" and "false". The default value is "false".
+ *
+ * When deferred replay is enabled, OpenGLRenderer collects the bitmaps,
+ * rectangles and text drawn by a display list tree, reorders the ones that
+ * do not overlap to group them by texture and paint, and merges unclipped
+ * bitmaps and text into fewer draw calls.
+ */
+#define PROPERTY_DEFERRED_REPLAY "debug.hwui.deferred_replay"
+
+/**
+ * Used to enable/disable the rasterization of shapes on a background thread.
+ * The accepted values are "true" and "false". The default value is "true".
+ *
+ * When enabled, the paths and shapes recorded in display lists are drawn
+ * into alpha8 bitmaps by a worker thread so that drawing them for the first
+ * time only requires a texture upload.
+ */
+#define PROPERTY_PRECACHE_SHAPES "ro.hwui.precache_shapes"
+
 // These properties are defined in mega-bytes
 #define PROPERTY_TEXTURE_CACHE_SIZE "ro.hwui.texture_cache_size"
 #define PROPERTY_LAYER_CACHE_SIZE "ro.hwui.layer_cache_size"
 #define PROPERTY_GRADIENT_CACHE_SIZE "ro.hwui.gradient_cache_size"
 #define PROPERTY_PATH_CACHE_SIZE "ro.hwui.path_cache_size"
 #define PROPERTY_SHAPE_CACHE_SIZE "ro.hwui.shape_cache_size"
+#define PROPERTY_TESSELLATION_CACHE_SIZE "ro.hwui.tessellation_cache_size"
+#define PROPERTY_PATCH_CACHE_SIZE "ro.hwui.patch_cache_size"
 #define PROPERTY_DROP_SHADOW_CACHE_SIZE "ro.hwui.drop_shadow_cache_size"
 #define PROPERTY_FBO_CACHE_SIZE "ro.hwui.fbo_cache_size"
 
@@ -132,7 +155,8 @@ enum DebugLevel {
 #define DEFAULT_LAYER_CACHE_SIZE 16.0f
 #define DEFAULT_PATH_CACHE_SIZE 4.0f
 #define DEFAULT_SHAPE_CACHE_SIZE 1.0f
-#define DEFAULT_PATCH_CACHE_SIZE 512
+#define DEFAULT_TESSELLATION_CACHE_SIZE 0.5f
+#define DEFAULT_PATCH_CACHE_SIZE 0.5f
 #define DEFAULT_GRADIENT_CACHE_SIZE 0.5f
 #define DEFAULT_DROP_SHADOW_CACHE_SIZE 2.0f
 #define DEFAULT_FBO_CACHE_SIZE 16
@@ -21,29 +21,150 @@
 namespace android {
 namespace uirenderer {
 
+///////////////////////////////////////////////////////////////////////////////
+// Defines
+///////////////////////////////////////////////////////////////////////////////
+
+#define MIN_RESOURCE_TABLE_CAPACITY 64
+
+// The table grows when more than 3/4 of its slots are used
+#define RESOURCE_TABLE_MAX_LOAD(capacity) (((capacity) >> 1) + ((capacity) >> 2))
+
+///////////////////////////////////////////////////////////////////////////////
+// Functions
+///////////////////////////////////////////////////////////////////////////////
+
+static inline size_t hashResource(void* resource) {
+    // Resources are heap allocated, their addresses share their lowest and
+    // highest bits. The final mix of MurmurHash3 makes every bit of the
+    // address affect the bits used to index the table
+    uint32_t hash = uint32_t(uintptr_t(resource));
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6b;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// References table
+///////////////////////////////////////////////////////////////////////////////
+
+ResourceReference* ResourceCache::findLocked(void* resource) {
+    if (mCount == 0) return NULL;
+
+    const size_t mask = mCapacity - 1;
+    size_t index = hashResource(resource) & mask;
+    while (mEntries[index].resource) {
+        if (mEntries[index].resource == resource) {
+            return &mEntries[index].reference;
+        }
+        index = (index + 1) & mask;
+    }
+    return NULL;
+}
+
+ResourceReference* ResourceCache::insertLocked(void* resource, ResourceType resourceType) {
+    reserveLocked(mCount + 1);
+
+    const size_t mask = mCapacity - 1;
+    size_t index = hashResource(resource) & mask;
+    while (mEntries[index].resource) {
+        index = (index + 1) & mask;
+    }
+
+    mEntries[index].resource = resource;
+    mEntries[index].reference = ResourceReference(resourceType);
+    mCount++;
+
+    return &mEntries[index].reference;
+}
+
+void ResourceCache::removeLocked(void* resource) {
+    if (mCount == 0) return;
+
+    const size_t mask = mCapacity - 1;
+    size_t index = hashResource(resource) & mask;
+    while (mEntries[index].resource != resource) {
+        if (!mEntries[index].resource) return;
+        index = (index + 1) & mask;
+    }
+
+    // Shift back the following entries of the cluster so that lookups
+    // never need to skip over deleted slots
+    size_t hole = index;
+    size_t next = (index + 1) & mask;
+    while (mEntries[next].resource) {
+        const size_t home = hashResource(mEntries[next].resource) & mask;
+        // Move the entry unless its home slot lies cyclically in ]hole, next]
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            mEntries[hole] = mEntries[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+
+    mEntries[hole].resource = NULL;
+    mCount--;
+}
+
+void ResourceCache::reserveLocked(size_t count) {
+    if (count <= RESOURCE_TABLE_MAX_LOAD(mCapacity)) return;
+
+    size_t capacity = mCapacity ? mCapacity : MIN_RESOURCE_TABLE_CAPACITY;
+    while (count > RESOURCE_TABLE_MAX_LOAD(capacity)) {
+        capacity <<= 1;
+    }
+    resizeLocked(capacity);
+}
+
+void ResourceCache::resizeLocked(size_t capacity) {
+    Entry* entries = mEntries;
+    const size_t oldCapacity = mCapacity;
+
+    mEntries = new Entry[capacity];
+    mCapacity = capacity;
+    for (size_t i = 0; i < capacity; i++) {
+        mEntries[i].resource = NULL;
+    }
+
+    const size_t mask = capacity - 1;
+    for (size_t i = 0; i < oldCapacity; i++) {
+        if (entries[i].resource) {
+            size_t index = hashResource(entries[i].resource) & mask;
+            while (mEntries[index].resource) {
+                index = (index + 1) & mask;
+            }
+            mEntries[index] = entries[i];
+        }
+    }
+
+    delete[] entries;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Resource cache
 ///////////////////////////////////////////////////////////////////////////////
 
 void ResourceCache::logCache() {
     ALOGD("ResourceCache: cacheReport:");
-    for (size_t i = 0; i < mCache->size(); ++i) {
-        ResourceReference* ref = mCache->valueAt(i);
+    for (size_t i = 0; i < mCapacity; ++i) {
+        if (!mEntries[i].resource) continue;
+        ResourceReference* ref = &mEntries[i].reference;
         ALOGD("  ResourceCache: mCache(%d): resource, ref = 0x%p, 0x%p",
-                i, mCache->keyAt(i), mCache->valueAt(i));
+                i, mEntries[i].resource, ref);
         ALOGD("  ResourceCache: mCache(%d): refCount, recycled, destroyed, type = %d, %d, %d, %d",
                 i, ref->refCount, ref->recycled, ref->destroyed, ref->resourceType);
     }
 }
 
-ResourceCache::ResourceCache() {
-    Mutex::Autolock _l(mLock);
-    mCache = new KeyedVector<void*, ResourceReference*>();
+ResourceCache::ResourceCache(): mEntries(NULL), mCapacity(0), mCount(0) {
 }
 
 ResourceCache::~ResourceCache() {
     Mutex::Autolock _l(mLock);
-    delete mCache;
+    delete[] mEntries;
 }
 
 void ResourceCache::lock() {
@@ -84,11 +205,9 @@ void ResourceCache::incrementRefcount(Layer* layerResource) {
 }
 
 void ResourceCache::incrementRefcountLocked(void* resource, ResourceType resourceType) {
-    ssize_t index = mCache->indexOfKey(resource);
-    ResourceReference* ref = index >= 0 ? mCache->valueAt(index) : NULL;
-    if (ref == NULL || mCache->size() == 0) {
-        ref = new ResourceReference(resourceType);
-        mCache->add(resource, ref);
+    ResourceReference* ref = findLocked(resource);
+    if (ref == NULL) {
+        ref = insertLocked(resource, resourceType);
     }
     ref->refCount++;
 }
@@ -147,8 +266,7 @@ void ResourceCache::decrementRefcount(Layer* layerResource) {
 }
 
 void ResourceCache::decrementRefcountLocked(void* resource) {
-    ssize_t index = mCache->indexOfKey(resource);
-    ResourceReference* ref = index >= 0 ? mCache->valueAt(index) : NULL;
+    ResourceReference* ref = findLocked(resource);
     if (ref == NULL) {
         // Should not get here - shouldn't get a call to decrement if we're not yet tracking it
         return;
@@ -183,14 +301,78 @@ void ResourceCache::decrementRefcountLocked(Layer* layerResource) {
     decrementRefcountLocked((void*) layerResource);
 }
 
+void ResourceCache::incrementRefcountsLocked(SkBitmap* const* resources, size_t count) {
+    reserveLocked(mCount + count);
+    for (size_t i = 0; i < count; i++) {
+        incrementRefcountLocked(resources[i]);
+    }
+}
+
+void ResourceCache::incrementRefcountsLocked(SkPath* const* resources, size_t count) {
+    reserveLocked(mCount + count);
+    for (size_t i = 0; i < count; i++) {
+        incrementRefcountLocked(resources[i]);
+    }
+}
+
+void ResourceCache::incrementRefcountsLocked(SkiaShader* const* resources, size_t count) {
+    reserveLocked(mCount + count);
+    for (size_t i = 0; i < count; i++) {
+        incrementRefcountLocked(resources[i]);
+    }
+}
+
+void ResourceCache::incrementRefcountsLocked(SkiaColorFilter* const* resources, size_t count) {
+    reserveLocked(mCount + count);
+    for (size_t i = 0; i < count; i++) {
+        incrementRefcountLocked(resources[i]);
+    }
+}
+
+void ResourceCache::incrementRefcountsLocked(Layer* const* resources, size_t count) {
+    reserveLocked(mCount + count);
+    for (size_t i = 0; i < count; i++) {
+        incrementRefcountLocked(resources[i]);
+    }
+}
+
+void ResourceCache::decrementRefcountsLocked(SkBitmap* const* resources, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        decrementRefcountLocked(resources[i]);
+    }
+}
+
+void ResourceCache::decrementRefcountsLocked(SkPath* const* resources, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        decrementRefcountLocked(resources[i]);
+    }
+}
+
+void ResourceCache::decrementRefcountsLocked(SkiaShader* const* resources, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        decrementRefcountLocked(resources[i]);
+    }
+}
+
+void ResourceCache::decrementRefcountsLocked(SkiaColorFilter* const* resources, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        decrementRefcountLocked(resources[i]);
+    }
+}
+
+void ResourceCache::decrementRefcountsLocked(Layer* const* resources, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        decrementRefcountLocked(resources[i]);
+    }
+}
+
 void ResourceCache::destructor(SkPath* resource) {
     Mutex::Autolock _l(mLock);
     destructorLocked(resource);
 }
 
 void ResourceCache::destructorLocked(SkPath* resource) {
-    ssize_t index = mCache->indexOfKey(resource);
-    ResourceReference* ref = index >= 0 ? mCache->valueAt(index) : NULL;
+    ResourceReference* ref = findLocked(resource);
     if (ref == NULL) {
         // If we're not tracking this resource, just delete it
         if (Caches::hasInstance()) {
@@ -211,8 +393,7 @@ void ResourceCache::destructor(SkBitmap* resource) {
 }
 
 void ResourceCache::destructorLocked(SkBitmap* resource) {
-    ssize_t index = mCache->indexOfKey(resource);
-    ResourceReference* ref = index >= 0 ? mCache->valueAt(index) : NULL;
+    ResourceReference* ref = findLocked(resource);
     if (ref == NULL) {
         // If we're not tracking this resource, just delete it
         if (Caches::hasInstance()) {
@@ -233,8 +414,7 @@ void ResourceCache::destructor(SkiaShader* resource) {
 }
 
 void ResourceCache::destructorLocked(SkiaShader* resource) {
-    ssize_t index = mCache->indexOfKey(resource);
-    ResourceReference* ref = index >= 0 ? mCache->valueAt(index) : NULL;
+    ResourceReference* ref = findLocked(resource);
     if (ref == NULL) {
         // If we're not tracking this resource, just delete it
         delete resource;
@@ -252,8 +432,7 @@ void ResourceCache::destructor(SkiaColorFilter* resource) {
 }
 
 void ResourceCache::destructorLocked(SkiaColorFilter* resource) {
-    ssize_t index = mCache->indexOfKey(resource);
-    ResourceReference* ref = index >= 0 ? mCache->valueAt(index) : NULL;
+    ResourceReference* ref = findLocked(resource);
     if (ref == NULL) {
         // If we're not tracking this resource, just delete it
         delete resource;
@@ -279,17 +458,12 @@ bool ResourceCache::recycle(SkBitmap* resource) {
  * reaches 0.
  */
 bool ResourceCache::recycleLocked(SkBitmap* resource) {
-    ssize_t index = mCache->indexOfKey(resource);
-    if (index < 0) {
+    ResourceReference* ref = findLocked(resource);
+    if (ref == NULL) {
         // not tracking this resource; just recycle the pixel data
         resource->setPixels(NULL, NULL);
         return true;
     }
-    ResourceReference* ref = mCache->valueAt(index);
-    if (ref == NULL) {
-        // Should not get here - shouldn't get a call to recycle if we're not yet tracking it
-        return true;
-    }
     ref->recycled = true;
     if (ref->refCount == 0) {
         deleteResourceReferenceLocked(resource, ref);
@@ -342,8 +516,7 @@ void ResourceCache::deleteResourceReferenceLocked(void* resource, ResourceRefere
             break;
         }
     }
-    mCache->removeItem(resource);
-    delete ref;
+    removeLocked(resource);
 }
 
 }; // namespace uirenderer
@@ -102,7 +102,37 @@ public:
     bool recycle(SkBitmap* resource);
     bool recycleLocked(SkBitmap* resource);
 
+    /**
+     * Batched variants of incrementRefcountLocked() and decrementRefcountLocked(),
+     * used by display lists to acquire and release all their resources at once.
+     */
+    void incrementRefcountsLocked(SkBitmap* const* resources, size_t count);
+    void incrementRefcountsLocked(SkPath* const* resources, size_t count);
+    void incrementRefcountsLocked(SkiaShader* const* resources, size_t count);
+    void incrementRefcountsLocked(SkiaColorFilter* const* resources, size_t count);
+    void incrementRefcountsLocked(Layer* const* resources, size_t count);
+
+    void decrementRefcountsLocked(SkBitmap* const* resources, size_t count);
+    void decrementRefcountsLocked(SkPath* const* resources, size_t count);
+    void decrementRefcountsLocked(SkiaShader* const* resources, size_t count);
+    void decrementRefcountsLocked(SkiaColorFilter* const* resources, size_t count);
+    void decrementRefcountsLocked(Layer* const* resources, size_t count);
+
 private:
+    /**
+     * Slot of the references table. A NULL resource marks an empty slot.
+     */
+    struct Entry {
+        void* resource;
+        ResourceReference reference;
+    };
+
+    ResourceReference* findLocked(void* resource);
+    ResourceReference* insertLocked(void* resource, ResourceType resourceType);
+    void removeLocked(void* resource);
+    void reserveLocked(size_t count);
+    void resizeLocked(size_t capacity);
+
     void deleteResourceReferenceLocked(void* resource, ResourceReference* ref);
 
     void incrementRefcount(void* resource, ResourceType resourceType);
@@ -120,7 +150,13 @@ private:
      */
     mutable Mutex mLock;
 
-    KeyedVector<void*, ResourceReference*>* mCache;
+    /**
+     * References of the tracked resources, stored in an open addressing
+     * hash table with linear probing. The capacity is 0 or a power of 2.
+     */
+    Entry* mEntries;
+    size_t mCapacity;
+    size_t mCount;
 };
 
 }; // namespace uirenderer
@@ -29,6 +29,12 @@ RoundRectShapeCache::RoundRectShapeCache(): ShapeCache<RoundRectShapeCacheEntry>
         "round rect", PROPERTY_SHAPE_CACHE_SIZE, DEFAULT_SHAPE_CACHE_SIZE) {
 }
 
+static void createRoundRectPath(SkPath& path, float width, float height, float rx, float ry) {
+    SkRect r;
+    r.set(0.0f, 0.0f, width, height);
+    path.addRoundRect(r, rx, ry, SkPath::kCW_Direction);
+}
+
 PathTexture* RoundRectShapeCache::getRoundRect(float width, float height,
         float rx, float ry, SkPaint* paint) {
     RoundRectShapeCacheEntry entry(width, height, rx, ry, paint);
@@ -36,9 +42,7 @@ PathTexture* RoundRectShapeCache::getRoundRect(float width, float height,
 
     if (!texture) {
         SkPath path;
-        SkRect r;
-        r.set(0.0f, 0.0f, width, height);
-        path.addRoundRect(r, rx, ry, SkPath::kCW_Direction);
+        createRoundRectPath(path, width, height, rx, ry);
 
         texture = addTexture(entry, &path, paint);
     }
@@ -46,6 +50,16 @@ PathTexture* RoundRectShapeCache::getRoundRect(float width, float height,
     return texture;
 }
 
+void RoundRectShapeCache::precacheRoundRect(float width, float height,
+        float rx, float ry, SkPaint* paint) {
+    RoundRectShapeCacheEntry entry(width, height, rx, ry, paint);
+
+    SkPath path;
+    createRoundRectPath(path, width, height, rx, ry);
+
+    precacheTexture(entry, &path, paint);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Circles
 ///////////////////////////////////////////////////////////////////////////////
@@ -68,6 +82,15 @@ PathTexture* CircleShapeCache::getCircle(float radius, SkPaint* paint) {
     return texture;
 }
 
+void CircleShapeCache::precacheCircle(float radius, SkPaint* paint) {
+    CircleShapeCacheEntry entry(radius, paint);
+
+    SkPath path;
+    path.addCircle(radius, radius, radius, SkPath::kCW_Direction);
+
+    precacheTexture(entry, &path, paint);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Ovals
 ///////////////////////////////////////////////////////////////////////////////
@@ -76,15 +99,19 @@ OvalShapeCache::OvalShapeCache(): ShapeCache<OvalShapeCacheEntry>(
         "oval", PROPERTY_SHAPE_CACHE_SIZE, DEFAULT_SHAPE_CACHE_SIZE) {
 }
 
+static void createOvalPath(SkPath& path, float width, float height) {
+    SkRect r;
+    r.set(0.0f, 0.0f, width, height);
+    path.addOval(r, SkPath::kCW_Direction);
+}
+
 PathTexture* OvalShapeCache::getOval(float width, float height, SkPaint* paint) {
     OvalShapeCacheEntry entry(width, height, paint);
     PathTexture* texture = get(entry);
 
     if (!texture) {
         SkPath path;
-        SkRect r;
-        r.set(0.0f, 0.0f, width, height);
-        path.addOval(r, SkPath::kCW_Direction);
+        createOvalPath(path, width, height);
 
         texture = addTexture(entry, &path, paint);
     }
@@ -92,6 +119,15 @@ PathTexture* OvalShapeCache::getOval(float width, float height, SkPaint* paint)
     return texture;
 }
 
+void OvalShapeCache::precacheOval(float width, float height, SkPaint* paint) {
+    OvalShapeCacheEntry entry(width, height, paint);
+
+    SkPath path;
+    createOvalPath(path, width, height);
+
+    precacheTexture(entry, &path, paint);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Rects
 ///////////////////////////////////////////////////////////////////////////////
@@ -141,6 +177,19 @@ ArcShapeCache::ArcShapeCache(): ShapeCache<ArcShapeCacheEntry>(
         "arc", PROPERTY_SHAPE_CACHE_SIZE, DEFAULT_SHAPE_CACHE_SIZE) {
 }
 
+static void createArcPath(SkPath& path, float width, float height,
+        float startAngle, float sweepAngle, bool useCenter) {
+    SkRect r;
+    r.set(0.0f, 0.0f, width, height);
+    if (useCenter) {
+        path.moveTo(r.centerX(), r.centerY());
+    }
+    path.arcTo(r, startAngle, sweepAngle, !useCenter);
+    if (useCenter) {
+        path.close();
+    }
+}
+
 PathTexture* ArcShapeCache::getArc(float width, float height,
         float startAngle, float sweepAngle, bool useCenter, SkPaint* paint) {
     ArcShapeCacheEntry entry(width, height, startAngle, sweepAngle, useCenter, paint);
@@ -148,15 +197,7 @@ PathTexture* ArcShapeCache::getArc(float width, float height,
 
     if (!texture) {
         SkPath path;
-        SkRect r;
-        r.set(0.0f, 0.0f, width, height);
-        if (useCenter) {
-            path.moveTo(r.centerX(), r.centerY());
-        }
-        path.arcTo(r, startAngle, sweepAngle, !useCenter);
-        if (useCenter) {
-            path.close();
-        }
+        createArcPath(path, width, height, startAngle, sweepAngle, useCenter);
 
         texture = addTexture(entry, &path, paint);
     }
@@ -164,5 +205,15 @@ PathTexture* ArcShapeCache::getArc(float width, float height,
     return texture;
 }
 
+void ArcShapeCache::precacheArc(float width, float height,
+        float startAngle, float sweepAngle, bool useCenter, SkPaint* paint) {
+    ArcShapeCacheEntry entry(width, height, startAngle, sweepAngle, useCenter, paint);
+
+    SkPath path;
+    createArcPath(path, width, height, startAngle, sweepAngle, useCenter);
+
+    precacheTexture(entry, &path, paint);
+}
+
 }; // namespace uirenderer
 }; // namespace android
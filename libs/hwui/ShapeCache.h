@@ -25,8 +25,11 @@
 #include <SkPath.h>
 #include <SkRect.h>
 
+#include <utils/KeyedVector.h>
+
 #include "Debug.h"
 #include "Properties.h"
+#include "ShapeRasterizer.h"
 #include "Texture.h"
 #include "utils/Compare.h"
 #include "utils/GenerationCache.h"
@@ -333,8 +336,25 @@ public:
      * Returns the current size of the cache in bytes.
      */
     uint32_t getSize();
+    /**
+     * Returns the size in bytes of the bitmaps held by paths queued with
+     * precacheTexture() that were not used yet.
+     */
+    uint32_t getPendingSize();
+
+    /**
+     * Discards the paths queued for rasterization.
+     */
+    void clearPendingTasks();
 
 protected:
+    /**
+     * Queues the rasterization of the specified path on the shape rasterizer
+     * thread, unless the entry is already cached. The next call to addTexture()
+     * for this entry will then only need to upload the rasterized path.
+     */
+    void precacheTexture(const Entry& entry, const SkPath *path, const SkPaint* paint);
+
     PathTexture* addTexture(const Entry& entry, const SkPath *path, const SkPaint* paint);
     PathTexture* addTexture(const Entry& entry, SkBitmap* bitmap);
     void addTexture(const Entry& entry, SkBitmap* bitmap, PathTexture* texture);
@@ -356,7 +376,17 @@ protected:
 
     void removeTexture(PathTexture* texture);
 
+    /**
+     * Removes the pending task at the specified index, canceling it if requested.
+     */
+    void removePendingTaskAt(size_t index, bool cancel);
+
     GenerationCache<Entry, PathTexture*> mCache;
+    // Paths queued with precacheTexture() that were not used yet
+    KeyedVector<Entry, sp<ShapeTask> > mPendingTasks;
+    // Size of the bitmaps of the pending tasks, capped to a fraction of
+    // mMaxSize by QUEUED_SHAPES_CACHE_RATIO
+    uint32_t mPendingSize;
     uint32_t mSize;
     uint32_t mMaxSize;
     GLuint mMaxTextureSize;
@@ -370,6 +400,12 @@ private:
      */
     void generateTexture(SkBitmap& bitmap, Texture* texture);
 
+    /**
+     * Discards the pending task that was queued first.
+     */
+    void dropOldestPendingTask();
+    uint32_t getMaxPendingSize() const;
+
     void init();
 }; // class ShapeCache
 
@@ -378,6 +414,7 @@ public:
     RoundRectShapeCache();
 
     PathTexture* getRoundRect(float width, float height, float rx, float ry, SkPaint* paint);
+    void precacheRoundRect(float width, float height, float rx, float ry, SkPaint* paint);
 }; // class RoundRectShapeCache
 
 class CircleShapeCache: public ShapeCache<CircleShapeCacheEntry> {
@@ -385,6 +422,7 @@ public:
     CircleShapeCache();
 
     PathTexture* getCircle(float radius, SkPaint* paint);
+    void precacheCircle(float radius, SkPaint* paint);
 }; // class CircleShapeCache
 
 class OvalShapeCache: public ShapeCache<OvalShapeCacheEntry> {
@@ -392,6 +430,7 @@ public:
     OvalShapeCache();
 
     PathTexture* getOval(float width, float height, SkPaint* paint);
+    void precacheOval(float width, float height, SkPaint* paint);
 }; // class OvalShapeCache
 
 class RectShapeCache: public ShapeCache<RectShapeCacheEntry> {
@@ -407,6 +446,8 @@ public:
 
     PathTexture* getArc(float width, float height, float startAngle, float sweepAngle,
             bool useCenter, SkPaint* paint);
+    void precacheArc(float width, float height, float startAngle, float sweepAngle,
+            bool useCenter, SkPaint* paint);
 }; // class ArcShapeCache
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -416,7 +457,7 @@ public:
 template<class Entry>
 ShapeCache<Entry>::ShapeCache(const char* name, const char* propertyName, float defaultSize):
         mCache(GenerationCache<ShapeCacheEntry, PathTexture*>::kUnlimitedCapacity),
-        mSize(0), mMaxSize(MB(defaultSize)) {
+        mPendingSize(0), mSize(0), mMaxSize(MB(defaultSize)) {
     char property[PROPERTY_VALUE_MAX];
     if (property_get(propertyName, property, NULL) > 0) {
         INIT_LOGD("  Setting %s cache size to %sMB", name, property);
@@ -435,6 +476,7 @@ ShapeCache<Entry>::ShapeCache(const char* name, const char* propertyName, float
 
 template<class Entry>
 ShapeCache<Entry>::~ShapeCache() {
+    clearPendingTasks();
     mCache.clear();
     delete[] mName;
 }
@@ -459,17 +501,30 @@ uint32_t ShapeCache<Entry>::getSize() {
     return mSize;
 }
 
+template<class Entry>
+uint32_t ShapeCache<Entry>::getPendingSize() {
+    return mPendingSize;
+}
+
 template<class Entry>
 uint32_t ShapeCache<Entry>::getMaxSize() {
     return mMaxSize;
 }
 
+template<class Entry>
+uint32_t ShapeCache<Entry>::getMaxPendingSize() const {
+    return uint32_t(mMaxSize * QUEUED_SHAPES_CACHE_RATIO);
+}
+
 template<class Entry>
 void ShapeCache<Entry>::setMaxSize(uint32_t maxSize) {
     mMaxSize = maxSize;
     while (mSize > mMaxSize) {
         mCache.removeOldest();
     }
+    while (!mPendingTasks.isEmpty() && mPendingSize > getMaxPendingSize()) {
+        dropOldestPendingTask();
+    }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -560,9 +615,106 @@ bool ShapeCache<Entry>::checkTextureSize(uint32_t width, uint32_t height) {
     return true;
 }
 
+template<class Entry>
+void ShapeCache<Entry>::precacheTexture(const Entry& entry, const SkPath *path,
+        const SkPaint* paint) {
+    ShapeRasterizer& rasterizer = ShapeRasterizer::getInstance();
+    if (!rasterizer.isEnabled()) return;
+
+    if (mPendingTasks.indexOfKey(entry) >= 0) return;
+
+    // Looking the texture up with get() would make it the most recently used
+    // entry of the cache even though it may never be drawn. A cached texture
+    // whose path has since changed is regenerated when it is drawn instead.
+    if (mCache.contains(entry)) return;
+
+    float left, top, offset;
+    uint32_t width, height;
+    computePathBounds(path, paint, left, top, offset, width, height);
+
+    // Let addTexture() report the error
+    if (width > mMaxTextureSize || height > mMaxTextureSize) return;
+
+    const uint32_t size = width * height;
+    if (size > getMaxPendingSize()) return;
+
+    // Paths that are never drawn must not prevent others from being queued
+    while (!mPendingTasks.isEmpty() && (mPendingTasks.size() >= MAX_QUEUED_SHAPES ||
+            mPendingSize + size > getMaxPendingSize())) {
+        dropOldestPendingTask();
+    }
+
+    SkPaint pathPaint(*paint);
+    initPaint(pathPaint);
+
+    sp<ShapeTask> task = new ShapeTask(*path, pathPaint, left, top, offset, width, height);
+    if (rasterizer.enqueue(task)) {
+        mPendingTasks.add(entry, task);
+        mPendingSize += size;
+    }
+}
+
+template<class Entry>
+void ShapeCache<Entry>::removePendingTaskAt(size_t index, bool cancel) {
+    const sp<ShapeTask>& task = mPendingTasks.valueAt(index);
+    if (cancel) {
+        ShapeRasterizer::getInstance().cancel(task);
+    }
+    mPendingSize -= task->width * task->height;
+    mPendingTasks.removeItemsAt(index);
+}
+
+template<class Entry>
+void ShapeCache<Entry>::dropOldestPendingTask() {
+    size_t oldest = 0;
+    for (size_t i = 1; i < mPendingTasks.size(); i++) {
+        if (mPendingTasks.valueAt(i)->getSequence() <
+                mPendingTasks.valueAt(oldest)->getSequence()) {
+            oldest = i;
+        }
+    }
+    removePendingTaskAt(oldest, true);
+    ShapeRasterizer::getInstance().recordDrop();
+}
+
+template<class Entry>
+void ShapeCache<Entry>::clearPendingTasks() {
+    ShapeRasterizer& rasterizer = ShapeRasterizer::getInstance();
+    for (size_t i = 0; i < mPendingTasks.size(); i++) {
+        rasterizer.cancel(mPendingTasks.valueAt(i));
+    }
+    mPendingTasks.clear();
+    mPendingSize = 0;
+}
+
 template<class Entry>
 PathTexture* ShapeCache<Entry>::addTexture(const Entry& entry, const SkPath *path,
         const SkPaint* paint) {
+    ShapeRasterizer& rasterizer = ShapeRasterizer::getInstance();
+
+    ssize_t index = mPendingTasks.indexOfKey(entry);
+    if (index >= 0) {
+        sp<ShapeTask> task = mPendingTasks.valueAt(index);
+        removePendingTaskAt(index, false);
+
+        // The path may have been modified since it was queued
+        if (task->generation == path->getGenerationID()) {
+            if (rasterizer.finish(task)) {
+                purgeCache(task->width, task->height);
+
+                PathTexture* texture = createTexture(task->left, task->top, task->offset,
+                        task->width, task->height, task->generation);
+                addTexture(entry, &task->bitmap, texture);
+
+                return texture;
+            }
+        } else {
+            rasterizer.cancel(task);
+            rasterizer.recordMiss();
+        }
+    } else {
+        rasterizer.recordMiss();
+    }
 
     float left, top, offset;
     uint32_t width, height;
@@ -608,6 +760,7 @@ void ShapeCache<Entry>::addTexture(const Entry& entry, SkBitmap* bitmap, PathTex
 
 template<class Entry>
 void ShapeCache<Entry>::clear() {
+    clearPendingTasks();
     mCache.clear();
 }
 
@@ -0,0 +1,215 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "OpenGLRenderer"
+
+#include <SkCanvas.h>
+
+#include <cutils/properties.h>
+#include <utils/Log.h>
+
+#include "Properties.h"
+#include "ShapeRasterizer.h"
+
+namespace android {
+
+#ifdef USE_OPENGL_RENDERER
+using namespace uirenderer;
+ANDROID_SINGLETON_STATIC_INSTANCE(ShapeRasterizer);
+#endif
+
+namespace uirenderer {
+
+///////////////////////////////////////////////////////////////////////////////
+// Tasks
+///////////////////////////////////////////////////////////////////////////////
+
+ShapeTask::ShapeTask(const SkPath& path, const SkPaint& paint, float left, float top,
+        float offset, uint32_t width, uint32_t height):
+        path(path), paint(paint), left(left), top(top), offset(offset),
+        width(width), height(height), generation(path.getGenerationID()),
+        mState(kStateQueued), mSequence(0) {
+}
+
+void ShapeTask::rasterize() {
+    bitmap.setConfig(SkBitmap::kA8_Config, width, height);
+    bitmap.allocPixels();
+    bitmap.eraseColor(0);
+
+    SkCanvas canvas(bitmap);
+    canvas.translate(-left + offset, -top + offset);
+    canvas.drawPath(path, paint);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructors/destructor
+///////////////////////////////////////////////////////////////////////////////
+
+ShapeRasterizer::ShapeRasterizer(): Singleton<ShapeRasterizer>(), mSequence(0) {
+    char property[PROPERTY_VALUE_MAX];
+    if (property_get(PROPERTY_PRECACHE_SHAPES, property, "true")) {
+        mEnabled = !strcasecmp(property, "true");
+    } else {
+        mEnabled = true;
+    }
+    INIT_LOGD("  Background shape rasterization %s", mEnabled ? "enabled" : "disabled");
+}
+
+ShapeRasterizer::~ShapeRasterizer() {
+    if (mThread != NULL) {
+        mThread->requestExit();
+        {
+            Mutex::Autolock _l(mLock);
+            mTaskQueued.signal();
+        }
+        mThread->join();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Tasks management
+///////////////////////////////////////////////////////////////////////////////
+
+bool ShapeRasterizer::enqueue(const sp<ShapeTask>& task) {
+    Mutex::Autolock _l(mLock);
+
+    if (mQueue.size() >= MAX_QUEUED_SHAPES) {
+        mStats.dropped++;
+        return false;
+    }
+
+    if (mThread == NULL) {
+        mThread = new RasterizerThread(*this);
+        if (mThread->run("hwuiShapeRasterizer", PRIORITY_FOREGROUND) != NO_ERROR) {
+            ALOGW("Could not start the shape rasterizer thread");
+            mThread.clear();
+            mEnabled = false;
+            return false;
+        }
+    }
+
+    task->mState = ShapeTask::kStateQueued;
+    task->mSequence = mSequence++;
+    mQueue.push(task);
+    mStats.queued++;
+
+    mTaskQueued.signal();
+    return true;
+}
+
+bool ShapeRasterizer::finish(const sp<ShapeTask>& task) {
+    Mutex::Autolock _l(mLock);
+
+    switch (task->mState) {
+        case ShapeTask::kStateDone:
+            mStats.hits++;
+            return true;
+        case ShapeTask::kStateRunning:
+            mStats.late++;
+            while (task->mState == ShapeTask::kStateRunning) {
+                mTaskDone.wait(mLock);
+            }
+            return task->mState == ShapeTask::kStateDone;
+        case ShapeTask::kStateQueued:
+            // Rasterizing the path right away is cheaper than waiting
+            // for the tasks queued before this one
+            mStats.late++;
+            break;
+        case ShapeTask::kStateCanceled:
+            return false;
+    }
+
+    for (size_t i = 0; i < mQueue.size(); i++) {
+        if (mQueue.itemAt(i) == task) {
+            mQueue.removeAt(i);
+            break;
+        }
+    }
+    task->mState = ShapeTask::kStateCanceled;
+
+    return false;
+}
+
+void ShapeRasterizer::cancel(const sp<ShapeTask>& task) {
+    Mutex::Autolock _l(mLock);
+
+    if (task->mState != ShapeTask::kStateQueued) return;
+
+    for (size_t i = 0; i < mQueue.size(); i++) {
+        if (mQueue.itemAt(i) == task) {
+            mQueue.removeAt(i);
+            break;
+        }
+    }
+    task->mState = ShapeTask::kStateCanceled;
+}
+
+bool ShapeRasterizer::processNextTask() {
+    sp<ShapeTask> task;
+    {
+        Mutex::Autolock _l(mLock);
+        while (mQueue.isEmpty()) {
+            if (mThread->exitPending()) return false;
+            mTaskQueued.wait(mLock);
+        }
+
+        task = mQueue.itemAt(0);
+        mQueue.removeAt(0);
+        task->mState = ShapeTask::kStateRunning;
+    }
+
+    task->rasterize();
+
+    {
+        Mutex::Autolock _l(mLock);
+        task->mState = ShapeTask::kStateDone;
+        mTaskDone.broadcast();
+    }
+
+    return true;
+}
+
+bool ShapeRasterizer::RasterizerThread::threadLoop() {
+    return mRasterizer.processNextTask();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Statistics
+///////////////////////////////////////////////////////////////////////////////
+
+void ShapeRasterizer::recordMiss() {
+    Mutex::Autolock _l(mLock);
+    mStats.misses++;
+}
+
+void ShapeRasterizer::recordDrop() {
+    Mutex::Autolock _l(mLock);
+    mStats.dropped++;
+}
+
+ShapeRasterizer::Stats ShapeRasterizer::getStats() const {
+    Mutex::Autolock _l(mLock);
+    return mStats;
+}
+
+void ShapeRasterizer::dumpStats(String8& log) const {
+    Stats stats = getStats();
+    log.appendFormat("  ShapeRasterizer      %d queued, %d hits, %d misses, %d late, %d dropped\n",
+            stats.queued, stats.hits, stats.misses, stats.late, stats.dropped);
+}
+
+}; // namespace uirenderer
+}; // namespace android
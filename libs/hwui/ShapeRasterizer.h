@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HWUI_SHAPE_RASTERIZER_H
+#define ANDROID_HWUI_SHAPE_RASTERIZER_H
+
+#include <SkBitmap.h>
+#include <SkPaint.h>
+#include <SkPath.h>
+
+#include <utils/RefBase.h>
+#include <utils/Singleton.h>
+#include <utils/String8.h>
+#include <utils/threads.h>
+#include <utils/Vector.h>
+
+#include <cutils/compiler.h>
+
+#include "Debug.h"
+
+namespace android {
+namespace uirenderer {
+
+///////////////////////////////////////////////////////////////////////////////
+// Defines
+///////////////////////////////////////////////////////////////////////////////
+
+// Maximum number of shapes waiting to be rasterized, or waiting to be
+// uploaded by a shape cache
+#define MAX_QUEUED_SHAPES 32
+// Fraction of the maximum size of a shape cache that the bitmaps of its
+// queued shapes may use, on top of the cache itself
+#define QUEUED_SHAPES_CACHE_RATIO 0.25f
+
+///////////////////////////////////////////////////////////////////////////////
+// Classes
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Path rasterized in the background for a shape cache. The task owns copies
+ * of the path and paint so that they can be modified or destroyed while the
+ * task is pending.
+ */
+class ShapeTask: public LightRefBase<ShapeTask> {
+public:
+    ShapeTask(const SkPath& path, const SkPaint& paint, float left, float top, float offset,
+            uint32_t width, uint32_t height);
+
+    /**
+     * Draws the path into the bitmap. The paint must already be set up
+     * to draw into an alpha8 bitmap, see ShapeCache::initPaint().
+     */
+    void rasterize();
+
+    /**
+     * Returns a number that increases with the order in which tasks were queued.
+     */
+    uint32_t getSequence() const {
+        return mSequence;
+    }
+
+    const SkPath path;
+    const SkPaint paint;
+
+    const float left;
+    const float top;
+    const float offset;
+    const uint32_t width;
+    const uint32_t height;
+
+    // Generation ID of the path at the time the task was created
+    const uint32_t generation;
+
+    // Alpha8 image of the path, valid once the task is done
+    SkBitmap bitmap;
+
+private:
+    friend class ShapeRasterizer;
+
+    enum State {
+        kStateQueued,
+        kStateRunning,
+        kStateDone,
+        kStateCanceled
+    };
+
+    // Guarded by the rasterizer's lock
+    State mState;
+    uint32_t mSequence;
+}; // class ShapeTask
+
+/**
+ * Rasterizes paths on a background thread on behalf of the shape caches.
+ * Textures are still created on the thread that owns the GL context, when
+ * a shape cache needs them.
+ */
+class ANDROID_API ShapeRasterizer: public Singleton<ShapeRasterizer> {
+    ShapeRasterizer();
+    ~ShapeRasterizer();
+
+    friend class Singleton<ShapeRasterizer>;
+
+public:
+    /**
+     * Counters describing how useful background rasterization is.
+     */
+    struct Stats {
+        Stats(): queued(0), hits(0), misses(0), late(0), dropped(0) {
+        }
+
+        // Number of shapes queued for rasterization
+        uint32_t queued;
+        // Number of shapes that were rasterized by the time they were needed
+        uint32_t hits;
+        // Number of shapes rasterized on demand because nobody queued them
+        uint32_t misses;
+        // Number of shapes that were queued but not rasterized yet when needed
+        uint32_t late;
+        // Number of shapes discarded because too many were pending
+        uint32_t dropped;
+    }; // struct Stats
+
+    /**
+     * Indicates whether shapes should be queued. See PROPERTY_PRECACHE_SHAPES.
+     */
+    bool isEnabled() const {
+        return mEnabled;
+    }
+
+    /**
+     * Queues the specified task. Returns false if the queue is full.
+     */
+    bool enqueue(const sp<ShapeTask>& task);
+
+    /**
+     * Returns true once the bitmap of the specified task is available,
+     * waiting for the task to complete if it is running. If the task did
+     * not start yet, it is canceled and this method returns false: the
+     * caller must then rasterize the path itself.
+     */
+    bool finish(const sp<ShapeTask>& task);
+
+    /**
+     * Cancels the specified task if it did not start yet.
+     */
+    void cancel(const sp<ShapeTask>& task);
+
+    /**
+     * Invoked by the shape caches when they rasterize a path that was not queued.
+     */
+    void recordMiss();
+
+    /**
+     * Invoked by the shape caches when they discard a pending task.
+     */
+    void recordDrop();
+
+    Stats getStats() const;
+    void dumpStats(String8& log) const;
+
+private:
+    class RasterizerThread: public Thread {
+    public:
+        RasterizerThread(ShapeRasterizer& rasterizer):
+                Thread(false), mRasterizer(rasterizer) {
+        }
+
+    private:
+        virtual bool threadLoop();
+
+        ShapeRasterizer& mRasterizer;
+    }; // class RasterizerThread
+
+    bool processNextTask();
+
+    bool mEnabled;
+
+    mutable Mutex mLock;
+    // Signaled when a task is queued
+    Condition mTaskQueued;
+    // Signaled when a task is done
+    Condition mTaskDone;
+
+    Vector<sp<ShapeTask> > mQueue;
+    uint32_t mSequence;
+    Stats mStats;
+
+    // Started when the first task is queued
+    sp<RasterizerThread> mThread;
+}; // class ShapeRasterizer
+
+}; // namespace uirenderer
+}; // namespace android
+
+#endif // ANDROID_HWUI_SHAPE_RASTERIZER_H
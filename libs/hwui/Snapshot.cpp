@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 
+#include <stdlib.h>
+
 #include "Snapshot.h"
 
 #include <SkCanvas.h>
@@ -21,12 +23,57 @@
 namespace android {
 namespace uirenderer {
 
+///////////////////////////////////////////////////////////////////////////////
+// Snapshot pool
+///////////////////////////////////////////////////////////////////////////////
+
+SnapshotPool::SnapshotPool(): mFreeBlocks(NULL), mFreeCount(0) {
+}
+
+SnapshotPool::~SnapshotPool() {
+    while (mFreeBlocks) {
+        Header* header = mFreeBlocks;
+        mFreeBlocks = header->next;
+        free(header);
+    }
+}
+
+void* SnapshotPool::allocate(size_t size) {
+    Header* header = mFreeBlocks;
+    if (header) {
+        mFreeBlocks = header->next;
+        mFreeCount--;
+    } else {
+        // All the allocations are snapshots and have the same size
+        header = (Header*) malloc(sizeof(Header) + size);
+    }
+
+    header->pool = this;
+    return header + 1;
+}
+
+void SnapshotPool::release(void* storage) {
+    if (!storage) return;
+
+    Header* header = ((Header*) storage) - 1;
+    SnapshotPool* pool = header->pool;
+
+    if (pool->mFreeCount < MAX_POOLED_SNAPSHOTS) {
+        header->next = pool->mFreeBlocks;
+        pool->mFreeBlocks = header;
+        pool->mFreeCount++;
+    } else {
+        free(header);
+    }
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Constructors
 ///////////////////////////////////////////////////////////////////////////////
 
 Snapshot::Snapshot(): flags(0), previous(NULL), layer(NULL), fbo(0),
-        invisible(false), empty(false), alpha(1.0f) {
+        invisible(false), empty(false), alpha(1.0f),
+        mSharedTransform(false), mSharedClip(false) {
 
     transform = &mTransformRoot;
     clipRect = &mClipRectRoot;
@@ -37,36 +84,34 @@ Snapshot::Snapshot(): flags(0), previous(NULL), layer(NULL), fbo(0),
 /**
  * Copies the specified snapshot/ The specified snapshot is stored as
  * the previous snapshot.
+ *
+ * The transform and the clip are shared with the previous snapshot until
+ * they are modified, see editTransform() and editClipRect(). Without the
+ * matching save flag, modifications are applied to the previous snapshot.
  */
 Snapshot::Snapshot(const sp<Snapshot>& s, int saveFlags):
         flags(0), previous(s), layer(NULL), fbo(s->fbo),
         invisible(s->invisible), empty(false),
-        viewport(s->viewport), height(s->height), alpha(s->alpha) {
-
-    clipRegion = NULL;
-
-    if (saveFlags & SkCanvas::kMatrix_SaveFlag) {
-        mTransformRoot.load(*s->transform);
-        transform = &mTransformRoot;
-    } else {
-        transform = s->transform;
+        viewport(s->viewport), height(s->height), alpha(s->alpha),
+        mSharedTransform(saveFlags & SkCanvas::kMatrix_SaveFlag),
+        mSharedClip(saveFlags & SkCanvas::kClip_SaveFlag) {
+
+    // Modifications made through this snapshot must reach the matrix
+    // and the clip owned by the previous one, not the ones it shares
+    if (!mSharedTransform) {
+        s->editTransform();
+    }
+    if (!mSharedClip) {
+        s->editClipRect();
     }
 
-    if (saveFlags & SkCanvas::kClip_SaveFlag) {
-        mClipRectRoot.set(*s->clipRect);
-        clipRect = &mClipRectRoot;
+    transform = s->transform;
+    clipRect = s->clipRect;
 #if STENCIL_BUFFER_SIZE
-        if (s->clipRegion) {
-            mClipRegionRoot.op(*s->clipRegion, SkRegion::kUnion_Op);
-            clipRegion = &mClipRegionRoot;
-        }
-#endif
-    } else {
-        clipRect = s->clipRect;
-#if STENCIL_BUFFER_SIZE
-        clipRegion = s->clipRegion;
+    clipRegion = s->clipRegion;
+#else
+    clipRegion = NULL;
 #endif
-    }
 
     if (s->flags & Snapshot::kFlagFboTarget) {
         flags |= Snapshot::kFlagFboTarget;
@@ -79,6 +124,28 @@ Snapshot::Snapshot(const sp<Snapshot>& s, int saveFlags):
 #endif
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Copy on write
+///////////////////////////////////////////////////////////////////////////////
+
+void Snapshot::copyTransform() {
+    mTransformRoot.load(*transform);
+    transform = &mTransformRoot;
+    mSharedTransform = false;
+}
+
+void Snapshot::copyClip() {
+    mClipRectRoot.set(*clipRect);
+    clipRect = &mClipRectRoot;
+#if STENCIL_BUFFER_SIZE
+    if (clipRegion) {
+        mClipRegionRoot.setRegion(*clipRegion);
+        clipRegion = &mClipRegionRoot;
+    }
+#endif
+    mSharedClip = false;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Clipping
 ///////////////////////////////////////////////////////////////////////////////
@@ -130,6 +197,10 @@ bool Snapshot::clip(float left, float top, float right, float bottom, SkRegion::
 bool Snapshot::clipTransformed(const Rect& r, SkRegion::Op op) {
     bool clipped = false;
 
+    if (op != SkRegion::kReplace_Op) {
+        editClipRect();
+    }
+
     switch (op) {
         case SkRegion::kIntersect_Op: {
             if (CC_UNLIKELY(clipRegion)) {
@@ -171,6 +242,13 @@ bool Snapshot::clipTransformed(const Rect& r, SkRegion::Op op) {
 }
 
 void Snapshot::setClip(float left, float top, float right, float bottom) {
+    if (mSharedClip) {
+        // The whole clip is replaced, there is nothing to copy
+        clipRect = &mClipRectRoot;
+        clipRegion = NULL;
+        mSharedClip = false;
+    }
+
     clipRect->set(left, top, right, bottom);
 #if STENCIL_BUFFER_SIZE
     if (clipRegion) {
@@ -206,6 +284,11 @@ const Rect& Snapshot::getTileClip() {
 #endif
 
 void Snapshot::resetClip(float left, float top, float right, float bottom) {
+    if (mSharedClip) {
+        clipRegion = NULL;
+        mSharedClip = false;
+    }
+
     clipRect = &mClipRectRoot;
     setClip(left, top, right, bottom);
 }
@@ -217,6 +300,7 @@ void Snapshot::resetClip(float left, float top, float right, float bottom) {
 void Snapshot::resetTransform(float x, float y, float z) {
     transform = &mTransformRoot;
     transform->loadTranslate(x, y, z);
+    mSharedTransform = false;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -17,9 +17,14 @@
 #ifndef ANDROID_HWUI_SNAPSHOT_H
 #define ANDROID_HWUI_SNAPSHOT_H
 
+#include <stdint.h>
+#include <sys/types.h>
+
 #include <GLES2/gl2.h>
 #include <GLES2/gl2ext.h>
 
+#include <cutils/compiler.h>
+
 #include <utils/RefBase.h>
 #include <ui/Region.h>
 
@@ -32,6 +37,50 @@
 namespace android {
 namespace uirenderer {
 
+///////////////////////////////////////////////////////////////////////////////
+// Defines
+///////////////////////////////////////////////////////////////////////////////
+
+// Maximum number of unused snapshots kept by a pool
+#define MAX_POOLED_SNAPSHOTS 32
+
+///////////////////////////////////////////////////////////////////////////////
+// Classes
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Recycles the memory of the snapshots created by a renderer. Snapshots
+ * are created and destroyed by every save() and restore(), the pool avoids
+ * going through the heap each time. A pool must only be used by one thread
+ * and must outlive the snapshots allocated from it.
+ */
+class SnapshotPool {
+public:
+    SnapshotPool();
+    ~SnapshotPool();
+
+    void* allocate(size_t size);
+
+    /**
+     * Returns the specified storage to the pool it was allocated from.
+     */
+    static void release(void* storage);
+
+private:
+    /**
+     * Precedes every allocation. Holds the owning pool while the storage
+     * is in use and links the free blocks otherwise.
+     */
+    union Header {
+        SnapshotPool* pool;
+        Header* next;
+        int64_t align;
+    };
+
+    Header* mFreeBlocks;
+    uint32_t mFreeCount;
+}; // class SnapshotPool
+
 /**
  * A snapshot holds information about the current state of the rendering
  * surface. A snapshot is usually created whenever the user calls save()
@@ -40,6 +89,10 @@ namespace uirenderer {
  *
  * Each snapshot has a link to a previous snapshot, indicating the previous
  * state of the renderer.
+ *
+ * Snapshots must be allocated from a SnapshotPool:
+ *
+ *     sp<Snapshot> snapshot = new (pool) Snapshot();
  */
 class Snapshot: public LightRefBase<Snapshot> {
 public:
@@ -47,6 +100,14 @@ public:
     Snapshot();
     Snapshot(const sp<Snapshot>& s, int saveFlags);
 
+    static void* operator new(size_t size, SnapshotPool& pool) {
+        return pool.allocate(size);
+    }
+
+    static void operator delete(void* storage) {
+        SnapshotPool::release(storage);
+    }
+
     /**
      * Various flags set on ::flags.
      */
@@ -126,6 +187,26 @@ public:
      */
     void resetTransform(float x, float y, float z);
 
+    /**
+     * Returns the current transform for modification. The transform of
+     * the previous snapshot is copied the first time this method is called
+     * after a save with the flag SkCanvas::kMatrix_SaveFlag.
+     */
+    mat4* editTransform() {
+        if (CC_UNLIKELY(mSharedTransform)) copyTransform();
+        return transform;
+    }
+
+    /**
+     * Returns the current clip rect for modification. The clip of the
+     * previous snapshot is copied the first time this method is called
+     * after a save with the flag SkCanvas::kClip_SaveFlag.
+     */
+    Rect* editClipRect() {
+        if (CC_UNLIKELY(mSharedClip)) copyClip();
+        return clipRect;
+    }
+
     /**
      * Indicates whether this snapshot should be ignored. A snapshot
      * is typicalled ignored if its layer is invisible or empty.
@@ -194,6 +275,7 @@ public:
      *
      * This is a reference to a matrix owned by this snapshot or another
      *  snapshot. This pointer must not be freed. See ::mTransformRoot.
+     * Use editTransform() to modify the matrix.
      */
     mat4* transform;
 
@@ -203,6 +285,7 @@ public:
      *
      * This is a reference to a rect owned by this snapshot or another
      * snapshot. This pointer must not be freed. See ::mClipRectRoot.
+     * Use editClipRect() to modify the rect.
      */
     Rect* clipRect;
 
@@ -237,11 +320,20 @@ public:
     float alpha;
 
 private:
+    void copyTransform();
+    void copyClip();
+
     void ensureClipRegion();
     void copyClipRectFromRegion();
 
     bool clipRegionOp(float left, float top, float right, float bottom, SkRegion::Op op);
 
+    // Set when ::transform, or ::clipRect and ::clipRegion, still point to
+    // the state of a previous snapshot that must be copied before being
+    // modified by this snapshot
+    bool mSharedTransform;
+    bool mSharedClip;
+
     mat4 mTransformRoot;
     Rect mClipRectRoot;
     Rect mLocalClip;
@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "OpenGLRenderer"
+
+#include <math.h>
+
+#include <cutils/properties.h>
+
+#include "Properties.h"
+#include "TessellationCache.h"
+
+namespace android {
+namespace uirenderer {
+
+///////////////////////////////////////////////////////////////////////////////
+// Defines
+///////////////////////////////////////////////////////////////////////////////
+
+// Shapes larger than this fraction of the cache are tessellated every time
+#define MAX_TESSELLATION_FRACTION 8
+
+// Number of mantissa steps kept when quantizing inverse scales; the scale
+// used for tessellation is then within about 3% of the exact one
+#define INVERSE_SCALE_STEPS 32.0f
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructors/destructor
+///////////////////////////////////////////////////////////////////////////////
+
+TessellationCache::TessellationCache():
+        mCache(GenerationCache<TessellationCacheEntry, Tessellation*>::kUnlimitedCapacity),
+        mSize(0), mMaxSize(MB(DEFAULT_TESSELLATION_CACHE_SIZE)), mHits(0), mMisses(0) {
+    char property[PROPERTY_VALUE_MAX];
+    if (property_get(PROPERTY_TESSELLATION_CACHE_SIZE, property, NULL) > 0) {
+        INIT_LOGD("  Setting tessellation cache size to %sMB", property);
+        mMaxSize = MB(atof(property));
+    } else {
+        INIT_LOGD("  Using default tessellation cache size of %.2fMB",
+                DEFAULT_TESSELLATION_CACHE_SIZE);
+    }
+
+    mCache.setOnEntryRemovedListener(this);
+}
+
+TessellationCache::~TessellationCache() {
+    mCache.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Callbacks
+///////////////////////////////////////////////////////////////////////////////
+
+void TessellationCache::operator()(TessellationCacheEntry& entry,
+        Tessellation*& tessellation) {
+    if (tessellation) {
+        mSize -= tessellation->vertexBuffer.getByteSize();
+        delete tessellation;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Caching
+///////////////////////////////////////////////////////////////////////////////
+
+void TessellationCache::clear() {
+    mCache.clear();
+}
+
+/**
+ * Snaps an inverse scale to a few bits of mantissa. Animated transforms produce
+ * a slightly different scale every frame and would otherwise never hit the cache.
+ */
+float TessellationCache::quantizeInverseScale(float inverseScale) {
+    int exponent;
+    float mantissa = frexpf(inverseScale, &exponent);
+    return ldexpf(floorf(mantissa * INVERSE_SCALE_STEPS + 0.5f) / INVERSE_SCALE_STEPS, exponent);
+}
+
+TessellationCacheEntry TessellationCache::createEntry(TessellationCacheEntry::ShapeType type,
+        const SkPaint* paint, const mat4* transform) {
+    float inverseScaleX, inverseScaleY;
+    PathRenderer::computeInverseScales(transform, inverseScaleX, inverseScaleY);
+    return TessellationCacheEntry(type, paint,
+            quantizeInverseScale(inverseScaleX), quantizeInverseScale(inverseScaleY));
+}
+
+const Tessellation* TessellationCache::getRect(float width, float height,
+        const SkPaint* paint, const mat4* transform) {
+    TessellationCacheEntry entry = createEntry(TessellationCacheEntry::kShapeRect,
+            paint, transform);
+    entry.width = width;
+    entry.height = height;
+    return get(entry, paint);
+}
+
+const Tessellation* TessellationCache::getRoundRect(float width, float height,
+        float rx, float ry, const SkPaint* paint, const mat4* transform) {
+    TessellationCacheEntry entry = createEntry(TessellationCacheEntry::kShapeRoundRect,
+            paint, transform);
+    entry.width = width;
+    entry.height = height;
+    entry.arg1 = rx;
+    entry.arg2 = ry;
+    return get(entry, paint);
+}
+
+const Tessellation* TessellationCache::getCircle(float radius, const SkPaint* paint,
+        const mat4* transform) {
+    TessellationCacheEntry entry = createEntry(TessellationCacheEntry::kShapeCircle,
+            paint, transform);
+    entry.width = radius * 2.0f;
+    entry.height = radius * 2.0f;
+    return get(entry, paint);
+}
+
+const Tessellation* TessellationCache::getOval(float width, float height,
+        const SkPaint* paint, const mat4* transform) {
+    TessellationCacheEntry entry = createEntry(TessellationCacheEntry::kShapeOval,
+            paint, transform);
+    entry.width = width;
+    entry.height = height;
+    return get(entry, paint);
+}
+
+const Tessellation* TessellationCache::getArc(float width, float height,
+        float startAngle, float sweepAngle, bool useCenter, const SkPaint* paint,
+        const mat4* transform) {
+    TessellationCacheEntry entry = createEntry(TessellationCacheEntry::kShapeArc,
+            paint, transform);
+    entry.width = width;
+    entry.height = height;
+    entry.arg1 = startAngle;
+    entry.arg2 = sweepAngle;
+    entry.useCenter = useCenter;
+    return get(entry, paint);
+}
+
+const Tessellation* TessellationCache::get(TessellationCacheEntry& entry,
+        const SkPaint* paint) {
+    Tessellation* tessellation = mCache.get(entry);
+    if (tessellation) {
+        mHits++;
+        return tessellation;
+    }
+
+    mMisses++;
+    tessellate(entry, paint, &mScratch);
+
+    const uint32_t size = mScratch.vertexBuffer.getByteSize();
+    if (size > mMaxSize / MAX_TESSELLATION_FRACTION) {
+        return &mScratch;
+    }
+
+    tessellation = new Tessellation;
+    tessellation->vertexBuffer.copy(mScratch.vertexBuffer);
+    tessellation->bounds = mScratch.bounds;
+
+    while (mSize + size > mMaxSize) {
+        mCache.removeOldest();
+    }
+
+    mSize += size;
+    mCache.put(entry, tessellation);
+
+    return tessellation;
+}
+
+void TessellationCache::tessellate(const TessellationCacheEntry& entry,
+        const SkPaint* paint, Tessellation* tessellation) {
+    SkPath path;
+    SkRect rect = SkRect::MakeWH(entry.width, entry.height);
+
+    const bool strokeAndFill = paint->getStyle() == SkPaint::kStrokeAndFill_Style;
+    const float outset = paint->getStrokeWidth() / 2;
+
+    // The shapes are built exactly like OpenGLRenderer used to build them,
+    // but relative to their top-left corner
+    switch (entry.type) {
+        case TessellationCacheEntry::kShapeRect:
+            if (strokeAndFill) rect.outset(outset, outset);
+            path.addRect(rect);
+            break;
+        case TessellationCacheEntry::kShapeRoundRect: {
+            float rx = entry.arg1;
+            float ry = entry.arg2;
+            if (strokeAndFill) {
+                rect.outset(outset, outset);
+                rx += outset;
+                ry += outset;
+            }
+            path.addRoundRect(rect, rx, ry);
+            break;
+        }
+        case TessellationCacheEntry::kShapeCircle: {
+            const float radius = entry.width / 2.0f;
+            path.addCircle(radius, radius, strokeAndFill ? radius + outset : radius);
+            break;
+        }
+        case TessellationCacheEntry::kShapeOval:
+            if (strokeAndFill) rect.outset(outset, outset);
+            path.addOval(rect);
+            break;
+        case TessellationCacheEntry::kShapeArc:
+            if (strokeAndFill) rect.outset(outset, outset);
+            if (entry.useCenter) {
+                path.moveTo(rect.centerX(), rect.centerY());
+            }
+            path.arcTo(rect, entry.arg1, entry.arg2, !entry.useCenter);
+            if (entry.useCenter) {
+                path.close();
+            }
+            break;
+        case TessellationCacheEntry::kShapeNone:
+            break;
+    }
+
+    PathRenderer::convexPathVertices(path, paint, entry.inverseScaleX, entry.inverseScaleY,
+            mPerimeter, tessellation->vertexBuffer);
+    tessellation->bounds = PathRenderer::computePathBounds(path, paint);
+}
+
+}; // namespace uirenderer
+}; // namespace android
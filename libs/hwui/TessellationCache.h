@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HWUI_TESSELLATION_CACHE_H
+#define ANDROID_HWUI_TESSELLATION_CACHE_H
+
+#include <SkPaint.h>
+#include <SkPath.h>
+#include <SkRect.h>
+
+#include <utils/GenerationCache.h>
+
+#include "Debug.h"
+#include "Matrix.h"
+#include "PathRenderer.h"
+#include "utils/Compare.h"
+
+namespace android {
+namespace uirenderer {
+
+///////////////////////////////////////////////////////////////////////////////
+// Classes
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Vertices of a tessellated convex shape. The vertices and the bounds are
+ * relative to the top-left corner of the shape.
+ */
+struct Tessellation {
+    VertexBuffer vertexBuffer;
+    // Area touched by the shape, including its stroke
+    SkRect bounds;
+}; // struct Tessellation
+
+/**
+ * Describes a shape and the paint and scale it was tessellated with.
+ */
+struct TessellationCacheEntry {
+    enum ShapeType {
+        kShapeNone,
+        kShapeRect,
+        kShapeRoundRect,
+        kShapeCircle,
+        kShapeOval,
+        kShapeArc
+    };
+
+    TessellationCacheEntry(): type(kShapeNone), style(SkPaint::kFill_Style), antiAlias(false),
+            strokeWidth(0.0f), inverseScaleX(1.0f), inverseScaleY(1.0f),
+            width(0.0f), height(0.0f), arg1(0.0f), arg2(0.0f), useCenter(false) {
+    }
+
+    TessellationCacheEntry(ShapeType type, const SkPaint* paint,
+            float inverseScaleX, float inverseScaleY): type(type),
+            style(paint->getStyle()), antiAlias(paint->isAntiAlias()),
+            strokeWidth(paint->getStrokeWidth()),
+            inverseScaleX(inverseScaleX), inverseScaleY(inverseScaleY),
+            width(0.0f), height(0.0f), arg1(0.0f), arg2(0.0f), useCenter(false) {
+    }
+
+    bool operator<(const TessellationCacheEntry& rhs) const {
+        LTE_INT(type) {
+            LTE_INT(style) {
+                LTE_INT(antiAlias) {
+                    LTE_FLOAT(strokeWidth) {
+                        LTE_FLOAT(inverseScaleX) {
+                            LTE_FLOAT(inverseScaleY) {
+                                LTE_FLOAT(width) {
+                                    LTE_FLOAT(height) {
+                                        LTE_FLOAT(arg1) {
+                                            LTE_FLOAT(arg2) {
+                                                LTE_INT(useCenter) {
+                                                    return false;
+                                                }
+                                            }
+                                        }
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    ShapeType type;
+    SkPaint::Style style;
+    bool antiAlias;
+    float strokeWidth;
+    float inverseScaleX;
+    float inverseScaleY;
+
+    // Size of the bounding box of the shape
+    float width;
+    float height;
+    // Corner radii of round rects, start and sweep angles of arcs
+    float arg1;
+    float arg2;
+    bool useCenter;
+}; // struct TessellationCacheEntry
+
+/**
+ * A LRU cache of tessellated convex shapes, used by OpenGLRenderer to avoid
+ * tessellating the same rects, round rects, circles, ovals and arcs every
+ * frame. The cache has a maximum size expressed in bytes.
+ *
+ * The returned tessellations are owned by the cache and remain valid until
+ * the next call to one of the get methods.
+ */
+class TessellationCache: public OnEntryRemoved<TessellationCacheEntry, Tessellation*> {
+public:
+    TessellationCache();
+    ~TessellationCache();
+
+    /**
+     * Used as a callback when an entry is removed from the cache.
+     * Do not invoke directly.
+     */
+    void operator()(TessellationCacheEntry& entry, Tessellation*& tessellation);
+
+    const Tessellation* getRect(float width, float height, const SkPaint* paint,
+            const mat4* transform);
+    const Tessellation* getRoundRect(float width, float height, float rx, float ry,
+            const SkPaint* paint, const mat4* transform);
+    const Tessellation* getCircle(float radius, const SkPaint* paint, const mat4* transform);
+    const Tessellation* getOval(float width, float height, const SkPaint* paint,
+            const mat4* transform);
+    const Tessellation* getArc(float width, float height, float startAngle, float sweepAngle,
+            bool useCenter, const SkPaint* paint, const mat4* transform);
+
+    /**
+     * Clears the cache.
+     */
+    void clear();
+
+    /**
+     * Returns the maximum size of the cache in bytes.
+     */
+    uint32_t getMaxSize() const {
+        return mMaxSize;
+    }
+
+    /**
+     * Returns the current size of the cache in bytes.
+     */
+    uint32_t getSize() const {
+        return mSize;
+    }
+
+    uint32_t getHitCount() const {
+        return mHits;
+    }
+
+    uint32_t getMissCount() const {
+        return mMisses;
+    }
+
+private:
+    const Tessellation* get(TessellationCacheEntry& entry, const SkPaint* paint);
+    void tessellate(const TessellationCacheEntry& entry, const SkPaint* paint,
+            Tessellation* tessellation);
+
+    static float quantizeInverseScale(float inverseScale);
+    static TessellationCacheEntry createEntry(TessellationCacheEntry::ShapeType type,
+            const SkPaint* paint, const mat4* transform);
+
+    GenerationCache<TessellationCacheEntry, Tessellation*> mCache;
+    uint32_t mSize;
+    uint32_t mMaxSize;
+
+    uint32_t mHits;
+    uint32_t mMisses;
+
+    // Temporary storage used by the tessellator
+    PerimeterVertices mPerimeter;
+    // Holds the shapes that are too large to be cached
+    Tessellation mScratch;
+}; // class TessellationCache
+
+}; // namespace uirenderer
+}; // namespace android
+
+#endif // ANDROID_HWUI_TESSELLATION_CACHE_H
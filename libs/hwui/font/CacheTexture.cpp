@@ -23,172 +23,109 @@ namespace android {
 namespace uirenderer {
 
 ///////////////////////////////////////////////////////////////////////////////
-// CacheBlock
+// CacheTexture
 ///////////////////////////////////////////////////////////////////////////////
 
-/**
- * Insert new block into existing linked list of blocks. Blocks are sorted in increasing-width
- * order, except for the final block (the remainder space at the right, since we fill from the
- * left).
- */
-CacheBlock* CacheBlock::insertBlock(CacheBlock* head, CacheBlock* newBlock) {
-#if DEBUG_FONT_RENDERER
-    ALOGD("insertBlock: this, x, y, w, h = %p, %d, %d, %d, %d",
-            newBlock, newBlock->mX, newBlock->mY,
-            newBlock->mWidth, newBlock->mHeight);
-#endif
-
-    CacheBlock* currBlock = head;
-    CacheBlock* prevBlock = NULL;
-
-    while (currBlock && currBlock->mY != TEXTURE_BORDER_SIZE) {
-        if (newBlock->mWidth < currBlock->mWidth) {
-            newBlock->mNext = currBlock;
-            newBlock->mPrev = prevBlock;
-            currBlock->mPrev = newBlock;
-
-            if (prevBlock) {
-                prevBlock->mNext = newBlock;
-                return head;
-            } else {
-                return newBlock;
-            }
-        }
-
-        prevBlock = currBlock;
-        currBlock = currBlock->mNext;
+bool CacheTexture::fitBitmap(const SkGlyph& glyph, uint32_t* retOriginX, uint32_t* retOriginY,
+        uint16_t* retShelf) {
+    if (glyph.fHeight + TEXTURE_BORDER_SIZE * 2 > mHeight) {
+        return false;
     }
 
-    // new block larger than all others - insert at end (but before the remainder space, if there)
-    newBlock->mNext = currBlock;
-    newBlock->mPrev = prevBlock;
+    uint16_t glyphW = glyph.fWidth + TEXTURE_BORDER_SIZE;
+    uint16_t glyphH = glyph.fHeight + TEXTURE_BORDER_SIZE;
 
-    if (currBlock) {
-        currBlock->mPrev = newBlock;
+    // New shelves are rounded up to the next multiple of CACHE_SHELF_ROUNDING_SIZE so that
+    // glyphs that are close but not necessarily exactly the same height can share a shelf
+    uint16_t roundedUpH = (glyphH + CACHE_SHELF_ROUNDING_SIZE - 1) & -CACHE_SHELF_ROUNDING_SIZE;
+
+    // Find the shortest shelf with enough room left for this glyph
+    ssize_t best = -1;
+    for (size_t i = 0; i < mShelves.size(); i++) {
+        const CacheShelf& shelf = mShelves[i];
+        if (glyphH <= shelf.mHeight && shelf.mX + glyphW <= mWidth &&
+                (best < 0 || shelf.mHeight < mShelves[best].mHeight)) {
+            best = i;
+        }
     }
 
-    if (prevBlock) {
-        prevBlock->mNext = newBlock;
-        return head;
-    } else {
-        return newBlock;
+    // Prefer opening a new shelf over wasting the height of a much taller one
+    if (best < 0 || mShelves[best].mHeight - roundedUpH >= CACHE_SHELF_ROUNDING_SIZE) {
+        uint16_t remainingH = mHeight - mShelvesBottom;
+        if (glyphH <= remainingH) {
+            mShelves.add(CacheShelf(mShelvesBottom, roundedUpH < remainingH ?
+                    roundedUpH : remainingH));
+            mShelvesBottom += mShelves.top().mHeight;
+            best = mShelves.size() - 1;
+#if DEBUG_FONT_RENDERER
+            ALOGD("fitBitmap: Created new shelf: y, h = %d, %d",
+                    mShelves[best].mY, mShelves[best].mHeight);
+#endif
+        }
     }
-}
 
-CacheBlock* CacheBlock::removeBlock(CacheBlock* head, CacheBlock* blockToRemove) {
+    if (best < 0) {
 #if DEBUG_FONT_RENDERER
-    ALOGD("removeBlock: this, x, y, w, h = %p, %d, %d, %d, %d",
-            blockToRemove, blockToRemove->mX, blockToRemove->mY,
-            blockToRemove->mWidth, blockToRemove->mHeight);
+        ALOGD("fitBitmap: returning false for glyph of size %d, %d", glyphW, glyphH);
 #endif
-
-    CacheBlock* newHead = head;
-    CacheBlock* nextBlock = blockToRemove->mNext;
-    CacheBlock* prevBlock = blockToRemove->mPrev;
-
-    if (prevBlock) {
-        prevBlock->mNext = nextBlock;
-    } else {
-        newHead = nextBlock;
+        return false;
     }
 
-    if (nextBlock) {
-        nextBlock->mPrev = prevBlock;
-    }
+    CacheShelf& shelf = mShelves.editItemAt(best);
+    *retOriginX = shelf.mX;
+    *retOriginY = shelf.mY;
+    *retShelf = best;
 
-    delete blockToRemove;
+    shelf.mX += glyphW;
+    shelf.mNumGlyphs++;
 
-    return newHead;
-}
+    mDirty = true;
+    const Rect r(*retOriginX - TEXTURE_BORDER_SIZE, *retOriginY - TEXTURE_BORDER_SIZE,
+            *retOriginX + glyphW, *retOriginY + glyphH);
+    mDirtyRect.unionWith(r);
+    mNumGlyphs++;
 
-///////////////////////////////////////////////////////////////////////////////
-// CacheTexture
-///////////////////////////////////////////////////////////////////////////////
-
-bool CacheTexture::fitBitmap(const SkGlyph& glyph, uint32_t* retOriginX, uint32_t* retOriginY) {
-    if (glyph.fHeight + TEXTURE_BORDER_SIZE * 2 > mHeight) {
-        return false;
-    }
+    return true;
+}
 
+ssize_t CacheTexture::findEvictableShelf(const SkGlyph& glyph) const {
     uint16_t glyphW = glyph.fWidth + TEXTURE_BORDER_SIZE;
     uint16_t glyphH = glyph.fHeight + TEXTURE_BORDER_SIZE;
+    if (TEXTURE_BORDER_SIZE + glyphW > mWidth) {
+        return -1;
+    }
 
-    // roundedUpW equals glyphW to the next multiple of CACHE_BLOCK_ROUNDING_SIZE.
-    // This columns for glyphs that are close but not necessarily exactly the same size. It trades
-    // off the loss of a few pixels for some glyphs against the ability to store more glyphs
-    // of varying sizes in one block.
-    uint16_t roundedUpW = (glyphW + CACHE_BLOCK_ROUNDING_SIZE - 1) & -CACHE_BLOCK_ROUNDING_SIZE;
-
-    CacheBlock* cacheBlock = mCacheBlocks;
-    while (cacheBlock) {
-        // Store glyph in this block iff: it fits the block's remaining space and:
-        // it's the remainder space (mY == 0) or there's only enough height for this one glyph
-        // or it's within ROUNDING_SIZE of the block width
-        if (roundedUpW <= cacheBlock->mWidth && glyphH <= cacheBlock->mHeight &&
-                (cacheBlock->mY == TEXTURE_BORDER_SIZE ||
-                        (cacheBlock->mWidth - roundedUpW < CACHE_BLOCK_ROUNDING_SIZE))) {
-            if (cacheBlock->mHeight - glyphH < glyphH) {
-                // Only enough space for this glyph - don't bother rounding up the width
-                roundedUpW = glyphW;
-            }
-
-            *retOriginX = cacheBlock->mX;
-            *retOriginY = cacheBlock->mY;
-
-            // If this is the remainder space, create a new cache block for this column. Otherwise,
-            // adjust the info about this column.
-            if (cacheBlock->mY == TEXTURE_BORDER_SIZE) {
-                uint16_t oldX = cacheBlock->mX;
-                // Adjust remainder space dimensions
-                cacheBlock->mWidth -= roundedUpW;
-                cacheBlock->mX += roundedUpW;
-
-                if (mHeight - glyphH >= glyphH) {
-                    // There's enough height left over to create a new CacheBlock
-                    CacheBlock* newBlock = new CacheBlock(oldX, glyphH + TEXTURE_BORDER_SIZE,
-                            roundedUpW, mHeight - glyphH - TEXTURE_BORDER_SIZE);
-#if DEBUG_FONT_RENDERER
-                    ALOGD("fitBitmap: Created new block: this, x, y, w, h = %p, %d, %d, %d, %d",
-                            newBlock, newBlock->mX, newBlock->mY,
-                            newBlock->mWidth, newBlock->mHeight);
-#endif
-                    mCacheBlocks = CacheBlock::insertBlock(mCacheBlocks, newBlock);
-                }
-            } else {
-                // Insert into current column and adjust column dimensions
-                cacheBlock->mY += glyphH;
-                cacheBlock->mHeight -= glyphH;
-#if DEBUG_FONT_RENDERER
-                ALOGD("fitBitmap: Added to existing block: this, x, y, w, h = %p, %d, %d, %d, %d",
-                        cacheBlock, cacheBlock->mX, cacheBlock->mY,
-                        cacheBlock->mWidth, cacheBlock->mHeight);
-#endif
+    // Shelves more than twice as tall as the glyph are only evicted as a last
+    // resort, the space they would give back would be mostly wasted
+    ssize_t best = -1;
+    ssize_t tallest = -1;
+    for (size_t i = 0; i < mShelves.size(); i++) {
+        const CacheShelf& shelf = mShelves[i];
+        if (glyphH > shelf.mHeight) continue;
+
+        if (shelf.mHeight <= glyphH * 2) {
+            if (best < 0 || shelf.mLastUse < mShelves[best].mLastUse) {
+                best = i;
             }
+        } else if (tallest < 0 || shelf.mLastUse < mShelves[tallest].mLastUse) {
+            tallest = i;
+        }
+    }
 
-            if (cacheBlock->mHeight < fmin(glyphH, glyphW)) {
-                // If remaining space in this block is too small to be useful, remove it
-                mCacheBlocks = CacheBlock::removeBlock(mCacheBlocks, cacheBlock);
-            }
+    return best >= 0 ? best : tallest;
+}
 
-            mDirty = true;
-            const Rect r(*retOriginX - TEXTURE_BORDER_SIZE, *retOriginY - TEXTURE_BORDER_SIZE,
-                    *retOriginX + glyphW, *retOriginY + glyphH);
-            mDirtyRect.unionWith(r);
-            mNumGlyphs++;
+void CacheTexture::evictShelf(uint16_t shelf) {
+    CacheShelf& cacheShelf = mShelves.editItemAt(shelf);
 
 #if DEBUG_FONT_RENDERER
-            ALOGD("fitBitmap: current block list:");
-            mCacheBlocks->output();
+    ALOGD("evictShelf: y, h = %d, %d, glyphs = %d",
+            cacheShelf.mY, cacheShelf.mHeight, cacheShelf.mNumGlyphs);
 #endif
 
-            return true;
-        }
-        cacheBlock = cacheBlock->mNext;
-    }
-#if DEBUG_FONT_RENDERER
-    ALOGD("fitBitmap: returning false for glyph of size %d, %d", glyphW, glyphH);
-#endif
-    return false;
+    mNumGlyphs -= cacheShelf.mNumGlyphs;
+    cacheShelf.mNumGlyphs = 0;
+    cacheShelf.mX = TEXTURE_BORDER_SIZE;
 }
 
 }; // namespace uirenderer
@@ -22,6 +22,7 @@
 #include <SkScalerContext.h>
 
 #include <utils/Log.h>
+#include <utils/Vector.h>
 
 #include "FontUtil.h"
 #include "Rect.h"
@@ -30,41 +31,25 @@ namespace android {
 namespace uirenderer {
 
 /**
- * CacheBlock is a node in a linked list of current free space areas in a CacheTexture.
- * Using CacheBlocks enables us to pack the cache from top to bottom as well as left to right.
- * When we add a glyph to the cache, we see if it fits within one of the existing columns that
- * have already been started (this is the case if the glyph fits vertically as well as
- * horizontally, and if its width is sufficiently close to the column width to avoid
- * sub-optimal packing of small glyphs into wide columns). If there is no column in which the
- * glyph fits, we check the final node, which is the remaining space in the cache, creating
- * a new column as appropriate.
- *
- * As columns fill up, we remove their CacheBlock from the list to avoid having to check
- * small blocks in the future.
+ * CacheShelf is a horizontal band of a CacheTexture. Glyphs are packed from left to right
+ * in the shelf whose height is the closest to theirs, and new shelves are opened from top
+ * to bottom as needed. Shelves are never moved or resized: when a texture is full, the
+ * shelf that was used the least recently is emptied and its space is reused for new glyphs.
  */
-struct CacheBlock {
-    uint16_t mX;
+struct CacheShelf {
     uint16_t mY;
-    uint16_t mWidth;
     uint16_t mHeight;
-    CacheBlock* mNext;
-    CacheBlock* mPrev;
+    // Horizontal position of the next glyph added to this shelf
+    uint16_t mX;
+    uint16_t mNumGlyphs;
+    // Value of the font renderer's clock the last time a glyph of this shelf was used
+    uint64_t mLastUse;
 
-    CacheBlock(uint16_t x, uint16_t y, uint16_t width, uint16_t height, bool empty = false):
-            mX(x), mY(y), mWidth(width), mHeight(height), mNext(NULL), mPrev(NULL) {
+    CacheShelf(): mY(0), mHeight(0), mX(0), mNumGlyphs(0), mLastUse(0) {
     }
 
-    static CacheBlock* insertBlock(CacheBlock* head, CacheBlock* newBlock);
-
-    static CacheBlock* removeBlock(CacheBlock* head, CacheBlock* blockToRemove);
-
-    void output() {
-        CacheBlock* currBlock = this;
-        while (currBlock) {
-            ALOGD("Block: this, x, y, w, h = %p, %d, %d, %d, %d",
-                    currBlock, currBlock->mX, currBlock->mY, currBlock->mWidth, currBlock->mHeight);
-            currBlock = currBlock->mNext;
-        }
+    CacheShelf(uint16_t y, uint16_t height):
+            mY(y), mHeight(height), mX(TEXTURE_BORDER_SIZE), mNumGlyphs(0), mLastUse(0) {
     }
 };
 
@@ -72,31 +57,19 @@ class CacheTexture {
 public:
     CacheTexture(uint16_t width, uint16_t height) :
             mTexture(NULL), mTextureId(0), mWidth(width), mHeight(height),
-            mLinearFiltering(false), mDirty(false), mNumGlyphs(0) {
-        mCacheBlocks = new CacheBlock(TEXTURE_BORDER_SIZE, TEXTURE_BORDER_SIZE,
-                mWidth - TEXTURE_BORDER_SIZE, mHeight - TEXTURE_BORDER_SIZE, true);
+            mLinearFiltering(false), mDirty(false), mNumGlyphs(0),
+            mShelvesBottom(TEXTURE_BORDER_SIZE) {
     }
 
     ~CacheTexture() {
         releaseTexture();
-        reset();
-    }
-
-    void reset() {
-        // Delete existing cache blocks
-        while (mCacheBlocks != NULL) {
-            CacheBlock* tmpBlock = mCacheBlocks;
-            mCacheBlocks = mCacheBlocks->mNext;
-            delete tmpBlock;
-        }
-        mNumGlyphs = 0;
     }
 
     void init() {
-        // reset, then create a new remainder space to start again
-        reset();
-        mCacheBlocks = new CacheBlock(TEXTURE_BORDER_SIZE, TEXTURE_BORDER_SIZE,
-                mWidth - TEXTURE_BORDER_SIZE, mHeight - TEXTURE_BORDER_SIZE, true);
+        // Remove all the shelves to start again from the top of the texture
+        mShelves.clear();
+        mShelvesBottom = TEXTURE_BORDER_SIZE;
+        mNumGlyphs = 0;
     }
 
     void releaseTexture() {
@@ -137,7 +110,32 @@ public:
         }
     }
 
-    bool fitBitmap(const SkGlyph& glyph, uint32_t* retOriginX, uint32_t* retOriginY);
+    /**
+     * Finds room for the specified glyph. On success, the origin of the glyph in the
+     * texture and the index of the shelf it was added to are returned.
+     */
+    bool fitBitmap(const SkGlyph& glyph, uint32_t* retOriginX, uint32_t* retOriginY,
+            uint16_t* retShelf);
+
+    /**
+     * Returns the index of the least recently used shelf that can hold the specified
+     * glyph once emptied, or -1 if no shelf is tall enough.
+     */
+    ssize_t findEvictableShelf(const SkGlyph& glyph) const;
+
+    /**
+     * Removes all the glyphs of the specified shelf. The glyphs must be invalidated
+     * by the caller.
+     */
+    void evictShelf(uint16_t shelf);
+
+    inline void touchShelf(uint16_t shelf, uint64_t clock) {
+        mShelves.editItemAt(shelf).mLastUse = clock;
+    }
+
+    inline uint64_t getShelfLastUse(uint16_t shelf) const {
+        return mShelves[shelf].mLastUse;
+    }
 
     inline uint16_t getWidth() const {
         return mWidth;
@@ -201,7 +199,9 @@ private:
     bool mLinearFiltering;
     bool mDirty;
     uint16_t mNumGlyphs;
-    CacheBlock* mCacheBlocks;
+    Vector<CacheShelf> mShelves;
+    // Top of the space that is not used by any shelf yet
+    uint16_t mShelvesBottom;
     Rect mDirtyRect;
 };
 
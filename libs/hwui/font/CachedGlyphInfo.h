@@ -50,6 +50,8 @@ struct CachedGlyphInfo {
     SkFixed mLsbDelta;
     SkFixed mRsbDelta;
     CacheTexture* mCacheTexture;
+    // Shelf of mCacheTexture the glyph was added to
+    uint16_t mShelf;
 };
 
 }; // namespace uirenderer
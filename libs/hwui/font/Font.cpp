@@ -50,10 +50,11 @@ Font::~Font() {
     }
 }
 
-void Font::invalidateTextureCache(CacheTexture* cacheTexture) {
+void Font::invalidateTextureCache(CacheTexture* cacheTexture, int shelf) {
     for (uint32_t i = 0; i < mCachedGlyphs.size(); i++) {
         CachedGlyphInfo* cachedGlyph = mCachedGlyphs.valueAt(i);
-        if (!cacheTexture || cachedGlyph->mCacheTexture == cacheTexture) {
+        if (!cacheTexture || (cachedGlyph->mCacheTexture == cacheTexture &&
+                (shelf < 0 || cachedGlyph->mShelf == shelf))) {
             cachedGlyph->mIsValid = false;
         }
     }
@@ -178,6 +179,8 @@ CachedGlyphInfo* Font::getCachedGlyph(SkPaint* paint, glyph_t textUnit, bool pre
     if (!cachedGlyph->mIsValid) {
         const SkGlyph& skiaGlyph = GET_METRICS(paint, textUnit);
         updateGlyphCache(paint, skiaGlyph, cachedGlyph, precaching);
+    } else {
+        mState->touchGlyph(cachedGlyph);
     }
 
     return cachedGlyph;
@@ -32,7 +32,7 @@
 
 #define TEXTURE_BORDER_SIZE 1
 
-#define CACHE_BLOCK_ROUNDING_SIZE 4
+#define CACHE_SHELF_ROUNDING_SIZE 4
 
 #if RENDER_TEXT_AS_GLYPHS
     typedef uint16_t glyph_t;
@@ -0,0 +1,690 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "OpenGLRenderer"
+
+#include <string.h>
+
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+
+#include <utils/Log.h>
+
+#include "NullGLES.h"
+
+namespace android {
+namespace uirenderer {
+
+///////////////////////////////////////////////////////////////////////////////
+// Defines
+///////////////////////////////////////////////////////////////////////////////
+
+// Limits reported to the renderer
+#define NULL_GL_MAX_TEXTURE_SIZE 2048
+#define NULL_GL_MAX_TEXTURE_UNITS 8
+#define NULL_GL_MAX_VERTEX_ATTRIBS 8
+
+// Extensions reported to the renderer, chosen to exercise its common code paths
+#define NULL_GL_EXTENSIONS "GL_OES_texture_npot GL_EXT_discard_framebuffer"
+
+///////////////////////////////////////////////////////////////////////////////
+// State
+///////////////////////////////////////////////////////////////////////////////
+
+struct NullGLState {
+    GLuint nextName;
+    GLint nextUniformLocation;
+
+    GLuint program;
+    GLuint textureUnit;
+    GLuint textures[NULL_GL_MAX_TEXTURE_UNITS];
+    GLuint arrayBuffer;
+    GLuint elementArrayBuffer;
+    GLuint framebuffer;
+
+    bool blend;
+    bool scissorTest;
+    bool stencilTest;
+    bool dither;
+    bool otherCapabilities;
+    GLenum blendSrc;
+    GLenum blendDst;
+    GLenum blendEquation;
+
+    GLint scissor[4];
+    GLint viewport[4];
+    GLfloat clearColor[4];
+    GLboolean colorMask[4];
+    bool vertexAttribArrays[NULL_GL_MAX_VERTEX_ATTRIBS];
+};
+
+static NullGLStats sStats;
+static NullGLState sState;
+
+static void initState() {
+    memset(&sState, 0, sizeof(sState));
+    sState.nextName = 1;
+    sState.dither = true;
+    sState.blendSrc = GL_ONE;
+    sState.blendDst = GL_ZERO;
+    sState.blendEquation = GL_FUNC_ADD;
+    sState.colorMask[0] = sState.colorMask[1] = GL_TRUE;
+    sState.colorMask[2] = sState.colorMask[3] = GL_TRUE;
+}
+
+static inline void recordCall() {
+    if (CC_UNLIKELY(!sState.nextName)) {
+        initState();
+    }
+    sStats.calls++;
+}
+
+/**
+ * Records a state change and applies it, counting it as redundant when
+ * the new value is the same as the current one.
+ */
+template<typename T>
+static inline void setState(T& current, T value) {
+    sStats.stateChanges++;
+    if (current == value) {
+        sStats.redundantStateChanges++;
+    } else {
+        current = value;
+    }
+}
+
+template<typename T>
+static inline void setState4(T* current, T a, T b, T c, T d) {
+    sStats.stateChanges++;
+    if (current[0] == a && current[1] == b && current[2] == c && current[3] == d) {
+        sStats.redundantStateChanges++;
+    } else {
+        current[0] = a;
+        current[1] = b;
+        current[2] = c;
+        current[3] = d;
+    }
+}
+
+static bool* getCapability(GLenum cap) {
+    switch (cap) {
+        case GL_BLEND:
+            return &sState.blend;
+        case GL_SCISSOR_TEST:
+            return &sState.scissorTest;
+        case GL_STENCIL_TEST:
+            return &sState.stencilTest;
+        case GL_DITHER:
+            return &sState.dither;
+    }
+    return &sState.otherCapabilities;
+}
+
+static uint32_t bytesPerPixel(GLenum format, GLenum type) {
+    switch (type) {
+        case GL_UNSIGNED_SHORT_5_6_5:
+        case GL_UNSIGNED_SHORT_4_4_4_4:
+        case GL_UNSIGNED_SHORT_5_5_5_1:
+            return 2;
+    }
+    switch (format) {
+        case GL_ALPHA:
+        case GL_LUMINANCE:
+            return 1;
+        case GL_LUMINANCE_ALPHA:
+            return 2;
+        case GL_RGB:
+            return 3;
+    }
+    return 4;
+}
+
+static void generateNames(GLsizei n, GLuint* names, int32_t& count) {
+    for (GLsizei i = 0; i < n; i++) {
+        names[i] = sState.nextName++;
+    }
+    count += n;
+}
+
+static void deleteNames(GLsizei n, const GLuint* names, int32_t& count) {
+    for (GLsizei i = 0; i < n; i++) {
+        if (names[i]) count--;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Stats
+///////////////////////////////////////////////////////////////////////////////
+
+NullGLStats::NullGLStats() {
+    memset(this, 0, sizeof(*this));
+}
+
+void getNullGLStats(NullGLStats* outStats) {
+    *outStats = sStats;
+}
+
+void resetNullGLStats() {
+    NullGLStats stats;
+    stats.textures = sStats.textures;
+    stats.buffers = sStats.buffers;
+    stats.framebuffers = sStats.framebuffers;
+    stats.programs = sStats.programs;
+    stats.shaders = sStats.shaders;
+    sStats = stats;
+}
+
+void dumpNullGLStats(String8& log) {
+    log.appendFormat("Null GL backend:\n");
+    log.appendFormat("  Calls                %8d\n", sStats.calls);
+    log.appendFormat("  Draw calls           %8d (%d vertices)\n",
+            sStats.drawCalls, sStats.drawnVertices);
+    log.appendFormat("  Clears               %8d\n", sStats.clears);
+    log.appendFormat("  State changes        %8d (%d redundant)\n",
+            sStats.stateChanges, sStats.redundantStateChanges);
+    log.appendFormat("  Program changes      %8d\n", sStats.programChanges);
+    log.appendFormat("  Texture bindings     %8d\n", sStats.textureBindings);
+    log.appendFormat("  Framebuffer bindings %8d\n", sStats.framebufferBindings);
+    log.appendFormat("  Uniform updates      %8d\n", sStats.uniformUpdates);
+    log.appendFormat("  Texture uploads      %8d (%llu bytes)\n",
+            sStats.textureUploads, (unsigned long long) sStats.textureUploadBytes);
+    log.appendFormat("  Buffer uploads       %8d (%llu bytes)\n",
+            sStats.bufferUploads, (unsigned long long) sStats.bufferUploadBytes);
+    log.appendFormat("  Readbacks            %8d (%llu bytes)\n",
+            sStats.readbacks, (unsigned long long) sStats.readbackBytes);
+    log.appendFormat("  Live objects: %d textures, %d buffers, %d framebuffers, "
+            "%d programs, %d shaders\n", sStats.textures, sStats.buffers,
+            sStats.framebuffers, sStats.programs, sStats.shaders);
+}
+
+}; // namespace uirenderer
+}; // namespace android
+
+///////////////////////////////////////////////////////////////////////////////
+// GLES 2.0 entry points
+///////////////////////////////////////////////////////////////////////////////
+
+using namespace android::uirenderer;
+
+extern "C" {
+
+// Objects
+
+void glGenTextures(GLsizei n, GLuint* textures) {
+    recordCall();
+    generateNames(n, textures, sStats.textures);
+}
+
+void glDeleteTextures(GLsizei n, const GLuint* textures) {
+    recordCall();
+    deleteNames(n, textures, sStats.textures);
+    for (GLsizei i = 0; i < n; i++) {
+        for (int unit = 0; unit < NULL_GL_MAX_TEXTURE_UNITS; unit++) {
+            if (sState.textures[unit] == textures[i]) sState.textures[unit] = 0;
+        }
+    }
+}
+
+void glGenBuffers(GLsizei n, GLuint* buffers) {
+    recordCall();
+    generateNames(n, buffers, sStats.buffers);
+}
+
+void glDeleteBuffers(GLsizei n, const GLuint* buffers) {
+    recordCall();
+    deleteNames(n, buffers, sStats.buffers);
+    for (GLsizei i = 0; i < n; i++) {
+        if (sState.arrayBuffer == buffers[i]) sState.arrayBuffer = 0;
+        if (sState.elementArrayBuffer == buffers[i]) sState.elementArrayBuffer = 0;
+    }
+}
+
+void glGenFramebuffers(GLsizei n, GLuint* framebuffers) {
+    recordCall();
+    generateNames(n, framebuffers, sStats.framebuffers);
+}
+
+void glDeleteFramebuffers(GLsizei n, const GLuint* framebuffers) {
+    recordCall();
+    deleteNames(n, framebuffers, sStats.framebuffers);
+    for (GLsizei i = 0; i < n; i++) {
+        if (sState.framebuffer == framebuffers[i]) sState.framebuffer = 0;
+    }
+}
+
+void glFramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget,
+        GLuint texture, GLint level) {
+    recordCall();
+}
+
+GLenum glCheckFramebufferStatus(GLenum target) {
+    recordCall();
+    return GL_FRAMEBUFFER_COMPLETE;
+}
+
+void glDiscardFramebufferEXT(GLenum target, GLsizei numAttachments,
+        const GLenum* attachments) {
+    recordCall();
+}
+
+// Shaders and programs
+
+GLuint glCreateShader(GLenum type) {
+    recordCall();
+    sStats.shaders++;
+    return sState.nextName++;
+}
+
+void glDeleteShader(GLuint shader) {
+    recordCall();
+    if (shader) sStats.shaders--;
+}
+
+void glShaderSource(GLuint shader, GLsizei count, const GLchar** string, const GLint* length) {
+    recordCall();
+}
+
+void glCompileShader(GLuint shader) {
+    recordCall();
+}
+
+void glGetShaderiv(GLuint shader, GLenum pname, GLint* params) {
+    recordCall();
+    *params = pname == GL_COMPILE_STATUS ? GL_TRUE : 0;
+}
+
+void glGetShaderInfoLog(GLuint shader, GLsizei bufsize, GLsizei* length, GLchar* infolog) {
+    recordCall();
+    if (length) *length = 0;
+    if (bufsize > 0) infolog[0] = '\0';
+}
+
+GLuint glCreateProgram() {
+    recordCall();
+    sStats.programs++;
+    return sState.nextName++;
+}
+
+void glDeleteProgram(GLuint program) {
+    recordCall();
+    if (program) sStats.programs--;
+    if (sState.program == program) sState.program = 0;
+}
+
+void glAttachShader(GLuint program, GLuint shader) {
+    recordCall();
+}
+
+void glDetachShader(GLuint program, GLuint shader) {
+    recordCall();
+}
+
+void glBindAttribLocation(GLuint program, GLuint index, const GLchar* name) {
+    recordCall();
+}
+
+void glLinkProgram(GLuint program) {
+    recordCall();
+}
+
+void glGetProgramiv(GLuint program, GLenum pname, GLint* params) {
+    recordCall();
+    *params = pname == GL_LINK_STATUS ? GL_TRUE : 0;
+}
+
+void glGetProgramInfoLog(GLuint program, GLsizei bufsize, GLsizei* length, GLchar* infolog) {
+    recordCall();
+    if (length) *length = 0;
+    if (bufsize > 0) infolog[0] = '\0';
+}
+
+int glGetAttribLocation(GLuint program, const GLchar* name) {
+    recordCall();
+    return 0;
+}
+
+int glGetUniformLocation(GLuint program, const GLchar* name) {
+    recordCall();
+    return sState.nextUniformLocation++;
+}
+
+void glUseProgram(GLuint program) {
+    recordCall();
+    sStats.programChanges++;
+    setState(sState.program, program);
+}
+
+// Uniforms
+
+void glUniform1i(GLint location, GLint x) {
+    recordCall();
+    sStats.uniformUpdates++;
+}
+
+void glUniform1f(GLint location, GLfloat x) {
+    recordCall();
+    sStats.uniformUpdates++;
+}
+
+void glUniform2f(GLint location, GLfloat x, GLfloat y) {
+    recordCall();
+    sStats.uniformUpdates++;
+}
+
+void glUniform4f(GLint location, GLfloat x, GLfloat y, GLfloat z, GLfloat w) {
+    recordCall();
+    sStats.uniformUpdates++;
+}
+
+void glUniform4fv(GLint location, GLsizei count, const GLfloat* v) {
+    recordCall();
+    sStats.uniformUpdates++;
+}
+
+void glUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose,
+        const GLfloat* value) {
+    recordCall();
+    sStats.uniformUpdates++;
+}
+
+// Textures
+
+void glActiveTexture(GLenum texture) {
+    recordCall();
+    GLuint unit = texture - GL_TEXTURE0;
+    if (unit >= NULL_GL_MAX_TEXTURE_UNITS) {
+        ALOGW("Null GL: texture unit %d is out of range", unit);
+        unit = 0;
+    }
+    setState(sState.textureUnit, unit);
+}
+
+void glBindTexture(GLenum target, GLuint texture) {
+    recordCall();
+    sStats.textureBindings++;
+    setState(sState.textures[sState.textureUnit], texture);
+}
+
+void glTexParameteri(GLenum target, GLenum pname, GLint param) {
+    recordCall();
+    sStats.stateChanges++;
+}
+
+void glPixelStorei(GLenum pname, GLint param) {
+    recordCall();
+    sStats.stateChanges++;
+}
+
+void glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width,
+        GLsizei height, GLint border, GLenum format, GLenum type, const GLvoid* pixels) {
+    recordCall();
+    sStats.textureUploads++;
+    if (pixels) {
+        sStats.textureUploadBytes += uint64_t(width) * height * bytesPerPixel(format, type);
+    }
+}
+
+void glTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset,
+        GLsizei width, GLsizei height, GLenum format, GLenum type, const GLvoid* pixels) {
+    recordCall();
+    sStats.textureUploads++;
+    sStats.textureUploadBytes += uint64_t(width) * height * bytesPerPixel(format, type);
+}
+
+void glCopyTexImage2D(GLenum target, GLint level, GLenum internalformat, GLint x, GLint y,
+        GLsizei width, GLsizei height, GLint border) {
+    recordCall();
+}
+
+void glCopyTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset,
+        GLint x, GLint y, GLsizei width, GLsizei height) {
+    recordCall();
+}
+
+void glGenerateMipmap(GLenum target) {
+    recordCall();
+}
+
+// Buffers and vertex attributes
+
+void glBindBuffer(GLenum target, GLuint buffer) {
+    recordCall();
+    if (target == GL_ELEMENT_ARRAY_BUFFER) {
+        setState(sState.elementArrayBuffer, buffer);
+    } else {
+        setState(sState.arrayBuffer, buffer);
+    }
+}
+
+void glBufferData(GLenum target, GLsizeiptr size, const GLvoid* data, GLenum usage) {
+    recordCall();
+    sStats.bufferUploads++;
+    if (data) {
+        sStats.bufferUploadBytes += size;
+    }
+}
+
+void glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid* data) {
+    recordCall();
+    sStats.bufferUploads++;
+    sStats.bufferUploadBytes += size;
+}
+
+void glEnableVertexAttribArray(GLuint index) {
+    recordCall();
+    if (index < NULL_GL_MAX_VERTEX_ATTRIBS) {
+        setState(sState.vertexAttribArrays[index], true);
+    }
+}
+
+void glDisableVertexAttribArray(GLuint index) {
+    recordCall();
+    if (index < NULL_GL_MAX_VERTEX_ATTRIBS) {
+        setState(sState.vertexAttribArrays[index], false);
+    }
+}
+
+void glVertexAttribPointer(GLuint indx, GLint size, GLenum type, GLboolean normalized,
+        GLsizei stride, const GLvoid* ptr) {
+    recordCall();
+    sStats.stateChanges++;
+}
+
+// Fixed function state
+
+void glEnable(GLenum cap) {
+    recordCall();
+    setState(*getCapability(cap), true);
+}
+
+void glDisable(GLenum cap) {
+    recordCall();
+    setState(*getCapability(cap), false);
+}
+
+GLboolean glIsEnabled(GLenum cap) {
+    recordCall();
+    return *getCapability(cap) ? GL_TRUE : GL_FALSE;
+}
+
+void glBlendFunc(GLenum sfactor, GLenum dfactor) {
+    recordCall();
+    sStats.stateChanges++;
+    if (sState.blendSrc == sfactor && sState.blendDst == dfactor) {
+        sStats.redundantStateChanges++;
+    } else {
+        sState.blendSrc = sfactor;
+        sState.blendDst = dfactor;
+    }
+}
+
+void glBlendEquation(GLenum mode) {
+    recordCall();
+    setState(sState.blendEquation, mode);
+}
+
+void glScissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+    recordCall();
+    setState4(sState.scissor, x, y, width, height);
+}
+
+void glViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+    recordCall();
+    setState4(sState.viewport, x, y, width, height);
+}
+
+void glClearColor(GLclampf red, GLclampf green, GLclampf blue, GLclampf alpha) {
+    recordCall();
+    setState4(sState.clearColor, red, green, blue, alpha);
+}
+
+void glClearStencil(GLint s) {
+    recordCall();
+    sStats.stateChanges++;
+}
+
+void glColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha) {
+    recordCall();
+    setState4(sState.colorMask, red, green, blue, alpha);
+}
+
+void glStencilFunc(GLenum func, GLint ref, GLuint mask) {
+    recordCall();
+    sStats.stateChanges++;
+}
+
+void glStencilOp(GLenum fail, GLenum zfail, GLenum zpass) {
+    recordCall();
+    sStats.stateChanges++;
+}
+
+void glBindFramebuffer(GLenum target, GLuint framebuffer) {
+    recordCall();
+    sStats.framebufferBindings++;
+    setState(sState.framebuffer, framebuffer);
+}
+
+// Drawing
+
+void glClear(GLbitfield mask) {
+    recordCall();
+    sStats.clears++;
+}
+
+void glDrawArrays(GLenum mode, GLint first, GLsizei count) {
+    recordCall();
+    sStats.drawCalls++;
+    sStats.drawnVertices += count;
+}
+
+void glDrawElements(GLenum mode, GLsizei count, GLenum type, const GLvoid* indices) {
+    recordCall();
+    sStats.drawCalls++;
+    sStats.drawnVertices += count;
+}
+
+void glReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format,
+        GLenum type, GLvoid* pixels) {
+    recordCall();
+    size_t size = size_t(width) * height * bytesPerPixel(format, type);
+    memset(pixels, 0, size);
+    sStats.readbacks++;
+    sStats.readbackBytes += size;
+}
+
+void glStartTilingQCOM(GLuint x, GLuint y, GLuint width, GLuint height,
+        GLbitfield preserveMask) {
+    recordCall();
+}
+
+void glEndTilingQCOM(GLbitfield preserveMask) {
+    recordCall();
+}
+
+// Queries
+
+GLenum glGetError() {
+    recordCall();
+    return GL_NO_ERROR;
+}
+
+void glGetIntegerv(GLenum pname, GLint* params) {
+    recordCall();
+    switch (pname) {
+        case GL_MAX_TEXTURE_SIZE:
+            *params = NULL_GL_MAX_TEXTURE_SIZE;
+            break;
+        case GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS:
+            *params = NULL_GL_MAX_TEXTURE_UNITS;
+            break;
+        case GL_MAX_VERTEX_ATTRIBS:
+            *params = NULL_GL_MAX_VERTEX_ATTRIBS;
+            break;
+        case GL_FRAMEBUFFER_BINDING:
+            *params = sState.framebuffer;
+            break;
+        case GL_VIEWPORT:
+            memcpy(params, sState.viewport, sizeof(sState.viewport));
+            break;
+        default:
+            *params = 0;
+            break;
+    }
+}
+
+const GLubyte* glGetString(GLenum name) {
+    recordCall();
+    switch (name) {
+        case GL_VENDOR:
+            return (const GLubyte*) "Android";
+        case GL_RENDERER:
+            return (const GLubyte*) "Null GL";
+        case GL_VERSION:
+            return (const GLubyte*) "OpenGL ES 2.0";
+        case GL_SHADING_LANGUAGE_VERSION:
+            return (const GLubyte*) "OpenGL ES GLSL ES 1.00";
+        case GL_EXTENSIONS:
+            return (const GLubyte*) NULL_GL_EXTENSIONS;
+    }
+    return (const GLubyte*) "";
+}
+
+// Debug markers and labels, never advertised but referenced by Caches
+
+void glInsertEventMarkerEXT(GLsizei length, const GLchar* marker) {
+    recordCall();
+}
+
+void glPushGroupMarkerEXT(GLsizei length, const GLchar* marker) {
+    recordCall();
+}
+
+void glPopGroupMarkerEXT() {
+    recordCall();
+}
+
+void glLabelObjectEXT(GLenum type, GLuint object, GLsizei length, const GLchar* label) {
+    recordCall();
+}
+
+void glGetObjectLabelEXT(GLenum type, GLuint object, GLsizei bufSize, GLsizei* length,
+        GLchar* label) {
+    recordCall();
+    if (length) *length = 0;
+    if (bufSize > 0) label[0] = '\0';
+}
+
+}; // extern "C"
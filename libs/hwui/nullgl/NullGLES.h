@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HWUI_NULL_GLES_H
+#define ANDROID_HWUI_NULL_GLES_H
+
+#include <stdint.h>
+
+#include <cutils/compiler.h>
+#include <utils/String8.h>
+
+namespace android {
+namespace uirenderer {
+
+///////////////////////////////////////////////////////////////////////////////
+// Null GL backend
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Counters kept by the null GLES 2.0 implementation that libhwui_null links
+ * against instead of the real driver. Every GL entry point used by the
+ * renderer is a no-op that only updates these counters, which makes it
+ * possible to measure the CPU cost of the renderer without a GPU.
+ *
+ * The counters are not synchronized: they must be read from the thread
+ * that issues the GL calls, or while that thread is idle.
+ */
+struct NullGLStats {
+    NullGLStats();
+
+    // Total number of GL calls
+    uint32_t calls;
+
+    // Calls to glDrawArrays() and glDrawElements(), and the vertices they draw
+    uint32_t drawCalls;
+    uint32_t drawnVertices;
+    uint32_t clears;
+
+    // Calls that modify the GL state, and how many of them set the current value again
+    uint32_t stateChanges;
+    uint32_t redundantStateChanges;
+    uint32_t programChanges;
+    uint32_t textureBindings;
+    uint32_t framebufferBindings;
+    uint32_t uniformUpdates;
+
+    // Data sent to the GPU
+    uint32_t textureUploads;
+    uint64_t textureUploadBytes;
+    uint32_t bufferUploads;
+    uint64_t bufferUploadBytes;
+
+    // Data read back from the GPU
+    uint32_t readbacks;
+    uint64_t readbackBytes;
+
+    // GL objects currently alive
+    int32_t textures;
+    int32_t buffers;
+    int32_t framebuffers;
+    int32_t programs;
+    int32_t shaders;
+}; // struct NullGLStats
+
+/**
+ * Returns a copy of the counters of the null GL backend.
+ */
+ANDROID_API void getNullGLStats(NullGLStats* outStats);
+
+/**
+ * Resets the call and upload counters of the null GL backend, typically at
+ * the beginning of a frame. The live object counts are left untouched.
+ */
+ANDROID_API void resetNullGLStats();
+
+/**
+ * Appends a human readable version of the counters to the specified log.
+ */
+ANDROID_API void dumpNullGLStats(String8& log);
+
+}; // namespace uirenderer
+}; // namespace android
+
+#endif // ANDROID_HWUI_NULL_GLES_H
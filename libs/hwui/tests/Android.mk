@@ -0,0 +1,70 @@
+# Build the unit tests.
+LOCAL_PATH:= $(call my-dir)
+include $(CLEAR_VARS)
+
+# libhwui is built with -fvisibility=hidden, so the tests compile the
+# sources they exercise instead of linking against the library.
+
+shared_libraries := \
+    libcutils \
+    libutils \
+    libstlport
+
+static_libraries := \
+    libgtest \
+    libgtest_main
+
+c_includes := \
+    bionic \
+    bionic/libstdc++/include \
+    external/gtest/include \
+    external/stlport/stlport
+
+module_tags := eng tests
+
+# Blur_test
+include $(CLEAR_VARS)
+LOCAL_SRC_FILES := Blur_test.cpp ../utils/Blur.cpp
+LOCAL_SHARED_LIBRARIES := $(shared_libraries)
+LOCAL_STATIC_LIBRARIES := $(static_libraries)
+LOCAL_C_INCLUDES := $(c_includes)
+LOCAL_MODULE := hwui_Blur_test
+LOCAL_MODULE_TAGS := $(module_tags)
+include $(BUILD_EXECUTABLE)
+
+# Build the benchmarks. They run on the host since they do not need a GPU.
+
+# CacheTexture_benchmark
+include $(CLEAR_VARS)
+LOCAL_SRC_FILES := \
+    CacheTexture_benchmark.cpp \
+    ../font/CacheTexture.cpp \
+    ../nullgl/NullGLES.cpp
+LOCAL_STATIC_LIBRARIES := libutils libcutils liblog
+LOCAL_C_INCLUDES := \
+    $(LOCAL_PATH)/.. \
+    external/skia/include/core \
+    frameworks/native/opengl/include
+LOCAL_MODULE := hwui_CacheTexture_benchmark
+LOCAL_MODULE_TAGS := $(module_tags)
+include $(BUILD_HOST_EXECUTABLE)
+
+# Snapshot_benchmark, needs a host build of libskia like libhwui_null.
+ifeq ($(HWUI_NULL_GPU_HOST),true)
+	include $(CLEAR_VARS)
+	LOCAL_SRC_FILES := \
+	    Snapshot_benchmark.cpp \
+	    ReferenceSnapshot.cpp \
+	    ../Snapshot.cpp \
+	    ../Matrix.cpp
+	LOCAL_SHARED_LIBRARIES := libskia
+	LOCAL_STATIC_LIBRARIES := libutils libcutils liblog
+	LOCAL_C_INCLUDES := \
+	    $(LOCAL_PATH)/.. \
+	    $(hwui_c_includes) \
+	    frameworks/native/opengl/include
+	LOCAL_CFLAGS := -DUSE_OPENGL_RENDERER -DHWUI_NULL_GPU
+	LOCAL_MODULE := hwui_Snapshot_benchmark
+	LOCAL_MODULE_TAGS := $(module_tags)
+	include $(BUILD_HOST_EXECUTABLE)
+endif
@@ -0,0 +1,291 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../utils/Blur.h"
+
+#include <gtest/gtest.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace android {
+namespace uirenderer {
+
+// Radii past MAX_CACHED_BLUR_RADIUS use the uncached weights.
+static const int32_t MAX_TESTED_BLUR_RADIUS = MAX_CACHED_BLUR_RADIUS + 8;
+
+// The vectorized loop of Blur::convolve() handles 8 pixels at a time.
+static const int32_t BLUR_VECTOR_SIZE = 8;
+
+
+// --- Reference implementation ---
+
+// The floating point blur that Blur replaced, kept to check the fixed
+// point version against. It rounds each pass to the nearest value like
+// Blur does instead of truncating it.
+
+static void referenceHorizontalBlur(float* weights, int32_t radius,
+        const uint8_t* source, uint8_t* dest, int32_t width, int32_t height) {
+    float blurredPixel = 0.0f;
+    float currentPixel = 0.0f;
+
+    for (int32_t y = 0; y < height; y ++) {
+
+        const uint8_t* input = source + y * width;
+        uint8_t* output = dest + y * width;
+
+        for (int32_t x = 0; x < width; x ++) {
+            blurredPixel = 0.0f;
+            const float* gPtr = weights;
+            // Optimization for non-border pixels
+            if (x > radius && x < (width - radius)) {
+                const uint8_t *i = input + (x - radius);
+                for (int r = -radius; r <= radius; r ++) {
+                    currentPixel = (float) (*i);
+                    blurredPixel += currentPixel * gPtr[0];
+                    gPtr++;
+                    i++;
+                }
+            } else {
+                for (int32_t r = -radius; r <= radius; r ++) {
+                    // Stepping left and right away from the pixel
+                    int validW = x + r;
+                    if (validW < 0) {
+                        validW = 0;
+                    }
+                    if (validW > width - 1) {
+                        validW = width - 1;
+                    }
+
+                    currentPixel = (float) input[validW];
+                    blurredPixel += currentPixel * gPtr[0];
+                    gPtr++;
+                }
+            }
+            *output = (uint8_t) (blurredPixel + 0.5f);
+            output ++;
+        }
+    }
+}
+
+static void referenceVerticalBlur(float* weights, int32_t radius,
+        const uint8_t* source, uint8_t* dest, int32_t width, int32_t height) {
+    float blurredPixel = 0.0f;
+    float currentPixel = 0.0f;
+
+    for (int32_t y = 0; y < height; y ++) {
+        uint8_t* output = dest + y * width;
+
+        for (int32_t x = 0; x < width; x ++) {
+            blurredPixel = 0.0f;
+            const float* gPtr = weights;
+            const uint8_t* input = source + x;
+            // Optimization for non-border pixels
+            if (y > radius && y < (height - radius)) {
+                const uint8_t *i = input + ((y - radius) * width);
+                for (int32_t r = -radius; r <= radius; r ++) {
+                    currentPixel = (float)(*i);
+                    blurredPixel += currentPixel * gPtr[0];
+                    gPtr++;
+                    i += width;
+                }
+            } else {
+                for (int32_t r = -radius; r <= radius; r ++) {
+                    int validH = y + r;
+                    // Clamp to zero and width
+                    if (validH < 0) {
+                        validH = 0;
+                    }
+                    if (validH > height - 1) {
+                        validH = height - 1;
+                    }
+
+                    const uint8_t *i = input + validH * width;
+                    currentPixel = (float) (*i);
+                    blurredPixel += currentPixel * gPtr[0];
+                    gPtr++;
+                }
+            }
+            *output = (uint8_t) (blurredPixel + 0.5f);
+            output++;
+        }
+    }
+}
+
+static void referenceBlurImage(uint8_t* image, int32_t width, int32_t height, int32_t radius) {
+    float* gaussian = new float[2 * radius + 1];
+    Blur::computeGaussianWeights(gaussian, radius);
+
+    uint8_t* scratch = new uint8_t[width * height];
+
+    referenceHorizontalBlur(gaussian, radius, image, scratch, width, height);
+    referenceVerticalBlur(gaussian, radius, scratch, image, width, height);
+
+    delete[] gaussian;
+    delete[] scratch;
+}
+
+
+// --- BlurTest ---
+
+class BlurTest : public testing::Test {
+protected:
+    Blur mBlur;
+
+    virtual void SetUp() {
+        srand(1);
+    }
+
+    /* Fills the image with a mix of transparent, opaque and random pixels,
+     * which is what the glyphs of a drop shadow look like. */
+    static void fillImage(uint8_t* image, int32_t width, int32_t height) {
+        for (int32_t i = 0; i < width * height; i++) {
+            switch (rand() % 3) {
+            case 0:
+                image[i] = 0;
+                break;
+            case 1:
+                image[i] = 255;
+                break;
+            default:
+                image[i] = uint8_t(rand());
+                break;
+            }
+        }
+    }
+
+    /* Blurs a random image with both implementations and checks that no pixel
+     * differs by more than 1. */
+    void checkBlurMatchesReference(int32_t width, int32_t height, int32_t radius) {
+        const int32_t size = width * height;
+        uint8_t* expected = new uint8_t[size];
+        uint8_t* actual = new uint8_t[size];
+        fillImage(expected, width, height);
+        memcpy(actual, expected, size);
+
+        referenceBlurImage(expected, width, height, radius);
+        mBlur.blurImage(actual, width, height, radius);
+
+        int32_t maxDifference = 0;
+        int32_t worstIndex = 0;
+        for (int32_t i = 0; i < size; i++) {
+            int32_t difference = abs(int32_t(expected[i]) - int32_t(actual[i]));
+            if (difference > maxDifference) {
+                maxDifference = difference;
+                worstIndex = i;
+            }
+        }
+        delete[] expected;
+        delete[] actual;
+
+        ASSERT_LE(maxDifference, 1)
+                << "width=" << width << ", height=" << height << ", radius=" << radius
+                << ", pixel (" << worstIndex % width << ", " << worstIndex / width << ")";
+    }
+};
+
+TEST_F(BlurTest, ComputeFixedWeights_AddUpToOne) {
+    uint16_t weights[2 * MAX_TESTED_BLUR_RADIUS + 1];
+    for (int32_t radius = 0; radius <= MAX_TESTED_BLUR_RADIUS; radius++) {
+        Blur::computeFixedWeights(weights, radius);
+
+        int32_t sum = 0;
+        for (int32_t i = 0; i < 2 * radius + 1; i++) {
+            sum += weights[i];
+        }
+        ASSERT_EQ(BLUR_WEIGHT_ONE, sum) << "radius=" << radius;
+    }
+}
+
+TEST_F(BlurTest, BlurImage_WithRadiusZero_LeavesImageUnchanged) {
+    uint8_t image[13 * 5];
+    uint8_t original[13 * 5];
+    fillImage(image, 13, 5);
+    memcpy(original, image, sizeof(image));
+
+    mBlur.blurImage(image, 13, 5, 0);
+    ASSERT_EQ(0, memcmp(original, image, sizeof(image)));
+}
+
+TEST_F(BlurTest, BlurImage_WithFlatImage_LeavesImageUnchanged) {
+    const int32_t width = 3 * BLUR_VECTOR_SIZE + 5;
+    const int32_t height = 7;
+    uint8_t image[width * height];
+    for (int32_t value = 0; value <= 255; value++) {
+        for (int32_t radius = 1; radius <= MAX_TESTED_BLUR_RADIUS; radius += 3) {
+            memset(image, value, sizeof(image));
+            mBlur.blurImage(image, width, height, radius);
+            for (int32_t i = 0; i < width * height; i++) {
+                ASSERT_EQ(value, image[i]) << "radius=" << radius << ", pixel " << i;
+            }
+        }
+    }
+}
+
+TEST_F(BlurTest, BlurImage_PreservesMean) {
+    // Truncating the sums would lose about half a level per pass.
+    const int32_t width = 256;
+    const int32_t height = 256;
+    uint8_t* image = new uint8_t[width * height];
+    for (int32_t i = 0; i < width * height; i++) {
+        image[i] = uint8_t(rand());
+    }
+
+    double sum = 0;
+    for (int32_t i = 0; i < width * height; i++) {
+        sum += image[i];
+    }
+    double mean = sum / (width * height);
+
+    mBlur.blurImage(image, width, height, 8);
+
+    double blurredSum = 0;
+    for (int32_t i = 0; i < width * height; i++) {
+        blurredSum += image[i];
+    }
+    delete[] image;
+
+    ASSERT_NEAR(mean, blurredSum / (width * height), 0.2);
+}
+
+TEST_F(BlurTest, BlurImage_MatchesFloatingPointBlur) {
+    for (int32_t radius = 0; radius <= MAX_TESTED_BLUR_RADIUS; radius++) {
+        // Widths that are not a multiple of the vector size run both the
+        // vectorized loop and the scalar tail of each row, narrow images
+        // only run the scalar tail.
+        int32_t width = BLUR_VECTOR_SIZE * (rand() % 24) + 1 + rand() % (BLUR_VECTOR_SIZE - 1);
+        int32_t height = 1 + rand() % 64;
+        ASSERT_NO_FATAL_FAILURE(checkBlurMatchesReference(width, height, radius));
+        ASSERT_NO_FATAL_FAILURE(checkBlurMatchesReference(1 + rand() % 7, height, radius));
+    }
+}
+
+TEST_F(BlurTest, BlurImage_WhenImageIsSmallerThanKernel_MatchesFloatingPointBlur) {
+    ASSERT_NO_FATAL_FAILURE(checkBlurMatchesReference(1, 1, MAX_TESTED_BLUR_RADIUS));
+    ASSERT_NO_FATAL_FAILURE(checkBlurMatchesReference(3, 2, MAX_CACHED_BLUR_RADIUS));
+    ASSERT_NO_FATAL_FAILURE(checkBlurMatchesReference(17, 4, MAX_CACHED_BLUR_RADIUS));
+}
+
+TEST_F(BlurTest, BlurImage_ReusesScratchBuffersAcrossSizes) {
+    // Shrinking then growing the image must not read stale scratch memory.
+    ASSERT_NO_FATAL_FAILURE(checkBlurMatchesReference(203, 61, 12));
+    ASSERT_NO_FATAL_FAILURE(checkBlurMatchesReference(9, 3, 2));
+    mBlur.releaseScratch();
+    ASSERT_NO_FATAL_FAILURE(checkBlurMatchesReference(259, 33, 20));
+}
+
+} // namespace uirenderer
+} // namespace android
@@ -0,0 +1,320 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Measures how well the shelf packer of CacheTexture keeps glyphs cached.
+ *
+ * Usage: hwui_CacheTexture_benchmark [--chars N] [--zipf S] [--draws N] [--clock-start N]
+ *
+ * Glyphs of several text sizes are drawn with a Zipf distribution over N characters,
+ * and are cached in textures of the default sizes the way FontRenderer does it.
+ * When no texture has room for a glyph, the least recently used shelf that can hold
+ * it is evicted.  Only when no shelf can hold it are all the textures flushed.  The
+ * same workload is then replayed flushing everything as soon as the textures are
+ * full, for comparison.
+ *
+ * --clock-start starts the glyph clock at the specified value, for instance close to
+ * 2^32 to check that the least recently used order survives large clock values.
+ */
+
+#include "../font/CacheTexture.h"
+
+#include <utils/KeyedVector.h>
+#include <utils/Vector.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace android;
+using namespace android::uirenderer;
+
+// Text sizes drawn by the workload, in pixels.
+static const int32_t TEXT_SIZES[] = { 12, 14, 16, 18, 24, 32, 48 };
+static const int32_t TEXT_SIZE_COUNT = sizeof(TEXT_SIZES) / sizeof(TEXT_SIZES[0]);
+
+// How often the occupancy of the textures is sampled, in draws.
+static const int32_t OCCUPANCY_SAMPLE_INTERVAL = 10000;
+
+
+// --- SimulatedGlyph ---
+
+struct SimulatedGlyph {
+    uint16_t width;
+    uint16_t height;
+    bool isValid;
+    ssize_t textureIndex;
+    uint16_t shelf;
+};
+
+
+// --- GlyphCacheSimulation ---
+
+/* Replays the caching decisions of FontRenderer::cacheBitmap() on CacheTextures
+ * without rendering anything. */
+class GlyphCacheSimulation {
+public:
+    GlyphCacheSimulation(bool evictShelves, uint64_t clockStart) :
+            mEvictShelves(evictShelves), mClock(clockStart),
+            mDraws(0), mMisses(0), mEvictions(0), mFlushes(0),
+            mOccupancySum(0), mOccupancySamples(0) {
+        addTexture(DEFAULT_TEXT_SMALL_CACHE_WIDTH, DEFAULT_TEXT_SMALL_CACHE_HEIGHT);
+        addTexture(DEFAULT_TEXT_LARGE_CACHE_WIDTH, DEFAULT_TEXT_LARGE_CACHE_HEIGHT >> 1);
+        addTexture(DEFAULT_TEXT_LARGE_CACHE_WIDTH, DEFAULT_TEXT_LARGE_CACHE_HEIGHT >> 1);
+        addTexture(DEFAULT_TEXT_LARGE_CACHE_WIDTH, DEFAULT_TEXT_LARGE_CACHE_HEIGHT);
+    }
+
+    ~GlyphCacheSimulation() {
+        for (size_t i = 0; i < mTextures.size(); i++) {
+            delete mTextures[i];
+        }
+    }
+
+    void draw(uint32_t key, uint16_t width, uint16_t height) {
+        mDraws += 1;
+
+        ssize_t index = mGlyphs.indexOfKey(key);
+        if (index < 0) {
+            SimulatedGlyph glyph;
+            glyph.width = width;
+            glyph.height = height;
+            glyph.isValid = false;
+            glyph.textureIndex = -1;
+            glyph.shelf = 0;
+            index = mGlyphs.add(key, glyph);
+        }
+
+        SimulatedGlyph& glyph = mGlyphs.editValueAt(index);
+        if (glyph.isValid) {
+            mTextures[glyph.textureIndex]->touchShelf(glyph.shelf, ++mClock);
+        } else {
+            mMisses += 1;
+            cacheGlyph(glyph);
+        }
+
+        if (mDraws % OCCUPANCY_SAMPLE_INTERVAL == 0) {
+            sampleOccupancy();
+        }
+    }
+
+    void report(const char* label) const {
+        printf("%s: draws=%u misses=%0.2f%% shelf-evictions=%u (%0.3f per 1000 draws) "
+                "flushes=%u occupancy=%0.1f%%\n",
+                label, mDraws, 100.0 * mMisses / mDraws,
+                mEvictions, 1000.0 * mEvictions / mDraws, mFlushes,
+                mOccupancySamples ? 100.0 * mOccupancySum / mOccupancySamples : 0.0);
+    }
+
+private:
+    bool mEvictShelves;
+    uint64_t mClock;
+
+    Vector<CacheTexture*> mTextures;
+    // Whether FontRenderer would have allocated the memory of each texture.
+    Vector<bool> mAllocated;
+    KeyedVector<uint32_t, SimulatedGlyph> mGlyphs;
+
+    uint32_t mDraws;
+    uint32_t mMisses;
+    uint32_t mEvictions;
+    uint32_t mFlushes;
+    double mOccupancySum;
+    uint32_t mOccupancySamples;
+
+    void addTexture(uint16_t width, uint16_t height) {
+        mTextures.push(new CacheTexture(width, height));
+        mAllocated.push(false);
+    }
+
+    ssize_t fitInTextures(const SkGlyph& skGlyph, uint16_t* outShelf) {
+        uint32_t x, y;
+        for (size_t i = 0; i < mTextures.size(); i++) {
+            if (mTextures[i]->fitBitmap(skGlyph, &x, &y, outShelf)) {
+                mAllocated.editItemAt(i) = true;
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    /* Same as FontRenderer::evictAndCacheBitmap(). */
+    ssize_t evictAndFit(const SkGlyph& skGlyph, uint16_t* outShelf) {
+        ssize_t victim = -1;
+        ssize_t victimShelf = -1;
+        for (size_t i = 0; i < mTextures.size(); i++) {
+            if (!mAllocated[i]) continue;
+
+            ssize_t shelf = mTextures[i]->findEvictableShelf(skGlyph);
+            if (shelf >= 0 && (victim < 0 || mTextures[i]->getShelfLastUse(shelf) <
+                    mTextures[victim]->getShelfLastUse(victimShelf))) {
+                victim = i;
+                victimShelf = shelf;
+            }
+        }
+        if (victim < 0) {
+            return -1;
+        }
+
+        mEvictions += 1;
+        mTextures[victim]->evictShelf(victimShelf);
+        for (size_t i = 0; i < mGlyphs.size(); i++) {
+            SimulatedGlyph& glyph = mGlyphs.editValueAt(i);
+            if (glyph.isValid && glyph.textureIndex == victim && glyph.shelf == victimShelf) {
+                glyph.isValid = false;
+            }
+        }
+
+        uint32_t x, y;
+        return mTextures[victim]->fitBitmap(skGlyph, &x, &y, outShelf) ? victim : -1;
+    }
+
+    void flushAll() {
+        mFlushes += 1;
+        for (size_t i = 0; i < mGlyphs.size(); i++) {
+            mGlyphs.editValueAt(i).isValid = false;
+        }
+        for (size_t i = 0; i < mTextures.size(); i++) {
+            mTextures[i]->init();
+        }
+    }
+
+    void cacheGlyph(SimulatedGlyph& glyph) {
+        SkGlyph skGlyph;
+        memset(&skGlyph, 0, sizeof(skGlyph));
+        skGlyph.fWidth = glyph.width;
+        skGlyph.fHeight = glyph.height;
+
+        uint16_t shelf = 0;
+        ssize_t textureIndex = fitInTextures(skGlyph, &shelf);
+        if (textureIndex < 0 && mEvictShelves) {
+            textureIndex = evictAndFit(skGlyph, &shelf);
+        }
+        if (textureIndex < 0) {
+            flushAll();
+            textureIndex = fitInTextures(skGlyph, &shelf);
+        }
+        if (textureIndex < 0) {
+            return; // too large for any texture
+        }
+
+        glyph.isValid = true;
+        glyph.textureIndex = textureIndex;
+        glyph.shelf = shelf;
+        mTextures[textureIndex]->touchShelf(shelf, ++mClock);
+    }
+
+    void sampleOccupancy() {
+        double totalArea = 0;
+        for (size_t i = 0; i < mTextures.size(); i++) {
+            totalArea += mTextures[i]->getWidth() * mTextures[i]->getHeight();
+        }
+
+        double glyphArea = 0;
+        for (size_t i = 0; i < mGlyphs.size(); i++) {
+            const SimulatedGlyph& glyph = mGlyphs.valueAt(i);
+            if (glyph.isValid) {
+                glyphArea += (glyph.width + TEXTURE_BORDER_SIZE) *
+                        (glyph.height + TEXTURE_BORDER_SIZE);
+            }
+        }
+
+        mOccupancySum += glyphArea / totalArea;
+        mOccupancySamples += 1;
+    }
+};
+
+
+// --- Workload ---
+
+/* Draws glyphs picked with a Zipf distribution.  The dimensions of a glyph only
+ * depend on its character and text size, so both simulations see the same glyphs. */
+static void runWorkload(GlyphCacheSimulation& simulation, int32_t charCount, double zipf,
+        uint32_t drawCount) {
+    Vector<double> cumulativeWeights;
+    double totalWeight = 0;
+    for (int32_t i = 0; i < charCount; i++) {
+        totalWeight += 1.0 / pow(i + 1, zipf);
+        cumulativeWeights.push(totalWeight);
+    }
+
+    srand(7);
+    for (uint32_t draw = 0; draw < drawCount; draw++) {
+        int32_t sizeIndex = rand() % TEXT_SIZE_COUNT;
+        double r = (rand() / (double) RAND_MAX) * totalWeight;
+
+        int32_t low = 0;
+        int32_t high = charCount - 1;
+        while (low < high) {
+            int32_t middle = (low + high) / 2;
+            if (cumulativeWeights[middle] < r) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+
+        uint32_t key = uint32_t(sizeIndex) * charCount + low;
+        uint32_t hash = key * 2654435761U;
+        float textSize = TEXT_SIZES[sizeIndex];
+        uint16_t width = uint16_t(textSize * (0.8f + 0.3f * ((hash >> 8) & 0xff) / 255.0f));
+        uint16_t height = uint16_t(textSize * (0.9f + 0.3f * ((hash >> 16) & 0xff) / 255.0f));
+        simulation.draw(key, width, height);
+    }
+}
+
+static void usage(const char* program) {
+    fprintf(stderr, "Usage: %s [--chars N] [--zipf S] [--draws N] [--clock-start N]\n",
+            program);
+}
+
+int main(int argc, char** argv) {
+    int32_t charCount = 2000;
+    double zipf = 1.0;
+    uint32_t drawCount = 3000000;
+    uint64_t clockStart = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && !strcmp(argv[i], "--chars")) {
+            charCount = atoi(argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "--zipf")) {
+            zipf = atof(argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "--draws")) {
+            drawCount = strtoul(argv[++i], NULL, 10);
+        } else if (i + 1 < argc && !strcmp(argv[i], "--clock-start")) {
+            clockStart = strtoull(argv[++i], NULL, 10);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (charCount <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    printf("chars=%d zipf=%0.2f clock-start=%llu\n", charCount, zipf,
+            (unsigned long long) clockStart);
+
+    GlyphCacheSimulation shelfEviction(true, clockStart);
+    runWorkload(shelfEviction, charCount, zipf, drawCount);
+    shelfEviction.report("Shelf eviction");
+
+    GlyphCacheSimulation flushOnly(false, clockStart);
+    runWorkload(flushOnly, charCount, zipf, drawCount);
+    flushOnly.report("Flush when full");
+    return 0;
+}
@@ -0,0 +1,331 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Measures save() and restore() with the pooled, copy on write Snapshot and
+ * with the Snapshot it replaced, and checks that both compute the same state.
+ *
+ * Usage: hwui_Snapshot_benchmark [--frames N] [--depth N]
+ *
+ * Each frame replays a tree of nested display lists the way OpenGLRenderer
+ * does it: every list saves around its transform and clip, and most of its
+ * ops save around a transform of their own.  Some ops save without the matrix
+ * flag, others clip with a non rectangular op.  During the first frames,
+ * every draw hashes the mapped bounds, the transform and the clip it sees.
+ * Only the frames that follow are timed.  The benchmark fails if the two
+ * implementations do not produce the same hash.
+ */
+
+#include "../Snapshot.h"
+#include "ReferenceSnapshot.h"
+
+#include <SkCanvas.h>
+
+#include <utils/Timers.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace android;
+using namespace android::uirenderer;
+
+static const int32_t VIEWPORT_WIDTH = 1080;
+static const int32_t VIEWPORT_HEIGHT = 1920;
+
+// Number of lists drawn by each list, up to the maximum depth.
+static const int32_t CHILD_LIST_COUNT = 4;
+
+// Number of ops drawn by each list.
+static const int32_t OP_COUNT = 8;
+
+// Number of frames hashed before the timed frames.
+static const int32_t HASHED_FRAME_COUNT = 100;
+
+
+// --- SnapshotTraits ---
+
+/* Creates and modifies snapshots the way OpenGLRenderer does for each implementation. */
+template<typename S>
+struct SnapshotTraits;
+
+template<>
+struct SnapshotTraits<Snapshot> {
+    static Snapshot* create(SnapshotPool& pool) {
+        return new (pool) Snapshot();
+    }
+
+    static Snapshot* create(SnapshotPool& pool, const sp<Snapshot>& previous, int flags) {
+        return new (pool) Snapshot(previous, flags);
+    }
+
+    static mat4* editTransform(Snapshot* snapshot) {
+        return snapshot->editTransform();
+    }
+};
+
+template<>
+struct SnapshotTraits<ReferenceSnapshot> {
+    static ReferenceSnapshot* create(SnapshotPool& pool) {
+        return new ReferenceSnapshot();
+    }
+
+    static ReferenceSnapshot* create(SnapshotPool& pool, const sp<ReferenceSnapshot>& previous,
+            int flags) {
+        return new ReferenceSnapshot(previous, flags);
+    }
+
+    static mat4* editTransform(ReferenceSnapshot* snapshot) {
+        return snapshot->transform;
+    }
+};
+
+
+// --- BenchmarkRenderer ---
+
+/* The save, restore, transform and clip logic of OpenGLRenderer, without any drawing. */
+template<typename S>
+class BenchmarkRenderer {
+public:
+    BenchmarkRenderer() : mSaveCount(1), mHashing(false), mHash(2166136261U), mDrawCount(0) {
+        mFirstSnapshot = SnapshotTraits<S>::create(mPool);
+        mFirstSnapshot->viewport.set(0, 0, VIEWPORT_WIDTH, VIEWPORT_HEIGHT);
+        mFirstSnapshot->height = VIEWPORT_HEIGHT;
+        mSnapshot = mFirstSnapshot;
+    }
+
+    void prepare() {
+        mSnapshot = SnapshotTraits<S>::create(mPool, mFirstSnapshot,
+                SkCanvas::kMatrix_SaveFlag | SkCanvas::kClip_SaveFlag);
+        mSaveCount = 1;
+        mSnapshot->setClip(0, 0, VIEWPORT_WIDTH, VIEWPORT_HEIGHT);
+    }
+
+    void finish() {
+        mSnapshot = mFirstSnapshot;
+    }
+
+    int save(int flags) {
+        mSnapshot = SnapshotTraits<S>::create(mPool, mSnapshot, flags);
+        return mSaveCount++;
+    }
+
+    void restoreToCount(int saveCount) {
+        if (saveCount < 1) saveCount = 1;
+
+        while (mSaveCount > saveCount) {
+            sp<S> previous = mSnapshot->previous;
+            mSnapshot = previous;
+            mSaveCount--;
+        }
+    }
+
+    void translate(float dx, float dy) {
+        SnapshotTraits<S>::editTransform(mSnapshot.get())->translate(dx, dy, 0.0f);
+    }
+
+    void scale(float sx, float sy) {
+        SnapshotTraits<S>::editTransform(mSnapshot.get())->scale(sx, sy, 1.0f);
+    }
+
+    void clipRect(float left, float top, float right, float bottom,
+            SkRegion::Op op = SkRegion::kIntersect_Op) {
+        mSnapshot->clip(left, top, right, bottom, op);
+    }
+
+    /* Rejects the rect like OpenGLRenderer::quickReject(), and also hashes
+     * the current state when hashing is enabled. */
+    void drawRect(float left, float top, float right, float bottom) {
+        Rect bounds(left, top, right, bottom);
+        mSnapshot->transform->mapRect(bounds);
+        if (bounds.intersects(*mSnapshot->clipRect)) {
+            mDrawCount++;
+        }
+        if (!mHashing) return;
+
+        hashRect(bounds);
+
+        const float* data = mSnapshot->transform->data;
+        for (int i = 0; i < 16; i++) {
+            hashFloat(data[i]);
+        }
+
+        hashRect(*mSnapshot->clipRect);
+        if (mSnapshot->clipRegion) {
+            const SkIRect& regionBounds = mSnapshot->clipRegion->getBounds();
+            hashRect(Rect(regionBounds.fLeft, regionBounds.fTop,
+                    regionBounds.fRight, regionBounds.fBottom));
+        }
+        hashRect(mSnapshot->getLocalClip());
+    }
+
+    void setHashing(bool hashing) {
+        mHashing = hashing;
+    }
+
+    uint32_t getHash() const {
+        return mHash;
+    }
+
+    uint32_t getDrawCount() const {
+        return mDrawCount;
+    }
+
+private:
+    // Declared first so that it outlives the snapshots, as in OpenGLRenderer
+    SnapshotPool mPool;
+
+    sp<S> mFirstSnapshot;
+    sp<S> mSnapshot;
+    int mSaveCount;
+    bool mHashing;
+    uint32_t mHash;
+    uint32_t mDrawCount;
+
+    void hashFloat(float value) {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        mHash = (mHash ^ bits) * 16777619U;
+    }
+
+    void hashRect(const Rect& r) {
+        hashFloat(r.left);
+        hashFloat(r.top);
+        hashFloat(r.right);
+        hashFloat(r.bottom);
+    }
+};
+
+
+// --- Workload ---
+
+/* Draws a list and its children, saving and restoring like DisplayList::replay(). */
+template<typename S>
+static void drawList(BenchmarkRenderer<S>& renderer, int32_t depth, int32_t maxDepth,
+        int32_t index) {
+    int saveCount = renderer.save(SkCanvas::kMatrix_SaveFlag | SkCanvas::kClip_SaveFlag);
+    renderer.translate(10 + index, 20 + index * 3);
+    renderer.clipRect(0, 0, 500 - depth * 20, 300);
+
+    for (int32_t op = 0; op < OP_COUNT; op++) {
+        // Ops like drawText or drawBitmap save around their transform
+        int opSaveCount = renderer.save(SkCanvas::kMatrix_SaveFlag);
+        if (op & 1) {
+            renderer.translate(op, op);
+        }
+        if (op == 2) {
+            renderer.scale(1.5f, 0.5f);
+        }
+        renderer.drawRect(op * 4, op * 2, op * 4 + 40, op * 2 + 20);
+        renderer.restoreToCount(opSaveCount);
+
+        if (op == 5) {
+            // Without the matrix flag the translation reaches the list
+            int clipSaveCount = renderer.save(SkCanvas::kClip_SaveFlag);
+            renderer.translate(1, 1);
+            renderer.clipRect(2, 2, 200, 200);
+            renderer.drawRect(0, 0, 10, 10);
+            renderer.restoreToCount(clipSaveCount);
+        }
+
+        if (op == 6 && depth == maxDepth && index == 0) {
+            // A non rectangular clip, inherited by the saves below it
+            int regionSaveCount = renderer.save(SkCanvas::kClip_SaveFlag);
+            renderer.clipRect(20, 20, 40, 40, SkRegion::kDifference_Op);
+            renderer.save(SkCanvas::kMatrix_SaveFlag | SkCanvas::kClip_SaveFlag);
+            renderer.translate(5, 5);
+            renderer.clipRect(0, 0, 100, 100);
+            renderer.drawRect(0, 0, 30, 30);
+            renderer.restoreToCount(regionSaveCount);
+        }
+    }
+
+    if (depth < maxDepth) {
+        for (int32_t i = 0; i < CHILD_LIST_COUNT; i++) {
+            drawList(renderer, depth + 1, maxDepth, i);
+        }
+    }
+
+    renderer.restoreToCount(saveCount);
+}
+
+template<typename S>
+static void drawFrames(BenchmarkRenderer<S>& renderer, int32_t frameCount, int32_t maxDepth) {
+    for (int32_t frame = 0; frame < frameCount; frame++) {
+        renderer.prepare();
+        drawList(renderer, 0, maxDepth, 0);
+        renderer.finish();
+    }
+}
+
+/* Hashes a few frames, then times frames without hashing so that only
+ * the snapshots are measured. Returns the hash. */
+template<typename S>
+static uint32_t runWorkload(const char* label, int32_t frameCount, int32_t maxDepth) {
+    BenchmarkRenderer<S> renderer;
+
+    renderer.setHashing(true);
+    drawFrames(renderer, HASHED_FRAME_COUNT, maxDepth);
+    renderer.setHashing(false);
+
+    nsecs_t startTime = systemTime(SYSTEM_TIME_MONOTONIC);
+    drawFrames(renderer, frameCount, maxDepth);
+    nsecs_t elapsed = systemTime(SYSTEM_TIME_MONOTONIC) - startTime;
+
+    printf("%s: %0.1fus/frame draws=%u hash=0x%08x\n", label,
+            elapsed / 1000.0 / frameCount, renderer.getDrawCount(), renderer.getHash());
+    return renderer.getHash();
+}
+
+static void usage(const char* program) {
+    fprintf(stderr, "Usage: %s [--frames N] [--depth N]\n", program);
+}
+
+int main(int argc, char** argv) {
+    int32_t frameCount = 20000;
+    int32_t maxDepth = 4;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && !strcmp(argv[i], "--frames")) {
+            frameCount = atoi(argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "--depth")) {
+            maxDepth = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (frameCount <= 0 || maxDepth < 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    int32_t listCount = 0;
+    for (int32_t depth = 0, lists = 1; depth <= maxDepth; depth++, lists *= CHILD_LIST_COUNT) {
+        listCount += lists;
+    }
+    printf("%d frames, %d lists per frame\n", frameCount, listCount);
+
+    uint32_t referenceHash = runWorkload<ReferenceSnapshot>("Reference snapshot", frameCount,
+            maxDepth);
+    uint32_t hash = runWorkload<Snapshot>("Pooled snapshot", frameCount, maxDepth);
+
+    if (hash != referenceHash) {
+        fprintf(stderr, "The snapshots computed different transforms or clips.\n");
+        return 1;
+    }
+    return 0;
+}
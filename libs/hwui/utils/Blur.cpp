@@ -0,0 +1,258 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "Blur.h"
+
+namespace android {
+namespace uirenderer {
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructors/destructor
+///////////////////////////////////////////////////////////////////////////////
+
+Blur::Blur(): mScratch(NULL), mScratchSize(0), mLine(NULL), mLineSize(0),
+        mSources(NULL), mUncachedWeights(NULL), mKernelSize(0) {
+    memset(mWeights, 0, sizeof(mWeights));
+}
+
+Blur::~Blur() {
+    for (int32_t i = 0; i <= MAX_CACHED_BLUR_RADIUS; i++) {
+        delete[] mWeights[i];
+    }
+    releaseScratch();
+}
+
+void Blur::releaseScratch() {
+    delete[] mScratch;
+    mScratch = NULL;
+    mScratchSize = 0;
+
+    delete[] mLine;
+    mLine = NULL;
+    mLineSize = 0;
+
+    delete[] mSources;
+    mSources = NULL;
+    delete[] mUncachedWeights;
+    mUncachedWeights = NULL;
+    mKernelSize = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Weights
+///////////////////////////////////////////////////////////////////////////////
+
+void Blur::computeGaussianWeights(float* weights, int32_t radius) {
+    // g(x) = ( 1 / sqrt( 2 * pi ) * sigma) * e ^ ( -x^2 / 2 * sigma^2 )
+    // x is of the form [-radius .. 0 .. radius]
+    // and sigma varies with radius.
+    // Based on some experimental radius values and sigma's
+    // we approximately fit sigma = f(radius) as
+    // sigma = radius * 0.3  + 0.6
+    // The larger the radius gets, the more our gaussian blur
+    // will resemble a box blur since with large sigma
+    // the gaussian curve begins to lose its shape
+    float sigma = 0.3f * (float) radius + 0.6f;
+
+    float coeff1 = 1.0f / (sqrtf(2.0f * M_PI) * sigma);
+    float coeff2 = -1.0f / (2.0f * sigma * sigma);
+
+    float normalizeFactor = 0.0f;
+    for (int32_t r = -radius; r <= radius; r++) {
+        float floatR = (float) r;
+        weights[r + radius] = coeff1 * expf(floatR * floatR * coeff2);
+        normalizeFactor += weights[r + radius];
+    }
+
+    // All our coefficients need to add up to one
+    normalizeFactor = 1.0f / normalizeFactor;
+    for (int32_t r = -radius; r <= radius; r++) {
+        weights[r + radius] *= normalizeFactor;
+    }
+}
+
+void Blur::computeFixedWeights(uint16_t* weights, int32_t radius) {
+    const int32_t count = 2 * radius + 1;
+    float* gaussian = new float[count];
+    computeGaussianWeights(gaussian, radius);
+
+    int32_t sum = 0;
+    for (int32_t i = 0; i < count; i++) {
+        weights[i] = (uint16_t) (gaussian[i] * BLUR_WEIGHT_ONE + 0.5f);
+        sum += weights[i];
+    }
+    // Rounding errors go to the center of the kernel so that the blur
+    // never brightens or darkens the image
+    weights[radius] += BLUR_WEIGHT_ONE - sum;
+
+    delete[] gaussian;
+}
+
+const uint16_t* Blur::getWeights(int32_t radius) {
+    if (radius <= MAX_CACHED_BLUR_RADIUS) {
+        if (!mWeights[radius]) {
+            mWeights[radius] = new uint16_t[2 * radius + 1];
+            computeFixedWeights(mWeights[radius], radius);
+        }
+        return mWeights[radius];
+    }
+
+    // ensureScratch() sized mUncachedWeights for this radius
+    computeFixedWeights(mUncachedWeights, radius);
+    return mUncachedWeights;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Blur
+///////////////////////////////////////////////////////////////////////////////
+
+void Blur::ensureScratch(int32_t width, int32_t height, int32_t radius) {
+    const size_t scratchSize = width * height;
+    if (scratchSize > mScratchSize) {
+        delete[] mScratch;
+        mScratch = new uint8_t[scratchSize];
+        mScratchSize = scratchSize;
+    }
+
+    const size_t lineSize = width + 2 * radius;
+    if (lineSize > mLineSize) {
+        delete[] mLine;
+        mLine = new uint8_t[lineSize];
+        mLineSize = lineSize;
+    }
+
+    const size_t kernelSize = 2 * radius + 1;
+    if (kernelSize > mKernelSize) {
+        delete[] mSources;
+        mSources = new const uint8_t*[kernelSize];
+        delete[] mUncachedWeights;
+        mUncachedWeights = new uint16_t[kernelSize];
+        mKernelSize = kernelSize;
+    }
+}
+
+void Blur::blurImage(uint8_t* image, int32_t width, int32_t height, int32_t radius) {
+    // A kernel of radius 0 is a single weight of 1.0
+    if (radius <= 0 || width <= 0 || height <= 0) return;
+
+    ensureScratch(width, height, radius);
+    const uint16_t* weights = getWeights(radius);
+
+    horizontalBlur(weights, radius, image, mScratch, width, height);
+    verticalBlur(weights, radius, mScratch, image, width, height);
+}
+
+void Blur::horizontalBlur(const uint16_t* weights, int32_t radius, const uint8_t* source,
+        uint8_t* dest, int32_t width, int32_t height) {
+    const int32_t count = 2 * radius + 1;
+    for (int32_t k = 0; k < count; k++) {
+        mSources[k] = mLine + k;
+    }
+
+    for (int32_t y = 0; y < height; y++) {
+        const uint8_t* input = source + y * width;
+
+        // Extending the row removes the clamping from the inner loop
+        memset(mLine, input[0], radius);
+        memcpy(mLine + radius, input, width);
+        memset(mLine + radius + width, input[width - 1], radius);
+
+        convolve(weights, count, mSources, dest + y * width, width);
+    }
+}
+
+void Blur::verticalBlur(const uint16_t* weights, int32_t radius, const uint8_t* source,
+        uint8_t* dest, int32_t width, int32_t height) {
+    const int32_t count = 2 * radius + 1;
+
+    for (int32_t y = 0; y < height; y++) {
+        for (int32_t k = 0; k < count; k++) {
+            int32_t row = y - radius + k;
+            if (row < 0) row = 0;
+            if (row > height - 1) row = height - 1;
+            mSources[k] = source + row * width;
+        }
+
+        convolve(weights, count, mSources, dest + y * width, width);
+    }
+}
+
+void Blur::convolve(const uint16_t* weights, int32_t count, const uint8_t** sources,
+        uint8_t* dest, int32_t width) {
+    int32_t x = 0;
+
+    // The weights add up to BLUR_WEIGHT_ONE, the sums therefore fit in
+    // 32 bits and never exceed 255 once shifted. Sums are rounded to the
+    // nearest value instead of truncated, which would darken the image
+    // by half a level on average at each pass
+#if defined(__ARM_NEON__)
+    for (; x + 8 <= width; x += 8) {
+        uint32x4_t low = vdupq_n_u32(0);
+        uint32x4_t high = vdupq_n_u32(0);
+        for (int32_t k = 0; k < count; k++) {
+            uint16x8_t pixels = vmovl_u8(vld1_u8(sources[k] + x));
+            uint16x4_t weight = vdup_n_u16(weights[k]);
+            low = vmlal_u16(low, vget_low_u16(pixels), weight);
+            high = vmlal_u16(high, vget_high_u16(pixels), weight);
+        }
+        // vrshrn adds 1 << (BLUR_WEIGHT_SHIFT - 1) before shifting
+        uint16x8_t result = vcombine_u16(vrshrn_n_u32(low, BLUR_WEIGHT_SHIFT),
+                vrshrn_n_u32(high, BLUR_WEIGHT_SHIFT));
+        vst1_u8(dest + x, vmovn_u16(result));
+    }
+#elif defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i half = _mm_set1_epi32(1 << (BLUR_WEIGHT_SHIFT - 1));
+    for (; x + 8 <= width; x += 8) {
+        __m128i low = half;
+        __m128i high = half;
+        for (int32_t k = 0; k < count; k++) {
+            __m128i pixels = _mm_unpacklo_epi8(
+                    _mm_loadl_epi64((const __m128i*) (sources[k] + x)), zero);
+            __m128i weight = _mm_set1_epi16(weights[k]);
+            // 16x16 bits multiplication, the low and high halves of
+            // each product are interleaved back into 32 bits lanes
+            __m128i productLow = _mm_mullo_epi16(pixels, weight);
+            __m128i productHigh = _mm_mulhi_epu16(pixels, weight);
+            low = _mm_add_epi32(low, _mm_unpacklo_epi16(productLow, productHigh));
+            high = _mm_add_epi32(high, _mm_unpackhi_epi16(productLow, productHigh));
+        }
+        __m128i result = _mm_packs_epi32(_mm_srli_epi32(low, BLUR_WEIGHT_SHIFT),
+                _mm_srli_epi32(high, BLUR_WEIGHT_SHIFT));
+        _mm_storel_epi64((__m128i*) (dest + x), _mm_packus_epi16(result, result));
+    }
+#endif
+
+    for (; x < width; x++) {
+        uint32_t sum = 1 << (BLUR_WEIGHT_SHIFT - 1);
+        for (int32_t k = 0; k < count; k++) {
+            sum += weights[k] * sources[k][x];
+        }
+        dest[x] = (uint8_t) (sum >> BLUR_WEIGHT_SHIFT);
+    }
+}
+
+}; // namespace uirenderer
+}; // namespace android
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HWUI_BLUR_H
+#define ANDROID_HWUI_BLUR_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+namespace android {
+namespace uirenderer {
+
+///////////////////////////////////////////////////////////////////////////////
+// Defines
+///////////////////////////////////////////////////////////////////////////////
+
+// Gaussian weights are stored as fixed point numbers with this many
+// fractional bits. The weights of a kernel always add up to exactly 1.0
+#define BLUR_WEIGHT_SHIFT 15
+#define BLUR_WEIGHT_ONE (1 << BLUR_WEIGHT_SHIFT)
+
+// Weights are cached for radii up to and including this value
+#define MAX_CACHED_BLUR_RADIUS 32
+
+///////////////////////////////////////////////////////////////////////////////
+// Blur
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Separable gaussian blur for alpha8 images. Both passes use integer
+ * arithmetic and are vectorized with NEON or SSE2 when available. The
+ * weights and the temporary buffers are kept between calls, an instance
+ * must therefore not be shared between threads.
+ */
+class Blur {
+public:
+    Blur();
+    ~Blur();
+
+    /**
+     * Blurs the specified image in place. Pixels outside of the image
+     * are clamped to the nearest edge.
+     */
+    void blurImage(uint8_t* image, int32_t width, int32_t height, int32_t radius);
+
+    /**
+     * Releases the temporary buffers. The cached weights are kept.
+     */
+    void releaseScratch();
+
+    /**
+     * Computes the normalized weights of the gaussian kernel of the
+     * specified radius. weights must hold 2 * radius + 1 values.
+     */
+    static void computeGaussianWeights(float* weights, int32_t radius);
+
+    /**
+     * Converts the weights of the gaussian kernel of the specified radius
+     * to fixed point, see BLUR_WEIGHT_SHIFT.
+     */
+    static void computeFixedWeights(uint16_t* weights, int32_t radius);
+
+private:
+    const uint16_t* getWeights(int32_t radius);
+    void ensureScratch(int32_t width, int32_t height, int32_t radius);
+
+    void horizontalBlur(const uint16_t* weights, int32_t radius, const uint8_t* source,
+            uint8_t* dest, int32_t width, int32_t height);
+    void verticalBlur(const uint16_t* weights, int32_t radius, const uint8_t* source,
+            uint8_t* dest, int32_t width, int32_t height);
+
+    /**
+     * Computes dest[x] = sum(weights[k] * sources[k][x]) for k in [0..count[
+     * and x in [0..width[.
+     */
+    static void convolve(const uint16_t* weights, int32_t count, const uint8_t** sources,
+            uint8_t* dest, int32_t width);
+
+    uint16_t* mWeights[MAX_CACHED_BLUR_RADIUS + 1];
+
+    // Intermediate image written by the horizontal pass
+    uint8_t* mScratch;
+    size_t mScratchSize;
+    // One row of the image, extended on both sides by replicating its edges
+    uint8_t* mLine;
+    size_t mLineSize;
+    // Rows or columns read for each weight of the kernel
+    const uint8_t** mSources;
+    // Weights of the last uncached radius
+    uint16_t* mUncachedWeights;
+    size_t mKernelSize;
+}; // class Blur
+
+}; // namespace uirenderer
+}; // namespace android
+
+#endif // ANDROID_HWUI_BLUR_H
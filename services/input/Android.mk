@@ -23,6 +23,7 @@ LOCAL_SRC_FILES:= \
     InputListener.cpp \
     InputManager.cpp \
     InputReader.cpp \
+    InputTrace.cpp \
     InputWindow.cpp \
     PointerController.cpp \
     SpriteController.cpp
@@ -162,7 +162,9 @@ EventHub::Device::Device(int fd, int32_t id, const String8& path,
         next(NULL),
         fd(fd), id(id), path(path), identifier(identifier),
         classes(0), configuration(NULL), virtualKeyMap(NULL),
-        ffEffectPlaying(false), ffEffectId(-1) {
+        ffEffectPlaying(false), ffEffectId(-1),
+        wakeupCount(0), readCount(0), eventCount(0), maxEventsPerWakeup(0),
+        lastWakeupSeq(0), eventsInLastWakeup(0) {
     memset(keyBitmask, 0, sizeof(keyBitmask));
     memset(absBitmask, 0, sizeof(absBitmask));
     memset(relBitmask, 0, sizeof(relBitmask));
@@ -198,9 +200,21 @@ EventHub::EventHub(void) :
         mOpeningDevices(0), mClosingDevices(0),
         mNeedToSendFinishedDeviceScan(false),
         mNeedToReopenDevices(false), mNeedToScanDevices(true),
-        mPendingEventCount(0), mPendingEventIndex(0), mPendingINotify(false) {
+        mPendingEventCount(0), mPendingEventIndex(0), mPendingINotify(false),
+        mReadCoalescingBudget(0), mWakeupSeq(0), mWakeupDeviceCount(0),
+        mLastWakeupDeviceCount(0), mCoalescedPollCount(0), mCoalescedEventCount(0),
+        mProbingCancelled(false), mProbeThreadExiting(false),
+        mAsyncProbeCount(0), mMaxProbeLatency(0) {
     acquire_wake_lock(PARTIAL_WAKE_LOCK, WAKE_LOCK_ID);
 
+    char coalescingBudget[PROPERTY_VALUE_MAX];
+    if (property_get("input.read_coalescing_us", coalescingBudget, NULL) > 0) {
+        mReadCoalescingBudget = nsecs_t(atoi(coalescingBudget)) * 1000LL;
+        if (mReadCoalescingBudget < 0) {
+            mReadCoalescingBudget = 0;
+        }
+    }
+
     mEpollFd = epoll_create(EPOLL_SIZE_HINT);
     LOG_ALWAYS_FATAL_IF(mEpollFd < 0, "Could not create epoll instance.  errno=%d", errno);
 
@@ -238,6 +252,10 @@ EventHub::EventHub(void) :
 }
 
 EventHub::~EventHub(void) {
+    // Subclasses that override probeDevice() have already stopped the thread.
+    stopDeviceProbeThread();
+    cancelAllDeviceProbesLocked();
+
     closeAllDevicesLocked();
 
     while (mClosingDevices) {
@@ -646,6 +664,10 @@ size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSiz
     RawEvent* event = buffer;
     size_t capacity = bufferSize;
     bool awoken = false;
+    nsecs_t firstEventTime = 0;
+    bool coalescing = false;
+    mWakeupSeq += 1;
+    mWakeupDeviceCount = 0;
     for (;;) {
         nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
 
@@ -655,6 +677,7 @@ size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSiz
 
             ALOGI("Reopening all input devices due to a configuration change.");
 
+            cancelAllDeviceProbesLocked();
             closeAllDevicesLocked();
             mNeedToScanDevices = true;
             break; // return to the caller before we actually rescan
@@ -824,12 +847,22 @@ size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSiz
 #else
                         event->when = now;
 #endif
+                        // The coalescing budget starts when the oldest pending event
+                        // was generated, not when we got around to reading it.
+                        nsecs_t eventTime = event->when < now ? event->when : now;
+                        if (!firstEventTime || eventTime < firstEventTime) {
+                            firstEventTime = eventTime;
+                        }
                         event->deviceId = deviceId;
                         event->type = iev.type;
                         event->code = iev.code;
                         event->value = iev.value;
                         event += 1;
                     }
+                    recordReadLocked(device, count);
+                    if (coalescing) {
+                        mCoalescedEventCount += count;
+                    }
                     capacity -= count;
                     if (capacity == 0) {
                         // The result buffer is full.  Reset the pending event index
@@ -858,11 +891,42 @@ size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSiz
             deviceChanged = true;
         }
 
+        // Register devices that the probe thread has finished probing.
+        if (registerProbedDevicesLocked()) {
+            deviceChanged = true;
+        }
+
         // Report added or removed devices immediately.
         if (deviceChanged) {
             continue;
         }
 
+        // When coalescing reads, pick up devices that became ready while we were reading.
+        // If the last wakeup involved several devices then also wait for up to the
+        // remainder of the latency budget since they are likely to report together.
+        if (firstEventTime && !awoken && capacity != 0
+                && mPendingEventIndex >= mPendingEventCount) {
+            int coalescingTimeout = getReadCoalescingTimeoutLocked(firstEventTime);
+            if (coalescingTimeout >= 0) {
+                if (coalescingTimeout > 0) {
+                    mLock.unlock();
+                }
+                int pollResult = epoll_wait(mEpollFd, mPendingEventItems, EPOLL_MAX_EVENTS,
+                        coalescingTimeout);
+                if (coalescingTimeout > 0) {
+                    mLock.lock();
+                }
+                if (pollResult > 0) {
+                    mPendingEventIndex = 0;
+                    mPendingEventCount = size_t(pollResult);
+                    mCoalescedPollCount += 1;
+                    coalescing = true;
+                    continue;
+                }
+                mPendingEventCount = 0;
+            }
+        }
+
         // Return now if we have collected any events or if we were explicitly awoken.
         if (event != buffer || awoken) {
             break;
@@ -911,10 +975,45 @@ size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSiz
         }
     }
 
+    if (mWakeupDeviceCount) {
+        mLastWakeupDeviceCount = mWakeupDeviceCount;
+    }
+
     // All done, return the number of events we read.
     return event - buffer;
 }
 
+void EventHub::recordReadLocked(Device* device, size_t count) {
+    if (device->lastWakeupSeq != mWakeupSeq) {
+        device->lastWakeupSeq = mWakeupSeq;
+        device->eventsInLastWakeup = 0;
+        device->wakeupCount += 1;
+        mWakeupDeviceCount += 1;
+    }
+    device->eventsInLastWakeup += count;
+    if (device->eventsInLastWakeup > device->maxEventsPerWakeup) {
+        device->maxEventsPerWakeup = device->eventsInLastWakeup;
+    }
+    device->readCount += 1;
+    device->eventCount += count;
+}
+
+int EventHub::getReadCoalescingTimeoutLocked(nsecs_t firstEventTime) const {
+    if (!mReadCoalescingBudget) {
+        return -1; // coalescing disabled
+    }
+
+    nsecs_t remaining = firstEventTime + mReadCoalescingBudget
+            - systemTime(SYSTEM_TIME_MONOTONIC);
+    if (remaining <= 0) {
+        return -1; // budget exhausted
+    }
+    if (mLastWakeupDeviceCount < 2) {
+        return 0; // only poll for devices that are already ready
+    }
+    return int(remaining / 1000000LL);
+}
+
 void EventHub::wake() {
     ALOGV("wake() called");
 
@@ -965,6 +1064,16 @@ static const int32_t GAMEPAD_KEYCODES[] = {
 };
 
 status_t EventHub::openDeviceLocked(const char *devicePath) {
+    Device* device = probeDevice(String8(devicePath), mNextDeviceId++, mExcludedDevices);
+    if (!device) {
+        return -1;
+    }
+    return registerDeviceLocked(device);
+}
+
+EventHub::Device* EventHub::probeDevice(const String8& path, int32_t deviceId,
+        const Vector<String8>& excludedDevices) {
+    const char* devicePath = path.string();
     char buffer[80];
 
     ALOGV("Opening device: %s", devicePath);
@@ -972,7 +1081,7 @@ status_t EventHub::openDeviceLocked(const char *devicePath) {
     int fd = open(devicePath, O_RDWR | O_CLOEXEC);
     if(fd < 0) {
         ALOGE("could not open %s, %s\n", devicePath, strerror(errno));
-        return -1;
+        return NULL;
     }
 
     InputDeviceIdentifier identifier;
@@ -986,12 +1095,12 @@ status_t EventHub::openDeviceLocked(const char *devicePath) {
     }
 
     // Check to see if the device is on our excluded list
-    for (size_t i = 0; i < mExcludedDevices.size(); i++) {
-        const String8& item = mExcludedDevices.itemAt(i);
+    for (size_t i = 0; i < excludedDevices.size(); i++) {
+        const String8& item = excludedDevices.itemAt(i);
         if (identifier.name == item) {
             ALOGI("ignoring event id %s driver %s\n", devicePath, item.string());
             close(fd);
-            return -1;
+            return NULL;
         }
     }
 
@@ -1000,7 +1109,7 @@ status_t EventHub::openDeviceLocked(const char *devicePath) {
     if(ioctl(fd, EVIOCGVERSION, &driverVersion)) {
         ALOGE("could not get driver version for %s, %s\n", devicePath, strerror(errno));
         close(fd);
-        return -1;
+        return NULL;
     }
 
     // Get device identifier.
@@ -1008,7 +1117,7 @@ status_t EventHub::openDeviceLocked(const char *devicePath) {
     if(ioctl(fd, EVIOCGID, &inputId)) {
         ALOGE("could not get device input id for %s, %s\n", devicePath, strerror(errno));
         close(fd);
-        return -1;
+        return NULL;
     }
     identifier.bus = inputId.bustype;
     identifier.product = inputId.product;
@@ -1038,12 +1147,11 @@ status_t EventHub::openDeviceLocked(const char *devicePath) {
     if (fcntl(fd, F_SETFL, O_NONBLOCK)) {
         ALOGE("Error %d making device file descriptor non-blocking.", errno);
         close(fd);
-        return -1;
+        return NULL;
     }
 
     // Allocate device.  (The device object takes ownership of the fd at this point.)
-    int32_t deviceId = mNextDeviceId++;
-    Device* device = new Device(fd, deviceId, String8(devicePath), identifier);
+    Device* device = new Device(fd, deviceId, path, identifier);
 
     ALOGV("add device %d: %s\n", deviceId, devicePath);
     ALOGV("  bus:        %04x\n"
@@ -1059,7 +1167,7 @@ status_t EventHub::openDeviceLocked(const char *devicePath) {
         driverVersion >> 16, (driverVersion >> 8) & 0xff, driverVersion & 0xff);
 
     // Load the configuration file for the device.
-    loadConfigurationLocked(device);
+    loadConfiguration(device);
 
     // Figure out the kinds of events the device reports.
     ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(device->keyBitmask)), device->keyBitmask);
@@ -1138,7 +1246,7 @@ status_t EventHub::openDeviceLocked(const char *devicePath) {
     if ((device->classes & INPUT_DEVICE_CLASS_TOUCH)) {
         // Load the virtual keys for the touch screen, if any.
         // We do this now so that we can make sure to load the keymap if necessary.
-        status_t status = loadVirtualKeyMapLocked(device);
+        status_t status = loadVirtualKeyMap(device);
         if (!status) {
             device->classes |= INPUT_DEVICE_CLASS_KEYBOARD;
         }
@@ -1146,39 +1254,30 @@ status_t EventHub::openDeviceLocked(const char *devicePath) {
 
     // Load the key map.
     // We need to do this for joysticks too because the key layout may specify axes.
-    status_t keyMapStatus = NAME_NOT_FOUND;
     if (device->classes & (INPUT_DEVICE_CLASS_KEYBOARD | INPUT_DEVICE_CLASS_JOYSTICK)) {
         // Load the keymap for the device.
-        keyMapStatus = loadKeyMapLocked(device);
+        loadKeyMap(device);
     }
 
     // Configure the keyboard, gamepad or virtual keyboard.
     if (device->classes & INPUT_DEVICE_CLASS_KEYBOARD) {
-        // Register the keyboard as a built-in keyboard if it is eligible.
-        if (!keyMapStatus
-                && mBuiltInKeyboardId == NO_BUILT_IN_KEYBOARD
-                && isEligibleBuiltInKeyboard(device->identifier,
-                        device->configuration, &device->keyMap)) {
-            mBuiltInKeyboardId = device->id;
-        }
-
         // 'Q' key support = cheap test of whether this is an alpha-capable kbd
-        if (hasKeycodeLocked(device, AKEYCODE_Q)) {
+        if (hasKeycode(device, AKEYCODE_Q)) {
             device->classes |= INPUT_DEVICE_CLASS_ALPHAKEY;
         }
 
         // See if this device has a DPAD.
-        if (hasKeycodeLocked(device, AKEYCODE_DPAD_UP) &&
-                hasKeycodeLocked(device, AKEYCODE_DPAD_DOWN) &&
-                hasKeycodeLocked(device, AKEYCODE_DPAD_LEFT) &&
-                hasKeycodeLocked(device, AKEYCODE_DPAD_RIGHT) &&
-                hasKeycodeLocked(device, AKEYCODE_DPAD_CENTER)) {
+        if (hasKeycode(device, AKEYCODE_DPAD_UP) &&
+                hasKeycode(device, AKEYCODE_DPAD_DOWN) &&
+                hasKeycode(device, AKEYCODE_DPAD_LEFT) &&
+                hasKeycode(device, AKEYCODE_DPAD_RIGHT) &&
+                hasKeycode(device, AKEYCODE_DPAD_CENTER)) {
             device->classes |= INPUT_DEVICE_CLASS_DPAD;
         }
 
         // See if this device has a gamepad.
         for (size_t i = 0; i < sizeof(GAMEPAD_KEYCODES)/sizeof(GAMEPAD_KEYCODES[0]); i++) {
-            if (hasKeycodeLocked(device, GAMEPAD_KEYCODES[i])) {
+            if (hasKeycode(device, GAMEPAD_KEYCODES[i])) {
                 device->classes |= INPUT_DEVICE_CLASS_GAMEPAD;
                 break;
             }
@@ -1190,25 +1289,39 @@ status_t EventHub::openDeviceLocked(const char *devicePath) {
         ALOGV("Dropping device: id=%d, path='%s', name='%s'",
                 deviceId, devicePath, device->identifier.name.string());
         delete device;
-        return -1;
+        return NULL;
     }
 
     // Determine whether the device is external or internal.
-    if (isExternalDeviceLocked(device)) {
+    if (isExternalDevice(device)) {
         device->classes |= INPUT_DEVICE_CLASS_EXTERNAL;
     }
+    return device;
+}
+
+status_t EventHub::registerDeviceLocked(Device* device) {
+    int fd = device->fd;
 
     // Register with epoll.
     struct epoll_event eventItem;
     memset(&eventItem, 0, sizeof(eventItem));
     eventItem.events = EPOLLIN;
-    eventItem.data.u32 = deviceId;
+    eventItem.data.u32 = device->id;
     if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, fd, &eventItem)) {
         ALOGE("Could not add device fd to epoll instance.  errno=%d", errno);
         delete device;
         return -1;
     }
 
+    // Register the keyboard as a built-in keyboard if it is eligible.
+    if ((device->classes & INPUT_DEVICE_CLASS_KEYBOARD)
+            && device->keyMap.isComplete()
+            && mBuiltInKeyboardId == NO_BUILT_IN_KEYBOARD
+            && isEligibleBuiltInKeyboard(device->identifier,
+                    device->configuration, &device->keyMap)) {
+        mBuiltInKeyboardId = device->id;
+    }
+
     // Enable wake-lock behavior on kernels that support it.
     // TODO: Only need this for devices that can really wake the system.
     bool usingSuspendBlockIoctl = !ioctl(fd, EVIOCSSUSPENDBLOCK, 1);
@@ -1234,12 +1347,12 @@ status_t EventHub::openDeviceLocked(const char *devicePath) {
     ALOGI("New device: id=%d, fd=%d, path='%s', name='%s', classes=0x%x, "
             "configuration='%s', keyLayout='%s', keyCharacterMap='%s', builtinKeyboard=%s, "
             "usingSuspendBlockIoctl=%s, usingClockIoctl=%s",
-         deviceId, fd, devicePath, device->identifier.name.string(),
+         device->id, fd, device->path.string(), device->identifier.name.string(),
          device->classes,
          device->configurationFile.string(),
          device->keyMap.keyLayoutFile.string(),
          device->keyMap.keyCharacterMapFile.string(),
-         toString(mBuiltInKeyboardId == deviceId),
+         toString(mBuiltInKeyboardId == device->id),
          toString(usingSuspendBlockIoctl), toString(usingClockIoctl));
 
     addDeviceLocked(device);
@@ -1257,7 +1370,7 @@ void EventHub::createVirtualKeyboardLocked() {
             | INPUT_DEVICE_CLASS_ALPHAKEY
             | INPUT_DEVICE_CLASS_DPAD
             | INPUT_DEVICE_CLASS_VIRTUAL;
-    loadKeyMapLocked(device);
+    loadKeyMap(device);
     addDeviceLocked(device);
 }
 
@@ -1267,7 +1380,7 @@ void EventHub::addDeviceLocked(Device* device) {
     mOpeningDevices = device;
 }
 
-void EventHub::loadConfigurationLocked(Device* device) {
+void EventHub::loadConfiguration(Device* device) {
     device->configurationFile = getInputDeviceConfigurationFilePathByDeviceIdentifier(
             device->identifier, INPUT_DEVICE_CONFIGURATION_FILE_TYPE_CONFIGURATION);
     if (device->configurationFile.isEmpty()) {
@@ -1284,7 +1397,7 @@ void EventHub::loadConfigurationLocked(Device* device) {
     }
 }
 
-status_t EventHub::loadVirtualKeyMapLocked(Device* device) {
+status_t EventHub::loadVirtualKeyMap(Device* device) {
     // The virtual key map is supplied by the kernel as a system board property file.
     String8 path;
     path.append("/sys/board_properties/virtualkeys.");
@@ -1295,11 +1408,11 @@ status_t EventHub::loadVirtualKeyMapLocked(Device* device) {
     return VirtualKeyMap::load(path, &device->virtualKeyMap);
 }
 
-status_t EventHub::loadKeyMapLocked(Device* device) {
+status_t EventHub::loadKeyMap(Device* device) {
     return device->keyMap.load(device->identifier, device->configuration);
 }
 
-bool EventHub::isExternalDeviceLocked(Device* device) {
+bool EventHub::isExternalDevice(Device* device) {
     if (device->configuration) {
         bool value;
         if (device->configuration->tryGetProperty(String8("device.internal"), value)) {
@@ -1309,7 +1422,7 @@ bool EventHub::isExternalDeviceLocked(Device* device) {
     return device->identifier.bus == BUS_USB || device->identifier.bus == BUS_BLUETOOTH;
 }
 
-bool EventHub::hasKeycodeLocked(Device* device, int keycode) const {
+bool EventHub::hasKeycode(Device* device, int keycode) {
     if (!device->keyMap.haveKeyLayout() || !device->keyBitmask) {
         return false;
     }
@@ -1333,6 +1446,7 @@ status_t EventHub::closeDeviceByPathLocked(const char *devicePath) {
         closeDeviceLocked(device);
         return 0;
     }
+    cancelDeviceProbeLocked(devicePath);
     ALOGV("Remove device: %s not found, device may already have been removed.", devicePath);
     return -1;
 }
@@ -1393,6 +1507,181 @@ void EventHub::closeDeviceLocked(Device* device) {
     }
 }
 
+void EventHub::stopDeviceProbeThread() {
+    { // acquire lock
+        AutoMutex _l(mProbeLock);
+        mProbeThreadExiting = true;
+        mProbeCondition.broadcast();
+    } // release lock
+
+    sp<DeviceProbeThread> thread;
+    { // acquire lock
+        AutoMutex _l(mLock);
+        thread = mProbeThread;
+    } // release lock
+
+    if (thread != NULL) {
+        thread->requestExitAndWait();
+    }
+}
+
+void EventHub::requestDeviceProbeLocked(const char *devicePath) {
+    bool probeThreadStopped;
+    { // acquire lock
+        AutoMutex _l(mProbeLock);
+        probeThreadStopped = mProbeThreadExiting;
+    } // release lock
+    if (probeThreadStopped) {
+        openDeviceLocked(devicePath);
+        return;
+    }
+
+    if (mProbeThread == NULL) {
+        sp<DeviceProbeThread> thread = new DeviceProbeThread(this);
+        status_t result = thread->run("InputDeviceProbe", PRIORITY_URGENT_DISPLAY);
+        if (result) {
+            ALOGE("Could not start the input device probe thread, status=%d.  "
+                    "Probing %s synchronously.", result, devicePath);
+            openDeviceLocked(devicePath);
+            return;
+        }
+        mProbeThread = thread;
+    }
+
+    ProbeRequest request;
+    request.path.setTo(devicePath);
+    request.deviceId = mNextDeviceId++;
+    request.excludedDevices = mExcludedDevices;
+    request.requestTime = systemTime(SYSTEM_TIME_MONOTONIC);
+
+    AutoMutex _l(mProbeLock);
+    mProbeRequests.push(request);
+    mProbeCondition.signal();
+}
+
+void EventHub::cancelDeviceProbeLocked(const char *devicePath) {
+    Vector<Device*> cancelledDevices;
+
+    { // acquire lock
+        AutoMutex _l(mProbeLock);
+
+        for (size_t i = 0; i < mProbeRequests.size(); ) {
+            if (mProbeRequests.itemAt(i).path == devicePath) {
+                mProbeRequests.removeAt(i);
+            } else {
+                i += 1;
+            }
+        }
+
+        if (mProbingPath == devicePath) {
+            mProbingCancelled = true;
+        }
+
+        for (size_t i = 0; i < mProbedDevices.size(); ) {
+            Device* device = mProbedDevices.itemAt(i);
+            if (device->path == devicePath) {
+                cancelledDevices.push(device);
+                mProbedDevices.removeAt(i);
+            } else {
+                i += 1;
+            }
+        }
+    } // release lock
+
+    for (size_t i = 0; i < cancelledDevices.size(); i++) {
+        ALOGI("Device %s was removed while it was being probed.", devicePath);
+        delete cancelledDevices.itemAt(i);
+    }
+}
+
+void EventHub::cancelAllDeviceProbesLocked() {
+    Vector<Device*> cancelledDevices;
+
+    { // acquire lock
+        AutoMutex _l(mProbeLock);
+
+        mProbeRequests.clear();
+        if (!mProbingPath.isEmpty()) {
+            mProbingCancelled = true;
+        }
+        cancelledDevices = mProbedDevices;
+        mProbedDevices.clear();
+    } // release lock
+
+    for (size_t i = 0; i < cancelledDevices.size(); i++) {
+        delete cancelledDevices.itemAt(i);
+    }
+}
+
+bool EventHub::registerProbedDevicesLocked() {
+    Vector<Device*> probedDevices;
+
+    { // acquire lock
+        AutoMutex _l(mProbeLock);
+
+        if (mProbedDevices.isEmpty()) {
+            return false;
+        }
+        probedDevices = mProbedDevices;
+        mProbedDevices.clear();
+    } // release lock
+
+    for (size_t i = 0; i < probedDevices.size(); i++) {
+        registerDeviceLocked(probedDevices.itemAt(i));
+    }
+    return true;
+}
+
+bool EventHub::probeThreadLoop() {
+    ProbeRequest request;
+
+    { // acquire lock
+        AutoMutex _l(mProbeLock);
+
+        while (!mProbeThreadExiting && mProbeRequests.isEmpty()) {
+            mProbeCondition.wait(mProbeLock);
+        }
+        if (mProbeThreadExiting) {
+            return false;
+        }
+
+        request = mProbeRequests.itemAt(0);
+        mProbeRequests.removeAt(0);
+        mProbingPath = request.path;
+        mProbingCancelled = false;
+    } // release lock
+
+    Device* device = probeDevice(request.path, request.deviceId, request.excludedDevices);
+    nsecs_t latency = systemTime(SYSTEM_TIME_MONOTONIC) - request.requestTime;
+
+    bool published = false;
+    { // acquire lock
+        AutoMutex _l(mProbeLock);
+
+        mAsyncProbeCount += 1;
+        if (latency > mMaxProbeLatency) {
+            mMaxProbeLatency = latency;
+        }
+
+        if (device && !mProbingCancelled) {
+            mProbedDevices.push(device);
+            published = true;
+        }
+        mProbingPath.clear();
+        mProbingCancelled = false;
+    } // release lock
+
+    ALOGV("Probed device %s in %0.3fms.", request.path.string(), latency * 0.000001f);
+
+    if (published) {
+        wake();
+    } else if (device) {
+        ALOGI("Device %s was removed while it was being probed.", request.path.string());
+        delete device;
+    }
+    return true;
+}
+
 status_t EventHub::readNotifyLocked() {
     int res;
     char devname[PATH_MAX];
@@ -1422,7 +1711,7 @@ status_t EventHub::readNotifyLocked() {
         if(event->len) {
             strcpy(filename, event->name);
             if(event->mask & IN_CREATE) {
-                openDeviceLocked(devname);
+                requestDeviceProbeLocked(devname);
             } else {
                 ALOGI("Removing device '%s' due to inotify event\n", devname);
                 closeDeviceByPathLocked(devname);
@@ -1502,6 +1791,31 @@ void EventHub::dump(String8& dump) {
                     device->configurationFile.string());
             dump.appendFormat(INDENT3 "HaveKeyboardLayoutOverlay: %s\n",
                     toString(device->overlayKeyMap != NULL));
+            dump.appendFormat(INDENT3 "Reads: wakeups=%u, reads=%u, events=%llu, "
+                    "eventsPerWakeup=%0.1f, maxEventsPerWakeup=%u\n",
+                    device->wakeupCount, device->readCount,
+                    (unsigned long long) device->eventCount,
+                    device->wakeupCount ? float(device->eventCount) / device->wakeupCount : 0.0f,
+                    device->maxEventsPerWakeup);
+        }
+
+        { // acquire lock
+            AutoMutex _probeLock(mProbeLock);
+
+            dump.appendFormat(INDENT "AsyncDeviceProbes: completed=%u, pending=%d, "
+                    "maxLatency=%0.3fms\n",
+                    mAsyncProbeCount,
+                    int(mProbeRequests.size()) + (mProbingPath.isEmpty() ? 0 : 1),
+                    mMaxProbeLatency * 0.000001f);
+        } // release lock
+
+        if (mReadCoalescingBudget) {
+            dump.appendFormat(INDENT "ReadCoalescing: budget=%0.3fms, coalescedPolls=%u, "
+                    "coalescedEvents=%llu\n",
+                    mReadCoalescingBudget * 0.000001f, mCoalescedPollCount,
+                    (unsigned long long) mCoalescedEventCount);
+        } else {
+            dump.append(INDENT "ReadCoalescing: disabled\n");
         }
     } // release lock
 }
@@ -1513,4 +1827,15 @@ void EventHub::monitor() {
 }
 
 
+// --- EventHub::DeviceProbeThread ---
+
+EventHub::DeviceProbeThread::DeviceProbeThread(EventHub* eventHub) :
+        Thread(/*canCallJava*/ false), mEventHub(eventHub) {
+}
+
+bool EventHub::DeviceProbeThread::threadLoop() {
+    return mEventHub->probeThreadLoop();
+}
+
+
 }; // namespace android
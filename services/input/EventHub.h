@@ -299,7 +299,6 @@ public:
 protected:
     virtual ~EventHub();
 
-private:
     struct Device {
         Device* next;
 
@@ -329,6 +328,15 @@ private:
         bool ffEffectPlaying;
         int16_t ffEffectId; // initially -1
 
+        // Read statistics.  A wakeup is a call to getEvents that returned events
+        // from this device.
+        uint32_t wakeupCount;
+        uint32_t readCount;
+        uint64_t eventCount;
+        uint32_t maxEventsPerWakeup;
+        uint32_t lastWakeupSeq;
+        uint32_t eventsInLastWakeup;
+
         Device(int fd, int32_t id, const String8& path, const InputDeviceIdentifier& identifier);
         ~Device();
 
@@ -344,10 +352,54 @@ private:
         }
     };
 
+    /*
+     * Opens the input device at the given path, identifies it and loads its configuration
+     * and key maps.  Returns NULL if the device is excluded or is not something we handle.
+     *
+     * Hotplugged devices are probed on the device probe thread without holding the event
+     * hub lock, so this function must not touch any state other than the new device.
+     */
+    virtual Device* probeDevice(const String8& path, int32_t deviceId,
+            const Vector<String8>& excludedDevices);
+
+    /*
+     * Stops the device probe thread and waits for it to exit.  Devices are probed
+     * synchronously afterwards.
+     *
+     * The probe thread calls probeDevice(), so subclasses that override it must call this
+     * from their destructor, before their own members are destroyed.
+     */
+    void stopDeviceProbeThread();
+
+private:
+    class DeviceProbeThread : public Thread {
+    public:
+        DeviceProbeThread(EventHub* eventHub);
+
+    private:
+        EventHub* mEventHub;
+
+        virtual bool threadLoop();
+    };
+
+    struct ProbeRequest {
+        String8 path;
+        int32_t deviceId;
+        Vector<String8> excludedDevices;
+        nsecs_t requestTime;
+    };
+
     status_t openDeviceLocked(const char *devicePath);
+    status_t registerDeviceLocked(Device* device);
     void createVirtualKeyboardLocked();
     void addDeviceLocked(Device* device);
 
+    void requestDeviceProbeLocked(const char *devicePath);
+    void cancelDeviceProbeLocked(const char *devicePath);
+    void cancelAllDeviceProbesLocked();
+    bool registerProbedDevicesLocked();
+    bool probeThreadLoop();
+
     status_t closeDeviceByPathLocked(const char *devicePath);
     void closeDeviceLocked(Device* device);
     void closeAllDevicesLocked();
@@ -359,13 +411,16 @@ private:
     Device* getDeviceLocked(int32_t deviceId) const;
     Device* getDeviceByPathLocked(const char* devicePath) const;
 
-    bool hasKeycodeLocked(Device* device, int keycode) const;
+    static bool hasKeycode(Device* device, int keycode);
 
-    void loadConfigurationLocked(Device* device);
-    status_t loadVirtualKeyMapLocked(Device* device);
-    status_t loadKeyMapLocked(Device* device);
+    static void loadConfiguration(Device* device);
+    static status_t loadVirtualKeyMap(Device* device);
+    static status_t loadKeyMap(Device* device);
 
-    bool isExternalDeviceLocked(Device* device);
+    static bool isExternalDevice(Device* device);
+
+    void recordReadLocked(Device* device, size_t count);
+    int getReadCoalescingTimeoutLocked(nsecs_t firstEventTime) const;
 
     // Protect all internal state.
     mutable Mutex mLock;
@@ -411,6 +466,33 @@ private:
     size_t mPendingEventCount;
     size_t mPendingEventIndex;
     bool mPendingINotify;
+
+    // Read coalescing.  When the budget is non-zero, getEvents keeps collecting events
+    // from devices that become ready after the first read until the budget has elapsed
+    // since the oldest pending event was generated, so that bursts from several devices
+    // are returned to the reader together without delaying any event by more than the
+    // budget.
+    nsecs_t mReadCoalescingBudget;
+    uint32_t mWakeupSeq;
+    uint32_t mWakeupDeviceCount;
+    uint32_t mLastWakeupDeviceCount;
+    uint32_t mCoalescedPollCount;
+    uint64_t mCoalescedEventCount;
+
+    // Hotplugged devices are probed on a separate thread so that reading events from
+    // the other devices is not held up while a new device is opened and configured.
+    // The probe state is protected by mProbeLock, which is always acquired after mLock.
+    // Probed devices are registered by getEvents after the probe thread wakes it up.
+    Mutex mProbeLock;
+    Condition mProbeCondition;
+    sp<DeviceProbeThread> mProbeThread;
+    Vector<ProbeRequest> mProbeRequests;
+    String8 mProbingPath; // path of the device being probed, empty if none
+    bool mProbingCancelled;
+    Vector<Device*> mProbedDevices;
+    bool mProbeThreadExiting;
+    uint32_t mAsyncProbeCount;
+    nsecs_t mMaxProbeLatency;
 };
 
 }; // namespace android
@@ -53,6 +53,8 @@
 #include <unistd.h>
 #include <errno.h>
 #include <limits.h>
+#include <math.h>
+#include <string.h>
 #include <time.h>
 
 #define INDENT "  "
@@ -196,6 +198,7 @@ InputDispatcher::InputDispatcher(const sp<InputDispatcherPolicyInterface>& polic
     mPendingEvent(NULL), mAppSwitchSawKeyDown(false), mAppSwitchDueTime(LONG_LONG_MAX),
     mNextUnblockedEvent(NULL),
     mDispatchEnabled(false), mDispatchFrozen(false), mInputFilterEnabled(false),
+    mInputFilterGeneration(0),
     mInputTargetWaitCause(INPUT_TARGET_WAIT_CAUSE_NONE) {
     mLooper = new Looper(false);
 
@@ -224,10 +227,17 @@ void InputDispatcher::dispatchOnce() {
         AutoMutex _l(mLock);
         mDispatcherIsAliveCondition.broadcast();
 
-        // Run a dispatch loop if there are no pending commands.
-        // The dispatch loop might enqueue commands to run afterwards.
-        if (!haveCommandsLocked()) {
-            dispatchOnceInnerLocked(&nextWakeupTime);
+        { // commands may release the lock so they are not timed
+            AutoLockHoldTimer _t(mDispatchLockHoldTimes);
+
+            // Pick up the events that were posted since the last iteration.
+            transferIncomingEventsLocked();
+
+            // Run a dispatch loop if there are no pending commands.
+            // The dispatch loop might enqueue commands to run afterwards.
+            if (!haveCommandsLocked()) {
+                dispatchOnceInnerLocked(&nextWakeupTime);
+            }
         }
 
         // Run all pending commands if there are any.
@@ -395,8 +405,38 @@ void InputDispatcher::dispatchOnceInnerLocked(nsecs_t* nextWakeupTime) {
     }
 }
 
-bool InputDispatcher::enqueueInboundEventLocked(EventEntry* entry) {
-    bool needWake = mInboundQueue.isEmpty();
+void InputDispatcher::postInboundEvents(EventEntry* entries) {
+    nsecs_t enqueueTime = now();
+    for (EventEntry* entry = entries; entry; entry = entry->next) {
+        entry->enqueueTime = enqueueTime;
+    }
+
+    // Only the first event posted since the dispatch loop last looked needs to wake it.
+    if (mIncomingQueue.post(entries)) {
+        mLooper->wake();
+    }
+}
+
+void InputDispatcher::transferIncomingEventsLocked() {
+    EventEntry* entry = mIncomingQueue.takeAll();
+    while (entry) {
+        EventEntry* nextEntry = entry->next;
+        if (entry->inputFilterGeneration >= 0
+                && entry->inputFilterGeneration != mInputFilterGeneration) {
+            // The input filter was enabled or disabled after the event was checked
+            // against it, and everything queued before that change has been dropped.
+#if DEBUG_INBOUND_EVENT_DETAILS
+            ALOGD("Dropped event because the input filter changed while it was posted.");
+#endif
+            releaseInboundEventLocked(entry);
+        } else {
+            enqueueInboundEventLocked(entry);
+        }
+        entry = nextEntry;
+    }
+}
+
+void InputDispatcher::enqueueInboundEventLocked(EventEntry* entry) {
     mInboundQueue.enqueueAtTail(entry);
     traceInboundQueueLengthLocked();
 
@@ -416,7 +456,6 @@ bool InputDispatcher::enqueueInboundEventLocked(EventEntry* entry) {
 #endif
                     mAppSwitchDueTime = keyEntry->eventTime + APP_SWITCH_TIMEOUT;
                     mAppSwitchSawKeyDown = false;
-                    needWake = true;
                 }
             }
         }
@@ -445,14 +484,11 @@ bool InputDispatcher::enqueueInboundEventLocked(EventEntry* entry) {
                 // User touched a different application than the one we are waiting on.
                 // Flag the event, and start pruning the input queue.
                 mNextUnblockedEvent = motionEntry;
-                needWake = true;
             }
         }
         break;
     }
     }
-
-    return needWake;
 }
 
 sp<InputWindowHandle> InputDispatcher::findTouchedWindowAtLocked(int32_t displayId,
@@ -596,6 +632,8 @@ InputDispatcher::CommandEntry* InputDispatcher::postCommandLocked(Command comman
 }
 
 void InputDispatcher::drainInboundQueueLocked() {
+    // Events that were posted but not yet picked up are dropped along with the rest.
+    transferIncomingEventsLocked();
     while (! mInboundQueue.isEmpty()) {
         EventEntry* entry = mInboundQueue.dequeueAtHead();
         releaseInboundEventLocked(entry);
@@ -1910,6 +1948,13 @@ void InputDispatcher::enqueueDispatchEntryLocked(
             delete dispatchEntry;
             return; // skip the inconsistent event
         }
+
+        // Fold the move into the one the window has not received yet, if any.
+        if (mConfig.motionCoalescingEnabled
+                && coalesceMotionDispatchEntryLocked(connection, dispatchEntry)) {
+            delete dispatchEntry;
+            return;
+        }
         break;
     }
     }
@@ -1924,6 +1969,116 @@ void InputDispatcher::enqueueDispatchEntryLocked(
     traceOutboundQueueLengthLocked(connection);
 }
 
+bool InputDispatcher::coalesceMotionDispatchEntryLocked(const sp<Connection>& connection,
+        DispatchEntry* dispatchEntry) {
+    // Only entries that have not been published yet can be coalesced.  A window only
+    // accumulates those while it is not keeping up and the socket is full.
+    DispatchEntry* pendingEntry = connection->outboundQueue.tail;
+    if (!pendingEntry
+            || pendingEntry->eventEntry->type != EventEntry::TYPE_MOTION
+            || pendingEntry->publishedHistoryCount
+            || pendingEntry->resolvedAction != dispatchEntry->resolvedAction
+            || pendingEntry->resolvedFlags != dispatchEntry->resolvedFlags
+            || pendingEntry->targetFlags != dispatchEntry->targetFlags
+            || pendingEntry->xOffset != dispatchEntry->xOffset
+            || pendingEntry->yOffset != dispatchEntry->yOffset
+            || pendingEntry->scaleFactor != dispatchEntry->scaleFactor) {
+        return false;
+    }
+    if (dispatchEntry->resolvedAction != AMOTION_EVENT_ACTION_MOVE
+            && dispatchEntry->resolvedAction != AMOTION_EVENT_ACTION_HOVER_MOVE) {
+        return false;
+    }
+
+    MotionEntry* pendingMotionEntry = static_cast<MotionEntry*>(pendingEntry->eventEntry);
+    MotionEntry* motionEntry = static_cast<MotionEntry*>(dispatchEntry->eventEntry);
+
+    // Injected events are never coalesced because the injector waits for each of them.
+    if (pendingMotionEntry->injectionState || motionEntry->injectionState
+            || pendingMotionEntry->deviceId != motionEntry->deviceId
+            || pendingMotionEntry->source != motionEntry->source
+            || pendingMotionEntry->displayId != motionEntry->displayId
+            || pendingMotionEntry->metaState != motionEntry->metaState
+            || pendingMotionEntry->buttonState != motionEntry->buttonState
+            || pendingMotionEntry->edgeFlags != motionEntry->edgeFlags
+            || pendingMotionEntry->xPrecision != motionEntry->xPrecision
+            || pendingMotionEntry->yPrecision != motionEntry->yPrecision
+            || pendingMotionEntry->downTime != motionEntry->downTime
+            || pendingMotionEntry->pointerCount != motionEntry->pointerCount
+            || pendingMotionEntry->eventTime > motionEntry->eventTime) {
+        return false;
+    }
+    for (uint32_t i = 0; i < motionEntry->pointerCount; i++) {
+        if (pendingMotionEntry->pointerProperties[i] != motionEntry->pointerProperties[i]) {
+            return false;
+        }
+    }
+
+#if DEBUG_DISPATCH_CYCLE
+    ALOGD("channel '%s' ~ coalesceMotionDispatchEntry: coalesced motion sample into "
+            "pending entry, history=%d", connection->getInputChannelName(),
+            pendingEntry->historyEntries.size() + 1);
+#endif
+
+    // The pending entry takes over the newer sample and keeps its own as history.
+    // Motion entries may be shared with other connections so they are never modified.
+    pendingEntry->historyEntries.push(pendingMotionEntry); // takes over the reference
+    pendingEntry->eventEntry = motionEntry;
+    motionEntry->refCount += 1;
+    connection->coalescedMotionCount += 1;
+
+    while (pendingEntry->historyEntries.size() > mConfig.motionCoalescingMaxHistory) {
+        pendingEntry->historyEntries.itemAt(0)->release();
+        pendingEntry->historyEntries.removeAt(0);
+        connection->droppedMotionCount += 1;
+    }
+    return true;
+}
+
+status_t InputDispatcher::publishMotionEventLocked(const sp<Connection>& connection,
+        DispatchEntry* dispatchEntry, MotionEntry* motionEntry, uint32_t seq) {
+    PointerCoords scaledCoords[MAX_POINTERS];
+    const PointerCoords* usingCoords = motionEntry->pointerCoords;
+
+    // Set the X and Y offset depending on the input source.
+    float xOffset, yOffset, scaleFactor;
+    if ((motionEntry->source & AINPUT_SOURCE_CLASS_POINTER)
+            && !(dispatchEntry->targetFlags & InputTarget::FLAG_ZERO_COORDS)) {
+        scaleFactor = dispatchEntry->scaleFactor;
+        xOffset = dispatchEntry->xOffset * scaleFactor;
+        yOffset = dispatchEntry->yOffset * scaleFactor;
+        if (scaleFactor != 1.0f) {
+            for (size_t i = 0; i < motionEntry->pointerCount; i++) {
+                scaledCoords[i] = motionEntry->pointerCoords[i];
+                scaledCoords[i].scale(scaleFactor);
+            }
+            usingCoords = scaledCoords;
+        }
+    } else {
+        xOffset = 0.0f;
+        yOffset = 0.0f;
+        scaleFactor = 1.0f;
+
+        // We don't want the dispatch target to know.
+        if (dispatchEntry->targetFlags & InputTarget::FLAG_ZERO_COORDS) {
+            for (size_t i = 0; i < motionEntry->pointerCount; i++) {
+                scaledCoords[i].clear();
+            }
+            usingCoords = scaledCoords;
+        }
+    }
+
+    return connection->inputPublisher.publishMotionEvent(seq,
+            motionEntry->deviceId, motionEntry->source,
+            dispatchEntry->resolvedAction, dispatchEntry->resolvedFlags,
+            motionEntry->edgeFlags, motionEntry->metaState, motionEntry->buttonState,
+            xOffset, yOffset,
+            motionEntry->xPrecision, motionEntry->yPrecision,
+            motionEntry->downTime, motionEntry->eventTime,
+            motionEntry->pointerCount, motionEntry->pointerProperties,
+            usingCoords);
+}
+
 void InputDispatcher::startDispatchCycleLocked(nsecs_t currentTime,
         const sp<Connection>& connection) {
 #if DEBUG_DISPATCH_CYCLE
@@ -1956,47 +2111,25 @@ void InputDispatcher::startDispatchCycleLocked(nsecs_t currentTime,
         case EventEntry::TYPE_MOTION: {
             MotionEntry* motionEntry = static_cast<MotionEntry*>(eventEntry);
 
-            PointerCoords scaledCoords[MAX_POINTERS];
-            const PointerCoords* usingCoords = motionEntry->pointerCoords;
-
-            // Set the X and Y offset depending on the input source.
-            float xOffset, yOffset, scaleFactor;
-            if ((motionEntry->source & AINPUT_SOURCE_CLASS_POINTER)
-                    && !(dispatchEntry->targetFlags & InputTarget::FLAG_ZERO_COORDS)) {
-                scaleFactor = dispatchEntry->scaleFactor;
-                xOffset = dispatchEntry->xOffset * scaleFactor;
-                yOffset = dispatchEntry->yOffset * scaleFactor;
-                if (scaleFactor != 1.0f) {
-                    for (size_t i = 0; i < motionEntry->pointerCount; i++) {
-                        scaledCoords[i] = motionEntry->pointerCoords[i];
-                        scaledCoords[i].scale(scaleFactor);
-                    }
-                    usingCoords = scaledCoords;
-                }
-            } else {
-                xOffset = 0.0f;
-                yOffset = 0.0f;
-                scaleFactor = 1.0f;
-
-                // We don't want the dispatch target to know.
-                if (dispatchEntry->targetFlags & InputTarget::FLAG_ZERO_COORDS) {
-                    for (size_t i = 0; i < motionEntry->pointerCount; i++) {
-                        scaledCoords[i].clear();
-                    }
-                    usingCoords = scaledCoords;
+            // Publish the samples that were coalesced into this entry first so that the
+            // consumer can batch them into the history of the newest sample.
+            status = OK;
+            while (dispatchEntry->publishedHistoryCount < dispatchEntry->historyEntries.size()) {
+                status = publishMotionEventLocked(connection, dispatchEntry,
+                        dispatchEntry->historyEntries.itemAt(
+                                dispatchEntry->publishedHistoryCount),
+                        DispatchEntry::nextSeq());
+                if (status) {
+                    break;
                 }
+                dispatchEntry->publishedHistoryCount += 1;
             }
 
             // Publish the motion event.
-            status = connection->inputPublisher.publishMotionEvent(dispatchEntry->seq,
-                    motionEntry->deviceId, motionEntry->source,
-                    dispatchEntry->resolvedAction, dispatchEntry->resolvedFlags,
-                    motionEntry->edgeFlags, motionEntry->metaState, motionEntry->buttonState,
-                    xOffset, yOffset,
-                    motionEntry->xPrecision, motionEntry->yPrecision,
-                    motionEntry->downTime, motionEntry->eventTime,
-                    motionEntry->pointerCount, motionEntry->pointerProperties,
-                    usingCoords);
+            if (!status) {
+                status = publishMotionEventLocked(connection, dispatchEntry, motionEntry,
+                        dispatchEntry->seq);
+            }
             break;
         }
 
@@ -2008,7 +2141,8 @@ void InputDispatcher::startDispatchCycleLocked(nsecs_t currentTime,
         // Check the result.
         if (status) {
             if (status == WOULD_BLOCK) {
-                if (connection->waitQueue.isEmpty()) {
+                // The pipe may legitimately be full of the history of this entry.
+                if (connection->waitQueue.isEmpty() && !dispatchEntry->publishedHistoryCount) {
                     ALOGE("channel '%s' ~ Could not publish event because the pipe is full. "
                             "This is unexpected because the wait queue is empty, so the pipe "
                             "should be empty and we shouldn't have any problems writing an "
@@ -2316,10 +2450,13 @@ InputDispatcher::splitMotionEvent(const MotionEntry* originalMotionEntry, BitSet
             originalMotionEntry->downTime,
             originalMotionEntry->displayId,
             splitPointerCount, splitPointerProperties, splitPointerCoords);
+    splitMotionEntry->readTime = originalMotionEntry->readTime;
+    splitMotionEntry->cookTime = originalMotionEntry->cookTime;
+    splitMotionEntry->enqueueTime = originalMotionEntry->enqueueTime;
 
     if (originalMotionEntry->injectionState) {
         splitMotionEntry->injectionState = originalMotionEntry->injectionState;
-        splitMotionEntry->injectionState->refCount += 1;
+        android_atomic_inc(&splitMotionEntry->injectionState->refCount);
     }
 
     return splitMotionEntry;
@@ -2330,17 +2467,8 @@ void InputDispatcher::notifyConfigurationChanged(const NotifyConfigurationChange
     ALOGD("notifyConfigurationChanged - eventTime=%lld", args->eventTime);
 #endif
 
-    bool needWake;
-    { // acquire lock
-        AutoMutex _l(mLock);
-
-        ConfigurationChangedEntry* newEntry = new ConfigurationChangedEntry(args->eventTime);
-        needWake = enqueueInboundEventLocked(newEntry);
-    } // release lock
-
-    if (needWake) {
-        mLooper->wake();
-    }
+    ConfigurationChangedEntry* newEntry = new ConfigurationChangedEntry(args->eventTime);
+    postInboundEvents(newEntry);
 }
 
 void InputDispatcher::notifyKey(const NotifyKeyArgs* args) {
@@ -2391,38 +2519,27 @@ void InputDispatcher::notifyKey(const NotifyKeyArgs* args) {
         flags |= AKEY_EVENT_FLAG_WOKE_HERE;
     }
 
-    bool needWake;
-    { // acquire lock
-        mLock.lock();
-
-        if (shouldSendKeyToInputFilterLocked(args)) {
-            mLock.unlock();
-
-            policyFlags |= POLICY_FLAG_FILTERED;
-            if (!mPolicy->filterInputEvent(&event, policyFlags)) {
-                return; // event was consumed by the filter
-            }
-
-            mLock.lock();
+    int32_t inputFilterGeneration = android_atomic_acquire_load(&mInputFilterGeneration);
+    if (shouldSendKeyToInputFilter(args)) {
+        policyFlags |= POLICY_FLAG_FILTERED;
+        if (!mPolicy->filterInputEvent(&event, policyFlags)) {
+            return; // event was consumed by the filter
         }
-
-        int32_t repeatCount = 0;
-        KeyEntry* newEntry = new KeyEntry(args->eventTime,
-                args->deviceId, args->source, policyFlags,
-                args->action, flags, args->keyCode, args->scanCode,
-                metaState, repeatCount, args->downTime);
-
-        needWake = enqueueInboundEventLocked(newEntry);
-        mLock.unlock();
-    } // release lock
-
-    if (needWake) {
-        mLooper->wake();
     }
+
+    int32_t repeatCount = 0;
+    KeyEntry* newEntry = new KeyEntry(args->eventTime,
+            args->deviceId, args->source, policyFlags,
+            args->action, flags, args->keyCode, args->scanCode,
+            metaState, repeatCount, args->downTime);
+    newEntry->readTime = args->readTime;
+    newEntry->cookTime = args->cookTime;
+    newEntry->inputFilterGeneration = inputFilterGeneration;
+    postInboundEvents(newEntry);
 }
 
-bool InputDispatcher::shouldSendKeyToInputFilterLocked(const NotifyKeyArgs* args) {
-    return mInputFilterEnabled;
+bool InputDispatcher::shouldSendKeyToInputFilter(const NotifyKeyArgs* args) {
+    return android_atomic_acquire_load(&mInputFilterEnabled);
 }
 
 void InputDispatcher::notifyMotion(const NotifyMotionArgs* args) {
@@ -2459,48 +2576,37 @@ void InputDispatcher::notifyMotion(const NotifyMotionArgs* args) {
     policyFlags |= POLICY_FLAG_TRUSTED;
     mPolicy->interceptMotionBeforeQueueing(args->eventTime, /*byref*/ policyFlags);
 
-    bool needWake;
-    { // acquire lock
-        mLock.lock();
-
-        if (shouldSendMotionToInputFilterLocked(args)) {
-            mLock.unlock();
-
-            MotionEvent event;
-            event.initialize(args->deviceId, args->source, args->action, args->flags,
-                    args->edgeFlags, args->metaState, args->buttonState, 0, 0,
-                    args->xPrecision, args->yPrecision,
-                    args->downTime, args->eventTime,
-                    args->pointerCount, args->pointerProperties, args->pointerCoords);
-
-            policyFlags |= POLICY_FLAG_FILTERED;
-            if (!mPolicy->filterInputEvent(&event, policyFlags)) {
-                return; // event was consumed by the filter
-            }
-
-            mLock.lock();
-        }
-
-        // Just enqueue a new motion event.
-        MotionEntry* newEntry = new MotionEntry(args->eventTime,
-                args->deviceId, args->source, policyFlags,
-                args->action, args->flags, args->metaState, args->buttonState,
-                args->edgeFlags, args->xPrecision, args->yPrecision, args->downTime,
-                args->displayId,
+    int32_t inputFilterGeneration = android_atomic_acquire_load(&mInputFilterGeneration);
+    if (shouldSendMotionToInputFilter(args)) {
+        MotionEvent event;
+        event.initialize(args->deviceId, args->source, args->action, args->flags,
+                args->edgeFlags, args->metaState, args->buttonState, 0, 0,
+                args->xPrecision, args->yPrecision,
+                args->downTime, args->eventTime,
                 args->pointerCount, args->pointerProperties, args->pointerCoords);
 
-        needWake = enqueueInboundEventLocked(newEntry);
-        mLock.unlock();
-    } // release lock
-
-    if (needWake) {
-        mLooper->wake();
+        policyFlags |= POLICY_FLAG_FILTERED;
+        if (!mPolicy->filterInputEvent(&event, policyFlags)) {
+            return; // event was consumed by the filter
+        }
     }
+
+    // Just enqueue a new motion event.
+    MotionEntry* newEntry = new MotionEntry(args->eventTime,
+            args->deviceId, args->source, policyFlags,
+            args->action, args->flags, args->metaState, args->buttonState,
+            args->edgeFlags, args->xPrecision, args->yPrecision, args->downTime,
+            args->displayId,
+            args->pointerCount, args->pointerProperties, args->pointerCoords);
+    newEntry->readTime = args->readTime;
+    newEntry->cookTime = args->cookTime;
+    newEntry->inputFilterGeneration = inputFilterGeneration;
+    postInboundEvents(newEntry);
 }
 
-bool InputDispatcher::shouldSendMotionToInputFilterLocked(const NotifyMotionArgs* args) {
+bool InputDispatcher::shouldSendMotionToInputFilter(const NotifyMotionArgs* args) {
     // TODO: support sending secondary display events to input filter
-    return mInputFilterEnabled && isMainDisplay(args->displayId);
+    return android_atomic_acquire_load(&mInputFilterEnabled) && isMainDisplay(args->displayId);
 }
 
 void InputDispatcher::notifySwitch(const NotifySwitchArgs* args) {
@@ -2522,17 +2628,8 @@ void InputDispatcher::notifyDeviceReset(const NotifyDeviceResetArgs* args) {
             args->eventTime, args->deviceId);
 #endif
 
-    bool needWake;
-    { // acquire lock
-        AutoMutex _l(mLock);
-
-        DeviceResetEntry* newEntry = new DeviceResetEntry(args->eventTime, args->deviceId);
-        needWake = enqueueInboundEventLocked(newEntry);
-    } // release lock
-
-    if (needWake) {
-        mLooper->wake();
-    }
+    DeviceResetEntry* newEntry = new DeviceResetEntry(args->eventTime, args->deviceId);
+    postInboundEvents(newEntry);
 }
 
 int32_t InputDispatcher::injectInputEvent(const InputEvent* event,
@@ -2574,7 +2671,6 @@ int32_t InputDispatcher::injectInputEvent(const InputEvent* event,
             flags |= AKEY_EVENT_FLAG_WOKE_HERE;
         }
 
-        mLock.lock();
         firstInjectedEntry = new KeyEntry(keyEvent->getEventTime(),
                 keyEvent->getDeviceId(), keyEvent->getSource(),
                 policyFlags, action, flags,
@@ -2599,7 +2695,6 @@ int32_t InputDispatcher::injectInputEvent(const InputEvent* event,
             mPolicy->interceptMotionBeforeQueueing(eventTime, /*byref*/ policyFlags);
         }
 
-        mLock.lock();
         const nsecs_t* sampleEventTimes = motionEvent->getSampleEventTimes();
         const PointerCoords* samplePointerCoords = motionEvent->getSamplePointerCoords();
         firstInjectedEntry = new MotionEntry(*sampleEventTimes,
@@ -2638,25 +2733,14 @@ int32_t InputDispatcher::injectInputEvent(const InputEvent* event,
         injectionState->injectionIsAsync = true;
     }
 
-    injectionState->refCount += 1;
+    android_atomic_inc(&injectionState->refCount);
     lastInjectedEntry->injectionState = injectionState;
 
-    bool needWake = false;
-    for (EventEntry* entry = firstInjectedEntry; entry != NULL; ) {
-        EventEntry* nextEntry = entry->next;
-        needWake |= enqueueInboundEventLocked(entry);
-        entry = nextEntry;
-    }
-
-    mLock.unlock();
-
-    if (needWake) {
-        mLooper->wake();
-    }
+    postInboundEvents(firstInjectedEntry);
 
     int32_t injectionResult;
     { // acquire lock
-        AutoMutex _l(mLock);
+        AutoMutex _l(mInjectionLock);
 
         if (syncMode == INPUT_EVENT_INJECTION_SYNC_NONE) {
             injectionResult = INPUT_EVENT_INJECTION_SUCCEEDED;
@@ -2677,7 +2761,8 @@ int32_t InputDispatcher::injectInputEvent(const InputEvent* event,
                     break;
                 }
 
-                mInjectionResultAvailableCondition.waitRelative(mLock, remainingTimeout);
+                mInjectionResultAvailableCondition.waitRelative(mInjectionLock,
+                        remainingTimeout);
             }
 
             if (injectionResult == INPUT_EVENT_INJECTION_SUCCEEDED
@@ -2697,7 +2782,8 @@ int32_t InputDispatcher::injectInputEvent(const InputEvent* event,
                         break;
                     }
 
-                    mInjectionSyncFinishedCondition.waitRelative(mLock, remainingTimeout);
+                    mInjectionSyncFinishedCondition.waitRelative(mInjectionLock,
+                            remainingTimeout);
                 }
             }
         }
@@ -2747,6 +2833,7 @@ void InputDispatcher::setInjectionResultLocked(EventEntry* entry, int32_t inject
             }
         }
 
+        AutoMutex _l(mInjectionLock);
         injectionState->injectionResult = injectionResult;
         mInjectionResultAvailableCondition.broadcast();
     }
@@ -2755,6 +2842,7 @@ void InputDispatcher::setInjectionResultLocked(EventEntry* entry, int32_t inject
 void InputDispatcher::incrementPendingForegroundDispatchesLocked(EventEntry* entry) {
     InjectionState* injectionState = entry->injectionState;
     if (injectionState) {
+        AutoMutex _l(mInjectionLock);
         injectionState->pendingForegroundDispatches += 1;
     }
 }
@@ -2762,6 +2850,7 @@ void InputDispatcher::incrementPendingForegroundDispatchesLocked(EventEntry* ent
 void InputDispatcher::decrementPendingForegroundDispatchesLocked(EventEntry* entry) {
     InjectionState* injectionState = entry->injectionState;
     if (injectionState) {
+        AutoMutex _l(mInjectionLock);
         injectionState->pendingForegroundDispatches -= 1;
 
         if (injectionState->pendingForegroundDispatches == 0) {
@@ -2772,11 +2861,10 @@ void InputDispatcher::decrementPendingForegroundDispatchesLocked(EventEntry* ent
 
 sp<InputWindowHandle> InputDispatcher::getWindowHandleLocked(
         const sp<InputChannel>& inputChannel) const {
-    size_t numWindows = mWindowHandles.size();
-    for (size_t i = 0; i < numWindows; i++) {
-        const sp<InputWindowHandle>& windowHandle = mWindowHandles.itemAt(i);
-        if (windowHandle->getInputChannel() == inputChannel) {
-            return windowHandle;
+    if (inputChannel != NULL) {
+        ssize_t index = mWindowHandlesByFd.indexOfKey(inputChannel->getFd());
+        if (index >= 0) {
+            return mWindowHandlesByFd.valueAt(index).windowHandle;
         }
     }
     return NULL;
@@ -2784,13 +2872,52 @@ sp<InputWindowHandle> InputDispatcher::getWindowHandleLocked(
 
 bool InputDispatcher::hasWindowHandleLocked(
         const sp<InputWindowHandle>& windowHandle) const {
+    return getWindowHandleIndexByFdLocked(windowHandle) >= 0;
+}
+
+ssize_t InputDispatcher::getWindowHandleIndexByFdLocked(
+        const sp<InputWindowHandle>& windowHandle) const {
+    sp<InputChannel> inputChannel = windowHandle->getInputChannel();
+    if (inputChannel != NULL) {
+        ssize_t index = mWindowHandlesByFd.indexOfKey(inputChannel->getFd());
+        if (index >= 0 && mWindowHandlesByFd.valueAt(index).windowHandle == windowHandle) {
+            return index;
+        }
+    }
+    return -1;
+}
+
+void InputDispatcher::addWindowHandleLocked(const sp<InputWindowHandle>& windowHandle,
+        uint32_t generation) {
+    // Insert the window in front of the first window with a lower layer.
+    int32_t layer = windowHandle->getInfo()->layer;
+    size_t numWindows = mWindowHandles.size();
+    size_t insertionIndex = 0;
+    while (insertionIndex < numWindows
+            && mWindowHandles.itemAt(insertionIndex)->getInfo()->layer >= layer) {
+        insertionIndex += 1;
+    }
+    mWindowHandles.insertAt(windowHandle, insertionIndex);
+
+    IndexedWindowHandle indexedWindowHandle;
+    indexedWindowHandle.windowHandle = windowHandle;
+    indexedWindowHandle.generation = generation;
+    mWindowHandlesByFd.add(windowHandle->getInputChannel()->getFd(), indexedWindowHandle);
+}
+
+void InputDispatcher::removeWindowHandleLocked(const sp<InputWindowHandle>& windowHandle) {
     size_t numWindows = mWindowHandles.size();
     for (size_t i = 0; i < numWindows; i++) {
         if (mWindowHandles.itemAt(i) == windowHandle) {
-            return true;
+            mWindowHandles.removeAt(i);
+            break;
         }
     }
-    return false;
+
+    ssize_t index = getWindowHandleIndexByFdLocked(windowHandle);
+    if (index >= 0) {
+        mWindowHandlesByFd.removeItemsAt(index);
+    }
 }
 
 void InputDispatcher::setInputWindows(const Vector<sp<InputWindowHandle> >& inputWindowHandles) {
@@ -2799,89 +2926,167 @@ void InputDispatcher::setInputWindows(const Vector<sp<InputWindowHandle> >& inpu
 #endif
     { // acquire lock
         AutoMutex _l(mLock);
+        AutoLockHoldTimer _t(mWindowUpdateLockHoldTimes);
 
         Vector<sp<InputWindowHandle> > oldWindowHandles = mWindowHandles;
         mWindowHandles = inputWindowHandles;
+        mWindowHandlesByFd.clear();
 
-        sp<InputWindowHandle> newFocusedWindowHandle;
-        bool foundHoveredWindow = false;
         for (size_t i = 0; i < mWindowHandles.size(); i++) {
             const sp<InputWindowHandle>& windowHandle = mWindowHandles.itemAt(i);
             if (!windowHandle->updateInfo() || windowHandle->getInputChannel() == NULL) {
                 mWindowHandles.removeAt(i--);
                 continue;
             }
-            if (windowHandle->getInfo()->hasFocus) {
-                newFocusedWindowHandle = windowHandle;
-            }
-            if (windowHandle == mLastHoverWindowHandle) {
-                foundHoveredWindow = true;
+
+            int fd = windowHandle->getInputChannel()->getFd();
+            if (mWindowHandlesByFd.indexOfKey(fd) >= 0) {
+                ALOGW("Ignoring window '%s' because its input channel is already used by "
+                        "another window.", windowHandle->getName().string());
+                mWindowHandles.removeAt(i--);
+                continue;
             }
-        }
 
-        if (!foundHoveredWindow) {
-            mLastHoverWindowHandle = NULL;
+            IndexedWindowHandle indexedWindowHandle;
+            indexedWindowHandle.windowHandle = windowHandle;
+            indexedWindowHandle.generation = 0;
+            mWindowHandlesByFd.add(fd, indexedWindowHandle);
         }
 
-        if (mFocusedWindowHandle != newFocusedWindowHandle) {
-            if (mFocusedWindowHandle != NULL) {
+        onInputWindowsChangedLocked(oldWindowHandles);
+    } // release lock
+
+    // Wake up poll loop since it may need to make new input dispatching choices.
+    mLooper->wake();
+}
+
+void InputDispatcher::updateInputWindows(const Vector<InputWindowUpdate>& updates) {
 #if DEBUG_FOCUS
-                ALOGD("Focus left window: %s",
-                        mFocusedWindowHandle->getName().string());
+    ALOGD("updateInputWindows: %d updates", updates.size());
 #endif
-                sp<InputChannel> focusedInputChannel = mFocusedWindowHandle->getInputChannel();
-                if (focusedInputChannel != NULL) {
-                    CancelationOptions options(CancelationOptions::CANCEL_NON_POINTER_EVENTS,
-                            "focus left window");
-                    synthesizeCancelationEventsForInputChannelLocked(
-                            focusedInputChannel, options);
+    { // acquire lock
+        AutoMutex _l(mLock);
+        AutoLockHoldTimer _t(mWindowUpdateLockHoldTimes);
+
+        Vector<sp<InputWindowHandle> > removedWindowHandles;
+        for (size_t i = 0; i < updates.size(); i++) {
+            const InputWindowUpdate& update = updates.itemAt(i);
+            const sp<InputWindowHandle>& windowHandle = update.windowHandle;
+            if (windowHandle == NULL) {
+                continue;
+            }
+
+            ssize_t index = getWindowHandleIndexByFdLocked(windowHandle);
+            if (update.action == InputWindowUpdate::ACTION_REMOVE) {
+                if (index >= 0) {
+                    removeWindowHandleLocked(windowHandle);
+                    removedWindowHandles.push(windowHandle);
                 }
+                continue;
             }
-            if (newFocusedWindowHandle != NULL) {
-#if DEBUG_FOCUS
-                ALOGD("Focus entered window: %s",
-                        newFocusedWindowHandle->getName().string());
-#endif
+
+            if (index >= 0) {
+                if (update.generation
+                        && mWindowHandlesByFd.valueAt(index).generation == update.generation) {
+                    continue; // unchanged
+                }
+
+                // Take the window out while it is refreshed since its input channel
+                // and its layer may change.
+                removeWindowHandleLocked(windowHandle);
+            }
+
+            if (!windowHandle->updateInfo() || windowHandle->getInputChannel() == NULL
+                    || getWindowHandleLocked(windowHandle->getInputChannel()) != NULL) {
+                if (index >= 0) {
+                    removedWindowHandles.push(windowHandle);
+                }
+                continue;
             }
-            mFocusedWindowHandle = newFocusedWindowHandle;
+            addWindowHandleLocked(windowHandle, update.generation);
         }
 
-        for (size_t i = 0; i < mTouchState.windows.size(); i++) {
-            TouchedWindow& touchedWindow = mTouchState.windows.editItemAt(i);
-            if (!hasWindowHandleLocked(touchedWindow.windowHandle)) {
+        onInputWindowsChangedLocked(removedWindowHandles);
+    } // release lock
+
+    // Wake up poll loop since it may need to make new input dispatching choices.
+    mLooper->wake();
+}
+
+void InputDispatcher::onInputWindowsChangedLocked(
+        const Vector<sp<InputWindowHandle> >& removedWindowHandles) {
+    sp<InputWindowHandle> newFocusedWindowHandle;
+    for (size_t i = 0; i < mWindowHandles.size(); i++) {
+        const sp<InputWindowHandle>& windowHandle = mWindowHandles.itemAt(i);
+        if (windowHandle->getInfo()->hasFocus) {
+            newFocusedWindowHandle = windowHandle;
+        }
+    }
+
+    if (mLastHoverWindowHandle != NULL && !hasWindowHandleLocked(mLastHoverWindowHandle)) {
+        mLastHoverWindowHandle = NULL;
+    }
+
+    if (mFocusedWindowHandle != newFocusedWindowHandle) {
+        if (mFocusedWindowHandle != NULL) {
 #if DEBUG_FOCUS
-                ALOGD("Touched window was removed: %s",
-                        touchedWindow.windowHandle->getName().string());
+            ALOGD("Focus left window: %s",
+                    mFocusedWindowHandle->getName().string());
 #endif
-                sp<InputChannel> touchedInputChannel =
-                        touchedWindow.windowHandle->getInputChannel();
-                if (touchedInputChannel != NULL) {
-                    CancelationOptions options(CancelationOptions::CANCEL_POINTER_EVENTS,
-                            "touched window was removed");
-                    synthesizeCancelationEventsForInputChannelLocked(
-                            touchedInputChannel, options);
-                }
-                mTouchState.windows.removeAt(i--);
+            sp<InputChannel> focusedInputChannel = mFocusedWindowHandle->getInputChannel();
+            if (focusedInputChannel != NULL) {
+                CancelationOptions options(CancelationOptions::CANCEL_NON_POINTER_EVENTS,
+                        "focus left window");
+                synthesizeCancelationEventsForInputChannelLocked(
+                        focusedInputChannel, options);
             }
         }
+        if (newFocusedWindowHandle != NULL) {
+#if DEBUG_FOCUS
+            ALOGD("Focus entered window: %s",
+                    newFocusedWindowHandle->getName().string());
+#endif
+        }
+        mFocusedWindowHandle = newFocusedWindowHandle;
+    }
 
-        // Release information for windows that are no longer present.
-        // This ensures that unused input channels are released promptly.
-        // Otherwise, they might stick around until the window handle is destroyed
-        // which might not happen until the next GC.
-        for (size_t i = 0; i < oldWindowHandles.size(); i++) {
-            const sp<InputWindowHandle>& oldWindowHandle = oldWindowHandles.itemAt(i);
-            if (!hasWindowHandleLocked(oldWindowHandle)) {
+    // Windows only leave the touch state when they are removed.
+    if (removedWindowHandles.isEmpty()) {
+        return;
+    }
+
+    for (size_t i = 0; i < mTouchState.windows.size(); i++) {
+        TouchedWindow& touchedWindow = mTouchState.windows.editItemAt(i);
+        if (!hasWindowHandleLocked(touchedWindow.windowHandle)) {
 #if DEBUG_FOCUS
-                ALOGD("Window went away: %s", oldWindowHandle->getName().string());
+            ALOGD("Touched window was removed: %s",
+                    touchedWindow.windowHandle->getName().string());
 #endif
-                oldWindowHandle->releaseInfo();
+            sp<InputChannel> touchedInputChannel =
+                    touchedWindow.windowHandle->getInputChannel();
+            if (touchedInputChannel != NULL) {
+                CancelationOptions options(CancelationOptions::CANCEL_POINTER_EVENTS,
+                        "touched window was removed");
+                synthesizeCancelationEventsForInputChannelLocked(
+                        touchedInputChannel, options);
             }
+            mTouchState.windows.removeAt(i--);
         }
-    } // release lock
+    }
 
-    // Wake up poll loop since it may need to make new input dispatching choices.
-    mLooper->wake();
+    // Release information for windows that are no longer present.
+    // This ensures that unused input channels are released promptly.
+    // Otherwise, they might stick around until the window handle is destroyed
+    // which might not happen until the next GC.
+    for (size_t i = 0; i < removedWindowHandles.size(); i++) {
+        const sp<InputWindowHandle>& oldWindowHandle = removedWindowHandles.itemAt(i);
+        if (!hasWindowHandleLocked(oldWindowHandle)) {
+#if DEBUG_FOCUS
+            ALOGD("Window went away: %s", oldWindowHandle->getName().string());
+#endif
+            oldWindowHandle->releaseInfo();
+        }
+    }
 }
 
 void InputDispatcher::setFocusedApplication(
@@ -2959,11 +3164,16 @@ void InputDispatcher::setInputFilterEnabled(bool enabled) {
     { // acquire lock
         AutoMutex _l(mLock);
 
-        if (mInputFilterEnabled == enabled) {
+        if (bool(mInputFilterEnabled) == enabled) {
             return;
         }
 
-        mInputFilterEnabled = enabled;
+        // The generation is published after the state so that a notify path that
+        // sees the new generation also sees the new state.  Events that were checked
+        // against the old state carry the old generation and are dropped when the
+        // dispatch loop takes them.
+        android_atomic_release_store(enabled, &mInputFilterEnabled);
+        android_atomic_release_store(mInputFilterGeneration + 1, &mInputFilterGeneration);
         resetAndDropEverythingLocked("input filter is being enabled or disabled");
     } // release lock
 
@@ -3212,6 +3422,13 @@ void InputDispatcher::dumpDispatchStateLocked(String8& dump) {
             } else {
                 dump.append(INDENT3 "WaitQueue: <empty>\n");
             }
+
+            if (connection->coalescedMotionCount) {
+                dump.appendFormat(INDENT3 "CoalescedMotion: samples=%u, dropped=%u\n",
+                        connection->coalescedMotionCount, connection->droppedMotionCount);
+            }
+
+            connection->latencyStatistics.dump(dump);
         }
     } else {
         dump.append(INDENT "Connections: <none>\n");
@@ -3224,11 +3441,17 @@ void InputDispatcher::dumpDispatchStateLocked(String8& dump) {
         dump.append(INDENT "AppSwitch: not pending\n");
     }
 
+    dump.append(INDENT "LockHoldTimes:\n");
+    mDispatchLockHoldTimes.dump(dump, INDENT2, "DispatchLoop");
+    mWindowUpdateLockHoldTimes.dump(dump, INDENT2, "WindowUpdates");
+
     dump.append(INDENT "Configuration:\n");
     dump.appendFormat(INDENT2 "KeyRepeatDelay: %0.1fms\n",
             mConfig.keyRepeatDelay * 0.000001f);
     dump.appendFormat(INDENT2 "KeyRepeatTimeout: %0.1fms\n",
             mConfig.keyRepeatTimeout * 0.000001f);
+    dump.appendFormat(INDENT2 "MotionCoalescing: enabled=%s, maxHistory=%u\n",
+            toString(mConfig.motionCoalescingEnabled), mConfig.motionCoalescingMaxHistory);
 }
 
 status_t InputDispatcher::registerInputChannel(const sp<InputChannel>& inputChannel,
@@ -3463,6 +3686,9 @@ void InputDispatcher::doDispatchCycleFinishedLockedInterruptible(
             ALOGI("%s", msg.string());
         }
 
+        connection->latencyStatistics.record(dispatchEntry->eventEntry,
+                dispatchEntry->deliveryTime, finishTime);
+
         bool restartEvent;
         if (dispatchEntry->eventEntry->type == EventEntry::TYPE_KEY) {
             KeyEntry* keyEntry = static_cast<KeyEntry*>(dispatchEntry->eventEntry);
@@ -3493,6 +3719,10 @@ void InputDispatcher::doDispatchCycleFinishedLockedInterruptible(
 
         // Start the next dispatch cycle for this connection.
         startDispatchCycleLocked(now(), connection);
+    } else {
+        // The application finished a history sample of a coalesced motion event.
+        // Nothing waits for it but it made room in the pipe for the rest of the entry.
+        startDispatchCycleLocked(now(), connection);
     }
 }
 
@@ -3734,6 +3964,12 @@ void InputDispatcher::monitor() {
     mLock.unlock();
 }
 
+void InputDispatcher::getInputWindowsForTest(
+        Vector<sp<InputWindowHandle> >& outWindowHandles) {
+    AutoMutex _l(mLock);
+    outWindowHandles = mWindowHandles;
+}
+
 
 // --- InputDispatcher::Queue ---
 
@@ -3760,11 +3996,11 @@ InputDispatcher::InjectionState::~InjectionState() {
 }
 
 void InputDispatcher::InjectionState::release() {
-    refCount -= 1;
-    if (refCount == 0) {
+    int32_t oldRefCount = android_atomic_dec(&refCount);
+    if (oldRefCount == 1) {
         delete this;
     } else {
-        ALOG_ASSERT(refCount > 0);
+        ALOG_ASSERT(oldRefCount > 1);
     }
 }
 
@@ -3773,7 +4009,8 @@ void InputDispatcher::InjectionState::release() {
 
 InputDispatcher::EventEntry::EventEntry(int32_t type, nsecs_t eventTime, uint32_t policyFlags) :
         refCount(1), type(type), eventTime(eventTime), policyFlags(policyFlags),
-        injectionState(NULL), dispatchInProgress(false) {
+        injectionState(NULL), readTime(0), cookTime(0), enqueueTime(0),
+        inputFilterGeneration(-1), dispatchInProgress(false) {
 }
 
 InputDispatcher::EventEntry::~EventEntry() {
@@ -3851,6 +4088,9 @@ void InputDispatcher::KeyEntry::appendDescription(String8& msg) const {
 void InputDispatcher::KeyEntry::recycle() {
     releaseInjectionState();
 
+    readTime = 0;
+    cookTime = 0;
+    enqueueTime = 0;
     dispatchInProgress = false;
     syntheticRepeat = false;
     interceptKeyResult = KeyEntry::INTERCEPT_KEY_RESULT_UNKNOWN;
@@ -3896,11 +4136,14 @@ InputDispatcher::DispatchEntry::DispatchEntry(EventEntry* eventEntry,
         seq(nextSeq()),
         eventEntry(eventEntry), targetFlags(targetFlags),
         xOffset(xOffset), yOffset(yOffset), scaleFactor(scaleFactor),
-        deliveryTime(0), resolvedAction(0), resolvedFlags(0) {
+        deliveryTime(0), resolvedAction(0), resolvedFlags(0), publishedHistoryCount(0) {
     eventEntry->refCount += 1;
 }
 
 InputDispatcher::DispatchEntry::~DispatchEntry() {
+    for (size_t i = 0; i < historyEntries.size(); i++) {
+        historyEntries.itemAt(i)->release();
+    }
     eventEntry->release();
 }
 
@@ -4246,13 +4489,121 @@ bool InputDispatcher::InputState::shouldCancelMotion(const MotionMemento& mement
 }
 
 
+// --- InputDispatcher::LatencyHistogram ---
+
+InputDispatcher::LatencyHistogram::LatencyHistogram() :
+        count(0), sum(0), max(0) {
+    memset(buckets, 0, sizeof(buckets));
+}
+
+void InputDispatcher::LatencyHistogram::add(nsecs_t latency) {
+    if (latency < 0) {
+        latency = 0;
+    }
+
+    uint32_t bucket = 0;
+    nsecs_t limit = BUCKET_BASE;
+    while (latency >= limit && bucket < BUCKET_COUNT - 1) {
+        bucket += 1;
+        limit <<= 1;
+    }
+
+    buckets[bucket] += 1;
+    count += 1;
+    sum += latency;
+    if (latency > max) {
+        max = latency;
+    }
+}
+
+nsecs_t InputDispatcher::LatencyHistogram::getPercentile(float fraction) const {
+    uint32_t threshold = uint32_t(ceilf(count * fraction));
+    uint32_t seen = 0;
+    nsecs_t limit = BUCKET_BASE;
+    for (uint32_t i = 0; i < BUCKET_COUNT - 1; i++) {
+        seen += buckets[i];
+        if (seen >= threshold) {
+            return limit < max ? limit : max;
+        }
+        limit <<= 1;
+    }
+    return max;
+}
+
+void InputDispatcher::LatencyHistogram::dump(String8& dump, const char* indent,
+        const char* label) const {
+    dump.appendFormat("%s%s: count=%u, mean=%0.3fms, p50<=%0.3fms, p90<=%0.3fms, "
+            "p99<=%0.3fms, max=%0.3fms\n",
+            indent, label, count, count ? sum * 0.000001f / count : 0.0f,
+            getPercentile(0.50f) * 0.000001f, getPercentile(0.90f) * 0.000001f,
+            getPercentile(0.99f) * 0.000001f, max * 0.000001f);
+}
+
+
+// --- InputDispatcher::LatencyStatistics ---
+
+void InputDispatcher::LatencyStatistics::record(const EventEntry* entry,
+        nsecs_t deliveryTime, nsecs_t finishTime) {
+    // Events that did not come from the InputReader, such as injected events and
+    // synthesized cancelations, only contribute to the dispatcher stages.
+    if (entry->readTime) {
+        stages[STAGE_READ].add(entry->readTime - entry->eventTime);
+        stages[STAGE_TOTAL].add(finishTime - entry->eventTime);
+        if (entry->cookTime) {
+            stages[STAGE_COOK].add(entry->cookTime - entry->readTime);
+        }
+    }
+    if (entry->cookTime && entry->enqueueTime) {
+        stages[STAGE_ENQUEUE].add(entry->enqueueTime - entry->cookTime);
+    }
+    if (entry->enqueueTime) {
+        stages[STAGE_PUBLISH].add(deliveryTime - entry->enqueueTime);
+    }
+    stages[STAGE_FINISH].add(finishTime - deliveryTime);
+}
+
+void InputDispatcher::LatencyStatistics::dump(String8& dump) const {
+    if (!stages[STAGE_FINISH].count) {
+        dump.append(INDENT3 "Latency: <none>\n");
+        return;
+    }
+
+    dump.append(INDENT3 "Latency:\n");
+    for (uint32_t i = 0; i < STAGE_COUNT; i++) {
+        if (stages[i].count) {
+            stages[i].dump(dump, INDENT4, getStageLabel(Stage(i)));
+        }
+    }
+}
+
+const char* InputDispatcher::LatencyStatistics::getStageLabel(Stage stage) {
+    switch (stage) {
+    case STAGE_READ:
+        return "KernelToRead";
+    case STAGE_COOK:
+        return "ReadToCook";
+    case STAGE_ENQUEUE:
+        return "CookToEnqueue";
+    case STAGE_PUBLISH:
+        return "EnqueueToPublish";
+    case STAGE_FINISH:
+        return "PublishToFinished";
+    case STAGE_TOTAL:
+        return "KernelToFinished";
+    default:
+        return "?";
+    }
+}
+
+
 // --- InputDispatcher::Connection ---
 
 InputDispatcher::Connection::Connection(const sp<InputChannel>& inputChannel,
         const sp<InputWindowHandle>& inputWindowHandle, bool monitor) :
         status(STATUS_NORMAL), inputChannel(inputChannel), inputWindowHandle(inputWindowHandle),
         monitor(monitor),
-        inputPublisher(inputChannel), inputPublisherBlocked(false) {
+        inputPublisher(inputChannel), inputPublisherBlocked(false),
+        coalescedMotionCount(0), droppedMotionCount(0) {
 }
 
 InputDispatcher::Connection::~Connection() {
@@ -173,9 +173,48 @@ struct InputDispatcherConfiguration {
     // The key repeat inter-key delay.
     nsecs_t keyRepeatDelay;
 
+    // True if consecutive motion moves that are still waiting to be published to a window
+    // that has fallen behind should be coalesced into a single dispatch entry.
+    bool motionCoalescingEnabled;
+
+    // The maximum number of superseded samples that a coalesced motion move keeps as
+    // history.  They are published ahead of the newest sample so that the consumer can
+    // batch them into the history of a single motion event.  Older samples are dropped.
+    uint32_t motionCoalescingMaxHistory;
+
     InputDispatcherConfiguration() :
             keyRepeatTimeout(500 * 1000000LL),
-            keyRepeatDelay(50 * 1000000LL) { }
+            keyRepeatDelay(50 * 1000000LL),
+            motionCoalescingEnabled(false),
+            motionCoalescingMaxHistory(8) { }
+};
+
+
+/*
+ * Describes a change to a single input window.
+ *
+ * The window handle identifies the window.  The generation is chosen by the caller and
+ * must change whenever the information of the window changes so that the dispatcher can
+ * avoid refreshing windows that have not changed since they were last reported.
+ * An update with a generation of 0 always refreshes the window.
+ */
+struct InputWindowUpdate {
+    enum Action {
+        // Adds the window, or updates it if it is already present.
+        ACTION_SET,
+        // Removes the window if it is present.
+        ACTION_REMOVE,
+    };
+
+    Action action;
+    sp<InputWindowHandle> windowHandle;
+    uint32_t generation;
+
+    InputWindowUpdate() :
+            action(ACTION_SET), generation(0) { }
+    InputWindowUpdate(Action action, const sp<InputWindowHandle>& windowHandle,
+            uint32_t generation) :
+            action(action), windowHandle(windowHandle), generation(generation) { }
 };
 
 
@@ -304,6 +343,16 @@ public:
      */
     virtual void setInputWindows(const Vector<sp<InputWindowHandle> >& inputWindowHandles) = 0;
 
+    /* Adds, updates or removes individual input windows.
+     *
+     * Windows that are not mentioned are left untouched and windows whose generation has
+     * not changed are not refreshed.  The windows are kept in front to back order,
+     * ordered by decreasing layer.
+     *
+     * This method may be called on any thread (usually by the input manager).
+     */
+    virtual void updateInputWindows(const Vector<InputWindowUpdate>& updates) = 0;
+
     /* Sets the focused application.
      *
      * This method may be called on any thread (usually by the input manager).
@@ -383,6 +432,7 @@ public:
             uint32_t policyFlags);
 
     virtual void setInputWindows(const Vector<sp<InputWindowHandle> >& inputWindowHandles);
+    virtual void updateInputWindows(const Vector<InputWindowUpdate>& updates);
     virtual void setFocusedApplication(const sp<InputApplicationHandle>& inputApplicationHandle);
     virtual void setInputDispatchMode(bool enabled, bool frozen);
     virtual void setInputFilterEnabled(bool enabled);
@@ -394,6 +444,9 @@ public:
             const sp<InputWindowHandle>& inputWindowHandle, bool monitor);
     virtual status_t unregisterInputChannel(const sp<InputChannel>& inputChannel);
 
+    /* Gets the current input windows, front to back.  Only used by tests. */
+    void getInputWindowsForTest(Vector<sp<InputWindowHandle> >& outWindowHandles);
+
 private:
     template <typename T>
     struct Link {
@@ -405,7 +458,7 @@ private:
     };
 
     struct InjectionState {
-        mutable int32_t refCount;
+        volatile int32_t refCount; // shared by the dispatcher and the injector
 
         int32_t injectorPid;
         int32_t injectorUid;
@@ -434,6 +487,15 @@ private:
         uint32_t policyFlags;
         InjectionState* injectionState;
 
+        // Pipeline timestamps for latency accounting, or 0 if unknown.
+        nsecs_t readTime; // when the raw events were read from the EventHub
+        nsecs_t cookTime; // when the InputReader produced the event
+        nsecs_t enqueueTime; // when the event was added to the inbound queue
+
+        // The input filter generation the event was checked against when it was posted,
+        // or -1 if the event does not go through the input filter.
+        int32_t inputFilterGeneration;
+
         bool dispatchInProgress; // initially false, set to true while dispatching
 
         inline bool isInjected() const { return injectionState != NULL; }
@@ -544,6 +606,11 @@ private:
         int32_t resolvedAction;
         int32_t resolvedFlags;
 
+        // Older motion samples that were coalesced into this entry, oldest first.
+        // Each one is published with its own sequence number ahead of the event itself.
+        Vector<MotionEntry*> historyEntries;
+        size_t publishedHistoryCount;
+
         DispatchEntry(EventEntry* eventEntry,
                 int32_t targetFlags, float xOffset, float yOffset, float scaleFactor);
         ~DispatchEntry();
@@ -556,10 +623,10 @@ private:
             return targetFlags & InputTarget::FLAG_SPLIT;
         }
 
+        static uint32_t nextSeq();
+
     private:
         static volatile int32_t sNextSeqAtomic;
-
-        static uint32_t nextSeq();
     };
 
     // A command entry captures state and behavior for an action to be performed in the
@@ -661,6 +728,56 @@ private:
         uint32_t count() const;
     };
 
+    // Lock-free queue that any number of threads may post to concurrently.
+    // A single consumer takes everything that has been posted at once, oldest first.
+    // Entries are kept newest first and linked through their next pointers.
+    template <typename T>
+    struct IncomingQueue {
+        T* volatile newest;
+
+        inline IncomingQueue() : newest(NULL) {
+        }
+
+        // Posts a list of entries linked through their next pointers, oldest first.
+        // Returns true if the queue was empty, in which case the consumer must be woken.
+        inline bool post(T* entries) {
+            T* oldestEntry = entries;
+            T* newestEntry = NULL;
+            while (entries) {
+                T* next = entries->next;
+                entries->next = newestEntry;
+                newestEntry = entries;
+                entries = next;
+            }
+
+            // Entries are never removed individually so there is no ABA problem.
+            // The builtins are used because the cutils atomics only operate on int32_t.
+            T* oldNewest;
+            do {
+                oldNewest = newest;
+                oldestEntry->next = oldNewest;
+            } while (!__sync_bool_compare_and_swap(&newest, oldNewest, newestEntry));
+            return !oldNewest;
+        }
+
+        // Takes all posted entries, linked through their next pointers, oldest first.
+        inline T* takeAll() {
+            T* entries;
+            do {
+                entries = newest;
+            } while (!__sync_bool_compare_and_swap(&newest, entries, (T*)NULL));
+
+            T* oldestEntry = NULL;
+            while (entries) {
+                T* next = entries->next;
+                entries->next = oldestEntry;
+                oldestEntry = entries;
+                entries = next;
+            }
+            return oldestEntry;
+        }
+    };
+
     /* Specifies which events are to be canceled and why. */
     struct CancelationOptions {
         enum Mode {
@@ -780,6 +897,73 @@ private:
                 const CancelationOptions& options);
     };
 
+    /* Accumulates a histogram of latencies using power of two buckets. */
+    struct LatencyHistogram {
+        enum {
+            // Bucket 0 holds latencies below BUCKET_BASE, bucket N holds latencies
+            // below BUCKET_BASE << N and the last bucket holds everything else.
+            BUCKET_COUNT = 16,
+            BUCKET_BASE = 125 * 1000, // 0.125ms
+        };
+
+        uint32_t count;
+        nsecs_t sum;
+        nsecs_t max;
+        uint32_t buckets[BUCKET_COUNT];
+
+        LatencyHistogram();
+
+        void add(nsecs_t latency);
+
+        // Returns an upper bound of the latency within which the given fraction
+        // of the samples fall, based on the bucket boundaries.
+        nsecs_t getPercentile(float fraction) const;
+
+        void dump(String8& dump, const char* indent, const char* label) const;
+    };
+
+    /* Adds the time from its construction to its destruction to a histogram.
+     * Declare it after a lock is acquired to measure how long the lock is held. */
+    class AutoLockHoldTimer {
+    public:
+        inline explicit AutoLockHoldTimer(LatencyHistogram& histogram) :
+                mHistogram(histogram), mStartTime(systemTime(SYSTEM_TIME_MONOTONIC)) {
+        }
+
+        inline ~AutoLockHoldTimer() {
+            mHistogram.add(systemTime(SYSTEM_TIME_MONOTONIC) - mStartTime);
+        }
+
+    private:
+        LatencyHistogram& mHistogram;
+        nsecs_t mStartTime;
+    };
+
+    /* Latency statistics for the events delivered to a connection, broken down by
+     * the stages of the input pipeline that each event passed through. */
+    struct LatencyStatistics {
+        enum Stage {
+            STAGE_READ,    // kernel timestamp to EventHub read
+            STAGE_COOK,    // EventHub read to InputReader cooked event
+            STAGE_ENQUEUE, // InputReader cooked event to dispatcher inbound queue
+            STAGE_PUBLISH, // dispatcher inbound queue to publish on the input channel
+            STAGE_FINISH,  // publish to receipt of the finished signal
+            STAGE_TOTAL,   // kernel timestamp to receipt of the finished signal
+
+            STAGE_COUNT
+        };
+
+        LatencyHistogram stages[STAGE_COUNT];
+
+        // Records the latencies of an event that was published at deliveryTime and
+        // reported finished at finishTime.
+        void record(const EventEntry* entry, nsecs_t deliveryTime, nsecs_t finishTime);
+
+        void dump(String8& dump) const;
+
+        static const char* getStageLabel(Stage stage);
+    };
+
     /* Manages the dispatch state associated with a single input channel. */
     class Connection : public RefBase {
     protected:
@@ -813,6 +997,14 @@ private:
         // yet received a "finished" response from the application.
         Queue<DispatchEntry> waitQueue;
 
+        // Latencies of the events that the application has finished.
+        LatencyStatistics latencyStatistics;
+
+        // Number of motion samples that were coalesced into a newer pending sample,
+        // and how many of those were dropped instead of being kept as history.
+        uint32_t coalescedMotionCount;
+        uint32_t droppedMotionCount;
+
         explicit Connection(const sp<InputChannel>& inputChannel,
                 const sp<InputWindowHandle>& inputWindowHandle, bool monitor);
 
@@ -846,10 +1038,24 @@ private:
     Queue<EventEntry> mInboundQueue;
     Queue<CommandEntry> mCommandQueue;
 
+    // Events posted by the notify and inject paths, which never take mLock.
+    // The dispatch loop moves them to mInboundQueue.
+    IncomingQueue<EventEntry> mIncomingQueue;
+
+    // How long mLock is held by the dispatch loop and by window updates.
+    LatencyHistogram mDispatchLockHoldTimes;
+    LatencyHistogram mWindowUpdateLockHoldTimes;
+
     void dispatchOnceInnerLocked(nsecs_t* nextWakeupTime);
 
-    // Enqueues an inbound event.  Returns true if mLooper->wake() should be called.
-    bool enqueueInboundEventLocked(EventEntry* entry);
+    // Posts a list of new inbound events linked through their next pointers.
+    void postInboundEvents(EventEntry* entries);
+
+    // Moves the events that have been posted since the last call to the inbound queue.
+    void transferIncomingEventsLocked();
+
+    // Enqueues an inbound event.
+    void enqueueInboundEventLocked(EventEntry* entry);
 
     // Cleans up input state when dropping an inbound event.
     void dropInboundEventLocked(EventEntry* entry, DropReason dropReason);
@@ -881,6 +1087,9 @@ private:
     Vector<sp<InputChannel> > mMonitoringChannels;
 
     // Event injection and synchronization.
+    // Injectors wait on mInjectionLock rather than mLock so that they do not contend with
+    // the dispatch loop.  It is always acquired after mLock.
+    Mutex mInjectionLock;
     Condition mInjectionResultAvailableCondition;
     bool hasInjectionPermission(int32_t injectorPid, int32_t injectorUid);
     void setInjectionResultLocked(EventEntry* entry, int32_t injectionResult);
@@ -904,8 +1113,8 @@ private:
     CommandEntry* postCommandLocked(Command command);
 
     // Input filter processing.
-    bool shouldSendKeyToInputFilterLocked(const NotifyKeyArgs* args);
-    bool shouldSendMotionToInputFilterLocked(const NotifyMotionArgs* args);
+    bool shouldSendKeyToInputFilter(const NotifyKeyArgs* args);
+    bool shouldSendMotionToInputFilter(const NotifyMotionArgs* args);
 
     // Inbound event processing.
     void drainInboundQueueLocked();
@@ -915,12 +1124,27 @@ private:
     // Dispatch state.
     bool mDispatchEnabled;
     bool mDispatchFrozen;
-    bool mInputFilterEnabled;
+    volatile int32_t mInputFilterEnabled; // read without mLock by the notify paths
+    volatile int32_t mInputFilterGeneration; // incremented when mInputFilterEnabled changes
 
+    // The input windows in front to back order.
     Vector<sp<InputWindowHandle> > mWindowHandles;
 
+    // The input windows indexed by the fd of their input channel, along with the
+    // generation of their most recent update.
+    struct IndexedWindowHandle {
+        sp<InputWindowHandle> windowHandle;
+        uint32_t generation;
+    };
+    KeyedVector<int, IndexedWindowHandle> mWindowHandlesByFd;
+
     sp<InputWindowHandle> getWindowHandleLocked(const sp<InputChannel>& inputChannel) const;
     bool hasWindowHandleLocked(const sp<InputWindowHandle>& windowHandle) const;
+    ssize_t getWindowHandleIndexByFdLocked(const sp<InputWindowHandle>& windowHandle) const;
+    void addWindowHandleLocked(const sp<InputWindowHandle>& windowHandle, uint32_t generation);
+    void removeWindowHandleLocked(const sp<InputWindowHandle>& windowHandle);
+    void onInputWindowsChangedLocked(
+            const Vector<sp<InputWindowHandle> >& removedWindowHandles);
 
     // Focus tracking for keys, trackball, etc.
     sp<InputWindowHandle> mFocusedWindowHandle;
@@ -1033,6 +1257,10 @@ private:
             EventEntry* eventEntry, const InputTarget* inputTarget);
     void enqueueDispatchEntryLocked(const sp<Connection>& connection,
             EventEntry* eventEntry, const InputTarget* inputTarget, int32_t dispatchMode);
+    bool coalesceMotionDispatchEntryLocked(const sp<Connection>& connection,
+            DispatchEntry* dispatchEntry);
+    status_t publishMotionEventLocked(const sp<Connection>& connection,
+            DispatchEntry* dispatchEntry, MotionEntry* motionEntry, uint32_t seq);
     void startDispatchCycleLocked(nsecs_t currentTime, const sp<Connection>& connection);
     void finishDispatchCycleLocked(nsecs_t currentTime, const sp<Connection>& connection,
             uint32_t seq, bool handled);
@@ -48,7 +48,8 @@ NotifyKeyArgs::NotifyKeyArgs(nsecs_t eventTime, int32_t deviceId, uint32_t sourc
         int32_t metaState, nsecs_t downTime) :
         eventTime(eventTime), deviceId(deviceId), source(source), policyFlags(policyFlags),
         action(action), flags(flags), keyCode(keyCode), scanCode(scanCode),
-        metaState(metaState), downTime(downTime) {
+        metaState(metaState), downTime(downTime),
+        readTime(0), cookTime(0) {
 }
 
 NotifyKeyArgs::NotifyKeyArgs(const NotifyKeyArgs& other) :
@@ -56,7 +57,8 @@ NotifyKeyArgs::NotifyKeyArgs(const NotifyKeyArgs& other) :
         policyFlags(other.policyFlags),
         action(other.action), flags(other.flags),
         keyCode(other.keyCode), scanCode(other.scanCode),
-        metaState(other.metaState), downTime(other.downTime) {
+        metaState(other.metaState), downTime(other.downTime),
+        readTime(other.readTime), cookTime(other.cookTime) {
 }
 
 void NotifyKeyArgs::notify(const sp<InputListenerInterface>& listener) const {
@@ -75,7 +77,8 @@ NotifyMotionArgs::NotifyMotionArgs(nsecs_t eventTime, int32_t deviceId, uint32_t
         eventTime(eventTime), deviceId(deviceId), source(source), policyFlags(policyFlags),
         action(action), flags(flags), metaState(metaState), buttonState(buttonState),
         edgeFlags(edgeFlags), displayId(displayId), pointerCount(pointerCount),
-        xPrecision(xPrecision), yPrecision(yPrecision), downTime(downTime) {
+        xPrecision(xPrecision), yPrecision(yPrecision), downTime(downTime),
+        readTime(0), cookTime(0) {
     for (uint32_t i = 0; i < pointerCount; i++) {
         this->pointerProperties[i].copyFrom(pointerProperties[i]);
         this->pointerCoords[i].copyFrom(pointerCoords[i]);
@@ -89,7 +92,8 @@ NotifyMotionArgs::NotifyMotionArgs(const NotifyMotionArgs& other) :
         metaState(other.metaState), buttonState(other.buttonState),
         edgeFlags(other.edgeFlags), displayId(other.displayId),
         pointerCount(other.pointerCount),
-        xPrecision(other.xPrecision), yPrecision(other.yPrecision), downTime(other.downTime) {
+        xPrecision(other.xPrecision), yPrecision(other.yPrecision), downTime(other.downTime),
+        readTime(other.readTime), cookTime(other.cookTime) {
     for (uint32_t i = 0; i < pointerCount; i++) {
         pointerProperties[i].copyFrom(other.pointerProperties[i]);
         pointerCoords[i].copyFrom(other.pointerCoords[i]);
@@ -137,7 +141,7 @@ void NotifyDeviceResetArgs::notify(const sp<InputListenerInterface>& listener) c
 // --- QueuedInputListener ---
 
 QueuedInputListener::QueuedInputListener(const sp<InputListenerInterface>& innerListener) :
-        mInnerListener(innerListener) {
+        mInnerListener(innerListener), mReadTime(0) {
 }
 
 QueuedInputListener::~QueuedInputListener() {
@@ -153,11 +157,17 @@ void QueuedInputListener::notifyConfigurationChanged(
 }
 
 void QueuedInputListener::notifyKey(const NotifyKeyArgs* args) {
-    mArgsQueue.push(new NotifyKeyArgs(*args));
+    NotifyKeyArgs* queuedArgs = new NotifyKeyArgs(*args);
+    queuedArgs->readTime = mReadTime;
+    queuedArgs->cookTime = systemTime(SYSTEM_TIME_MONOTONIC);
+    mArgsQueue.push(queuedArgs);
 }
 
 void QueuedInputListener::notifyMotion(const NotifyMotionArgs* args) {
-    mArgsQueue.push(new NotifyMotionArgs(*args));
+    NotifyMotionArgs* queuedArgs = new NotifyMotionArgs(*args);
+    queuedArgs->readTime = mReadTime;
+    queuedArgs->cookTime = systemTime(SYSTEM_TIME_MONOTONIC);
+    mArgsQueue.push(queuedArgs);
 }
 
 void QueuedInputListener::notifySwitch(const NotifySwitchArgs* args) {
@@ -168,6 +178,15 @@ void QueuedInputListener::notifyDeviceReset(const NotifyDeviceResetArgs* args) {
     mArgsQueue.push(new NotifyDeviceResetArgs(*args));
 }
 
+void QueuedInputListener::setReadTime(nsecs_t readTime) {
+    mReadTime = readTime;
+}
+
+void QueuedInputListener::append(const sp<QueuedInputListener>& other) {
+    mArgsQueue.appendVector(other->mArgsQueue);
+    other->mArgsQueue.clear();
+}
+
 void QueuedInputListener::flush() {
     size_t count = mArgsQueue.size();
     for (size_t i = 0; i < count; i++) {
@@ -63,6 +63,10 @@ struct NotifyKeyArgs : public NotifyArgs {
     int32_t metaState;
     nsecs_t downTime;
 
+    // Pipeline timestamps for latency accounting, or 0 if unknown.
+    nsecs_t readTime; // when the raw events were read from the EventHub
+    nsecs_t cookTime; // when the InputReader produced the event
+
     inline NotifyKeyArgs() { }
 
     NotifyKeyArgs(nsecs_t eventTime, int32_t deviceId, uint32_t source, uint32_t policyFlags,
@@ -96,6 +100,10 @@ struct NotifyMotionArgs : public NotifyArgs {
     float yPrecision;
     nsecs_t downTime;
 
+    // Pipeline timestamps for latency accounting, or 0 if unknown.
+    nsecs_t readTime; // when the raw events were read from the EventHub
+    nsecs_t cookTime; // when the InputReader produced the event
+
     inline NotifyMotionArgs() { }
 
     NotifyMotionArgs(nsecs_t eventTime, int32_t deviceId, uint32_t source, uint32_t policyFlags,
@@ -170,6 +178,9 @@ public:
 /*
  * An implementation of the listener interface that queues up and defers dispatch
  * of decoded events until flushed.
+ *
+ * Key and motion events are stamped with the current read time and the time at which
+ * they were queued so that the dispatcher can attribute latency to each pipeline stage.
  */
 class QueuedInputListener : public InputListenerInterface {
 protected:
@@ -184,11 +195,20 @@ public:
     virtual void notifySwitch(const NotifySwitchArgs* args);
     virtual void notifyDeviceReset(const NotifyDeviceResetArgs* args);
 
+    // Sets the time at which the raw events currently being processed were read,
+    // or 0 if the events being produced were not caused by a read.
+    void setReadTime(nsecs_t readTime);
+    inline nsecs_t getReadTime() const { return mReadTime; }
+
+    // Moves everything queued by another listener to the end of this queue.
+    void append(const sp<QueuedInputListener>& other);
+
     void flush();
 
 private:
     sp<InputListenerInterface> mInnerListener;
     Vector<NotifyArgs*> mArgsQueue;
+    nsecs_t mReadTime;
 };
 
 } // namespace android
@@ -42,6 +42,7 @@
 #include "InputReader.h"
 
 #include <cutils/log.h>
+#include <cutils/properties.h>
 #include <androidfw/Keyboard.h>
 #include <androidfw/VirtualKeyMap.h>
 
@@ -65,6 +66,9 @@ namespace android {
 // Maximum number of slots supported when using the slot-based Multitouch Protocol B.
 static const size_t MAX_SLOTS = 32;
 
+// Maximum number of threads used to process the events of different devices concurrently.
+static const size_t MAX_DEVICE_WORKERS = 8;
+
 // --- Static Functions ---
 
 template<typename T>
@@ -226,18 +230,29 @@ InputReader::InputReader(const sp<EventHubInterface>& eventHub,
         mContext(this), mEventHub(eventHub), mPolicy(policy),
         mGlobalMetaState(0), mGeneration(1),
         mDisableVirtualKeysTimeout(LLONG_MIN), mNextTimeout(LLONG_MAX),
-        mConfigurationChangesToRefresh(0) {
+        mConfigurationChangesToRefresh(0), mDeviceWorkerPool(NULL),
+        mFadePointerRequested(false) {
     mQueuedListener = new QueuedInputListener(listener);
+    pthread_key_create(&mDeviceRunListenerKey, NULL);
 
     { // acquire lock
         AutoMutex _l(mLock);
 
         refreshConfigurationLocked(0);
         updateGlobalMetaStateLocked();
+
+        char workerCount[PROPERTY_VALUE_MAX];
+        if (property_get("input.reader_workers", workerCount, NULL) > 0) {
+            int count = atoi(workerCount);
+            setDeviceWorkerCountLocked(count > 0 ? size_t(count) : 0);
+        }
     } // release lock
 }
 
 InputReader::~InputReader() {
+    delete mDeviceWorkerPool;
+    pthread_key_delete(mDeviceRunListenerKey);
+
     for (size_t i = 0; i < mDevices.size(); i++) {
         delete mDevices.valueAt(i);
     }
@@ -266,13 +281,16 @@ void InputReader::loopOnce() {
     } // release lock
 
     size_t count = mEventHub->getEvents(timeoutMillis, mEventBuffer, EVENT_BUFFER_SIZE);
+    nsecs_t readTime = systemTime(SYSTEM_TIME_MONOTONIC);
 
     { // acquire lock
         AutoMutex _l(mLock);
         mReaderIsAliveCondition.broadcast();
 
         if (count) {
+            mQueuedListener->setReadTime(readTime);
             processEventsLocked(mEventBuffer, count);
+            mQueuedListener->setReadTime(0);
         }
 
         if (mNextTimeout != LLONG_MAX) {
@@ -311,7 +329,13 @@ void InputReader::processEventsLocked(const RawEvent* rawEvents, size_t count) {
     for (const RawEvent* rawEvent = rawEvents; count;) {
         int32_t type = rawEvent->type;
         size_t batchSize = 1;
-        if (type < EventHubInterface::FIRST_SYNTHETIC_EVENT) {
+        if (type < EventHubInterface::FIRST_SYNTHETIC_EVENT && mDeviceWorkerPool) {
+            while (batchSize < count
+                    && rawEvent[batchSize].type < EventHubInterface::FIRST_SYNTHETIC_EVENT) {
+                batchSize += 1;
+            }
+            processEventsInParallelLocked(rawEvent, batchSize);
+        } else if (type < EventHubInterface::FIRST_SYNTHETIC_EVENT) {
             int32_t deviceId = rawEvent->deviceId;
             while (batchSize < count) {
                 if (rawEvent[batchSize].type >= EventHubInterface::FIRST_SYNTHETIC_EVENT
@@ -472,6 +496,165 @@ void InputReader::processEventsForDeviceLocked(int32_t deviceId,
     device->process(rawEvents, count);
 }
 
+void InputReader::setDeviceWorkerCount(size_t count) {
+    AutoMutex _l(mLock);
+    setDeviceWorkerCountLocked(count);
+}
+
+void InputReader::setDeviceWorkerCountLocked(size_t count) {
+    if (count > MAX_DEVICE_WORKERS) {
+        ALOGW("Limiting device workers to %d instead of %d.", MAX_DEVICE_WORKERS, count);
+        count = MAX_DEVICE_WORKERS;
+    }
+
+    size_t oldCount = mDeviceWorkerPool ? mDeviceWorkerPool->getThreadCount() : 0;
+    if (count != oldCount) {
+        ALOGI("Processing input devices with %d worker threads.", count);
+        delete mDeviceWorkerPool;
+        mDeviceWorkerPool = count ? new InputDeviceWorkerPool(count) : NULL;
+    }
+}
+
+bool InputReader::canProcessDeviceInParallel(InputDevice* device) {
+    // Keyboards update the global meta state that every other device reads, and
+    // devices that drive the pointer controller share it with each other, so they
+    // are always processed on the reader thread.
+    return !(device->getClasses() & INPUT_DEVICE_CLASS_KEYBOARD)
+            && !device->usesPointerController();
+}
+
+void InputReader::processEventsInParallelLocked(const RawEvent* rawEvents, size_t count) {
+    // Split the events into runs of consecutive events for the same device, exactly
+    // like processEventsLocked, and group the runs of each device into a single task
+    // so that the events of a device are always processed in order by one thread.
+    //
+    // Runs that must stay on the reader thread, such as keyboard runs that change the
+    // global meta state, act as barriers: every task started before such a run is
+    // completed before it is processed and tasks after it are started afresh.  This
+    // keeps each event observing the same shared state as it would sequentially.
+    mDeviceRuns.clear();
+    mDeviceTasks.clear();
+    size_t firstTaskInSegment = 0;
+    size_t maxTasksInSegment = 0;
+    for (const RawEvent* rawEvent = rawEvents; count;) {
+        int32_t deviceId = rawEvent->deviceId;
+        size_t batchSize = 1;
+        while (batchSize < count && rawEvent[batchSize].deviceId == deviceId) {
+            batchSize += 1;
+        }
+
+        ssize_t deviceIndex = mDevices.indexOfKey(deviceId);
+        if (deviceIndex < 0) {
+            ALOGW("Discarding event for unknown deviceId %d.", deviceId);
+        } else if (!mDevices.valueAt(deviceIndex)->isIgnored()) {
+            DeviceRun run;
+            run.device = mDevices.valueAt(deviceIndex);
+            run.rawEvents = rawEvent;
+            run.count = batchSize;
+            run.taskIndex = -1;
+            if (canProcessDeviceInParallel(run.device)) {
+                for (size_t i = firstTaskInSegment; i < mDeviceTasks.size(); i++) {
+                    if (mDeviceTasks.itemAt(i).device == run.device) {
+                        run.taskIndex = i;
+                        break;
+                    }
+                }
+                if (run.taskIndex < 0) {
+                    DeviceTask task;
+                    task.device = run.device;
+                    run.taskIndex = mDeviceTasks.add(task);
+                }
+                mDeviceTasks.editItemAt(run.taskIndex).runIndices.push(mDeviceRuns.size());
+            } else {
+                if (mDeviceTasks.size() - firstTaskInSegment > maxTasksInSegment) {
+                    maxTasksInSegment = mDeviceTasks.size() - firstTaskInSegment;
+                }
+                firstTaskInSegment = mDeviceTasks.size();
+            }
+            mDeviceRuns.push(run);
+        }
+        count -= batchSize;
+        rawEvent += batchSize;
+    }
+    if (mDeviceTasks.size() - firstTaskInSegment > maxTasksInSegment) {
+        maxTasksInSegment = mDeviceTasks.size() - firstTaskInSegment;
+    }
+
+    if (maxTasksInSegment < 2) {
+        for (size_t i = 0; i < mDeviceRuns.size(); i++) {
+            const DeviceRun& run = mDeviceRuns.itemAt(i);
+            run.device->process(run.rawEvents, run.count);
+        }
+        return;
+    }
+
+    // Each run queues its output separately so that the output can be merged back
+    // in the order in which the events were read, whichever thread processed them.
+    nsecs_t readTime = mQueuedListener->getReadTime();
+    while (mDeviceRunListeners.size() < mDeviceRuns.size()) {
+        mDeviceRunListeners.push(new QueuedInputListener(NULL));
+    }
+    for (size_t i = 0; i < mDeviceRuns.size(); i++) {
+        mDeviceRunListeners.itemAt(i)->setReadTime(readTime);
+    }
+
+    // Tasks are created in the order of their first run, so the tasks of a segment
+    // are contiguous and all of them start before the reader thread run that ends it.
+    size_t firstPendingTask = 0;
+    for (size_t i = 0; i < mDeviceRuns.size(); i++) {
+        if (mDeviceRuns.itemAt(i).taskIndex < 0) {
+            size_t endTask = firstPendingTask;
+            while (endTask < mDeviceTasks.size()
+                    && mDeviceTasks.itemAt(endTask).runIndices.itemAt(0) < i) {
+                endTask += 1;
+            }
+            processDeviceTasksLocked(firstPendingTask, endTask - firstPendingTask);
+            firstPendingTask = endTask;
+            fadePointerIfRequestedLocked();
+            processDeviceRunLocked(i);
+            fadePointerIfRequestedLocked();
+        }
+    }
+    processDeviceTasksLocked(firstPendingTask, mDeviceTasks.size() - firstPendingTask);
+    fadePointerIfRequestedLocked();
+
+    for (size_t i = 0; i < mDeviceRuns.size(); i++) {
+        mQueuedListener->append(mDeviceRunListeners.itemAt(i));
+    }
+}
+
+void InputReader::processDeviceTasksLocked(size_t firstTask, size_t taskCount) {
+    if (taskCount == 1) {
+        processDeviceTaskLocked(firstTask);
+    } else if (taskCount) {
+        DeviceTaskJob job(this, firstTask);
+        mDeviceWorkerPool->execute(&job, taskCount);
+    }
+}
+
+void InputReader::processDeviceTaskLocked(size_t taskIndex) {
+    // Called on a worker thread while the reader thread holds the lock and waits.
+    const DeviceTask& task = mDeviceTasks.itemAt(taskIndex);
+    for (size_t i = 0; i < task.runIndices.size(); i++) {
+        processDeviceRunLocked(task.runIndices.itemAt(i));
+    }
+}
+
+void InputReader::processDeviceRunLocked(size_t runIndex) {
+    const DeviceRun& run = mDeviceRuns.itemAt(runIndex);
+    pthread_setspecific(mDeviceRunListenerKey, mDeviceRunListeners.itemAt(runIndex).get());
+    run.device->process(run.rawEvents, run.count);
+    pthread_setspecific(mDeviceRunListenerKey, NULL);
+}
+
+void InputReader::fadePointerIfRequestedLocked() {
+    // Called on the reader thread while no worker is running.
+    if (mFadePointerRequested) {
+        mFadePointerRequested = false;
+        fadePointerLocked();
+    }
+}
+
 void InputReader::timeoutExpiredLocked(nsecs_t when) {
     for (size_t i = 0; i < mDevices.size(); i++) {
         InputDevice* device = mDevices.valueAt(i);
@@ -700,6 +883,8 @@ void InputReader::dump(String8& dump) {
     dump.append("\n");
 
     dump.append("Input Reader State:\n");
+    dump.appendFormat(INDENT "DeviceWorkers: %d\n",
+            mDeviceWorkerPool ? mDeviceWorkerPool->getThreadCount() : 0);
 
     for (size_t i = 0; i < mDevices.size(); i++) {
         mDevices.valueAt(i)->dump(dump);
@@ -778,37 +963,50 @@ InputReader::ContextImpl::ContextImpl(InputReader* reader) :
 
 void InputReader::ContextImpl::updateGlobalMetaState() {
     // lock is already held by the input loop
+    AutoMutex _l(mReader->mContextLock);
     mReader->updateGlobalMetaStateLocked();
 }
 
 int32_t InputReader::ContextImpl::getGlobalMetaState() {
     // lock is already held by the input loop
+    AutoMutex _l(mReader->mContextLock);
     return mReader->getGlobalMetaStateLocked();
 }
 
 void InputReader::ContextImpl::disableVirtualKeysUntil(nsecs_t time) {
     // lock is already held by the input loop
+    AutoMutex _l(mReader->mContextLock);
     mReader->disableVirtualKeysUntilLocked(time);
 }
 
 bool InputReader::ContextImpl::shouldDropVirtualKey(nsecs_t now,
         InputDevice* device, int32_t keyCode, int32_t scanCode) {
     // lock is already held by the input loop
+    AutoMutex _l(mReader->mContextLock);
     return mReader->shouldDropVirtualKeyLocked(now, device, keyCode, scanCode);
 }
 
 void InputReader::ContextImpl::fadePointer() {
     // lock is already held by the input loop
-    mReader->fadePointerLocked();
+    AutoMutex _l(mReader->mContextLock);
+    if (pthread_getspecific(mReader->mDeviceRunListenerKey)) {
+        // Fading touches the mappers of every device, which the workers may be
+        // processing, so defer it until the current runs are done.
+        mReader->mFadePointerRequested = true;
+    } else {
+        mReader->fadePointerLocked();
+    }
 }
 
 void InputReader::ContextImpl::requestTimeoutAtTime(nsecs_t when) {
     // lock is already held by the input loop
+    AutoMutex _l(mReader->mContextLock);
     mReader->requestTimeoutAtTimeLocked(when);
 }
 
 int32_t InputReader::ContextImpl::bumpGeneration() {
     // lock is already held by the input loop
+    AutoMutex _l(mReader->mContextLock);
     return mReader->bumpGenerationLocked();
 }
 
@@ -817,7 +1015,10 @@ InputReaderPolicyInterface* InputReader::ContextImpl::getPolicy() {
 }
 
 InputListenerInterface* InputReader::ContextImpl::getListener() {
-    return mReader->mQueuedListener.get();
+    // Device runs that are processed in parallel queue their output separately.
+    QueuedInputListener* listener = static_cast<QueuedInputListener*>(
+            pthread_getspecific(mReader->mDeviceRunListenerKey));
+    return listener ? listener : mReader->mQueuedListener.get();
 }
 
 EventHubInterface* InputReader::ContextImpl::getEventHub() {
@@ -825,6 +1026,99 @@ EventHubInterface* InputReader::ContextImpl::getEventHub() {
 }
 
 
+// --- InputReader::DeviceTaskJob ---
+
+InputReader::DeviceTaskJob::DeviceTaskJob(InputReader* reader, size_t firstTask) :
+        mReader(reader), mFirstTask(firstTask) {
+}
+
+void InputReader::DeviceTaskJob::execute(size_t index) {
+    mReader->processDeviceTaskLocked(mFirstTask + index);
+}
+
+
+// --- InputDeviceWorkerPool ---
+
+InputDeviceWorkerPool::InputDeviceWorkerPool(size_t threadCount) :
+        mJob(NULL), mJobSize(0), mNextIndex(0), mPendingCount(0), mExiting(false) {
+    for (size_t i = 0; i < threadCount; i++) {
+        sp<WorkerThread> thread = new WorkerThread(this);
+        String8 name;
+        name.appendFormat("InputWorker%d", i);
+        thread->run(name.string(), PRIORITY_URGENT_DISPLAY);
+        mThreads.push(thread);
+    }
+}
+
+InputDeviceWorkerPool::~InputDeviceWorkerPool() {
+    { // acquire lock
+        AutoMutex _l(mLock);
+        mExiting = true;
+        mWorkAvailableCondition.broadcast();
+    } // release lock
+
+    for (size_t i = 0; i < mThreads.size(); i++) {
+        mThreads.itemAt(i)->requestExitAndWait();
+    }
+}
+
+void InputDeviceWorkerPool::execute(Job* job, size_t count) {
+    AutoMutex _l(mLock);
+
+    mJob = job;
+    mJobSize = count;
+    mNextIndex = 0;
+    mPendingCount = count;
+    mWorkAvailableCondition.broadcast();
+
+    executePendingLocked();
+    while (mPendingCount) {
+        mWorkDoneCondition.wait(mLock);
+    }
+    mJob = NULL;
+}
+
+bool InputDeviceWorkerPool::workerLoop() {
+    AutoMutex _l(mLock);
+
+    while (!mExiting && (!mJob || mNextIndex >= mJobSize)) {
+        mWorkAvailableCondition.wait(mLock);
+    }
+    if (mExiting) {
+        return false;
+    }
+
+    executePendingLocked();
+    return true;
+}
+
+void InputDeviceWorkerPool::executePendingLocked() {
+    while (mJob && mNextIndex < mJobSize) {
+        Job* job = mJob;
+        size_t index = mNextIndex++;
+
+        mLock.unlock();
+        job->execute(index);
+        mLock.lock();
+
+        if (--mPendingCount == 0) {
+            mWorkDoneCondition.broadcast();
+        }
+    }
+}
+
+
+// --- InputDeviceWorkerPool::WorkerThread ---
+
+InputDeviceWorkerPool::WorkerThread::WorkerThread(InputDeviceWorkerPool* pool) :
+        Thread(/*canCallJava*/ false), mPool(pool) {
+}
+
+bool InputDeviceWorkerPool::WorkerThread::threadLoop() {
+    return mPool->workerLoop();
+}
+
+
 // --- InputReaderThread ---
 
 InputReaderThread::InputReaderThread(const sp<InputReaderInterface>& reader) :
@@ -1083,6 +1377,17 @@ void InputDevice::fadePointer() {
     }
 }
 
+bool InputDevice::usesPointerController() {
+    size_t numMappers = mMappers.size();
+    for (size_t i = 0; i < numMappers; i++) {
+        InputMapper* mapper = mMappers[i];
+        if (mapper->usesPointerController()) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void InputDevice::bumpGeneration() {
     mGeneration = mContext->bumpGeneration();
 }
@@ -1802,6 +2107,10 @@ int32_t InputMapper::getMetaState() {
 void InputMapper::fadePointer() {
 }
 
+bool InputMapper::usesPointerController() {
+    return false;
+}
+
 status_t InputMapper::getAbsoluteAxisInfo(int32_t axis, RawAbsoluteAxisInfo* axisInfo) {
     return getEventHub()->getAbsoluteAxisInfo(getDeviceId(), axis, axisInfo);
 }
@@ -2589,6 +2898,10 @@ void CursorInputMapper::fadePointer() {
     }
 }
 
+bool CursorInputMapper::usesPointerController() {
+    return mPointerController != NULL;
+}
+
 
 // --- TouchInputMapper ---
 
@@ -2796,6 +3109,20 @@ void TouchInputMapper::configureParameters() {
         }
     }
 
+    mParameters.pointerIdAssignment = Parameters::POINTER_ID_ASSIGNMENT_GREEDY;
+    String8 pointerIdAssignmentString;
+    if (getDevice()->getConfiguration().tryGetProperty(String8("touch.pointerIdAssignment"),
+            pointerIdAssignmentString)) {
+        if (pointerIdAssignmentString == "greedy") {
+            mParameters.pointerIdAssignment = Parameters::POINTER_ID_ASSIGNMENT_GREEDY;
+        } else if (pointerIdAssignmentString == "optimal") {
+            mParameters.pointerIdAssignment = Parameters::POINTER_ID_ASSIGNMENT_OPTIMAL;
+        } else if (pointerIdAssignmentString != "default") {
+            ALOGW("Invalid value for touch.pointerIdAssignment: '%s'",
+                    pointerIdAssignmentString.string());
+        }
+    }
+
     if (getEventHub()->hasInputProperty(getDeviceId(), INPUT_PROP_DIRECT)) {
         // The device is a touch screen.
         mParameters.deviceType = Parameters::DEVICE_TYPE_TOUCH_SCREEN;
@@ -2856,6 +3183,17 @@ void TouchInputMapper::dumpParameters(String8& dump) {
         assert(false);
     }
 
+    switch (mParameters.pointerIdAssignment) {
+    case Parameters::POINTER_ID_ASSIGNMENT_GREEDY:
+        dump.append(INDENT4 "PointerIdAssignment: greedy\n");
+        break;
+    case Parameters::POINTER_ID_ASSIGNMENT_OPTIMAL:
+        dump.append(INDENT4 "PointerIdAssignment: optimal\n");
+        break;
+    default:
+        assert(false);
+    }
+
     switch (mParameters.deviceType) {
     case Parameters::DEVICE_TYPE_TOUCH_SCREEN:
         dump.append(INDENT4 "DeviceType: touchScreen\n");
@@ -5577,6 +5915,10 @@ void TouchInputMapper::fadePointer() {
     }
 }
 
+bool TouchInputMapper::usesPointerController() {
+    return mPointerController != NULL;
+}
+
 void TouchInputMapper::unfadePointer(PointerControllerInterface::Transition transition) {
     if (mPointerController != NULL &&
             !(mPointerUsage == POINTER_USAGE_STYLUS && !mConfig.stylusIconEnabled)) {
@@ -5652,6 +5994,11 @@ void TouchInputMapper::assignPointerIds() {
         return;
     }
 
+    if (mParameters.pointerIdAssignment == Parameters::POINTER_ID_ASSIGNMENT_OPTIMAL) {
+        assignPointerIdsOptimal();
+        return;
+    }
+
     // General case.
     // We build a heap of squared euclidean distances between current and last pointers
     // associated with the current and last pointer indices.  Then, we find the best
@@ -5806,6 +6153,169 @@ void TouchInputMapper::assignPointerIds() {
     }
 }
 
+// Solves the square assignment problem for the given cost matrix using the Hungarian
+// method in O(size^3).  On return, outColumnForRow[row] holds the column assigned to
+// each row such that the sum of the costs of all assignments is minimal.
+static void solveAssignmentProblem(uint32_t size,
+        const int64_t cost[MAX_POINTERS][MAX_POINTERS], uint32_t* outColumnForRow) {
+    const int64_t infinity = 1LL << 62;
+
+    // Arrays are indexed from 1; row and column 0 are sentinels used by the algorithm.
+    int64_t rowPotential[MAX_POINTERS + 1];
+    int64_t columnPotential[MAX_POINTERS + 1];
+    int64_t minSlack[MAX_POINTERS + 1];
+    uint32_t rowForColumn[MAX_POINTERS + 1];
+    uint32_t previousColumn[MAX_POINTERS + 1];
+    bool visited[MAX_POINTERS + 1];
+
+    for (uint32_t i = 0; i <= size; i++) {
+        rowPotential[i] = 0;
+        columnPotential[i] = 0;
+        rowForColumn[i] = 0;
+        previousColumn[i] = 0;
+    }
+
+    for (uint32_t row = 1; row <= size; row++) {
+        // Grow an alternating tree from the new row until it reaches a free column.
+        rowForColumn[0] = row;
+        uint32_t column = 0;
+        for (uint32_t j = 0; j <= size; j++) {
+            minSlack[j] = infinity;
+            visited[j] = false;
+        }
+        do {
+            visited[column] = true;
+            uint32_t treeRow = rowForColumn[column];
+            int64_t delta = infinity;
+            uint32_t nextColumn = 0;
+            for (uint32_t j = 1; j <= size; j++) {
+                if (!visited[j]) {
+                    int64_t slack = cost[treeRow - 1][j - 1]
+                            - rowPotential[treeRow] - columnPotential[j];
+                    if (slack < minSlack[j]) {
+                        minSlack[j] = slack;
+                        previousColumn[j] = column;
+                    }
+                    if (minSlack[j] < delta) {
+                        delta = minSlack[j];
+                        nextColumn = j;
+                    }
+                }
+            }
+            for (uint32_t j = 0; j <= size; j++) {
+                if (visited[j]) {
+                    rowPotential[rowForColumn[j]] += delta;
+                    columnPotential[j] -= delta;
+                } else {
+                    minSlack[j] -= delta;
+                }
+            }
+            column = nextColumn;
+        } while (rowForColumn[column] != 0);
+
+        // Flip the augmenting path.
+        do {
+            uint32_t previous = previousColumn[column];
+            rowForColumn[column] = rowForColumn[previous];
+            column = previous;
+        } while (column != 0);
+    }
+
+    for (uint32_t j = 1; j <= size; j++) {
+        outColumnForRow[rowForColumn[j] - 1] = j - 1;
+    }
+}
+
+void TouchInputMapper::assignPointerIdsOptimal() {
+    uint32_t currentPointerCount = mCurrentRawPointerData.pointerCount;
+    uint32_t lastPointerCount = mLastRawPointerData.pointerCount;
+
+    // Build a square matrix of squared euclidean distances between current pointers
+    // (rows) and last pointers (columns) and find the matching with the least total
+    // distance.  Unlike the greedy strategy this does not swap the ids of pointers that
+    // move quickly past each other because the closest pair is not always matched.
+    //
+    // Rows or columns that pad the matrix to a square have no cost; a current pointer
+    // matched to a padding column gets a fresh id.  Pointers with different tool types
+    // must not be matched so those pairs cost more than any set of real matches, which
+    // means they are only used when nothing else is left and are discarded afterwards.
+    const int64_t maxDistance = 1LL << 40;
+    const int64_t mismatchedToolTypeCost = 1LL << 50;
+
+    uint32_t size = currentPointerCount > lastPointerCount
+            ? currentPointerCount : lastPointerCount;
+    int64_t cost[MAX_POINTERS][MAX_POINTERS];
+    for (uint32_t currentPointerIndex = 0; currentPointerIndex < size; currentPointerIndex++) {
+        for (uint32_t lastPointerIndex = 0; lastPointerIndex < size; lastPointerIndex++) {
+            if (currentPointerIndex >= currentPointerCount
+                    || lastPointerIndex >= lastPointerCount) {
+                cost[currentPointerIndex][lastPointerIndex] = 0;
+                continue;
+            }
+
+            const RawPointerData::Pointer& currentPointer =
+                    mCurrentRawPointerData.pointers[currentPointerIndex];
+            const RawPointerData::Pointer& lastPointer =
+                    mLastRawPointerData.pointers[lastPointerIndex];
+            if (currentPointer.toolType != lastPointer.toolType) {
+                cost[currentPointerIndex][lastPointerIndex] = mismatchedToolTypeCost;
+                continue;
+            }
+
+            int64_t deltaX = currentPointer.x - lastPointer.x;
+            int64_t deltaY = currentPointer.y - lastPointer.y;
+            int64_t distance = deltaX * deltaX + deltaY * deltaY;
+            cost[currentPointerIndex][lastPointerIndex] =
+                    distance < maxDistance ? distance : maxDistance;
+        }
+    }
+
+    uint32_t lastPointerIndexForCurrent[MAX_POINTERS];
+    solveAssignmentProblem(size, cost, lastPointerIndexForCurrent);
+
+    BitSet32 matchedCurrentBits(0);
+    BitSet32 usedIdBits(0);
+    for (uint32_t currentPointerIndex = 0; currentPointerIndex < currentPointerCount;
+            currentPointerIndex++) {
+        uint32_t lastPointerIndex = lastPointerIndexForCurrent[currentPointerIndex];
+        if (lastPointerIndex >= lastPointerCount
+                || cost[currentPointerIndex][lastPointerIndex] == mismatchedToolTypeCost) {
+            continue;
+        }
+
+        matchedCurrentBits.markBit(currentPointerIndex);
+
+        uint32_t id = mLastRawPointerData.pointers[lastPointerIndex].id;
+        mCurrentRawPointerData.pointers[currentPointerIndex].id = id;
+        mCurrentRawPointerData.idToIndex[id] = currentPointerIndex;
+        mCurrentRawPointerData.markIdBit(id,
+                mCurrentRawPointerData.isHovering(currentPointerIndex));
+        usedIdBits.markBit(id);
+
+#if DEBUG_POINTER_ASSIGNMENT
+        ALOGD("assignPointerIdsOptimal - matched: cur=%d, last=%d, id=%d, distance=%lld",
+                currentPointerIndex, lastPointerIndex, id,
+                cost[currentPointerIndex][lastPointerIndex]);
+#endif
+    }
+
+    // Assign fresh ids to pointers that were not matched in the process.
+    for (uint32_t i = currentPointerCount - matchedCurrentBits.count(); i != 0; i--) {
+        uint32_t currentPointerIndex = matchedCurrentBits.markFirstUnmarkedBit();
+        uint32_t id = usedIdBits.markFirstUnmarkedBit();
+
+        mCurrentRawPointerData.pointers[currentPointerIndex].id = id;
+        mCurrentRawPointerData.idToIndex[id] = currentPointerIndex;
+        mCurrentRawPointerData.markIdBit(id,
+                mCurrentRawPointerData.isHovering(currentPointerIndex));
+
+#if DEBUG_POINTER_ASSIGNMENT
+        ALOGD("assignPointerIdsOptimal - assigned: cur=%d, id=%d",
+                currentPointerIndex, id);
+#endif
+    }
+}
+
 int32_t TouchInputMapper::getKeyCodeState(uint32_t sourceMask, int32_t keyCode) {
     if (mCurrentVirtualKey.down && mCurrentVirtualKey.keyCode == keyCode) {
         return AKEY_STATE_VIRTUAL;
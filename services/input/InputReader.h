@@ -31,6 +31,7 @@
 #include <utils/String8.h>
 #include <utils/BitSet.h>
 
+#include <pthread.h>
 #include <stddef.h>
 #include <unistd.h>
 
@@ -378,6 +379,56 @@ public:
 };
 
 
+/*
+ * A small pool of threads that the InputReader uses to process the raw events of
+ * independent input devices concurrently.  The thread that calls execute() takes
+ * part in the work and only returns once every item of the job has been processed.
+ */
+class InputDeviceWorkerPool {
+public:
+    class Job {
+    public:
+        virtual ~Job() { }
+        virtual void execute(size_t index) = 0;
+    };
+
+    InputDeviceWorkerPool(size_t threadCount);
+    ~InputDeviceWorkerPool();
+
+    inline size_t getThreadCount() const { return mThreads.size(); }
+
+    /* Calls job->execute(index) for each index in [0, count) and waits for all of
+     * them to finish. */
+    void execute(Job* job, size_t count);
+
+private:
+    class WorkerThread : public Thread {
+    public:
+        WorkerThread(InputDeviceWorkerPool* pool);
+
+    private:
+        InputDeviceWorkerPool* mPool;
+
+        virtual bool threadLoop();
+    };
+
+    Mutex mLock;
+    Condition mWorkAvailableCondition;
+    Condition mWorkDoneCondition;
+
+    Job* mJob;
+    size_t mJobSize;
+    size_t mNextIndex;
+    size_t mPendingCount;
+    bool mExiting;
+
+    Vector<sp<WorkerThread> > mThreads;
+
+    bool workerLoop();
+    void executePendingLocked();
+};
+
+
 /* The input reader reads raw event data from the event hub and processes it into input events
  * that it sends to the input listener.  Some functions of the input reader, such as early
  * event filtering in low power states, are controlled by a separate policy object.
@@ -388,6 +439,11 @@ public:
  * uses a single Mutex to guard its state.  The Mutex may be held while calling into the
  * EventHub or the InputReaderPolicy but it is never held while calling into the
  * InputListener.
+ *
+ * Optionally, the raw events of different devices can be processed concurrently by a
+ * small pool of device workers while the reader thread holds the Mutex and waits.  The
+ * events of any one device are still processed in order by a single thread and the
+ * cooked events are merged back in the order in which the raw events were read.
  */
 class InputReader : public InputReaderInterface {
 public:
@@ -419,6 +475,10 @@ public:
             ssize_t repeat, int32_t token);
     virtual void cancelVibrate(int32_t deviceId, int32_t token);
 
+    /* Sets the number of worker threads used to process the events of different input
+     * devices concurrently, or 0 to process every device on the reader thread. */
+    void setDeviceWorkerCount(size_t count);
+
 protected:
     // These members are protected so they can be instrumented by test cases.
     virtual InputDevice* createDeviceLocked(int32_t deviceId,
@@ -448,6 +508,9 @@ protected:
 private:
     Mutex mLock;
 
+    // Serializes calls into the context made by device workers.
+    Mutex mContextLock;
+
     Condition mReaderIsAliveCondition;
 
     sp<EventHubInterface> mEventHub;
@@ -500,6 +563,47 @@ private:
             GetStateFunc getStateFunc);
     bool markSupportedKeyCodesLocked(int32_t deviceId, uint32_t sourceMask, size_t numCodes,
             const int32_t* keyCodes, uint8_t* outFlags);
+
+    // parallel device processing
+    struct DeviceRun {
+        InputDevice* device;
+        const RawEvent* rawEvents;
+        size_t count;
+        ssize_t taskIndex; // -1 if the run must be processed on the reader thread
+    };
+
+    struct DeviceTask {
+        InputDevice* device;
+        Vector<size_t> runIndices;
+    };
+
+    class DeviceTaskJob : public InputDeviceWorkerPool::Job {
+    public:
+        DeviceTaskJob(InputReader* reader, size_t firstTask);
+        virtual void execute(size_t index);
+
+    private:
+        InputReader* mReader;
+        size_t mFirstTask;
+    };
+
+    InputDeviceWorkerPool* mDeviceWorkerPool;
+    pthread_key_t mDeviceRunListenerKey;
+    Vector<DeviceRun> mDeviceRuns;
+    Vector<DeviceTask> mDeviceTasks;
+    Vector<sp<QueuedInputListener> > mDeviceRunListeners;
+
+    // Set when a device run asked to fade the pointer while runs were processed in
+    // parallel.  The fade is applied on the reader thread once the workers are done.
+    bool mFadePointerRequested;
+
+    void setDeviceWorkerCountLocked(size_t count);
+    void processEventsInParallelLocked(const RawEvent* rawEvents, size_t count);
+    void processDeviceTasksLocked(size_t firstTask, size_t taskCount);
+    void processDeviceTaskLocked(size_t taskIndex);
+    void processDeviceRunLocked(size_t runIndex);
+    void fadePointerIfRequestedLocked();
+    static bool canProcessDeviceInParallel(InputDevice* device);
 };
 
 
@@ -554,6 +658,7 @@ public:
     int32_t getMetaState();
 
     void fadePointer();
+    bool usesPointerController();
 
     void bumpGeneration();
 
@@ -951,6 +1056,10 @@ public:
 
     virtual void fadePointer();
 
+    /* Returns true if the mapper drives the pointer controller, which is shared by
+     * every device. */
+    virtual bool usesPointerController();
+
 protected:
     InputDevice* mDevice;
     InputReaderContext* mContext;
@@ -1094,6 +1203,7 @@ public:
     virtual int32_t getScanCodeState(uint32_t sourceMask, int32_t scanCode);
 
     virtual void fadePointer();
+    virtual bool usesPointerController();
 
 private:
     // Amount that trackball needs to move in order to generate a key event.
@@ -1162,6 +1272,7 @@ public:
             const int32_t* keyCodes, uint8_t* outFlags);
 
     virtual void fadePointer();
+    virtual bool usesPointerController();
     virtual void timeoutExpired(nsecs_t when);
 
 protected:
@@ -1217,6 +1328,14 @@ protected:
             GESTURE_MODE_SPOTS,
         };
         GestureMode gestureMode;
+
+        enum PointerIdAssignment {
+            // Match the closest pair of pointers first, then the next closest, and so on.
+            POINTER_ID_ASSIGNMENT_GREEDY,
+            // Match pointers so that the total distance they moved is minimized.
+            POINTER_ID_ASSIGNMENT_OPTIMAL,
+        };
+        PointerIdAssignment pointerIdAssignment;
     } mParameters;
 
     // Immutable calibration parameters in parsed form.
@@ -1677,6 +1796,7 @@ private:
     const VirtualKey* findVirtualKeyHit(int32_t x, int32_t y);
 
     void assignPointerIds();
+    void assignPointerIdsOptimal();
 
     void unfadePointer(PointerControllerInterface::Transition transition);
 
@@ -0,0 +1,1138 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "InputTrace"
+
+//#define LOG_NDEBUG 0
+
+#include "InputTrace.h"
+
+#include <cutils/log.h>
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#define INDENT "  "
+
+namespace android {
+
+// --- Constants ---
+
+static const uint32_t TRACE_MAGIC = 0x52544941; // "AITR" in little-endian byte order
+static const uint32_t TRACE_VERSION = 2;
+
+enum {
+    TAG_DEVICE = 1,
+    TAG_BATCH = 2,
+};
+
+// --- Static Functions ---
+
+static void appendVarint(Vector<uint8_t>& buffer, uint64_t value) {
+    while (value >= 0x80) {
+        buffer.push(uint8_t(value | 0x80));
+        value >>= 7;
+    }
+    buffer.push(uint8_t(value));
+}
+
+static void appendSigned(Vector<uint8_t>& buffer, int64_t value) {
+    appendVarint(buffer, (uint64_t(value) << 1) ^ uint64_t(value >> 63));
+}
+
+static void appendString(Vector<uint8_t>& buffer, const String8& value) {
+    appendVarint(buffer, value.size());
+    buffer.appendArray(reinterpret_cast<const uint8_t*>(value.string()), value.size());
+}
+
+static void appendUint32(Vector<uint8_t>& buffer, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        buffer.push(uint8_t(value >> (i * 8)));
+    }
+}
+
+/* Decodes trace records from a memory buffer. */
+class TraceParser {
+public:
+    TraceParser(const uint8_t* data, size_t size) :
+            mData(data), mEnd(data + size), mError(false) {
+    }
+
+    inline bool hasError() const { return mError; }
+    inline bool isEof() const { return mData >= mEnd; }
+
+    uint8_t readByte() {
+        if (mData >= mEnd) {
+            mError = true;
+            return 0;
+        }
+        return *(mData++);
+    }
+
+    uint32_t readUint32() {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; i++) {
+            value |= uint32_t(readByte()) << (i * 8);
+        }
+        return value;
+    }
+
+    uint64_t readVarint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t byte = readByte();
+            value |= uint64_t(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                return value;
+            }
+        }
+        mError = true;
+        return 0;
+    }
+
+    int64_t readSigned() {
+        uint64_t value = readVarint();
+        return int64_t(value >> 1) ^ -int64_t(value & 1);
+    }
+
+    String8 readString() {
+        size_t size = readVarint();
+        if (size > size_t(mEnd - mData)) {
+            mError = true;
+            return String8();
+        }
+        String8 value(reinterpret_cast<const char*>(mData), size);
+        mData += size;
+        return value;
+    }
+
+private:
+    const uint8_t* mData;
+    const uint8_t* mEnd;
+    bool mError;
+};
+
+static void writeDeviceRecord(Vector<uint8_t>& buffer, const InputTraceDevice& device) {
+    buffer.push(TAG_DEVICE);
+    appendSigned(buffer, device.id);
+    appendVarint(buffer, device.classes);
+    appendString(buffer, device.identifier.name);
+    appendString(buffer, device.identifier.location);
+    appendString(buffer, device.identifier.uniqueId);
+    appendString(buffer, device.identifier.descriptor);
+    appendVarint(buffer, device.identifier.bus);
+    appendVarint(buffer, device.identifier.vendor);
+    appendVarint(buffer, device.identifier.product);
+    appendVarint(buffer, device.identifier.version);
+
+    const KeyedVector<String8, String8>& properties = device.configuration.getProperties();
+    appendVarint(buffer, properties.size());
+    for (size_t i = 0; i < properties.size(); i++) {
+        appendString(buffer, properties.keyAt(i));
+        appendString(buffer, properties.valueAt(i));
+    }
+
+    appendVarint(buffer, device.keysByScanCode.size());
+    for (size_t i = 0; i < device.keysByScanCode.size(); i++) {
+        const InputTraceDevice::KeyInfo& key = device.keysByScanCode.valueAt(i);
+        appendVarint(buffer, device.keysByScanCode.keyAt(i));
+        appendSigned(buffer, key.keyCode);
+        appendVarint(buffer, key.flags);
+        buffer.push(key.down ? 1 : 0);
+    }
+
+    appendVarint(buffer, device.absoluteAxes.size());
+    for (size_t i = 0; i < device.absoluteAxes.size(); i++) {
+        const InputTraceDevice::AxisState& axis = device.absoluteAxes.valueAt(i);
+        appendVarint(buffer, device.absoluteAxes.keyAt(i));
+        appendSigned(buffer, axis.info.minValue);
+        appendSigned(buffer, axis.info.maxValue);
+        appendSigned(buffer, axis.info.flat);
+        appendSigned(buffer, axis.info.fuzz);
+        appendSigned(buffer, axis.info.resolution);
+        appendSigned(buffer, axis.value);
+        buffer.push(axis.hasMapping ? 1 : 0);
+        if (axis.hasMapping) {
+            appendVarint(buffer, axis.mapping.mode);
+            appendSigned(buffer, axis.mapping.axis);
+            appendSigned(buffer, axis.mapping.highAxis);
+            appendSigned(buffer, axis.mapping.splitValue);
+            appendSigned(buffer, axis.mapping.flatOverride);
+        }
+    }
+
+    appendVarint(buffer, device.relativeAxes.size());
+    for (size_t i = 0; i < device.relativeAxes.size(); i++) {
+        appendVarint(buffer, device.relativeAxes.itemAt(i));
+    }
+
+    appendVarint(buffer, device.inputProperties.size());
+    for (size_t i = 0; i < device.inputProperties.size(); i++) {
+        appendVarint(buffer, device.inputProperties.itemAt(i));
+    }
+
+    appendVarint(buffer, device.leds.size());
+    for (size_t i = 0; i < device.leds.size(); i++) {
+        appendVarint(buffer, device.leds.keyAt(i));
+        buffer.push(device.leds.valueAt(i) ? 1 : 0);
+    }
+
+    appendVarint(buffer, device.switchStates.size());
+    for (size_t i = 0; i < device.switchStates.size(); i++) {
+        appendVarint(buffer, device.switchStates.keyAt(i));
+        appendSigned(buffer, device.switchStates.valueAt(i));
+    }
+
+    appendVarint(buffer, device.virtualKeys.size());
+    for (size_t i = 0; i < device.virtualKeys.size(); i++) {
+        const VirtualKeyDefinition& virtualKey = device.virtualKeys.itemAt(i);
+        appendVarint(buffer, virtualKey.scanCode);
+        appendSigned(buffer, virtualKey.centerX);
+        appendSigned(buffer, virtualKey.centerY);
+        appendSigned(buffer, virtualKey.width);
+        appendSigned(buffer, virtualKey.height);
+    }
+
+    buffer.push(device.hasKeyCharacterMap ? 1 : 0);
+    if (device.hasKeyCharacterMap) {
+        appendVarint(buffer, device.keyCharacterMap.size());
+        for (size_t i = 0; i < device.keyCharacterMap.size(); i++) {
+            appendSigned(buffer, device.keyCharacterMap.itemAt(i));
+        }
+    }
+}
+
+static void readDeviceRecord(TraceParser& parser, InputTraceDevice& device) {
+    device.id = parser.readSigned();
+    device.classes = parser.readVarint();
+    device.identifier.name = parser.readString();
+    device.identifier.location = parser.readString();
+    device.identifier.uniqueId = parser.readString();
+    device.identifier.descriptor = parser.readString();
+    device.identifier.bus = parser.readVarint();
+    device.identifier.vendor = parser.readVarint();
+    device.identifier.product = parser.readVarint();
+    device.identifier.version = parser.readVarint();
+
+    size_t count = parser.readVarint();
+    for (size_t i = 0; i < count && !parser.hasError(); i++) {
+        String8 key = parser.readString();
+        String8 value = parser.readString();
+        device.configuration.addProperty(key, value);
+    }
+
+    count = parser.readVarint();
+    for (size_t i = 0; i < count && !parser.hasError(); i++) {
+        int32_t scanCode = parser.readVarint();
+        InputTraceDevice::KeyInfo key;
+        key.keyCode = parser.readSigned();
+        key.flags = parser.readVarint();
+        key.down = parser.readByte() != 0;
+        device.keysByScanCode.add(scanCode, key);
+    }
+
+    count = parser.readVarint();
+    for (size_t i = 0; i < count && !parser.hasError(); i++) {
+        int32_t axisCode = parser.readVarint();
+        InputTraceDevice::AxisState axis;
+        axis.info.valid = true;
+        axis.info.minValue = parser.readSigned();
+        axis.info.maxValue = parser.readSigned();
+        axis.info.flat = parser.readSigned();
+        axis.info.fuzz = parser.readSigned();
+        axis.info.resolution = parser.readSigned();
+        axis.value = parser.readSigned();
+        axis.hasMapping = parser.readByte() != 0;
+        if (axis.hasMapping) {
+            axis.mapping.mode = AxisInfo::Mode(parser.readVarint());
+            axis.mapping.axis = parser.readSigned();
+            axis.mapping.highAxis = parser.readSigned();
+            axis.mapping.splitValue = parser.readSigned();
+            axis.mapping.flatOverride = parser.readSigned();
+        }
+        device.absoluteAxes.add(axisCode, axis);
+    }
+
+    count = parser.readVarint();
+    for (size_t i = 0; i < count && !parser.hasError(); i++) {
+        device.relativeAxes.push(int32_t(parser.readVarint()));
+    }
+
+    count = parser.readVarint();
+    for (size_t i = 0; i < count && !parser.hasError(); i++) {
+        device.inputProperties.push(int32_t(parser.readVarint()));
+    }
+
+    count = parser.readVarint();
+    for (size_t i = 0; i < count && !parser.hasError(); i++) {
+        int32_t led = parser.readVarint();
+        device.leds.add(led, parser.readByte() != 0);
+    }
+
+    count = parser.readVarint();
+    for (size_t i = 0; i < count && !parser.hasError(); i++) {
+        int32_t sw = parser.readVarint();
+        device.switchStates.add(sw, int32_t(parser.readSigned()));
+    }
+
+    count = parser.readVarint();
+    for (size_t i = 0; i < count && !parser.hasError(); i++) {
+        VirtualKeyDefinition virtualKey;
+        virtualKey.scanCode = parser.readVarint();
+        virtualKey.centerX = parser.readSigned();
+        virtualKey.centerY = parser.readSigned();
+        virtualKey.width = parser.readSigned();
+        virtualKey.height = parser.readSigned();
+        device.virtualKeys.push(virtualKey);
+    }
+
+    device.hasKeyCharacterMap = parser.readByte() != 0;
+    if (device.hasKeyCharacterMap) {
+        count = parser.readVarint();
+        for (size_t i = 0; i < count && !parser.hasError(); i++) {
+            device.keyCharacterMap.push(int32_t(parser.readSigned()));
+        }
+    }
+}
+
+
+// --- InputTraceDevice ---
+
+void InputTraceDevice::captureFrom(const EventHubInterface* eventHub, int32_t deviceId) {
+    id = deviceId;
+    classes = eventHub->getDeviceClasses(deviceId);
+    identifier = eventHub->getDeviceIdentifier(deviceId);
+    configuration.clear();
+    eventHub->getConfiguration(deviceId, &configuration);
+
+    keysByScanCode.clear();
+    for (int32_t scanCode = 0; scanCode <= KEY_MAX; scanCode++) {
+        KeyInfo key;
+        if (!eventHub->mapKey(deviceId, scanCode, 0, &key.keyCode, &key.flags)) {
+            key.down = eventHub->getScanCodeState(deviceId, scanCode) == AKEY_STATE_DOWN;
+            keysByScanCode.add(scanCode, key);
+        } else if (eventHub->hasScanCode(deviceId, scanCode)) {
+            // Buttons such as BTN_TOUCH and BTN_LEFT usually have no key layout entry
+            // but the mappers still query whether they exist.
+            key.keyCode = AKEYCODE_UNKNOWN;
+            key.flags = 0;
+            key.down = eventHub->getScanCodeState(deviceId, scanCode) == AKEY_STATE_DOWN;
+            keysByScanCode.add(scanCode, key);
+        }
+    }
+
+    absoluteAxes.clear();
+    for (int axisCode = 0; axisCode <= ABS_MAX; axisCode++) {
+        AxisState axis;
+        if (!eventHub->getAbsoluteAxisInfo(deviceId, axisCode, &axis.info) && axis.info.valid) {
+            if (eventHub->getAbsoluteAxisValue(deviceId, axisCode, &axis.value)) {
+                axis.value = 0;
+            }
+            axis.hasMapping = !eventHub->mapAxis(deviceId, axisCode, &axis.mapping);
+            absoluteAxes.add(axisCode, axis);
+        }
+    }
+
+    relativeAxes.clear();
+    for (int axisCode = 0; axisCode <= REL_MAX; axisCode++) {
+        if (eventHub->hasRelativeAxis(deviceId, axisCode)) {
+            relativeAxes.push(axisCode);
+        }
+    }
+
+    inputProperties.clear();
+    for (int property = 0; property <= INPUT_PROP_MAX; property++) {
+        if (eventHub->hasInputProperty(deviceId, property)) {
+            inputProperties.push(property);
+        }
+    }
+
+    leds.clear();
+    for (int32_t led = 0; led <= LED_MAX; led++) {
+        if (eventHub->hasLed(deviceId, led)) {
+            leds.add(led, false);
+        }
+    }
+
+    switchStates.clear();
+    for (int32_t sw = 0; sw <= SW_MAX; sw++) {
+        int32_t state = eventHub->getSwitchState(deviceId, sw);
+        if (state != AKEY_STATE_UNKNOWN) {
+            switchStates.add(sw, state);
+        }
+    }
+
+    eventHub->getVirtualKeyDefinitions(deviceId, virtualKeys);
+
+    keyCharacterMap.clear();
+    sp<KeyCharacterMap> map = eventHub->getKeyCharacterMap(deviceId);
+    hasKeyCharacterMap = map != NULL;
+    if (hasKeyCharacterMap) {
+        map->getCompiledWords(&keyCharacterMap);
+    }
+}
+
+
+// --- InputTraceWriter ---
+
+InputTraceWriter::InputTraceWriter() :
+        mFile(NULL), mLastWhen(0), mEventCount(0), mByteCount(0) {
+}
+
+InputTraceWriter::~InputTraceWriter() {
+    close();
+}
+
+status_t InputTraceWriter::open(const String8& path) {
+    close();
+
+    mFile = fopen(path.string(), "wb");
+    if (!mFile) {
+        ALOGE("Could not open input trace file '%s' for writing, errno=%d.",
+                path.string(), errno);
+        return -errno;
+    }
+
+    mLastWhen = 0;
+    mEventCount = 0;
+    mByteCount = 0;
+
+    mBuffer.clear();
+    appendUint32(mBuffer, TRACE_MAGIC);
+    appendUint32(mBuffer, TRACE_VERSION);
+    flushBuffer();
+    return OK;
+}
+
+void InputTraceWriter::close() {
+    if (mFile) {
+        fclose(mFile);
+        mFile = NULL;
+    }
+}
+
+void InputTraceWriter::writeDevice(const InputTraceDevice& device) {
+    if (!mFile) {
+        return;
+    }
+
+    writeDeviceRecord(mBuffer, device);
+    flushBuffer();
+}
+
+void InputTraceWriter::writeEvents(nsecs_t readTime, const RawEvent* events, size_t count) {
+    if (!mFile) {
+        return;
+    }
+
+    mBuffer.push(TAG_BATCH);
+    appendSigned(mBuffer, readTime - mLastWhen);
+    mLastWhen = readTime;
+    appendVarint(mBuffer, count);
+    for (size_t i = 0; i < count; i++) {
+        const RawEvent& event = events[i];
+        appendSigned(mBuffer, event.when - mLastWhen);
+        mLastWhen = event.when;
+        appendSigned(mBuffer, event.deviceId);
+        appendVarint(mBuffer, uint32_t(event.type));
+        appendVarint(mBuffer, uint32_t(event.code));
+        appendSigned(mBuffer, event.value);
+    }
+    mEventCount += count;
+    flushBuffer();
+}
+
+void InputTraceWriter::flushBuffer() {
+    if (fwrite(mBuffer.array(), 1, mBuffer.size(), mFile) != mBuffer.size()) {
+        ALOGE("Could not write to input trace file, errno=%d.  Recording stopped.", errno);
+        close();
+    } else {
+        mByteCount += mBuffer.size();
+    }
+    mBuffer.clear();
+}
+
+
+// --- InputTraceReader ---
+
+InputTraceReader::InputTraceReader() {
+}
+
+InputTraceReader::~InputTraceReader() {
+}
+
+status_t InputTraceReader::load(const String8& path) {
+    mBatches.clear();
+    mEvents.clear();
+    mDevices.clear();
+
+    FILE* file = fopen(path.string(), "rb");
+    if (!file) {
+        ALOGE("Could not open input trace file '%s', errno=%d.", path.string(), errno);
+        return -errno;
+    }
+
+    Vector<uint8_t> data;
+    uint8_t chunk[4096];
+    size_t size;
+    while ((size = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        data.appendArray(chunk, size);
+    }
+    fclose(file);
+
+    TraceParser parser(data.array(), data.size());
+    if (parser.readUint32() != TRACE_MAGIC) {
+        ALOGE("Input trace file '%s' has an invalid header.", path.string());
+        return BAD_VALUE;
+    }
+    uint32_t version = parser.readUint32();
+    if (version != TRACE_VERSION) {
+        ALOGE("Input trace file '%s' has unsupported version %d.", path.string(), version);
+        return BAD_VALUE;
+    }
+
+    nsecs_t lastWhen = 0;
+    size_t firstPendingDevice = 0;
+    while (!parser.isEof() && !parser.hasError()) {
+        uint8_t tag = parser.readByte();
+        switch (tag) {
+        case TAG_DEVICE: {
+            InputTraceDevice device;
+            readDeviceRecord(parser, device);
+            mDevices.push(device);
+            break;
+        }
+
+        case TAG_BATCH: {
+            Batch batch;
+            lastWhen += parser.readSigned();
+            batch.readTime = lastWhen;
+            batch.firstEvent = mEvents.size();
+            batch.eventCount = parser.readVarint();
+            batch.firstDevice = firstPendingDevice;
+            batch.deviceCount = mDevices.size() - firstPendingDevice;
+            firstPendingDevice = mDevices.size();
+
+            for (size_t i = 0; i < batch.eventCount && !parser.hasError(); i++) {
+                RawEvent event;
+                lastWhen += parser.readSigned();
+                event.when = lastWhen;
+                event.deviceId = parser.readSigned();
+                event.type = parser.readVarint();
+                event.code = parser.readVarint();
+                event.value = parser.readSigned();
+                mEvents.push(event);
+            }
+            mBatches.push(batch);
+            break;
+        }
+
+        default:
+            ALOGE("Input trace file '%s' contains unknown record tag %d.", path.string(), tag);
+            return BAD_VALUE;
+        }
+    }
+
+    if (parser.hasError()) {
+        // A trace that was being recorded when the process died may be truncated.
+        // Keep whatever complete batches we decoded.
+        ALOGW("Input trace file '%s' is truncated.", path.string());
+        if (!mBatches.isEmpty()) {
+            const Batch& last = mBatches.top();
+            if (last.firstEvent + last.eventCount > mEvents.size()) {
+                mEvents.resize(last.firstEvent);
+                mBatches.pop();
+            }
+        }
+    }
+
+    ALOGI("Loaded input trace '%s': %d devices, %d batches, %d events.", path.string(),
+            mDevices.size(), mBatches.size(), mEvents.size());
+    return OK;
+}
+
+
+// --- RecordingEventHub ---
+
+RecordingEventHub::RecordingEventHub(const sp<EventHubInterface>& eventHub,
+        const String8& tracePath) :
+        mEventHub(eventHub), mTracePath(tracePath) {
+    if (!mWriter.open(tracePath)) {
+        ALOGI("Recording input trace to '%s'.", tracePath.string());
+    }
+}
+
+RecordingEventHub::~RecordingEventHub() {
+}
+
+uint32_t RecordingEventHub::getDeviceClasses(int32_t deviceId) const {
+    return mEventHub->getDeviceClasses(deviceId);
+}
+
+InputDeviceIdentifier RecordingEventHub::getDeviceIdentifier(int32_t deviceId) const {
+    return mEventHub->getDeviceIdentifier(deviceId);
+}
+
+void RecordingEventHub::getConfiguration(int32_t deviceId,
+        PropertyMap* outConfiguration) const {
+    mEventHub->getConfiguration(deviceId, outConfiguration);
+}
+
+status_t RecordingEventHub::getAbsoluteAxisInfo(int32_t deviceId, int axis,
+        RawAbsoluteAxisInfo* outAxisInfo) const {
+    return mEventHub->getAbsoluteAxisInfo(deviceId, axis, outAxisInfo);
+}
+
+bool RecordingEventHub::hasRelativeAxis(int32_t deviceId, int axis) const {
+    return mEventHub->hasRelativeAxis(deviceId, axis);
+}
+
+bool RecordingEventHub::hasInputProperty(int32_t deviceId, int property) const {
+    return mEventHub->hasInputProperty(deviceId, property);
+}
+
+status_t RecordingEventHub::mapKey(int32_t deviceId, int32_t scanCode, int32_t usageCode,
+        int32_t* outKeycode, uint32_t* outFlags) const {
+    return mEventHub->mapKey(deviceId, scanCode, usageCode, outKeycode, outFlags);
+}
+
+status_t RecordingEventHub::mapAxis(int32_t deviceId, int32_t scanCode,
+        AxisInfo* outAxisInfo) const {
+    return mEventHub->mapAxis(deviceId, scanCode, outAxisInfo);
+}
+
+void RecordingEventHub::setExcludedDevices(const Vector<String8>& devices) {
+    mEventHub->setExcludedDevices(devices);
+}
+
+size_t RecordingEventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSize) {
+    size_t count = mEventHub->getEvents(timeoutMillis, buffer, bufferSize);
+    if (count) {
+        nsecs_t readTime = systemTime(SYSTEM_TIME_MONOTONIC);
+
+        AutoMutex _l(mLock);
+
+        // Describe newly added devices before the events that announce them so that
+        // the replay can answer the queries the reader makes when it sees DEVICE_ADDED.
+        for (size_t i = 0; i < count; i++) {
+            if (buffer[i].type == DEVICE_ADDED) {
+                InputTraceDevice device;
+                device.captureFrom(mEventHub.get(), buffer[i].deviceId);
+                mWriter.writeDevice(device);
+            }
+        }
+        mWriter.writeEvents(readTime, buffer, count);
+    }
+    return count;
+}
+
+int32_t RecordingEventHub::getScanCodeState(int32_t deviceId, int32_t scanCode) const {
+    return mEventHub->getScanCodeState(deviceId, scanCode);
+}
+
+int32_t RecordingEventHub::getKeyCodeState(int32_t deviceId, int32_t keyCode) const {
+    return mEventHub->getKeyCodeState(deviceId, keyCode);
+}
+
+int32_t RecordingEventHub::getSwitchState(int32_t deviceId, int32_t sw) const {
+    return mEventHub->getSwitchState(deviceId, sw);
+}
+
+status_t RecordingEventHub::getAbsoluteAxisValue(int32_t deviceId, int32_t axis,
+        int32_t* outValue) const {
+    return mEventHub->getAbsoluteAxisValue(deviceId, axis, outValue);
+}
+
+bool RecordingEventHub::markSupportedKeyCodes(int32_t deviceId, size_t numCodes,
+        const int32_t* keyCodes, uint8_t* outFlags) const {
+    return mEventHub->markSupportedKeyCodes(deviceId, numCodes, keyCodes, outFlags);
+}
+
+bool RecordingEventHub::hasScanCode(int32_t deviceId, int32_t scanCode) const {
+    return mEventHub->hasScanCode(deviceId, scanCode);
+}
+
+bool RecordingEventHub::hasLed(int32_t deviceId, int32_t led) const {
+    return mEventHub->hasLed(deviceId, led);
+}
+
+void RecordingEventHub::setLedState(int32_t deviceId, int32_t led, bool on) {
+    mEventHub->setLedState(deviceId, led, on);
+}
+
+void RecordingEventHub::getVirtualKeyDefinitions(int32_t deviceId,
+        Vector<VirtualKeyDefinition>& outVirtualKeys) const {
+    mEventHub->getVirtualKeyDefinitions(deviceId, outVirtualKeys);
+}
+
+sp<KeyCharacterMap> RecordingEventHub::getKeyCharacterMap(int32_t deviceId) const {
+    return mEventHub->getKeyCharacterMap(deviceId);
+}
+
+bool RecordingEventHub::setKeyboardLayoutOverlay(int32_t deviceId,
+        const sp<KeyCharacterMap>& map) {
+    return mEventHub->setKeyboardLayoutOverlay(deviceId, map);
+}
+
+void RecordingEventHub::vibrate(int32_t deviceId, nsecs_t duration) {
+    mEventHub->vibrate(deviceId, duration);
+}
+
+void RecordingEventHub::cancelVibrate(int32_t deviceId) {
+    mEventHub->cancelVibrate(deviceId);
+}
+
+void RecordingEventHub::requestReopenDevices() {
+    mEventHub->requestReopenDevices();
+}
+
+void RecordingEventHub::wake() {
+    mEventHub->wake();
+}
+
+void RecordingEventHub::dump(String8& dump) {
+    mEventHub->dump(dump);
+
+    AutoMutex _l(mLock);
+    dump.append(INDENT "Input Trace:\n");
+    dump.appendFormat(INDENT INDENT "Path: %s\n", mTracePath.string());
+    dump.appendFormat(INDENT INDENT "Recording: %s\n", mWriter.isOpen() ? "true" : "false");
+    dump.appendFormat(INDENT INDENT "Events: %d\n", mWriter.getEventCount());
+    dump.appendFormat(INDENT INDENT "Bytes: %d\n", mWriter.getByteCount());
+}
+
+void RecordingEventHub::monitor() {
+    mEventHub->monitor();
+}
+
+
+// --- ReplayEventHub ---
+
+ReplayEventHub::ReplayEventHub(const InputTraceReader& trace, bool paced) :
+        mTrace(trace), mPaced(paced),
+        mWakeRequested(false),
+        mNextBatch(0), mNextEventInBatch(0), mStartOffset(0), mTimeOffset(0) {
+}
+
+ReplayEventHub::~ReplayEventHub() {
+}
+
+bool ReplayEventHub::isFinished() const {
+    AutoMutex _l(mLock);
+    return mNextBatch >= mTrace.getBatches().size();
+}
+
+const InputTraceDevice* ReplayEventHub::getDeviceLocked(int32_t deviceId) const {
+    ssize_t index = mDevices.indexOfKey(deviceId);
+    return index >= 0 ? &mDevices.valueAt(index) : NULL;
+}
+
+void ReplayEventHub::addDeviceLocked(const InputTraceReader::Batch& batch, int32_t deviceId) {
+    // A batch can describe the same device twice if it was removed and added again,
+    // the last description is the one that was captured for this event.
+    const InputTraceDevice* description = NULL;
+    for (size_t i = 0; i < batch.deviceCount; i++) {
+        const InputTraceDevice& device = mTrace.getDevices().itemAt(batch.firstDevice + i);
+        if (device.id == deviceId) {
+            description = &device;
+        }
+    }
+    if (!description) {
+        return;
+    }
+
+    mDevices.replaceValueFor(deviceId, *description);
+    mBaseKeyCharacterMaps.removeItem(deviceId);
+    mKeyCharacterMaps.removeItem(deviceId);
+    if (description->hasKeyCharacterMap) {
+        sp<KeyCharacterMap> map;
+        if (KeyCharacterMap::loadCompiledWords(description->keyCharacterMap, &map)) {
+            ALOGW("Could not restore the key character map of device %d.", deviceId);
+        } else {
+            mBaseKeyCharacterMaps.add(deviceId, map);
+            mKeyCharacterMaps.add(deviceId, map);
+        }
+    }
+}
+
+void ReplayEventHub::removeDeviceLocked(int32_t deviceId) {
+    mDevices.removeItem(deviceId);
+    mBaseKeyCharacterMaps.removeItem(deviceId);
+    mKeyCharacterMaps.removeItem(deviceId);
+}
+
+void ReplayEventHub::updateStateLocked(const InputTraceReader::Batch& batch,
+        const RawEvent& event) {
+    if (event.type == DEVICE_ADDED) {
+        addDeviceLocked(batch, event.deviceId);
+        return;
+    }
+    if (event.type == DEVICE_REMOVED) {
+        removeDeviceLocked(event.deviceId);
+        return;
+    }
+
+    ssize_t index = mDevices.indexOfKey(event.deviceId);
+    if (index < 0) {
+        return;
+    }
+
+    InputTraceDevice& device = mDevices.editValueAt(index);
+    if (event.type == EV_SW) {
+        ssize_t switchIndex = device.switchStates.indexOfKey(event.code);
+        if (switchIndex >= 0) {
+            device.switchStates.replaceValueAt(switchIndex,
+                    event.value ? AKEY_STATE_DOWN : AKEY_STATE_UP);
+        }
+    } else if (event.type == EV_KEY) {
+        ssize_t keyIndex = device.keysByScanCode.indexOfKey(event.code);
+        if (keyIndex >= 0) {
+            device.keysByScanCode.editValueAt(keyIndex).down = event.value != 0;
+        }
+    } else if (event.type == EV_ABS) {
+        ssize_t axisIndex = device.absoluteAxes.indexOfKey(event.code);
+        if (axisIndex >= 0) {
+            device.absoluteAxes.editValueAt(axisIndex).value = event.value;
+        }
+    }
+}
+
+uint32_t ReplayEventHub::getDeviceClasses(int32_t deviceId) const {
+    AutoMutex _l(mLock);
+    const InputTraceDevice* device = getDeviceLocked(deviceId);
+    return device ? device->classes : 0;
+}
+
+InputDeviceIdentifier ReplayEventHub::getDeviceIdentifier(int32_t deviceId) const {
+    AutoMutex _l(mLock);
+    const InputTraceDevice* device = getDeviceLocked(deviceId);
+    return device ? device->identifier : InputDeviceIdentifier();
+}
+
+void ReplayEventHub::getConfiguration(int32_t deviceId, PropertyMap* outConfiguration) const {
+    AutoMutex _l(mLock);
+    const InputTraceDevice* device = getDeviceLocked(deviceId);
+    if (device) {
+        *outConfiguration = device->configuration;
+    } else {
+        outConfiguration->clear();
+    }
+}
+
+status_t ReplayEventHub::getAbsoluteAxisInfo(int32_t deviceId, int axis,
+        RawAbsoluteAxisInfo* outAxisInfo) const {
+    outAxisInfo->clear();
+
+    AutoMutex _l(mLock);
+    const InputTraceDevice* device = getDeviceLocked(deviceId);
+    if (device) {
+        ssize_t index = device->absoluteAxes.indexOfKey(axis);
+        if (index >= 0) {
+            *outAxisInfo = device->absoluteAxes.valueAt(index).info;
+            return OK;
+        }
+    }
+    return -1;
+}
+
+bool ReplayEventHub::hasRelativeAxis(int32_t deviceId, int axis) const {
+    AutoMutex _l(mLock);
+    const InputTraceDevice* device = getDeviceLocked(deviceId);
+    if (device) {
+        for (size_t i = 0; i < device->relativeAxes.size(); i++) {
+            if (device->relativeAxes.itemAt(i) == axis) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool ReplayEventHub::hasInputProperty(int32_t deviceId, int property) const {
+    AutoMutex _l(mLock);
+    const InputTraceDevice* device = getDeviceLocked(deviceId);
+    if (device) {
+        for (size_t i = 0; i < device->inputProperties.size(); i++) {
+            if (device->inputProperties.itemAt(i) == property) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+status_t ReplayEventHub::mapKey(int32_t deviceId, int32_t scanCode, int32_t usageCode,
+        int32_t* outKeycode, uint32_t* outFlags) const {
+    AutoMutex _l(mLock);
+    const InputTraceDevice* device = getDeviceLocked(deviceId);
+    if (device) {
+        ssize_t index = device->keysByScanCode.indexOfKey(scanCode);
+        if (index >= 0) {
+            const InputTraceDevice::KeyInfo& key = device->keysByScanCode.valueAt(index);
+            if (key.keyCode != AKEYCODE_UNKNOWN) {
+                *outKeycode = key.keyCode;
+                *outFlags = key.flags;
+                return NO_ERROR;
+            }
+        }
+    }
+    *outKeycode = 0;
+    *outFlags = 0;
+    return NAME_NOT_FOUND;
+}
+
+status_t ReplayEventHub::mapAxis(int32_t deviceId, int32_t scanCode,
+        AxisInfo* outAxisInfo) const {
+    AutoMutex _l(mLock);
+    const InputTraceDevice* device = getDeviceLocked(deviceId);
+    if (device) {
+        ssize_t index = device->absoluteAxes.indexOfKey(scanCode);
+        if (index >= 0 && device->absoluteAxes.valueAt(index).hasMapping) {
+            *outAxisInfo = device->absoluteAxes.valueAt(index).mapping;
+            return NO_ERROR;
+        }
+    }
+    return NAME_NOT_FOUND;
+}
+
+void ReplayEventHub::setExcludedDevices(const Vector<String8>& devices) {
+    // The trace already reflects the device exclusions in effect when it was recorded.
+}
+
+size_t ReplayEventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSize) {
+    ALOG_ASSERT(bufferSize >= 1);
+
+    AutoMutex _l(mLock);
+
+    const Vector<InputTraceReader::Batch>& batches = mTrace.getBatches();
+    if (mNextBatch >= batches.size()) {
+        // Nothing more will ever arrive, so behave like an idle device instead of
+        // letting the reader thread spin: sleep until woken or until the timeout.
+        if (!mWakeRequested) {
+            if (timeoutMillis < 0) {
+                mWakeCondition.wait(mLock);
+            } else if (timeoutMillis > 0) {
+                mWakeCondition.waitRelative(mLock, milliseconds_to_nanoseconds(timeoutMillis));
+            }
+        }
+        mWakeRequested = false;
+        return 0;
+    }
+
+    const InputTraceReader::Batch& batch = batches.itemAt(mNextBatch);
+    if (mNextEventInBatch == 0) {
+        nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+        if (mNextBatch == 0) {
+            mStartOffset = now - batch.readTime;
+        } else if (mPaced) {
+            nsecs_t due = batch.readTime + mStartOffset;
+            if (due > now) {
+                mLock.unlock();
+                usleep((due - now) / 1000);
+                mLock.lock();
+                now = systemTime(SYSTEM_TIME_MONOTONIC);
+            }
+        }
+
+        // Rebase the batch so that it appears to have been read just now while keeping
+        // the recorded delay between the kernel timestamps and the read.
+        mTimeOffset = now - batch.readTime;
+        mDeliveryTimes.push(now);
+    }
+
+    size_t count = batch.eventCount - mNextEventInBatch;
+    if (count > bufferSize) {
+        count = bufferSize;
+    }
+
+    const RawEvent* events = mTrace.getEvents().array() + batch.firstEvent + mNextEventInBatch;
+    for (size_t i = 0; i < count; i++) {
+        buffer[i] = events[i];
+        buffer[i].when += mTimeOffset;
+        updateStateLocked(batch, events[i]);
+    }
+
+    mNextEventInBatch += count;
+    if (mNextEventInBatch >= batch.eventCount) {
+        mNextBatch += 1;
+        mNextEventInBatch = 0;
+    }
+    return count;
+}
+
+int32_t ReplayEventHub::getScanCodeState(int32_t deviceId, int32_t scanCode) const {
+    AutoMutex _l(mLock);
+    const InputTraceDevice* device = getDeviceLocked(deviceId);
+    if (device) {
+        ssize_t index = device->keysByScanCode.indexOfKey(scanCode);
+        if (index >= 0) {
+            return device->keysByScanCode.valueAt(index).down ? AKEY_STATE_DOWN : AKEY_STATE_UP;
+        }
+    }
+    return AKEY_STATE_UNKNOWN;
+}
+
+int32_t ReplayEventHub::getKeyCodeState(int32_t deviceId, int32_t keyCode) const {
+    AutoMutex _l(mLock);
+    const InputTraceDevice* device = getDeviceLocked(deviceId);
+    int32_t result = AKEY_STATE_UNKNOWN;
+    if (device) {
+        for (size_t i = 0; i < device->keysByScanCode.size(); i++) {
+            const InputTraceDevice::KeyInfo& key = device->keysByScanCode.valueAt(i);
+            if (key.keyCode == keyCode) {
+                if (key.down) {
+                    return AKEY_STATE_DOWN;
+                }
+                result = AKEY_STATE_UP;
+            }
+        }
+    }
+    return result;
+}
+
+int32_t ReplayEventHub::getSwitchState(int32_t deviceId, int32_t sw) const {
+    AutoMutex _l(mLock);
+    const InputTraceDevice* device = getDeviceLocked(deviceId);
+    if (device) {
+        ssize_t index = device->switchStates.indexOfKey(sw);
+        if (index >= 0) {
+            return device->switchStates.valueAt(index);
+        }
+    }
+    return AKEY_STATE_UNKNOWN;
+}
+
+status_t ReplayEventHub::getAbsoluteAxisValue(int32_t deviceId, int32_t axis,
+        int32_t* outValue) const {
+    *outValue = 0;
+
+    AutoMutex _l(mLock);
+    const InputTraceDevice* device = getDeviceLocked(deviceId);
+    if (device) {
+        ssize_t index = device->absoluteAxes.indexOfKey(axis);
+        if (index >= 0) {
+            *outValue = device->absoluteAxes.valueAt(index).value;
+            return OK;
+        }
+    }
+    return -1;
+}
+
+bool ReplayEventHub::markSupportedKeyCodes(int32_t deviceId, size_t numCodes,
+        const int32_t* keyCodes, uint8_t* outFlags) const {
+    AutoMutex _l(mLock);
+    const InputTraceDevice* device = getDeviceLocked(deviceId);
+    if (!device) {
+        return false;
+    }
+
+    for (size_t codeIndex = 0; codeIndex < numCodes; codeIndex++) {
+        for (size_t i = 0; i < device->keysByScanCode.size(); i++) {
+            if (device->keysByScanCode.valueAt(i).keyCode == keyCodes[codeIndex]) {
+                outFlags[codeIndex] = 1;
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+bool ReplayEventHub::hasScanCode(int32_t deviceId, int32_t scanCode) const {
+    AutoMutex _l(mLock);
+    const InputTraceDevice* device = getDeviceLocked(deviceId);
+    return device && device->keysByScanCode.indexOfKey(scanCode) >= 0;
+}
+
+bool ReplayEventHub::hasLed(int32_t deviceId, int32_t led) const {
+    AutoMutex _l(mLock);
+    const InputTraceDevice* device = getDeviceLocked(deviceId);
+    return device && device->leds.indexOfKey(led) >= 0;
+}
+
+void ReplayEventHub::setLedState(int32_t deviceId, int32_t led, bool on) {
+    AutoMutex _l(mLock);
+    ssize_t index = mDevices.indexOfKey(deviceId);
+    if (index >= 0) {
+        InputTraceDevice& device = mDevices.editValueAt(index);
+        ssize_t ledIndex = device.leds.indexOfKey(led);
+        if (ledIndex >= 0) {
+            device.leds.replaceValueAt(ledIndex, on);
+        }
+    }
+}
+
+void ReplayEventHub::getVirtualKeyDefinitions(int32_t deviceId,
+        Vector<VirtualKeyDefinition>& outVirtualKeys) const {
+    outVirtualKeys.clear();
+
+    AutoMutex _l(mLock);
+    const InputTraceDevice* device = getDeviceLocked(deviceId);
+    if (device) {
+        outVirtualKeys.appendVector(device->virtualKeys);
+    }
+}
+
+sp<KeyCharacterMap> ReplayEventHub::getKeyCharacterMap(int32_t deviceId) const {
+    AutoMutex _l(mLock);
+    ssize_t index = mKeyCharacterMaps.indexOfKey(deviceId);
+    return index >= 0 ? mKeyCharacterMaps.valueAt(index) : NULL;
+}
+
+bool ReplayEventHub::setKeyboardLayoutOverlay(int32_t deviceId,
+        const sp<KeyCharacterMap>& map) {
+    AutoMutex _l(mLock);
+    ssize_t index = mBaseKeyCharacterMaps.indexOfKey(deviceId);
+    if (index < 0) {
+        return false;
+    }
+
+    // Same as EventHub, the trace only holds the base map.
+    mKeyCharacterMaps.replaceValueFor(deviceId,
+            KeyCharacterMap::combine(mBaseKeyCharacterMaps.valueAt(index), map));
+    return true;
+}
+
+void ReplayEventHub::vibrate(int32_t deviceId, nsecs_t duration) {
+}
+
+void ReplayEventHub::cancelVibrate(int32_t deviceId) {
+}
+
+void ReplayEventHub::requestReopenDevices() {
+}
+
+void ReplayEventHub::wake() {
+    AutoMutex _l(mLock);
+    mWakeRequested = true;
+    mWakeCondition.broadcast();
+}
+
+void ReplayEventHub::dump(String8& dump) {
+    AutoMutex _l(mLock);
+    dump.append("Replay Event Hub State:\n");
+    dump.appendFormat(INDENT "Paced: %s\n", mPaced ? "true" : "false");
+    dump.appendFormat(INDENT "Batches: %d of %d\n",
+            mNextBatch, mTrace.getBatches().size());
+    dump.appendFormat(INDENT "Devices: %d\n", mDevices.size());
+}
+
+void ReplayEventHub::monitor() {
+    mLock.lock();
+    mLock.unlock();
+}
+
+} // namespace android
@@ -0,0 +1,286 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _UI_INPUT_TRACE_H
+#define _UI_INPUT_TRACE_H
+
+#include "EventHub.h"
+
+#include <utils/Errors.h>
+#include <utils/KeyedVector.h>
+#include <utils/String8.h>
+#include <utils/threads.h>
+#include <utils/Timers.h>
+#include <utils/Vector.h>
+
+#include <stdio.h>
+
+namespace android {
+
+/*
+ * Input traces capture the stream of RawEvents returned by EventHub::getEvents
+ * together with enough information about each input device to reproduce the
+ * behavior of the InputReader off-device.
+ *
+ * The trace file format is a compact binary stream:
+ *
+ *   header:  magic "AITR", uint32 version
+ *   record:  uint8 tag followed by the tag-specific payload
+ *
+ * Integers within records are encoded as LEB128 varints, signed integers are
+ * zigzag encoded first.  Event timestamps are stored as deltas from the previous
+ * event which keeps typical touch traces at 4-6 bytes per event.
+ */
+
+/* Describes the static properties of a device as seen through the EventHubInterface. */
+struct InputTraceDevice {
+    struct KeyInfo {
+        int32_t keyCode;
+        uint32_t flags;
+        bool down;
+    };
+
+    struct AxisState {
+        RawAbsoluteAxisInfo info;
+        int32_t value;
+        bool hasMapping;
+        AxisInfo mapping;
+    };
+
+    int32_t id;
+    uint32_t classes;
+    InputDeviceIdentifier identifier;
+    PropertyMap configuration;
+    KeyedVector<int32_t, KeyInfo> keysByScanCode;
+    KeyedVector<int32_t, AxisState> absoluteAxes;
+    Vector<int32_t> relativeAxes;
+    Vector<int32_t> inputProperties;
+    KeyedVector<int32_t, bool> leds;
+    KeyedVector<int32_t, int32_t> switchStates;
+    Vector<VirtualKeyDefinition> virtualKeys;
+
+    // The compiled form of the key character map, see KeyCharacterMap::getCompiledWords.
+    bool hasKeyCharacterMap;
+    Vector<int32_t> keyCharacterMap;
+
+    InputTraceDevice() : id(0), classes(0), hasKeyCharacterMap(false) { }
+
+    /* Captures the description of a device from an event hub. */
+    void captureFrom(const EventHubInterface* eventHub, int32_t deviceId);
+};
+
+
+/* Writes an input trace to a file. */
+class InputTraceWriter {
+public:
+    InputTraceWriter();
+    ~InputTraceWriter();
+
+    status_t open(const String8& path);
+    void close();
+
+    inline bool isOpen() const { return mFile != NULL; }
+
+    void writeDevice(const InputTraceDevice& device);
+    void writeEvents(nsecs_t readTime, const RawEvent* events, size_t count);
+
+    inline size_t getEventCount() const { return mEventCount; }
+    inline size_t getByteCount() const { return mByteCount; }
+
+private:
+    FILE* mFile;
+    nsecs_t mLastWhen;
+    size_t mEventCount;
+    size_t mByteCount;
+    Vector<uint8_t> mBuffer;
+
+    void flushBuffer();
+};
+
+
+/* Reads an input trace from a file.  The whole trace is loaded into memory. */
+class InputTraceReader {
+public:
+    /* A group of events returned by one call to getEvents at record time. */
+    struct Batch {
+        nsecs_t readTime;
+        size_t firstEvent;
+        size_t eventCount;
+        size_t firstDevice;
+        size_t deviceCount;
+    };
+
+    InputTraceReader();
+    ~InputTraceReader();
+
+    status_t load(const String8& path);
+
+    inline const Vector<Batch>& getBatches() const { return mBatches; }
+    inline const Vector<RawEvent>& getEvents() const { return mEvents; }
+    inline const Vector<InputTraceDevice>& getDevices() const { return mDevices; }
+
+private:
+    Vector<Batch> mBatches;
+    Vector<RawEvent> mEvents;
+    Vector<InputTraceDevice> mDevices;
+};
+
+
+/*
+ * An event hub that forwards to another event hub and records everything
+ * that getEvents returns into an input trace.
+ */
+class RecordingEventHub : public EventHubInterface {
+public:
+    RecordingEventHub(const sp<EventHubInterface>& eventHub, const String8& tracePath);
+
+    virtual uint32_t getDeviceClasses(int32_t deviceId) const;
+    virtual InputDeviceIdentifier getDeviceIdentifier(int32_t deviceId) const;
+    virtual void getConfiguration(int32_t deviceId, PropertyMap* outConfiguration) const;
+    virtual status_t getAbsoluteAxisInfo(int32_t deviceId, int axis,
+            RawAbsoluteAxisInfo* outAxisInfo) const;
+    virtual bool hasRelativeAxis(int32_t deviceId, int axis) const;
+    virtual bool hasInputProperty(int32_t deviceId, int property) const;
+    virtual status_t mapKey(int32_t deviceId, int32_t scanCode, int32_t usageCode,
+            int32_t* outKeycode, uint32_t* outFlags) const;
+    virtual status_t mapAxis(int32_t deviceId, int32_t scanCode,
+            AxisInfo* outAxisInfo) const;
+    virtual void setExcludedDevices(const Vector<String8>& devices);
+    virtual size_t getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSize);
+    virtual int32_t getScanCodeState(int32_t deviceId, int32_t scanCode) const;
+    virtual int32_t getKeyCodeState(int32_t deviceId, int32_t keyCode) const;
+    virtual int32_t getSwitchState(int32_t deviceId, int32_t sw) const;
+    virtual status_t getAbsoluteAxisValue(int32_t deviceId, int32_t axis,
+            int32_t* outValue) const;
+    virtual bool markSupportedKeyCodes(int32_t deviceId, size_t numCodes,
+            const int32_t* keyCodes, uint8_t* outFlags) const;
+    virtual bool hasScanCode(int32_t deviceId, int32_t scanCode) const;
+    virtual bool hasLed(int32_t deviceId, int32_t led) const;
+    virtual void setLedState(int32_t deviceId, int32_t led, bool on);
+    virtual void getVirtualKeyDefinitions(int32_t deviceId,
+            Vector<VirtualKeyDefinition>& outVirtualKeys) const;
+    virtual sp<KeyCharacterMap> getKeyCharacterMap(int32_t deviceId) const;
+    virtual bool setKeyboardLayoutOverlay(int32_t deviceId, const sp<KeyCharacterMap>& map);
+    virtual void vibrate(int32_t deviceId, nsecs_t duration);
+    virtual void cancelVibrate(int32_t deviceId);
+    virtual void requestReopenDevices();
+    virtual void wake();
+    virtual void dump(String8& dump);
+    virtual void monitor();
+
+protected:
+    virtual ~RecordingEventHub();
+
+private:
+    sp<EventHubInterface> mEventHub;
+    String8 mTracePath;
+
+    // Protects the writer; only the reader thread writes but dump() may run anywhere.
+    Mutex mLock;
+    InputTraceWriter mWriter;
+};
+
+
+/*
+ * An event hub that plays back an input trace.
+ *
+ * Each call to getEvents returns the events of the next recorded batch.  Event
+ * timestamps are rebased so that each batch appears to have been read at the time
+ * it is returned, preserving the recorded delay between the kernel timestamps and
+ * the read.  When paced, getEvents sleeps to reproduce the original spacing between
+ * batches; otherwise batches are returned as fast as they are requested which is
+ * what throughput benchmarks want.
+ */
+class ReplayEventHub : public EventHubInterface {
+public:
+    ReplayEventHub(const InputTraceReader& trace, bool paced);
+
+    /* Returns true once every recorded batch has been returned by getEvents. */
+    bool isFinished() const;
+
+    /* Gets the time at which each batch was handed out, indexed by batch number. */
+    inline const Vector<nsecs_t>& getBatchDeliveryTimes() const { return mDeliveryTimes; }
+
+    virtual uint32_t getDeviceClasses(int32_t deviceId) const;
+    virtual InputDeviceIdentifier getDeviceIdentifier(int32_t deviceId) const;
+    virtual void getConfiguration(int32_t deviceId, PropertyMap* outConfiguration) const;
+    virtual status_t getAbsoluteAxisInfo(int32_t deviceId, int axis,
+            RawAbsoluteAxisInfo* outAxisInfo) const;
+    virtual bool hasRelativeAxis(int32_t deviceId, int axis) const;
+    virtual bool hasInputProperty(int32_t deviceId, int property) const;
+    virtual status_t mapKey(int32_t deviceId, int32_t scanCode, int32_t usageCode,
+            int32_t* outKeycode, uint32_t* outFlags) const;
+    virtual status_t mapAxis(int32_t deviceId, int32_t scanCode,
+            AxisInfo* outAxisInfo) const;
+    virtual void setExcludedDevices(const Vector<String8>& devices);
+    virtual size_t getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSize);
+    virtual int32_t getScanCodeState(int32_t deviceId, int32_t scanCode) const;
+    virtual int32_t getKeyCodeState(int32_t deviceId, int32_t keyCode) const;
+    virtual int32_t getSwitchState(int32_t deviceId, int32_t sw) const;
+    virtual status_t getAbsoluteAxisValue(int32_t deviceId, int32_t axis,
+            int32_t* outValue) const;
+    virtual bool markSupportedKeyCodes(int32_t deviceId, size_t numCodes,
+            const int32_t* keyCodes, uint8_t* outFlags) const;
+    virtual bool hasScanCode(int32_t deviceId, int32_t scanCode) const;
+    virtual bool hasLed(int32_t deviceId, int32_t led) const;
+    virtual void setLedState(int32_t deviceId, int32_t led, bool on);
+    virtual void getVirtualKeyDefinitions(int32_t deviceId,
+            Vector<VirtualKeyDefinition>& outVirtualKeys) const;
+    virtual sp<KeyCharacterMap> getKeyCharacterMap(int32_t deviceId) const;
+    virtual bool setKeyboardLayoutOverlay(int32_t deviceId, const sp<KeyCharacterMap>& map);
+    virtual void vibrate(int32_t deviceId, nsecs_t duration);
+    virtual void cancelVibrate(int32_t deviceId);
+    virtual void requestReopenDevices();
+    virtual void wake();
+    virtual void dump(String8& dump);
+    virtual void monitor();
+
+protected:
+    virtual ~ReplayEventHub();
+
+private:
+    const InputTraceReader& mTrace;
+    bool mPaced;
+
+    mutable Mutex mLock;
+
+    // Signalled by wake() so a finished replay can block in getEvents like a real device.
+    Condition mWakeCondition;
+    bool mWakeRequested;
+
+    // Devices are keyed by id.  A device is described when its DEVICE_ADDED event is
+    // returned and forgotten when its DEVICE_REMOVED event is returned.
+    KeyedVector<int32_t, InputTraceDevice> mDevices;
+
+    // Key character maps of the devices that have one, including keyboard layout overlays.
+    KeyedVector<int32_t, sp<KeyCharacterMap> > mBaseKeyCharacterMaps;
+    KeyedVector<int32_t, sp<KeyCharacterMap> > mKeyCharacterMaps;
+
+    size_t mNextBatch;
+    size_t mNextEventInBatch;
+    nsecs_t mStartOffset;
+    nsecs_t mTimeOffset;
+    Vector<nsecs_t> mDeliveryTimes;
+
+    const InputTraceDevice* getDeviceLocked(int32_t deviceId) const;
+    void addDeviceLocked(const InputTraceReader::Batch& batch, int32_t deviceId);
+    void removeDeviceLocked(int32_t deviceId);
+    void updateStateLocked(const InputTraceReader::Batch& batch, const RawEvent& event);
+};
+
+} // namespace android
+
+#endif // _UI_INPUT_TRACE_H
@@ -74,33 +74,59 @@ void SpriteController::closeTransaction() {
 }
 
 void SpriteController::invalidateSpriteLocked(const sp<SpriteImpl>& sprite) {
-    bool wasEmpty = mLocked.invalidatedSprites.isEmpty();
+    bool wasIdle = mLocked.invalidatedSprites.isEmpty() && mLocked.disposedSurfaces.isEmpty();
     mLocked.invalidatedSprites.push(sprite);
-    if (wasEmpty) {
-        if (mLocked.transactionNestingCount != 0) {
-            mLocked.deferredSpriteUpdate = true;
-        } else {
-            mLooper->sendMessage(mHandler, Message(MSG_UPDATE_SPRITES));
-        }
+    if (wasIdle) {
+        scheduleUpdateLocked();
     }
 }
 
-void SpriteController::disposeSurfaceLocked(const sp<SurfaceControl>& surfaceControl) {
-    bool wasEmpty = mLocked.disposedSurfaces.isEmpty();
-    mLocked.disposedSurfaces.push(surfaceControl);
-    if (wasEmpty) {
-        mLooper->sendMessage(mHandler, Message(MSG_DISPOSE_SURFACES));
+void SpriteController::disposeSurfaceLocked(const SpriteState& state) {
+    // The surface is hidden and returned to the pool by the next update so that it
+    // happens in the same surface transaction as the other sprite changes.
+    bool wasIdle = mLocked.invalidatedSprites.isEmpty() && mLocked.disposedSurfaces.isEmpty();
+    mLocked.disposedSurfaces.push(PooledSurface(state.surfaceControl,
+            state.surfaceWidth, state.surfaceHeight,
+            state.surfaceDrawn ? state.surfaceGenerationId : 0, state.surfaceVisible));
+    if (wasIdle) {
+        scheduleUpdateLocked();
+    }
+}
+
+void SpriteController::scheduleUpdateLocked() {
+    if (mLocked.transactionNestingCount != 0) {
+        mLocked.deferredSpriteUpdate = true;
+    } else {
+        mLooper->sendMessage(mHandler, Message(MSG_UPDATE_SPRITES));
     }
 }
 
+SkBitmap SpriteController::getIconBitmapLocked(const SkBitmap& bitmap) {
+    uint32_t generationId = bitmap.getGenerationID();
+    if (generationId) {
+        ssize_t index = mLocked.iconCache.indexOfKey(generationId);
+        if (index >= 0) {
+            return mLocked.iconCache.valueAt(index);
+        }
+    }
+
+    SkBitmap bitmapCopy;
+    bitmap.copyTo(&bitmapCopy, SkBitmap::kARGB_8888_Config);
+    if (generationId) {
+        // Generation ids increase over time so the first entry is the oldest icon.
+        if (mLocked.iconCache.size() >= MAX_CACHED_ICONS) {
+            mLocked.iconCache.removeItemsAt(0);
+        }
+        mLocked.iconCache.add(generationId, bitmapCopy);
+    }
+    return bitmapCopy;
+}
+
 void SpriteController::handleMessage(const Message& message) {
     switch (message.what) {
     case MSG_UPDATE_SPRITES:
         doUpdateSprites();
         break;
-    case MSG_DISPOSE_SURFACES:
-        doDisposeSurfaces();
-        break;
     }
 }
 
@@ -111,6 +137,7 @@ void SpriteController::doUpdateSprites() {
     // may invalidate themselves again during this time but we will handle those changes
     // in the next iteration.
     Vector<SpriteUpdate> updates;
+    Vector<PooledSurface> disposedSurfaces;
     size_t numSprites;
     { // acquire lock
         AutoMutex _l(mLock);
@@ -123,26 +150,55 @@ void SpriteController::doUpdateSprites() {
             sprite->resetDirtyLocked();
         }
         mLocked.invalidatedSprites.clear();
+
+        disposedSurfaces = mLocked.disposedSurfaces;
+        mLocked.disposedSurfaces.clear();
     } // release lock
 
-    // Create missing surfaces.
+    // Return the surfaces of deleted sprites to the pool.  They are hidden below unless
+    // a sprite shows them again in the same transaction.
+    mSurfacePool.appendVector(disposedSurfaces);
+    disposedSurfaces.clear();
+
+    // Create missing surfaces, reusing pooled ones when possible.
+    Vector<sp<SurfaceControl> > surfacesToHide;
     bool surfaceChanged = false;
     for (size_t i = 0; i < numSprites; i++) {
         SpriteUpdate& update = updates.editItemAt(i);
 
         if (update.state.surfaceControl == NULL && update.state.wantSurfaceVisible()) {
-            update.state.surfaceWidth = update.state.icon.bitmap.width();
-            update.state.surfaceHeight = update.state.icon.bitmap.height();
-            update.state.surfaceDrawn = false;
-            update.state.surfaceVisible = false;
-            update.state.surfaceControl = obtainSurface(
-                    update.state.surfaceWidth, update.state.surfaceHeight);
-            if (update.state.surfaceControl != NULL) {
+            PooledSurface surface = obtainSurface(update.state.icon.bitmap.width(),
+                    update.state.icon.bitmap.height(),
+                    update.state.icon.bitmap.getGenerationID());
+            if (surface.surfaceControl != NULL) {
+                if (surface.visible) {
+                    surfacesToHide.push(surface.surfaceControl);
+                }
+                update.state.surfaceControl = surface.surfaceControl;
+                update.state.surfaceWidth = surface.width;
+                update.state.surfaceHeight = surface.height;
+                update.state.surfaceGenerationId = surface.generationId;
+                update.state.surfaceDrawn = surface.generationId != 0;
+                update.state.surfaceVisible = false;
                 update.surfaceChanged = surfaceChanged = true;
             }
         }
     }
 
+    // Trim the pool and hide what remains in it.
+    Vector<sp<SurfaceControl> > releasedSurfaces;
+    while (mSurfacePool.size() > MAX_POOLED_SURFACES) {
+        releasedSurfaces.push(mSurfacePool.itemAt(0).surfaceControl);
+        mSurfacePool.removeAt(0);
+    }
+    for (size_t i = 0; i < mSurfacePool.size(); i++) {
+        PooledSurface& surface = mSurfacePool.editItemAt(i);
+        if (surface.visible) {
+            surfacesToHide.push(surface.surfaceControl);
+            surface.visible = false;
+        }
+    }
+
     // Resize sprites if needed, inside a global transaction.
     bool haveGlobalTransaction = false;
     for (size_t i = 0; i < numSprites; i++) {
@@ -186,10 +242,15 @@ void SpriteController::doUpdateSprites() {
     }
 
     // Redraw sprites if needed.
+    // Surfaces that already show the icon, such as when a sprite is given back the icon
+    // it had before or reuses a pooled surface, are left alone.
     for (size_t i = 0; i < numSprites; i++) {
         SpriteUpdate& update = updates.editItemAt(i);
 
-        if ((update.state.dirty & DIRTY_BITMAP) && update.state.surfaceDrawn) {
+        uint32_t generationId = update.state.icon.bitmap.getGenerationID();
+        if (update.state.surfaceDrawn && update.state.icon.isValid()
+                && (generationId != update.state.surfaceGenerationId
+                        || (!generationId && (update.state.dirty & DIRTY_BITMAP)))) {
             update.state.surfaceDrawn = false;
             update.surfaceChanged = surfaceChanged = true;
         }
@@ -230,6 +291,7 @@ void SpriteController::doUpdateSprites() {
                 if (status) {
                     ALOGE("Error %d unlocking and posting sprite surface after drawing.", status);
                 } else {
+                    update.state.surfaceGenerationId = generationId;
                     update.state.surfaceDrawn = true;
                     update.surfaceChanged = surfaceChanged = true;
                 }
@@ -237,8 +299,22 @@ void SpriteController::doUpdateSprites() {
         }
     }
 
-    // Set sprite surface properties and make them visible.
+    // Set sprite surface properties and make them visible, all in one transaction.
+    // Surfaces that went back to the pool are hidden first so that sprites that
+    // reused them can show them again.
     bool haveTransaction = false;
+    if (!surfacesToHide.isEmpty()) {
+        SurfaceComposerClient::openGlobalTransaction();
+        haveTransaction = true;
+
+        for (size_t i = 0; i < surfacesToHide.size(); i++) {
+            status_t status = surfacesToHide.itemAt(i)->hide();
+            if (status) {
+                ALOGE("Error %d hiding pooled sprite surface.", status);
+            }
+        }
+    }
+
     for (size_t i = 0; i < numSprites; i++) {
         SpriteUpdate& update = updates.editItemAt(i);
 
@@ -331,6 +407,7 @@ void SpriteController::doUpdateSprites() {
             if (update.surfaceChanged) {
                 update.sprite->setSurfaceLocked(update.state.surfaceControl,
                         update.state.surfaceWidth, update.state.surfaceHeight,
+                        update.state.surfaceGenerationId,
                         update.state.surfaceDrawn, update.state.surfaceVisible);
             }
         }
@@ -342,21 +419,11 @@ void SpriteController::doUpdateSprites() {
     // sprite being deleted and the lock being reacquired by the sprite destructor
     // while already held.
     updates.clear();
-}
-
-void SpriteController::doDisposeSurfaces() {
-    // Collect disposed surfaces.
-    Vector<sp<SurfaceControl> > disposedSurfaces;
-    { // acquire lock
-        AutoMutex _l(mLock);
 
-        disposedSurfaces = mLocked.disposedSurfaces;
-        mLocked.disposedSurfaces.clear();
-    } // release lock
-
-    // Release the last reference to each surface outside of the lock.
-    // We don't want the surfaces to be deleted while we are holding our lock.
-    disposedSurfaces.clear();
+    // Release the last reference to the surfaces that did not fit in the pool, also
+    // outside of the lock.
+    surfacesToHide.clear();
+    releasedSurfaces.clear();
 }
 
 void SpriteController::ensureSurfaceComposerClient() {
@@ -365,7 +432,32 @@ void SpriteController::ensureSurfaceComposerClient() {
     }
 }
 
-sp<SurfaceControl> SpriteController::obtainSurface(int32_t width, int32_t height) {
+SpriteController::PooledSurface SpriteController::obtainSurface(int32_t width, int32_t height,
+        uint32_t generationId) {
+    // Prefer the most recently pooled surface of the right size, ideally one that
+    // already shows the icon.
+    ssize_t bestIndex = -1;
+    for (size_t i = mSurfacePool.size(); i-- > 0; ) {
+        const PooledSurface& surface = mSurfacePool.itemAt(i);
+        if (surface.width == width && surface.height == height) {
+            if (generationId && surface.generationId == generationId) {
+                bestIndex = i;
+                break;
+            }
+            if (bestIndex < 0) {
+                bestIndex = i;
+            }
+        }
+    }
+    if (bestIndex >= 0) {
+        PooledSurface surface = mSurfacePool.itemAt(bestIndex);
+        mSurfacePool.removeAt(bestIndex);
+        if (surface.generationId != generationId) {
+            surface.generationId = 0;
+        }
+        return surface;
+    }
+
     ensureSurfaceComposerClient();
 
     sp<SurfaceControl> surfaceControl = mSurfaceComposerClient->createSurface(
@@ -374,9 +466,9 @@ sp<SurfaceControl> SpriteController::obtainSurface(int32_t width, int32_t height
     if (surfaceControl == NULL || !surfaceControl->isValid()
             || !surfaceControl->getSurface()->isValid()) {
         ALOGE("Error creating sprite surface.");
-        return NULL;
+        return PooledSurface();
     }
-    return surfaceControl;
+    return PooledSurface(surfaceControl, width, height, 0, false);
 }
 
 
@@ -392,7 +484,7 @@ SpriteController::SpriteImpl::~SpriteImpl() {
     // Let the controller take care of deleting the last reference to sprite
     // surfaces so that we do not block the caller on an IPC here.
     if (mLocked.state.surfaceControl != NULL) {
-        mController->disposeSurfaceLocked(mLocked.state.surfaceControl);
+        mController->disposeSurfaceLocked(mLocked.state);
         mLocked.state.surfaceControl.clear();
     }
 }
@@ -402,9 +494,19 @@ void SpriteController::SpriteImpl::setIcon(const SpriteIcon& icon) {
 
     uint32_t dirty;
     if (icon.isValid()) {
-        icon.bitmap.copyTo(&mLocked.state.icon.bitmap, SkBitmap::kARGB_8888_Config);
+        SkBitmap bitmap = mController->getIconBitmapLocked(icon.bitmap);
+        if (mLocked.state.icon.isValid()
+                && bitmap.getGenerationID()
+                && mLocked.state.icon.bitmap.getGenerationID() == bitmap.getGenerationID()
+                && mLocked.state.icon.hotSpotX == icon.hotSpotX
+                && mLocked.state.icon.hotSpotY == icon.hotSpotY) {
+            return; // already showing this icon
+        }
+
+        bool wasValid = mLocked.state.icon.isValid();
+        mLocked.state.icon.bitmap = bitmap;
 
-        if (!mLocked.state.icon.isValid()
+        if (!wasValid
                 || mLocked.state.icon.hotSpotX != icon.hotSpotX
                 || mLocked.state.icon.hotSpotY != icon.hotSpotY) {
             mLocked.state.icon.hotSpotX = icon.hotSpotX;
@@ -19,6 +19,7 @@
 
 #include <utils/RefBase.h>
 #include <utils/Looper.h>
+#include <utils/KeyedVector.h>
 
 #include <gui/SurfaceComposerClient.h>
 
@@ -156,7 +157,14 @@ public:
 private:
     enum {
         MSG_UPDATE_SPRITES,
-        MSG_DISPOSE_SURFACES,
+    };
+
+    enum {
+        // The maximum number of surfaces of deleted sprites that are kept for reuse.
+        MAX_POOLED_SURFACES = 8,
+
+        // The maximum number of icon bitmaps that are kept for reuse.
+        MAX_CACHED_ICONS = 8,
     };
 
     enum {
@@ -178,7 +186,8 @@ private:
         inline SpriteState() :
                 dirty(0), visible(false),
                 positionX(0), positionY(0), layer(0), alpha(1.0f),
-                surfaceWidth(0), surfaceHeight(0), surfaceDrawn(false), surfaceVisible(false) {
+                surfaceWidth(0), surfaceHeight(0), surfaceGenerationId(0),
+                surfaceDrawn(false), surfaceVisible(false) {
         }
 
         uint32_t dirty;
@@ -194,6 +203,7 @@ private:
         sp<SurfaceControl> surfaceControl;
         int32_t surfaceWidth;
         int32_t surfaceHeight;
+        uint32_t surfaceGenerationId; // generation id of the icon drawn on the surface
         bool surfaceDrawn;
         bool surfaceVisible;
 
@@ -232,10 +242,11 @@ private:
         }
 
         inline void setSurfaceLocked(const sp<SurfaceControl>& surfaceControl,
-                int32_t width, int32_t height, bool drawn, bool visible) {
+                int32_t width, int32_t height, uint32_t generationId, bool drawn, bool visible) {
             mLocked.state.surfaceControl = surfaceControl;
             mLocked.state.surfaceWidth = width;
             mLocked.state.surfaceHeight = height;
+            mLocked.state.surfaceGenerationId = generationId;
             mLocked.state.surfaceDrawn = drawn;
             mLocked.state.surfaceVisible = visible;
         }
@@ -262,6 +273,22 @@ private:
         bool surfaceChanged;
     };
 
+    /* A surface that is not attached to a sprite, along with what it last showed. */
+    struct PooledSurface {
+        inline PooledSurface() : width(0), height(0), generationId(0), visible(false) { }
+        inline PooledSurface(const sp<SurfaceControl>& surfaceControl,
+                int32_t width, int32_t height, uint32_t generationId, bool visible) :
+                surfaceControl(surfaceControl), width(width), height(height),
+                generationId(generationId), visible(visible) {
+        }
+
+        sp<SurfaceControl> surfaceControl;
+        int32_t width;
+        int32_t height;
+        uint32_t generationId; // generation id of the icon drawn on the surface, or 0
+        bool visible;
+    };
+
     mutable Mutex mLock;
 
     sp<Looper> mLooper;
@@ -270,22 +297,31 @@ private:
 
     sp<SurfaceComposerClient> mSurfaceComposerClient;
 
+    // Surfaces of deleted sprites that can be reused, oldest first.
+    // Only accessed on the looper thread.
+    Vector<PooledSurface> mSurfacePool;
+
     struct Locked {
         Vector<sp<SpriteImpl> > invalidatedSprites;
-        Vector<sp<SurfaceControl> > disposedSurfaces;
+        Vector<PooledSurface> disposedSurfaces;
         uint32_t transactionNestingCount;
         bool deferredSpriteUpdate;
+
+        // Copies of the icons that sprites display, indexed by the generation id of the
+        // bitmap they were copied from.  Sprites that show the same icon share its pixels.
+        KeyedVector<uint32_t, SkBitmap> iconCache;
     } mLocked; // guarded by mLock
 
     void invalidateSpriteLocked(const sp<SpriteImpl>& sprite);
-    void disposeSurfaceLocked(const sp<SurfaceControl>& surfaceControl);
+    void disposeSurfaceLocked(const SpriteState& state);
+    void scheduleUpdateLocked();
+    SkBitmap getIconBitmapLocked(const SkBitmap& bitmap);
 
     void handleMessage(const Message& message);
     void doUpdateSprites();
-    void doDisposeSurfaces();
 
     void ensureSurfaceComposerClient();
-    sp<SurfaceControl> obtainSurface(int32_t width, int32_t height);
+    PooledSurface obtainSurface(int32_t width, int32_t height, uint32_t generationId);
 };
 
 } // namespace android
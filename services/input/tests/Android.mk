@@ -5,7 +5,9 @@ include $(CLEAR_VARS)
 # Build the unit tests.
 test_src_files := \
     InputReader_test.cpp \
-    InputDispatcher_test.cpp
+    InputDispatcher_test.cpp \
+    InputTrace_test.cpp \
+    EventHub_test.cpp
 
 shared_libraries := \
     libcutils \
@@ -42,5 +44,47 @@ $(foreach file,$(test_src_files), \
     $(eval include $(BUILD_EXECUTABLE)) \
 )
 
+# Build the benchmarks.
+benchmark_src_files := \
+    InputDispatcher_benchmark.cpp \
+    InputReplay_benchmark.cpp \
+    PointerIdAssignment_benchmark.cpp
+
+$(foreach file,$(benchmark_src_files), \
+    $(eval include $(CLEAR_VARS)) \
+    $(eval LOCAL_SHARED_LIBRARIES := $(shared_libraries)) \
+    $(eval LOCAL_C_INCLUDES := $(c_includes)) \
+    $(eval LOCAL_SRC_FILES := $(file)) \
+    $(eval LOCAL_MODULE := $(notdir $(file:%.cpp=%))) \
+    $(eval LOCAL_MODULE_TAGS := $(module_tags)) \
+    $(eval include $(BUILD_EXECUTABLE)) \
+)
+
+# Build the benchmarks for the host as well, so that recorded traces can be
+# replayed on a workstation.  The host executables compile the reader, the
+# dispatcher and the trace sources directly since libinput is device only.
+ifeq ($(HOST_OS),linux)
+host_src_files := \
+    ../InputApplication.cpp \
+    ../InputDispatcher.cpp \
+    ../InputListener.cpp \
+    ../InputReader.cpp \
+    ../InputTrace.cpp \
+    ../InputWindow.cpp \
+    ../../../libs/androidfw/InputTransport.cpp
+
+$(foreach file,$(benchmark_src_files), \
+    $(eval include $(CLEAR_VARS)) \
+    $(eval LOCAL_SHARED_LIBRARIES := libskia) \
+    $(eval LOCAL_STATIC_LIBRARIES := libandroidfw libutils libcutils liblog) \
+    $(eval LOCAL_C_INCLUDES := external/skia/include/core) \
+    $(eval LOCAL_SRC_FILES := $(file) $(host_src_files)) \
+    $(eval LOCAL_LDLIBS := -lpthread -lrt) \
+    $(eval LOCAL_MODULE := $(notdir $(file:%.cpp=%))_host) \
+    $(eval LOCAL_MODULE_TAGS := $(module_tags)) \
+    $(eval include $(BUILD_HOST_EXECUTABLE)) \
+)
+endif
+
 # Build the manual test programs.
 include $(call all-makefiles-under, $(LOCAL_PATH))
@@ -0,0 +1,265 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "EventHub_test"
+
+#include "../EventHub.h"
+
+#include <gtest/gtest.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/uinput.h>
+#include <utils/Log.h>
+
+namespace android {
+
+static const char* FAST_DEVICE_NAME = "EventHub_test fast keyboard";
+static const char* SLOW_DEVICE_NAME = "EventHub_test slow keyboard";
+
+// How long to wait for an expected event before giving up.
+static const nsecs_t EVENT_TIMEOUT = 5000000000LL; // 5 seconds
+
+// How long the fast device may take to report a key while the slow device is being probed.
+static const nsecs_t FAST_EVENT_TIMEOUT = 1000000000LL; // 1 second
+
+static const size_t EVENT_BUFFER_SIZE = 64;
+
+
+// --- UinputKeyboard ---
+
+/* A virtual keyboard created through the uinput driver. */
+class UinputKeyboard {
+public:
+    UinputKeyboard() : mFd(-1) { }
+
+    ~UinputKeyboard() {
+        if (mFd >= 0) {
+            ioctl(mFd, UI_DEV_DESTROY);
+            close(mFd);
+        }
+    }
+
+    status_t create(const char* name) {
+        mFd = open("/dev/uinput", O_WRONLY | O_NONBLOCK);
+        if (mFd < 0) {
+            return -errno;
+        }
+
+        ioctl(mFd, UI_SET_EVBIT, EV_KEY);
+        ioctl(mFd, UI_SET_EVBIT, EV_SYN);
+        for (int code = KEY_ESC; code <= KEY_SPACE; code++) {
+            ioctl(mFd, UI_SET_KEYBIT, code);
+        }
+
+        struct uinput_user_dev device;
+        memset(&device, 0, sizeof(device));
+        strncpy(device.name, name, UINPUT_MAX_NAME_SIZE - 1);
+        device.id.bustype = BUS_VIRTUAL;
+        device.id.vendor = 0x18d1;
+        device.id.product = 0x4ee7;
+        device.id.version = 1;
+        if (write(mFd, &device, sizeof(device)) != sizeof(device)
+                || ioctl(mFd, UI_DEV_CREATE)) {
+            return -errno;
+        }
+        return OK;
+    }
+
+    void pressKey(int code) {
+        writeEvent(EV_KEY, code, 1);
+        writeEvent(EV_SYN, SYN_REPORT, 0);
+        writeEvent(EV_KEY, code, 0);
+        writeEvent(EV_SYN, SYN_REPORT, 0);
+    }
+
+private:
+    int mFd;
+
+    void writeEvent(int type, int code, int value) {
+        struct input_event event;
+        memset(&event, 0, sizeof(event));
+        event.type = type;
+        event.code = code;
+        event.value = value;
+        write(mFd, &event, sizeof(event));
+    }
+};
+
+
+// --- SlowProbeEventHub ---
+
+/* An event hub that holds up the probe of one device until the test releases it. */
+class SlowProbeEventHub : public EventHub {
+public:
+    SlowProbeEventHub(const char* slowDeviceName) :
+            mSlowDeviceName(slowDeviceName), mProbeStarted(false), mProbeReleased(false) {
+    }
+
+    bool waitForProbeStarted(nsecs_t timeout) {
+        AutoMutex _l(mLock);
+        nsecs_t deadline = systemTime(SYSTEM_TIME_MONOTONIC) + timeout;
+        while (!mProbeStarted) {
+            nsecs_t remaining = deadline - systemTime(SYSTEM_TIME_MONOTONIC);
+            if (remaining <= 0) {
+                return false;
+            }
+            mCondition.waitRelative(mLock, remaining);
+        }
+        return true;
+    }
+
+    void releaseProbe() {
+        AutoMutex _l(mLock);
+        mProbeReleased = true;
+        mCondition.broadcast();
+    }
+
+protected:
+    virtual ~SlowProbeEventHub() {
+        // The probe thread must not call probeDevice() once our members are gone.
+        stopDeviceProbeThread();
+    }
+
+    virtual Device* probeDevice(const String8& path, int32_t deviceId,
+            const Vector<String8>& excludedDevices) {
+        Device* device = EventHub::probeDevice(path, deviceId, excludedDevices);
+        if (device && device->identifier.name == mSlowDeviceName) {
+            AutoMutex _l(mLock);
+            mProbeStarted = true;
+            mCondition.broadcast();
+            while (!mProbeReleased) {
+                mCondition.wait(mLock);
+            }
+        }
+        return device;
+    }
+
+private:
+    String8 mSlowDeviceName;
+
+    Mutex mLock;
+    Condition mCondition;
+    bool mProbeStarted;
+    bool mProbeReleased;
+};
+
+
+// --- EventHubTest ---
+
+class EventHubTest : public testing::Test {
+protected:
+    sp<SlowProbeEventHub> mEventHub;
+
+    virtual void SetUp() {
+        mEventHub = new SlowProbeEventHub(SLOW_DEVICE_NAME);
+    }
+
+    virtual void TearDown() {
+        // Never leave the probe thread blocked, the event hub waits for it to finish.
+        mEventHub->releaseProbe();
+        mEventHub.clear();
+    }
+
+    /* Reads events until a device with the given name is added.  Returns its id or -1. */
+    int32_t waitForDeviceAdded(const char* name) {
+        nsecs_t deadline = systemTime(SYSTEM_TIME_MONOTONIC) + EVENT_TIMEOUT;
+        RawEvent buffer[EVENT_BUFFER_SIZE];
+        while (systemTime(SYSTEM_TIME_MONOTONIC) < deadline) {
+            size_t count = mEventHub->getEvents(100, buffer, EVENT_BUFFER_SIZE);
+            for (size_t i = 0; i < count; i++) {
+                if (buffer[i].type == EventHubInterface::DEVICE_ADDED
+                        && mEventHub->getDeviceIdentifier(buffer[i].deviceId).name == name) {
+                    return buffer[i].deviceId;
+                }
+            }
+        }
+        return -1;
+    }
+
+    /* Reads events until a key up arrives from the given device, failing if any
+     * device with the given name is added in the meantime. */
+    bool waitForKeyUp(int32_t deviceId, int32_t scanCode, const char* unexpectedDeviceName,
+            nsecs_t timeout) {
+        nsecs_t deadline = systemTime(SYSTEM_TIME_MONOTONIC) + timeout;
+        RawEvent buffer[EVENT_BUFFER_SIZE];
+        while (systemTime(SYSTEM_TIME_MONOTONIC) < deadline) {
+            size_t count = mEventHub->getEvents(10, buffer, EVENT_BUFFER_SIZE);
+            for (size_t i = 0; i < count; i++) {
+                const RawEvent& event = buffer[i];
+                if (event.type == EventHubInterface::DEVICE_ADDED) {
+                    EXPECT_STRNE(unexpectedDeviceName,
+                            mEventHub->getDeviceIdentifier(event.deviceId).name.string())
+                            << "The device should not be added before its probe completes.";
+                }
+                if (event.deviceId == deviceId && event.type == EV_KEY
+                        && event.code == scanCode && event.value == 0) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+};
+
+TEST_F(EventHubTest, SlowHotplugProbe_DoesNotStallEventsFromOtherDevices) {
+    UinputKeyboard fastKeyboard;
+    status_t status = fastKeyboard.create(FAST_DEVICE_NAME);
+    if (status) {
+        ALOGW("Skipping test because /dev/uinput is not available, status=%d.", status);
+        return;
+    }
+
+    int32_t fastDeviceId = waitForDeviceAdded(FAST_DEVICE_NAME);
+    ASSERT_GE(fastDeviceId, 0)
+            << "The fast keyboard should have been added.";
+
+    // Plug in the slow keyboard and read events until its probe has started.
+    UinputKeyboard slowKeyboard;
+    ASSERT_EQ(OK, slowKeyboard.create(SLOW_DEVICE_NAME));
+
+    nsecs_t deadline = systemTime(SYSTEM_TIME_MONOTONIC) + EVENT_TIMEOUT;
+    RawEvent buffer[EVENT_BUFFER_SIZE];
+    while (!mEventHub->waitForProbeStarted(0)
+            && systemTime(SYSTEM_TIME_MONOTONIC) < deadline) {
+        mEventHub->getEvents(10, buffer, EVENT_BUFFER_SIZE);
+    }
+    ASSERT_TRUE(mEventHub->waitForProbeStarted(0))
+            << "The slow keyboard should have been probed after it was plugged in.";
+
+    // Events from the fast keyboard must keep flowing while the probe is stuck.
+    for (int i = 0; i < 3; i++) {
+        fastKeyboard.pressKey(KEY_A);
+        ASSERT_TRUE(waitForKeyUp(fastDeviceId, KEY_A, SLOW_DEVICE_NAME, FAST_EVENT_TIMEOUT))
+                << "Key events from the fast keyboard should be read while the slow "
+                "keyboard is being probed.";
+    }
+
+    // Once the probe completes, the slow keyboard is added.
+    mEventHub->releaseProbe();
+    int32_t slowDeviceId = waitForDeviceAdded(SLOW_DEVICE_NAME);
+    ASSERT_GE(slowDeviceId, 0)
+            << "The slow keyboard should be added after its probe completes.";
+    ASSERT_NE(fastDeviceId, slowDeviceId);
+
+    slowKeyboard.pressKey(KEY_B);
+    ASSERT_TRUE(waitForKeyUp(slowDeviceId, KEY_B, NULL, EVENT_TIMEOUT))
+            << "Key events from the slow keyboard should be read after it is added.";
+}
+
+} // namespace android
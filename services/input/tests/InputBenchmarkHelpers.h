@@ -0,0 +1,386 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _UI_INPUT_BENCHMARK_HELPERS_H
+#define _UI_INPUT_BENCHMARK_HELPERS_H
+
+#include "../InputDispatcher.h"
+#include "../InputReader.h"
+
+#include <androidfw/InputTransport.h>
+#include <utils/threads.h>
+#include <utils/Timers.h>
+#include <utils/Vector.h>
+
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace android {
+
+/*
+ * Shared fixtures for the input pipeline benchmarks.
+ *
+ * The benchmarks are plain executables rather than gtest cases because their
+ * output is a report, not a pass / fail result.
+ */
+
+// --- BenchmarkLatencyStats ---
+
+/* Collects latency samples and reports percentiles. */
+class BenchmarkLatencyStats {
+public:
+    BenchmarkLatencyStats() { }
+
+    inline void add(nsecs_t latency) {
+        mSamples.push(latency);
+    }
+
+    inline size_t size() const { return mSamples.size(); }
+
+    void merge(const BenchmarkLatencyStats& other) {
+        mSamples.appendVector(other.mSamples);
+    }
+
+    nsecs_t percentile(int p) {
+        if (mSamples.isEmpty()) {
+            return 0;
+        }
+        mSamples.sort(compare);
+        size_t index = (mSamples.size() - 1) * p / 100;
+        return mSamples.itemAt(index);
+    }
+
+    nsecs_t mean() const {
+        if (mSamples.isEmpty()) {
+            return 0;
+        }
+        nsecs_t total = 0;
+        for (size_t i = 0; i < mSamples.size(); i++) {
+            total += mSamples.itemAt(i);
+        }
+        return total / nsecs_t(mSamples.size());
+    }
+
+    void print(const char* label) {
+        printf("%s: samples=%d mean=%0.3fms p50=%0.3fms p90=%0.3fms p99=%0.3fms max=%0.3fms\n",
+                label, mSamples.size(), mean() * 0.000001f,
+                percentile(50) * 0.000001f, percentile(90) * 0.000001f,
+                percentile(99) * 0.000001f, percentile(100) * 0.000001f);
+    }
+
+private:
+    Vector<nsecs_t> mSamples;
+
+    static int compare(const nsecs_t* a, const nsecs_t* b) {
+        return *a < *b ? -1 : (*a > *b ? 1 : 0);
+    }
+};
+
+
+// --- BenchmarkPointerController ---
+
+class BenchmarkPointerController : public PointerControllerInterface {
+    float mMaxX, mMaxY;
+    float mX, mY;
+    int32_t mButtonState;
+
+protected:
+    virtual ~BenchmarkPointerController() { }
+
+public:
+    BenchmarkPointerController(float maxX, float maxY) :
+            mMaxX(maxX), mMaxY(maxY), mX(0), mY(0), mButtonState(0) {
+    }
+
+    virtual bool getBounds(float* outMinX, float* outMinY,
+            float* outMaxX, float* outMaxY) const {
+        *outMinX = 0;
+        *outMinY = 0;
+        *outMaxX = mMaxX;
+        *outMaxY = mMaxY;
+        return true;
+    }
+
+    virtual void move(float deltaX, float deltaY) {
+        mX += deltaX;
+        mY += deltaY;
+    }
+
+    virtual void setButtonState(int32_t buttonState) { mButtonState = buttonState; }
+    virtual int32_t getButtonState() const { return mButtonState; }
+    virtual void setPosition(float x, float y) { mX = x; mY = y; }
+    virtual void getPosition(float* outX, float* outY) const { *outX = mX; *outY = mY; }
+    virtual void fade(Transition transition) { }
+    virtual void unfade(Transition transition) { }
+    virtual void setPresentation(Presentation presentation) { }
+    virtual void setSpots(const PointerCoords* spotCoords, const uint32_t* spotIdToIndex,
+            BitSet32 spotIdBits) { }
+    virtual void clearSpots() { }
+};
+
+
+// --- BenchmarkReaderPolicy ---
+
+class BenchmarkReaderPolicy : public InputReaderPolicyInterface {
+    InputReaderConfiguration mConfig;
+    int32_t mWidth, mHeight;
+
+protected:
+    virtual ~BenchmarkReaderPolicy() { }
+
+public:
+    BenchmarkReaderPolicy(int32_t width, int32_t height) :
+            mWidth(width), mHeight(height) {
+        DisplayViewport v;
+        v.displayId = ADISPLAY_ID_DEFAULT;
+        v.orientation = DISPLAY_ORIENTATION_0;
+        v.logicalRight = width;
+        v.logicalBottom = height;
+        v.physicalRight = width;
+        v.physicalBottom = height;
+        v.deviceWidth = width;
+        v.deviceHeight = height;
+        mConfig.setDisplayInfo(false /*external*/, v);
+        mConfig.setDisplayInfo(true /*external*/, v);
+    }
+
+    virtual void getReaderConfiguration(InputReaderConfiguration* outConfig) {
+        *outConfig = mConfig;
+    }
+
+    virtual sp<PointerControllerInterface> obtainPointerController(int32_t deviceId) {
+        return new BenchmarkPointerController(mWidth - 1, mHeight - 1);
+    }
+
+    virtual void notifyInputDevicesChanged(const Vector<InputDeviceInfo>& inputDevices) {
+    }
+
+    virtual sp<KeyCharacterMap> getKeyboardLayoutOverlay(const String8& inputDeviceDescriptor) {
+        return NULL;
+    }
+
+    virtual String8 getDeviceAlias(const InputDeviceIdentifier& identifier) {
+        return String8::empty();
+    }
+};
+
+
+// --- BenchmarkDispatcherPolicy ---
+
+/* A dispatcher policy that passes every event through to the application. */
+class BenchmarkDispatcherPolicy : public InputDispatcherPolicyInterface {
+    InputDispatcherConfiguration mConfig;
+
+protected:
+    virtual ~BenchmarkDispatcherPolicy() { }
+
+public:
+    BenchmarkDispatcherPolicy() { }
+
+    virtual void notifyConfigurationChanged(nsecs_t when) { }
+
+    virtual nsecs_t notifyANR(const sp<InputApplicationHandle>& inputApplicationHandle,
+            const sp<InputWindowHandle>& inputWindowHandle) {
+        // Keep waiting; the consumers are expected to catch up eventually.
+        return 5000 * 1000000LL;
+    }
+
+    virtual void notifyInputChannelBroken(const sp<InputWindowHandle>& inputWindowHandle) { }
+
+    virtual void getDispatcherConfiguration(InputDispatcherConfiguration* outConfig) {
+        *outConfig = mConfig;
+    }
+
+    virtual bool isKeyRepeatEnabled() { return false; }
+
+    virtual bool filterInputEvent(const InputEvent* inputEvent, uint32_t policyFlags) {
+        return true;
+    }
+
+    virtual void interceptKeyBeforeQueueing(const KeyEvent* keyEvent, uint32_t& policyFlags) {
+        policyFlags |= POLICY_FLAG_PASS_TO_USER;
+    }
+
+    virtual void interceptMotionBeforeQueueing(nsecs_t when, uint32_t& policyFlags) {
+        policyFlags |= POLICY_FLAG_PASS_TO_USER;
+    }
+
+    virtual nsecs_t interceptKeyBeforeDispatching(const sp<InputWindowHandle>& inputWindowHandle,
+            const KeyEvent* keyEvent, uint32_t policyFlags) {
+        return 0;
+    }
+
+    virtual bool dispatchUnhandledKey(const sp<InputWindowHandle>& inputWindowHandle,
+            const KeyEvent* keyEvent, uint32_t policyFlags, KeyEvent* outFallbackKeyEvent) {
+        return false;
+    }
+
+    virtual void notifySwitch(nsecs_t when,
+            uint32_t switchValues, uint32_t switchMask, uint32_t policyFlags) { }
+
+    virtual void pokeUserActivity(nsecs_t eventTime, int32_t eventType) { }
+
+    virtual bool checkInjectEventsPermissionNonReentrant(
+            int32_t injectorPid, int32_t injectorUid) {
+        return true;
+    }
+};
+
+
+// --- BenchmarkApplicationHandle ---
+
+class BenchmarkApplicationHandle : public InputApplicationHandle {
+public:
+    BenchmarkApplicationHandle() { }
+
+    virtual bool updateInfo() {
+        if (!mInfo) {
+            mInfo = new InputApplicationInfo();
+        }
+        mInfo->name = "Benchmark Application";
+        mInfo->dispatchingTimeout = 5000 * 1000000LL;
+        return true;
+    }
+};
+
+
+// --- BenchmarkWindowHandle ---
+
+/* A visible, touchable, split-touch window covering the given frame. */
+class BenchmarkWindowHandle : public InputWindowHandle {
+    sp<InputChannel> mInputChannel;
+    String8 mName;
+    int32_t mLeft, mTop, mRight, mBottom;
+    int32_t mLayer;
+    bool mHasFocus;
+
+public:
+    BenchmarkWindowHandle(const sp<InputApplicationHandle>& inputApplicationHandle,
+            const sp<InputChannel>& inputChannel, const String8& name,
+            int32_t left, int32_t top, int32_t right, int32_t bottom,
+            int32_t layer, bool hasFocus) :
+            InputWindowHandle(inputApplicationHandle),
+            mInputChannel(inputChannel), mName(name),
+            mLeft(left), mTop(top), mRight(right), mBottom(bottom),
+            mLayer(layer), mHasFocus(hasFocus) {
+    }
+
+    virtual bool updateInfo() {
+        if (!mInfo) {
+            mInfo = new InputWindowInfo();
+        }
+        mInfo->inputChannel = mInputChannel;
+        mInfo->name = mName;
+        mInfo->layoutParamsFlags = InputWindowInfo::FLAG_SPLIT_TOUCH
+                | InputWindowInfo::FLAG_NOT_TOUCH_MODAL;
+        mInfo->layoutParamsType = InputWindowInfo::TYPE_APPLICATION;
+        mInfo->dispatchingTimeout = 5000 * 1000000LL;
+        mInfo->frameLeft = mLeft;
+        mInfo->frameTop = mTop;
+        mInfo->frameRight = mRight;
+        mInfo->frameBottom = mBottom;
+        mInfo->scaleFactor = 1.0f;
+        mInfo->touchableRegion.setRect(mLeft, mTop, mRight, mBottom);
+        mInfo->visible = true;
+        mInfo->canReceiveKeys = true;
+        mInfo->hasFocus = mHasFocus;
+        mInfo->hasWallpaper = false;
+        mInfo->paused = false;
+        mInfo->layer = mLayer;
+        mInfo->ownerPid = getpid();
+        mInfo->ownerUid = getuid();
+        mInfo->inputFeatures = 0;
+        mInfo->displayId = ADISPLAY_ID_DEFAULT;
+        return true;
+    }
+};
+
+
+// --- BenchmarkConsumerThread ---
+
+/*
+ * Consumes events from an input channel as fast as possible, recording the
+ * latency between each event's timestamp and the time it was received.
+ */
+class BenchmarkConsumerThread : public Thread {
+public:
+    BenchmarkConsumerThread(const sp<InputChannel>& channel) :
+            Thread(/*canCallJava*/ false), mConsumer(channel),
+            mEventCount(0), mLastEventTime(0) {
+    }
+
+    inline size_t getEventCount() const {
+        AutoMutex _l(mLock);
+        return mEventCount;
+    }
+
+    inline nsecs_t getLastEventTime() const {
+        AutoMutex _l(mLock);
+        return mLastEventTime;
+    }
+
+    BenchmarkLatencyStats getLatencyStats() const {
+        AutoMutex _l(mLock);
+        return mLatency;
+    }
+
+private:
+    InputConsumer mConsumer;
+    PreallocatedInputEventFactory mEventFactory;
+
+    mutable Mutex mLock;
+    size_t mEventCount;
+    nsecs_t mLastEventTime;
+    BenchmarkLatencyStats mLatency;
+
+    virtual bool threadLoop() {
+        struct pollfd fds[1];
+        fds[0].fd = mConsumer.getChannel()->getFd();
+        fds[0].events = POLLIN;
+        fds[0].revents = 0;
+        if (poll(fds, 1, 100) <= 0) {
+            return true;
+        }
+
+        for (;;) {
+            uint32_t seq;
+            InputEvent* event;
+            status_t status = mConsumer.consume(&mEventFactory, true /*consumeBatches*/,
+                    -1, &seq, &event);
+            if (status) {
+                break;
+            }
+
+            nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+            nsecs_t eventTime = event->getType() == AINPUT_EVENT_TYPE_MOTION
+                    ? static_cast<MotionEvent*>(event)->getEventTime()
+                    : static_cast<KeyEvent*>(event)->getEventTime();
+            { // acquire lock
+                AutoMutex _l(mLock);
+                mEventCount += 1;
+                mLastEventTime = now;
+                mLatency.add(now - eventTime);
+            } // release lock
+            mConsumer.sendFinishedSignal(seq, true);
+        }
+        return true;
+    }
+};
+
+} // namespace android
+
+#endif // _UI_INPUT_BENCHMARK_HELPERS_H
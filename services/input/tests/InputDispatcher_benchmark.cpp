@@ -0,0 +1,394 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Drives the InputDispatcher with synthetic motion and key streams and reports
+ * throughput, end-to-end latency and heap allocations per event.
+ *
+ * Usage: InputDispatcher_benchmark [--windows M] [--monitors N] [--motion-rate HZ]
+ *         [--key-rate HZ] [--duration S] [--inject]
+ *
+ * Each window has its own input channel and consumer thread.  Monitors are extra
+ * input channels that receive every event.  Motion events are touch gestures that
+ * sweep across the windows in turn and keys go to the focused window.  The rates are
+ * in events per second for each stream and a rate of 0 disables the stream.  With
+ * --inject the events go through injectInputEvent instead of notifyMotion and notifyKey.
+ *
+ * Allocations are counted by replacing the global operator new, so they include every
+ * thread in the process but not memory obtained directly with malloc, such as the
+ * storage of Vectors.
+ */
+
+#include "InputBenchmarkHelpers.h"
+
+#include <cutils/atomic.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace android;
+
+static volatile int32_t gAllocationCount = 0;
+
+void* operator new(size_t size) {
+    android_atomic_inc(&gAllocationCount);
+    void* p = malloc(size);
+    if (!p) {
+        abort();
+    }
+    return p;
+}
+
+void* operator new[](size_t size) {
+    android_atomic_inc(&gAllocationCount);
+    void* p = malloc(size);
+    if (!p) {
+        abort();
+    }
+    return p;
+}
+
+void operator delete(void* p) {
+    free(p);
+}
+
+void operator delete[](void* p) {
+    free(p);
+}
+
+static const int32_t DISPLAY_WIDTH = 1080;
+static const int32_t DISPLAY_HEIGHT = 1920;
+
+static const int32_t TOUCH_DEVICE_ID = 1;
+static const int32_t KEYBOARD_DEVICE_ID = 2;
+
+// The number of samples in each synthetic gesture, including the down and the up.
+static const size_t GESTURE_SAMPLES = 60;
+
+
+// --- SyntheticStreamThread ---
+
+/* Sends events to the dispatcher at a fixed rate until the end time. */
+class SyntheticStreamThread : public Thread {
+public:
+    SyntheticStreamThread(const sp<InputDispatcher>& dispatcher, bool inject,
+            float rate, nsecs_t startTime, nsecs_t endTime) :
+            Thread(/*canCallJava*/ false), mDispatcher(dispatcher), mInject(inject),
+            mInterval(nsecs_t(1000000000.0f / rate)), mNextTime(startTime), mEndTime(endTime),
+            mEventCount(0), mFailedCount(0) {
+    }
+
+    /* Only valid once the thread has exited. */
+    inline size_t getEventCount() const { return mEventCount; }
+    inline size_t getFailedCount() const { return mFailedCount; }
+
+protected:
+    sp<InputDispatcher> mDispatcher;
+    bool mInject;
+
+    /* Sends the event with the given index.  Returns false if it was rejected. */
+    virtual bool sendEvent(size_t index, nsecs_t eventTime) = 0;
+
+    bool injectEvent(const InputEvent* event) {
+        return mDispatcher->injectInputEvent(event, getpid(), getuid(),
+                INPUT_EVENT_INJECTION_SYNC_NONE, 0, 0) == INPUT_EVENT_INJECTION_SUCCEEDED;
+    }
+
+private:
+    nsecs_t mInterval;
+    nsecs_t mNextTime;
+    nsecs_t mEndTime;
+    size_t mEventCount;
+    size_t mFailedCount;
+
+    virtual bool threadLoop() {
+        nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+        if (now >= mEndTime) {
+            return false;
+        }
+        if (now < mNextTime) {
+            nsecs_t delay = mNextTime - now;
+            struct timespec ts;
+            ts.tv_sec = delay / 1000000000LL;
+            ts.tv_nsec = delay % 1000000000LL;
+            nanosleep(&ts, NULL);
+            return true;
+        }
+
+        // Keep to the schedule: if we fell behind then send the late events back to back.
+        if (!sendEvent(mEventCount, now)) {
+            mFailedCount += 1;
+        }
+        mEventCount += 1;
+        mNextTime += mInterval;
+        return true;
+    }
+};
+
+
+// --- MotionStreamThread ---
+
+/* Sends single finger gestures that move down the middle of each window in turn. */
+class MotionStreamThread : public SyntheticStreamThread {
+public:
+    MotionStreamThread(const sp<InputDispatcher>& dispatcher, bool inject,
+            float rate, nsecs_t startTime, nsecs_t endTime, size_t windowCount) :
+            SyntheticStreamThread(dispatcher, inject, rate, startTime, endTime),
+            mWindowCount(windowCount), mDownTime(0) {
+        mPointerProperties.clear();
+        mPointerProperties.id = 0;
+        mPointerProperties.toolType = AMOTION_EVENT_TOOL_TYPE_FINGER;
+    }
+
+private:
+    size_t mWindowCount;
+    nsecs_t mDownTime;
+    PointerProperties mPointerProperties;
+    MotionEvent mEvent;
+
+    virtual bool sendEvent(size_t index, nsecs_t eventTime) {
+        size_t gesture = index / GESTURE_SAMPLES;
+        size_t sample = index % GESTURE_SAMPLES;
+        int32_t action;
+        if (sample == 0) {
+            action = AMOTION_EVENT_ACTION_DOWN;
+            mDownTime = eventTime;
+        } else if (sample == GESTURE_SAMPLES - 1) {
+            action = AMOTION_EVENT_ACTION_UP;
+        } else {
+            action = AMOTION_EVENT_ACTION_MOVE;
+        }
+
+        int32_t windowWidth = DISPLAY_WIDTH / int32_t(mWindowCount);
+        PointerCoords pointerCoords;
+        pointerCoords.clear();
+        pointerCoords.setAxisValue(AMOTION_EVENT_AXIS_X,
+                (gesture % mWindowCount) * windowWidth + windowWidth * 0.5f);
+        pointerCoords.setAxisValue(AMOTION_EVENT_AXIS_Y,
+                100.0f + sample * float(DISPLAY_HEIGHT - 200) / GESTURE_SAMPLES);
+        pointerCoords.setAxisValue(AMOTION_EVENT_AXIS_PRESSURE, 1.0f);
+        pointerCoords.setAxisValue(AMOTION_EVENT_AXIS_SIZE, 0.1f);
+
+        if (mInject) {
+            mEvent.initialize(TOUCH_DEVICE_ID, AINPUT_SOURCE_TOUCHSCREEN, action, 0, 0,
+                    AMETA_NONE, 0, 0, 0, 1.0f, 1.0f, mDownTime, eventTime,
+                    1, &mPointerProperties, &pointerCoords);
+            return injectEvent(&mEvent);
+        }
+
+        NotifyMotionArgs args(eventTime, TOUCH_DEVICE_ID, AINPUT_SOURCE_TOUCHSCREEN, 0,
+                action, 0, AMETA_NONE, 0, 0, ADISPLAY_ID_DEFAULT,
+                1, &mPointerProperties, &pointerCoords, 1.0f, 1.0f, mDownTime);
+        mDispatcher->notifyMotion(&args);
+        return true;
+    }
+};
+
+
+// --- KeyStreamThread ---
+
+/* Sends alternating key downs and ups. */
+class KeyStreamThread : public SyntheticStreamThread {
+public:
+    KeyStreamThread(const sp<InputDispatcher>& dispatcher, bool inject,
+            float rate, nsecs_t startTime, nsecs_t endTime) :
+            SyntheticStreamThread(dispatcher, inject, rate, startTime, endTime),
+            mDownTime(0) {
+    }
+
+private:
+    nsecs_t mDownTime;
+    KeyEvent mEvent;
+
+    virtual bool sendEvent(size_t index, nsecs_t eventTime) {
+        int32_t action;
+        if (index % 2 == 0) {
+            action = AKEY_EVENT_ACTION_DOWN;
+            mDownTime = eventTime;
+        } else {
+            action = AKEY_EVENT_ACTION_UP;
+        }
+
+        if (mInject) {
+            mEvent.initialize(KEYBOARD_DEVICE_ID, AINPUT_SOURCE_KEYBOARD, action, 0,
+                    AKEYCODE_A, KEY_A, AMETA_NONE, 0, mDownTime, eventTime);
+            return injectEvent(&mEvent);
+        }
+
+        NotifyKeyArgs args(eventTime, KEYBOARD_DEVICE_ID, AINPUT_SOURCE_KEYBOARD, 0,
+                action, 0, AKEYCODE_A, KEY_A, AMETA_NONE, mDownTime);
+        mDispatcher->notifyKey(&args);
+        return true;
+    }
+};
+
+
+static void usage(const char* program) {
+    fprintf(stderr, "Usage: %s [--windows M] [--monitors N] [--motion-rate HZ] "
+            "[--key-rate HZ] [--duration S] [--inject]\n", program);
+}
+
+int main(int argc, char** argv) {
+    int windowCount = 4;
+    int monitorCount = 0;
+    float motionRate = 1000.0f;
+    float keyRate = 20.0f;
+    float duration = 5.0f;
+    bool inject = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--windows") && i + 1 < argc) {
+            windowCount = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--monitors") && i + 1 < argc) {
+            monitorCount = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--motion-rate") && i + 1 < argc) {
+            motionRate = float(atof(argv[++i]));
+        } else if (!strcmp(argv[i], "--key-rate") && i + 1 < argc) {
+            keyRate = float(atof(argv[++i]));
+        } else if (!strcmp(argv[i], "--duration") && i + 1 < argc) {
+            duration = float(atof(argv[++i]));
+        } else if (!strcmp(argv[i], "--inject")) {
+            inject = true;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (windowCount < 1 || windowCount > DISPLAY_WIDTH || monitorCount < 0
+            || motionRate < 0 || keyRate < 0 || duration <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    sp<BenchmarkDispatcherPolicy> policy = new BenchmarkDispatcherPolicy();
+    sp<InputDispatcher> dispatcher = new InputDispatcher(policy);
+    sp<InputApplicationHandle> application = new BenchmarkApplicationHandle();
+
+    // Tile the display with windows from left to right, the first one has focus.
+    Vector<sp<InputChannel> > serverChannels;
+    Vector<sp<BenchmarkConsumerThread> > consumers;
+    Vector<sp<InputWindowHandle> > windows;
+    int32_t windowWidth = DISPLAY_WIDTH / windowCount;
+    for (int i = 0; i < windowCount + monitorCount; i++) {
+        bool monitor = i >= windowCount;
+        String8 name;
+        name.appendFormat(monitor ? "monitor %d" : "window %d",
+                monitor ? i - windowCount : i);
+
+        sp<InputChannel> serverChannel, clientChannel;
+        InputChannel::openInputChannelPair(name, serverChannel, clientChannel);
+        sp<InputWindowHandle> window;
+        if (!monitor) {
+            window = new BenchmarkWindowHandle(application, serverChannel, name,
+                    i * windowWidth, 0, (i + 1) * windowWidth - 1, DISPLAY_HEIGHT,
+                    windowCount - i, i == 0 /*hasFocus*/);
+            windows.push(window);
+        }
+        dispatcher->registerInputChannel(serverChannel, window, monitor);
+        serverChannels.push(serverChannel);
+        consumers.push(new BenchmarkConsumerThread(clientChannel));
+    }
+    dispatcher->setFocusedApplication(application);
+    dispatcher->setInputWindows(windows);
+    dispatcher->setInputDispatchMode(true /*enabled*/, false /*frozen*/);
+
+    sp<InputDispatcherThread> dispatcherThread = new InputDispatcherThread(dispatcher);
+    dispatcherThread->run("bench-dispatcher", PRIORITY_URGENT_DISPLAY);
+    for (size_t i = 0; i < consumers.size(); i++) {
+        String8 name;
+        name.appendFormat("bench-consumer-%d", i);
+        consumers.itemAt(i)->run(name.string(), PRIORITY_URGENT_DISPLAY);
+    }
+
+    int32_t startAllocationCount = android_atomic_acquire_load(&gAllocationCount);
+    nsecs_t startTime = systemTime(SYSTEM_TIME_MONOTONIC);
+    nsecs_t endTime = startTime + nsecs_t(duration * 1000000000.0f);
+    sp<MotionStreamThread> motionStream;
+    if (motionRate > 0) {
+        motionStream = new MotionStreamThread(dispatcher, inject, motionRate,
+                startTime, endTime, windowCount);
+        motionStream->run("bench-motion", PRIORITY_URGENT_DISPLAY);
+    }
+    sp<KeyStreamThread> keyStream;
+    if (keyRate > 0) {
+        keyStream = new KeyStreamThread(dispatcher, inject, keyRate, startTime, endTime);
+        keyStream->run("bench-keys", PRIORITY_URGENT_DISPLAY);
+    }
+    if (motionStream != NULL) {
+        motionStream->join();
+    }
+    if (keyStream != NULL) {
+        keyStream->join();
+    }
+
+    // Give the dispatcher and consumers time to drain.
+    size_t deliveredCount = 0;
+    size_t lastCount = size_t(-1);
+    while (deliveredCount != lastCount) {
+        lastCount = deliveredCount;
+        usleep(200 * 1000);
+        deliveredCount = 0;
+        for (size_t i = 0; i < consumers.size(); i++) {
+            deliveredCount += consumers.itemAt(i)->getEventCount();
+        }
+    }
+    int32_t allocationCount = android_atomic_acquire_load(&gAllocationCount)
+            - startAllocationCount;
+
+    nsecs_t lastDeliveryTime = startTime;
+    BenchmarkLatencyStats latency;
+    for (size_t i = 0; i < consumers.size(); i++) {
+        const sp<BenchmarkConsumerThread>& consumer = consumers.itemAt(i);
+        if (consumer->getLastEventTime() > lastDeliveryTime) {
+            lastDeliveryTime = consumer->getLastEventTime();
+        }
+        latency.merge(consumer->getLatencyStats());
+    }
+
+    dispatcherThread->requestExit();
+    for (size_t i = 0; i < consumers.size(); i++) {
+        consumers.itemAt(i)->requestExit();
+    }
+    for (size_t i = 0; i < serverChannels.size(); i++) {
+        dispatcher->unregisterInputChannel(serverChannels.itemAt(i));
+    }
+    dispatcherThread->join();
+    for (size_t i = 0; i < consumers.size(); i++) {
+        consumers.itemAt(i)->join();
+    }
+
+    size_t motionCount = motionStream != NULL ? motionStream->getEventCount() : 0;
+    size_t keyCount = keyStream != NULL ? keyStream->getEventCount() : 0;
+    size_t failedCount = (motionStream != NULL ? motionStream->getFailedCount() : 0)
+            + (keyStream != NULL ? keyStream->getFailedCount() : 0);
+    size_t generatedCount = motionCount + keyCount;
+    float seconds = (lastDeliveryTime - startTime) * 0.000000001f;
+
+    printf("Setup: %d windows, %d monitors, %s, motion %0.1f/s, keys %0.1f/s, %0.1fs\n",
+            windowCount, monitorCount, inject ? "injected" : "notified",
+            motionRate, keyRate, duration);
+    printf("Generated: %d motion events, %d key events, %d rejected\n",
+            motionCount, keyCount, failedCount);
+    printf("Delivered: %d events in %0.3fs, %0.1f events/s\n", deliveredCount,
+            seconds, seconds > 0 ? deliveredCount / seconds : 0.0f);
+    printf("Allocations: %d, %0.2f per generated event\n", allocationCount,
+            generatedCount ? float(allocationCount) / generatedCount : 0.0f);
+    latency.print("End-to-end latency (event time -> consumer)");
+    return 0;
+}
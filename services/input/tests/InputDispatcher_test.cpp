@@ -16,8 +16,12 @@
 
 #include "../InputDispatcher.h"
 
+#include <androidfw/InputTransport.h>
 #include <gtest/gtest.h>
 #include <linux/input.h>
+#include <poll.h>
+#include <stdio.h>
+#include <unistd.h>
 
 namespace android {
 
@@ -36,13 +40,25 @@ static const int32_t INJECTOR_UID = 1001;
 
 class FakeInputDispatcherPolicy : public InputDispatcherPolicyInterface {
     InputDispatcherConfiguration mConfig;
+    InputDispatcher* mDispatcherToUnfilter;
 
 protected:
     virtual ~FakeInputDispatcherPolicy() {
     }
 
 public:
-    FakeInputDispatcherPolicy() {
+    FakeInputDispatcherPolicy() :
+            mDispatcherToUnfilter(NULL) {
+    }
+
+    void setConfiguration(const InputDispatcherConfiguration& config) {
+        mConfig = config;
+    }
+
+    /* Disables the input filter of the dispatcher while the next event is being filtered,
+     * as if it had been disabled concurrently. */
+    void disableInputFilterWhileFiltering(InputDispatcher* dispatcher) {
+        mDispatcherToUnfilter = dispatcher;
     }
 
 private:
@@ -66,13 +82,19 @@ private:
     }
 
     virtual bool filterInputEvent(const InputEvent* inputEvent, uint32_t policyFlags) {
+        if (mDispatcherToUnfilter) {
+            mDispatcherToUnfilter->setInputFilterEnabled(false);
+            mDispatcherToUnfilter = NULL;
+        }
         return true;
     }
 
     virtual void interceptKeyBeforeQueueing(const KeyEvent* keyEvent, uint32_t& policyFlags) {
+        policyFlags |= POLICY_FLAG_PASS_TO_USER;
     }
 
     virtual void interceptMotionBeforeQueueing(nsecs_t when, uint32_t& policyFlags) {
+        policyFlags |= POLICY_FLAG_PASS_TO_USER;
     }
 
     virtual nsecs_t interceptKeyBeforeDispatching(const sp<InputWindowHandle>& inputWindowHandle,
@@ -99,6 +121,74 @@ private:
 };
 
 
+// --- FakeInputWindowHandle ---
+
+class FakeInputWindowHandle : public InputWindowHandle {
+    sp<InputChannel> mServerChannel;
+    sp<InputChannel> mClientChannel;
+    String8 mName;
+    int32_t mLayer;
+    bool mHasFocus;
+    int32_t mUpdateInfoCount;
+
+public:
+    FakeInputWindowHandle(const char* name, int32_t layer) :
+            InputWindowHandle(NULL), mName(name), mLayer(layer), mHasFocus(false),
+            mUpdateInfoCount(0) {
+        InputChannel::openInputChannelPair(mName, mServerChannel, mClientChannel);
+    }
+
+    void setLayer(int32_t layer) {
+        mLayer = layer;
+    }
+
+    void setHasFocus(bool hasFocus) {
+        mHasFocus = hasFocus;
+    }
+
+    int32_t getUpdateInfoCount() const {
+        return mUpdateInfoCount;
+    }
+
+    const sp<InputChannel>& getServerChannel() const {
+        return mServerChannel;
+    }
+
+    const sp<InputChannel>& getClientChannel() const {
+        return mClientChannel;
+    }
+
+    virtual bool updateInfo() {
+        mUpdateInfoCount += 1;
+        if (!mInfo) {
+            mInfo = new InputWindowInfo();
+        }
+        mInfo->inputChannel = mServerChannel;
+        mInfo->name = mName;
+        mInfo->layoutParamsFlags = 0;
+        mInfo->layoutParamsType = InputWindowInfo::TYPE_APPLICATION;
+        mInfo->dispatchingTimeout = 5000 * 1000000LL;
+        mInfo->frameLeft = 0;
+        mInfo->frameTop = 0;
+        mInfo->frameRight = 100;
+        mInfo->frameBottom = 100;
+        mInfo->scaleFactor = 1.0f;
+        mInfo->touchableRegion.setRect(0, 0, 100, 100);
+        mInfo->visible = true;
+        mInfo->canReceiveKeys = true;
+        mInfo->hasFocus = mHasFocus;
+        mInfo->hasWallpaper = false;
+        mInfo->paused = false;
+        mInfo->layer = mLayer;
+        mInfo->ownerPid = getpid();
+        mInfo->ownerUid = getuid();
+        mInfo->inputFeatures = 0;
+        mInfo->displayId = ADISPLAY_ID_DEFAULT;
+        return true;
+    }
+};
+
+
 // --- InputDispatcherTest ---
 
 class InputDispatcherTest : public testing::Test {
@@ -115,6 +205,22 @@ protected:
         mFakePolicy.clear();
         mDispatcher.clear();
     }
+
+    /* Returns the names of the dispatcher's windows in front to back order,
+     * separated by spaces. */
+    String8 getWindowOrder() {
+        Vector<sp<InputWindowHandle> > windowHandles;
+        mDispatcher->getInputWindowsForTest(windowHandles);
+
+        String8 order;
+        for (size_t i = 0; i < windowHandles.size(); i++) {
+            if (i) {
+                order.append(" ");
+            }
+            order.append(windowHandles.itemAt(i)->getName());
+        }
+        return order;
+    }
 };
 
 
@@ -243,4 +349,636 @@ TEST_F(InputDispatcherTest, InjectInputEvent_ValidatesMotionEvents) {
             << "Should reject motion events with duplicate pointer ids.";
 }
 
+TEST_F(InputDispatcherTest, SetInputWindows_RefreshesEveryWindow) {
+    sp<FakeInputWindowHandle> windowA = new FakeInputWindowHandle("A", 2);
+    sp<FakeInputWindowHandle> windowB = new FakeInputWindowHandle("B", 1);
+    Vector<sp<InputWindowHandle> > windowHandles;
+    windowHandles.push(windowA);
+    windowHandles.push(windowB);
+
+    mDispatcher->setInputWindows(windowHandles);
+    mDispatcher->setInputWindows(windowHandles);
+    ASSERT_EQ(2, windowA->getUpdateInfoCount());
+    ASSERT_EQ(2, windowB->getUpdateInfoCount());
+    ASSERT_STREQ("A B", getWindowOrder().string());
+
+    // Windows that were set in bulk are refreshed by their first update.
+    Vector<InputWindowUpdate> updates;
+    updates.push(InputWindowUpdate(InputWindowUpdate::ACTION_SET, windowB, 1));
+    mDispatcher->updateInputWindows(updates);
+    ASSERT_EQ(2, windowA->getUpdateInfoCount());
+    ASSERT_EQ(3, windowB->getUpdateInfoCount());
+}
+
+TEST_F(InputDispatcherTest, UpdateInputWindows_SkipsUnchangedWindows) {
+    sp<FakeInputWindowHandle> windowA = new FakeInputWindowHandle("A", 2);
+    sp<FakeInputWindowHandle> windowB = new FakeInputWindowHandle("B", 1);
+
+    Vector<InputWindowUpdate> updates;
+    updates.push(InputWindowUpdate(InputWindowUpdate::ACTION_SET, windowA, 1));
+    updates.push(InputWindowUpdate(InputWindowUpdate::ACTION_SET, windowB, 1));
+    mDispatcher->updateInputWindows(updates);
+    ASSERT_EQ(1, windowA->getUpdateInfoCount());
+    ASSERT_EQ(1, windowB->getUpdateInfoCount());
+    ASSERT_STREQ("A B", getWindowOrder().string());
+
+    // Same generations: nothing is refreshed.
+    updates.clear();
+    updates.push(InputWindowUpdate(InputWindowUpdate::ACTION_SET, windowA, 1));
+    updates.push(InputWindowUpdate(InputWindowUpdate::ACTION_SET, windowB, 1));
+    mDispatcher->updateInputWindows(updates);
+    ASSERT_EQ(1, windowA->getUpdateInfoCount());
+    ASSERT_EQ(1, windowB->getUpdateInfoCount());
+
+    // Only the window whose generation changed is refreshed.
+    updates.clear();
+    updates.push(InputWindowUpdate(InputWindowUpdate::ACTION_SET, windowA, 2));
+    updates.push(InputWindowUpdate(InputWindowUpdate::ACTION_SET, windowB, 1));
+    mDispatcher->updateInputWindows(updates);
+    ASSERT_EQ(2, windowA->getUpdateInfoCount());
+    ASSERT_EQ(1, windowB->getUpdateInfoCount());
+
+    // Generation 0 always refreshes.
+    updates.clear();
+    updates.push(InputWindowUpdate(InputWindowUpdate::ACTION_SET, windowB, 0));
+    mDispatcher->updateInputWindows(updates);
+    ASSERT_EQ(2, windowB->getUpdateInfoCount());
+}
+
+TEST_F(InputDispatcherTest, UpdateInputWindows_KeepsWindowsOrderedByLayer) {
+    sp<FakeInputWindowHandle> windowA = new FakeInputWindowHandle("A", 1);
+    sp<FakeInputWindowHandle> windowB = new FakeInputWindowHandle("B", 3);
+    sp<FakeInputWindowHandle> windowC = new FakeInputWindowHandle("C", 2);
+
+    Vector<InputWindowUpdate> updates;
+    updates.push(InputWindowUpdate(InputWindowUpdate::ACTION_SET, windowA, 1));
+    updates.push(InputWindowUpdate(InputWindowUpdate::ACTION_SET, windowB, 1));
+    updates.push(InputWindowUpdate(InputWindowUpdate::ACTION_SET, windowC, 1));
+    mDispatcher->updateInputWindows(updates);
+    ASSERT_STREQ("B C A", getWindowOrder().string());
+
+    // Raising a window moves it to the front.
+    windowA->setLayer(4);
+    updates.clear();
+    updates.push(InputWindowUpdate(InputWindowUpdate::ACTION_SET, windowA, 2));
+    mDispatcher->updateInputWindows(updates);
+    ASSERT_STREQ("A B C", getWindowOrder().string());
+
+    // Setting a window that is not present adds it.
+    sp<FakeInputWindowHandle> windowD = new FakeInputWindowHandle("D", 3);
+    updates.clear();
+    updates.push(InputWindowUpdate(InputWindowUpdate::ACTION_SET, windowD, 1));
+    mDispatcher->updateInputWindows(updates);
+    ASSERT_STREQ("A B D C", getWindowOrder().string());
+}
+
+TEST_F(InputDispatcherTest, UpdateInputWindows_RemovesWindowsAndReleasesTheirInfo) {
+    sp<FakeInputWindowHandle> windowA = new FakeInputWindowHandle("A", 2);
+    sp<FakeInputWindowHandle> windowB = new FakeInputWindowHandle("B", 1);
+    windowB->setHasFocus(true);
+
+    Vector<InputWindowUpdate> updates;
+    updates.push(InputWindowUpdate(InputWindowUpdate::ACTION_SET, windowA, 1));
+    updates.push(InputWindowUpdate(InputWindowUpdate::ACTION_SET, windowB, 1));
+    mDispatcher->updateInputWindows(updates);
+
+    String8 dump;
+    mDispatcher->dump(dump);
+    ASSERT_GE(dump.find("FocusedWindow: name='B'"), 0);
+
+    updates.clear();
+    updates.push(InputWindowUpdate(InputWindowUpdate::ACTION_REMOVE, windowB, 0));
+    mDispatcher->updateInputWindows(updates);
+    ASSERT_STREQ("A", getWindowOrder().string());
+    ASSERT_TRUE(windowB->getInfo() == NULL)
+            << "The information of a removed window should be released.";
+    ASSERT_TRUE(windowA->getInfo() != NULL);
+
+    dump.clear();
+    mDispatcher->dump(dump);
+    ASSERT_GE(dump.find("FocusedWindow: name='<null>'"), 0);
+
+    // Removing a window that is not present does nothing.
+    mDispatcher->updateInputWindows(updates);
+    ASSERT_STREQ("A", getWindowOrder().string());
+}
+
+
+// --- InputDispatcherMotionCoalescingTest ---
+
+// The number of moves in the gesture sent to a stalled window.
+static const int32_t MOVE_COUNT = 500;
+
+class InputDispatcherMotionCoalescingTest : public InputDispatcherTest {
+protected:
+    sp<FakeInputWindowHandle> mWindow;
+    sp<InputDispatcherThread> mDispatcherThread;
+
+    // What the window received, in order.
+    int32_t mReceivedMoveSampleCount;
+    float mLastMoveX;
+    bool mMovesInOrder;
+
+    virtual void TearDown() {
+        if (mDispatcherThread != NULL) {
+            mDispatcherThread->requestExit();
+            mDispatcher->unregisterInputChannel(mWindow->getServerChannel());
+            mDispatcherThread->join();
+        }
+        InputDispatcherTest::TearDown();
+    }
+
+    void startDispatcher(bool coalescingEnabled, uint32_t maxHistory) {
+        InputDispatcherConfiguration config;
+        config.motionCoalescingEnabled = coalescingEnabled;
+        config.motionCoalescingMaxHistory = maxHistory;
+        mFakePolicy->setConfiguration(config);
+        mDispatcher = new InputDispatcher(mFakePolicy);
+
+        mWindow = new FakeInputWindowHandle("A", 1);
+        mDispatcher->registerInputChannel(mWindow->getServerChannel(), mWindow, false);
+        Vector<sp<InputWindowHandle> > windows;
+        windows.push(mWindow);
+        mDispatcher->setInputWindows(windows);
+        mDispatcher->setInputDispatchMode(true, false);
+
+        mDispatcherThread = new InputDispatcherThread(mDispatcher);
+        mDispatcherThread->run("InputDispatcher", PRIORITY_URGENT_DISPLAY);
+    }
+
+    void notifyMotion(nsecs_t eventTime, nsecs_t downTime, int32_t action, float x) {
+        PointerProperties pointerProperties;
+        pointerProperties.clear();
+        pointerProperties.id = 0;
+        pointerProperties.toolType = AMOTION_EVENT_TOOL_TYPE_FINGER;
+        PointerCoords pointerCoords;
+        pointerCoords.clear();
+        pointerCoords.setAxisValue(AMOTION_EVENT_AXIS_X, x);
+        pointerCoords.setAxisValue(AMOTION_EVENT_AXIS_Y, 50);
+
+        NotifyMotionArgs args(eventTime, DEVICE_ID, AINPUT_SOURCE_TOUCHSCREEN, 0,
+                action, 0, 0, 0, AMOTION_EVENT_EDGE_FLAG_NONE, ADISPLAY_ID_DEFAULT,
+                1, &pointerProperties, &pointerCoords, 0, 0, downTime);
+        mDispatcher->notifyMotion(&args);
+    }
+
+    /* Sends a gesture with many moves while the window is not consuming anything, and
+     * waits until the dispatcher has queued all of it for the window. */
+    void sendGestureToStalledWindow() {
+        // Events must be recent, otherwise the dispatcher drops them as stale.
+        nsecs_t downTime = systemTime(SYSTEM_TIME_MONOTONIC);
+        notifyMotion(downTime, downTime, AMOTION_EVENT_ACTION_DOWN, 0);
+        for (int32_t i = 1; i <= MOVE_COUNT; i++) {
+            notifyMotion(downTime + i, downTime, AMOTION_EVENT_ACTION_MOVE, i * 0.1f);
+        }
+        notifyMotion(downTime + MOVE_COUNT + 1, downTime, AMOTION_EVENT_ACTION_UP,
+                MOVE_COUNT * 0.1f);
+
+        // The up is queued for the window once everything before it has been.
+        nsecs_t deadline = systemTime(SYSTEM_TIME_MONOTONIC) + 5000000000LL;
+        for (;;) {
+            String8 dump;
+            mDispatcher->dump(dump);
+            if (dump.find("resolvedAction=1,") >= 0
+                    || systemTime(SYSTEM_TIME_MONOTONIC) > deadline) {
+                break;
+            }
+            usleep(10000);
+        }
+    }
+
+    /* Reads the coalescing counters of the window's connection from the dump. */
+    void getCoalescingCounts(uint32_t* outCoalescedCount, uint32_t* outDroppedCount) {
+        String8 dump;
+        mDispatcher->dump(dump);
+        *outCoalescedCount = 0;
+        *outDroppedCount = 0;
+        ssize_t position = dump.find("CoalescedMotion: ");
+        if (position >= 0) {
+            sscanf(dump.string() + position, "CoalescedMotion: samples=%u, dropped=%u",
+                    outCoalescedCount, outDroppedCount);
+        }
+    }
+
+    /* Consumes events like an application that finally caught up, until the up arrives. */
+    void consumeGesture() {
+        mReceivedMoveSampleCount = 0;
+        mLastMoveX = -1;
+        mMovesInOrder = true;
+
+        InputConsumer consumer(mWindow->getClientChannel());
+        PreallocatedInputEventFactory factory;
+        struct pollfd pfd;
+        pfd.fd = mWindow->getClientChannel()->getFd();
+        pfd.events = POLLIN;
+        for (;;) {
+            uint32_t seq;
+            InputEvent* event;
+            status_t status = consumer.consume(&factory, true, -1, &seq, &event);
+            if (status == WOULD_BLOCK) {
+                ASSERT_GT(poll(&pfd, 1, 5000), 0)
+                        << "The rest of the gesture should be delivered.";
+                continue;
+            }
+            ASSERT_EQ(OK, status);
+            ASSERT_EQ(AINPUT_EVENT_TYPE_MOTION, event->getType());
+            ASSERT_EQ(OK, consumer.sendFinishedSignal(seq, true));
+
+            MotionEvent* motionEvent = static_cast<MotionEvent*>(event);
+            if (motionEvent->getAction() == AMOTION_EVENT_ACTION_UP) {
+                break;
+            }
+            if (motionEvent->getAction() != AMOTION_EVENT_ACTION_MOVE) {
+                continue;
+            }
+            for (size_t h = 0; h <= motionEvent->getHistorySize(); h++) {
+                float x = h < motionEvent->getHistorySize()
+                        ? motionEvent->getHistoricalX(0, h) : motionEvent->getX(0);
+                if (x <= mLastMoveX) {
+                    mMovesInOrder = false;
+                }
+                mLastMoveX = x;
+                mReceivedMoveSampleCount += 1;
+            }
+        }
+    }
+};
+
+TEST_F(InputDispatcherMotionCoalescingTest, Disabled_DeliversEveryMove) {
+    startDispatcher(false, 0);
+    sendGestureToStalledWindow();
+    ASSERT_NO_FATAL_FAILURE(consumeGesture());
+
+    ASSERT_EQ(MOVE_COUNT, mReceivedMoveSampleCount);
+    ASSERT_TRUE(mMovesInOrder);
+
+    uint32_t coalescedCount, droppedCount;
+    getCoalescingCounts(&coalescedCount, &droppedCount);
+    ASSERT_EQ(0U, coalescedCount);
+}
+
+TEST_F(InputDispatcherMotionCoalescingTest, Enabled_CoalescesMovesForStalledWindow) {
+    startDispatcher(true, 0);
+    sendGestureToStalledWindow();
+
+    uint32_t coalescedCount, droppedCount;
+    getCoalescingCounts(&coalescedCount, &droppedCount);
+    ASSERT_GT(coalescedCount, 0U)
+            << "Moves should have been coalesced while the window was not consuming.";
+
+    ASSERT_NO_FATAL_FAILURE(consumeGesture());
+    getCoalescingCounts(&coalescedCount, &droppedCount);
+    ASSERT_EQ(coalescedCount, droppedCount)
+            << "No history should be kept when the maximum history is 0.";
+    ASSERT_EQ(MOVE_COUNT - int32_t(droppedCount), mReceivedMoveSampleCount);
+    ASSERT_TRUE(mMovesInOrder);
+    ASSERT_NEAR(MOVE_COUNT * 0.1f, mLastMoveX, 0.001f)
+            << "The newest move should never be dropped.";
+}
+
+TEST_F(InputDispatcherMotionCoalescingTest, Enabled_KeepsRecentSamplesAsHistory) {
+    const uint32_t maxHistory = 8;
+    startDispatcher(true, maxHistory);
+    sendGestureToStalledWindow();
+
+    uint32_t coalescedCount, droppedCount;
+    getCoalescingCounts(&coalescedCount, &droppedCount);
+    ASSERT_GT(coalescedCount, maxHistory);
+
+    // The history is published ahead of the newest sample, in order.
+    ASSERT_NO_FATAL_FAILURE(consumeGesture());
+    getCoalescingCounts(&coalescedCount, &droppedCount);
+    ASSERT_LE(droppedCount, coalescedCount - maxHistory)
+            << "The most recent superseded samples should be kept as history.";
+    ASSERT_EQ(MOVE_COUNT - int32_t(droppedCount), mReceivedMoveSampleCount);
+    ASSERT_TRUE(mMovesInOrder);
+    ASSERT_NEAR(MOVE_COUNT * 0.1f, mLastMoveX, 0.001f);
+}
+
+
+// --- InputDispatcherInboundTest ---
+
+// The number of threads that notify the dispatcher concurrently, and how much each sends.
+static const int32_t PRODUCER_COUNT = 4;
+static const int32_t PRODUCER_EVENT_COUNT = 150;
+
+// Injected events use a device id that no producer uses.
+static const int32_t INJECTED_DEVICE_ID = 100;
+static const int32_t INJECTED_BATCH_COUNT = 40;
+static const int32_t INJECTED_BATCH_SIZE = 5;
+
+static void initializeScrollEvent(MotionEvent* event, int32_t deviceId, nsecs_t eventTime,
+        size_t sampleCount) {
+    PointerProperties pointerProperties;
+    pointerProperties.clear();
+    pointerProperties.id = 0;
+    PointerCoords pointerCoords;
+    pointerCoords.clear();
+    pointerCoords.setAxisValue(AMOTION_EVENT_AXIS_VSCROLL, 1);
+
+    event->initialize(deviceId, AINPUT_SOURCE_TRACKBALL,
+            AMOTION_EVENT_ACTION_SCROLL, 0, 0, AMETA_NONE, 0, 0, 0, 0, 0,
+            eventTime, eventTime, 1, &pointerProperties, &pointerCoords);
+    for (size_t i = 1; i < sampleCount; i++) {
+        event->addSample(eventTime + i, &pointerCoords);
+    }
+}
+
+/* Sends an interleaved stream of keys and trackball scrolls for one device.
+ * The event time of each event is one more than that of the one before. */
+class NotifyProducerThread : public Thread {
+public:
+    NotifyProducerThread(const sp<InputDispatcher>& dispatcher, int32_t deviceId,
+            nsecs_t baseTime) :
+            Thread(false), mDispatcher(dispatcher), mDeviceId(deviceId), mBaseTime(baseTime) {
+    }
+
+private:
+    sp<InputDispatcher> mDispatcher;
+    int32_t mDeviceId;
+    nsecs_t mBaseTime;
+
+    virtual bool threadLoop() {
+        for (int32_t i = 0; i < PRODUCER_EVENT_COUNT; i++) {
+            nsecs_t when = mBaseTime + i;
+            if (i % 3 == 2) {
+                PointerProperties pointerProperties;
+                pointerProperties.clear();
+                pointerProperties.id = 0;
+                PointerCoords pointerCoords;
+                pointerCoords.clear();
+                pointerCoords.setAxisValue(AMOTION_EVENT_AXIS_VSCROLL, 1);
+                NotifyMotionArgs args(when, mDeviceId, AINPUT_SOURCE_TRACKBALL, 0,
+                        AMOTION_EVENT_ACTION_SCROLL, 0, 0, 0, AMOTION_EVENT_EDGE_FLAG_NONE,
+                        ADISPLAY_ID_DEFAULT, 1, &pointerProperties, &pointerCoords, 0, 0, when);
+                mDispatcher->notifyMotion(&args);
+            } else {
+                int32_t action = i % 3 == 0 ? AKEY_EVENT_ACTION_DOWN : AKEY_EVENT_ACTION_UP;
+                NotifyKeyArgs args(when, mDeviceId, AINPUT_SOURCE_KEYBOARD, 0,
+                        action, 0, AKEYCODE_A, KEY_A, AMETA_NONE, when);
+                mDispatcher->notifyKey(&args);
+            }
+        }
+        return false;
+    }
+};
+
+/* Injects a trackball scroll, optionally with history so that it is posted as a batch of
+ * several entries, and records the result of the last injection. */
+class InjectorThread : public Thread {
+public:
+    InjectorThread(const sp<InputDispatcher>& dispatcher, int32_t injectionCount,
+            size_t sampleCount, int32_t syncMode, int32_t timeoutMillis) :
+            Thread(false), mDispatcher(dispatcher), mInjectionCount(injectionCount),
+            mSampleCount(sampleCount), mSyncMode(syncMode), mTimeoutMillis(timeoutMillis),
+            mResult(INPUT_EVENT_INJECTION_PENDING) {
+    }
+
+    int32_t getResult() const {
+        return mResult;
+    }
+
+private:
+    sp<InputDispatcher> mDispatcher;
+    int32_t mInjectionCount;
+    size_t mSampleCount;
+    int32_t mSyncMode;
+    int32_t mTimeoutMillis;
+    volatile int32_t mResult;
+
+    virtual bool threadLoop() {
+        for (int32_t i = 0; i < mInjectionCount; i++) {
+            MotionEvent event;
+            initializeScrollEvent(&event, INJECTED_DEVICE_ID,
+                    systemTime(SYSTEM_TIME_MONOTONIC), mSampleCount);
+            mResult = mDispatcher->injectInputEvent(&event, getpid(), getuid(),
+                    mSyncMode, mTimeoutMillis, 0);
+        }
+        return false;
+    }
+};
+
+class InputDispatcherInboundTest : public InputDispatcherTest {
+protected:
+    sp<FakeInputWindowHandle> mWindow;
+    sp<InputDispatcherThread> mDispatcherThread;
+    InputConsumer* mConsumer;
+    PreallocatedInputEventFactory mEventFactory;
+
+    virtual void SetUp() {
+        InputDispatcherTest::SetUp();
+
+        mWindow = new FakeInputWindowHandle("A", 1);
+        mWindow->setHasFocus(true);
+        mDispatcher->registerInputChannel(mWindow->getServerChannel(), mWindow, false);
+        Vector<sp<InputWindowHandle> > windows;
+        windows.push(mWindow);
+        mDispatcher->setInputWindows(windows);
+        mConsumer = new InputConsumer(mWindow->getClientChannel());
+    }
+
+    virtual void TearDown() {
+        if (mDispatcherThread != NULL) {
+            mDispatcherThread->requestExit();
+        }
+        mDispatcher->unregisterInputChannel(mWindow->getServerChannel());
+        if (mDispatcherThread != NULL) {
+            mDispatcherThread->join();
+        }
+        delete mConsumer;
+        InputDispatcherTest::TearDown();
+    }
+
+    void startDispatcher(bool frozen) {
+        mDispatcher->setInputDispatchMode(true, frozen);
+        mDispatcherThread = new InputDispatcherThread(mDispatcher);
+        mDispatcherThread->run("InputDispatcher", PRIORITY_URGENT_DISPLAY);
+    }
+
+    /* Receives the next event delivered to the window and reports it as handled.
+     * Returns NULL if nothing arrives within the timeout. */
+    InputEvent* consumeEvent(int timeoutMillis) {
+        struct pollfd pfd;
+        pfd.fd = mWindow->getClientChannel()->getFd();
+        pfd.events = POLLIN;
+        for (;;) {
+            uint32_t seq;
+            InputEvent* event;
+            status_t status = mConsumer->consume(&mEventFactory, true, -1, &seq, &event);
+            if (status == WOULD_BLOCK) {
+                if (poll(&pfd, 1, timeoutMillis) <= 0) {
+                    return NULL;
+                }
+                continue;
+            }
+            if (status || mConsumer->sendFinishedSignal(seq, true)) {
+                return NULL;
+            }
+            return event;
+        }
+    }
+};
+
+TEST_F(InputDispatcherInboundTest, ConcurrentNotify_PreservesOrderOfEachProducer) {
+    startDispatcher(false);
+
+    // Events must be recent, otherwise the dispatcher drops them as stale.
+    nsecs_t baseTime = systemTime(SYSTEM_TIME_MONOTONIC);
+    Vector<sp<Thread> > threads;
+    for (int32_t p = 0; p < PRODUCER_COUNT; p++) {
+        threads.push(new NotifyProducerThread(mDispatcher, DEVICE_ID + p, baseTime));
+    }
+    sp<InjectorThread> injector = new InjectorThread(mDispatcher, INJECTED_BATCH_COUNT,
+            INJECTED_BATCH_SIZE, INPUT_EVENT_INJECTION_SYNC_NONE, 0);
+    threads.push(injector);
+    for (size_t i = 0; i < threads.size(); i++) {
+        threads[i]->run("Producer");
+    }
+
+    nsecs_t lastEventTimes[PRODUCER_COUNT];
+    int32_t receivedCounts[PRODUCER_COUNT];
+    for (int32_t p = 0; p < PRODUCER_COUNT; p++) {
+        lastEventTimes[p] = -1;
+        receivedCounts[p] = 0;
+    }
+    int32_t injectedCount = 0;
+    int32_t injectedRunLength = 0;
+    int32_t expectedCount = PRODUCER_COUNT * PRODUCER_EVENT_COUNT
+            + INJECTED_BATCH_COUNT * INJECTED_BATCH_SIZE;
+    for (int32_t received = 0; received < expectedCount; ) {
+        InputEvent* event = consumeEvent(5000);
+        ASSERT_TRUE(event != NULL) << "Only received " << received << " events.";
+
+        nsecs_t eventTime;
+        if (event->getType() == AINPUT_EVENT_TYPE_KEY) {
+            KeyEvent* keyEvent = static_cast<KeyEvent*>(event);
+            if (keyEvent->getRepeatCount()) {
+                continue; // synthesized by the dispatcher
+            }
+            eventTime = keyEvent->getEventTime();
+        } else {
+            eventTime = static_cast<MotionEvent*>(event)->getEventTime();
+        }
+        received += 1;
+
+        // Each injected batch must arrive in one piece.
+        if (event->getDeviceId() == INJECTED_DEVICE_ID) {
+            if (injectedRunLength == INJECTED_BATCH_SIZE) {
+                injectedRunLength = 0;
+            }
+            injectedRunLength += 1;
+            injectedCount += 1;
+            continue;
+        }
+        ASSERT_TRUE(injectedRunLength == 0 || injectedRunLength == INJECTED_BATCH_SIZE)
+                << "An injected batch was interleaved with other events.";
+        injectedRunLength = 0;
+
+        int32_t p = event->getDeviceId() - DEVICE_ID;
+        ASSERT_GE(p, 0);
+        ASSERT_LT(p, PRODUCER_COUNT);
+        ASSERT_GT(eventTime, lastEventTimes[p])
+                << "Events of producer " << p << " were reordered.";
+        lastEventTimes[p] = eventTime;
+        receivedCounts[p] += 1;
+    }
+
+    for (size_t i = 0; i < threads.size(); i++) {
+        threads[i]->join();
+    }
+    for (int32_t p = 0; p < PRODUCER_COUNT; p++) {
+        ASSERT_EQ(PRODUCER_EVENT_COUNT, receivedCounts[p]);
+    }
+    ASSERT_EQ(INJECTED_BATCH_COUNT * INJECTED_BATCH_SIZE, injectedCount);
+}
+
+TEST_F(InputDispatcherInboundTest, InjectInputEvent_WaitForResult_SucceedsOnceDispatched) {
+    startDispatcher(false);
+
+    MotionEvent event;
+    initializeScrollEvent(&event, INJECTED_DEVICE_ID, systemTime(SYSTEM_TIME_MONOTONIC), 1);
+    ASSERT_EQ(INPUT_EVENT_INJECTION_SUCCEEDED, mDispatcher->injectInputEvent(&event,
+            getpid(), getuid(), INPUT_EVENT_INJECTION_SYNC_WAIT_FOR_RESULT, 5000, 0));
+}
+
+TEST_F(InputDispatcherInboundTest, InjectInputEvent_WaitForResult_TimesOutWhenNotDispatched) {
+    startDispatcher(true /*frozen*/);
+
+    MotionEvent event;
+    initializeScrollEvent(&event, INJECTED_DEVICE_ID, systemTime(SYSTEM_TIME_MONOTONIC), 1);
+    nsecs_t before = systemTime(SYSTEM_TIME_MONOTONIC);
+    ASSERT_EQ(INPUT_EVENT_INJECTION_TIMED_OUT, mDispatcher->injectInputEvent(&event,
+            getpid(), getuid(), INPUT_EVENT_INJECTION_SYNC_WAIT_FOR_RESULT, 100, 0));
+    ASSERT_GE(systemTime(SYSTEM_TIME_MONOTONIC) - before, milliseconds_to_nanoseconds(90));
+}
+
+TEST_F(InputDispatcherInboundTest, InjectInputEvent_WaitForFinished_SucceedsOnceConsumed) {
+    startDispatcher(false);
+
+    sp<InjectorThread> injector = new InjectorThread(mDispatcher, 1, 1,
+            INPUT_EVENT_INJECTION_SYNC_WAIT_FOR_FINISHED, 5000);
+    injector->run("Injector");
+    ASSERT_TRUE(consumeEvent(5000) != NULL);
+    injector->join();
+    ASSERT_EQ(INPUT_EVENT_INJECTION_SUCCEEDED, injector->getResult());
+}
+
+TEST_F(InputDispatcherInboundTest, InjectInputEvent_WaitForFinished_TimesOutWhenNotConsumed) {
+    startDispatcher(false);
+
+    MotionEvent event;
+    initializeScrollEvent(&event, INJECTED_DEVICE_ID, systemTime(SYSTEM_TIME_MONOTONIC), 1);
+    nsecs_t before = systemTime(SYSTEM_TIME_MONOTONIC);
+    ASSERT_EQ(INPUT_EVENT_INJECTION_TIMED_OUT, mDispatcher->injectInputEvent(&event,
+            getpid(), getuid(), INPUT_EVENT_INJECTION_SYNC_WAIT_FOR_FINISHED, 100, 0));
+    ASSERT_GE(systemTime(SYSTEM_TIME_MONOTONIC) - before, milliseconds_to_nanoseconds(90));
+}
+
+TEST_F(InputDispatcherInboundTest, DisableDispatch_ReleasesEventsNotYetTransferred) {
+    // Without a dispatcher thread, posted events are never moved to the inbound queue.
+    mDispatcher->setInputDispatchMode(true, false);
+    sp<InjectorThread> injector = new InjectorThread(mDispatcher, 1, INJECTED_BATCH_SIZE,
+            INPUT_EVENT_INJECTION_SYNC_WAIT_FOR_RESULT, 5000);
+    injector->run("Injector");
+
+    // Disabling dispatch drains everything that was posted so far.  Repeat until the
+    // injector has posted its batch and been told that it was dropped.
+    nsecs_t deadline = systemTime(SYSTEM_TIME_MONOTONIC) + milliseconds_to_nanoseconds(2000);
+    while (injector->getResult() == INPUT_EVENT_INJECTION_PENDING
+            && systemTime(SYSTEM_TIME_MONOTONIC) < deadline) {
+        usleep(10000);
+        mDispatcher->setInputDispatchMode(false, false);
+        mDispatcher->setInputDispatchMode(true, false);
+    }
+    injector->join();
+    ASSERT_EQ(INPUT_EVENT_INJECTION_FAILED, injector->getResult())
+            << "Dropping an injected event that was never transferred should fail it.";
+
+    // Nothing that was drained is delivered later.
+    startDispatcher(false);
+    ASSERT_TRUE(consumeEvent(100) == NULL);
+}
+
+TEST_F(InputDispatcherInboundTest, NotifyKey_WhenInputFilterChangesWhileFiltering_DropsEvent) {
+    startDispatcher(false);
+    mDispatcher->setInputFilterEnabled(true);
+    mFakePolicy->disableInputFilterWhileFiltering(mDispatcher.get());
+
+    // The filter lets the first key through, but it was checked against a filter state
+    // that no longer holds once it reaches the dispatch loop.
+    nsecs_t when = systemTime(SYSTEM_TIME_MONOTONIC);
+    NotifyKeyArgs staleArgs(when, DEVICE_ID, AINPUT_SOURCE_KEYBOARD, 0,
+            AKEY_EVENT_ACTION_DOWN, 0, AKEYCODE_A, KEY_A, AMETA_NONE, when);
+    mDispatcher->notifyKey(&staleArgs);
+
+    NotifyKeyArgs args(when + 1, DEVICE_ID, AINPUT_SOURCE_KEYBOARD, 0,
+            AKEY_EVENT_ACTION_DOWN, 0, AKEYCODE_B, KEY_B, AMETA_NONE, when + 1);
+    mDispatcher->notifyKey(&args);
+
+    InputEvent* event = consumeEvent(5000);
+    ASSERT_TRUE(event != NULL);
+    ASSERT_EQ(AINPUT_EVENT_TYPE_KEY, event->getType());
+    ASSERT_EQ(AKEYCODE_B, static_cast<KeyEvent*>(event)->getKeyCode());
+}
+
 } // namespace android
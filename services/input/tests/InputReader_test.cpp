@@ -50,6 +50,8 @@ class FakePointerController : public PointerControllerInterface {
     float mMinX, mMinY, mMaxX, mMaxY;
     float mX, mY;
     int32_t mButtonState;
+    pthread_t mOwnerThread;
+    bool mUsedByOtherThread;
 
 protected:
     virtual ~FakePointerController() { }
@@ -57,7 +59,11 @@ protected:
 public:
     FakePointerController() :
         mHaveBounds(false), mMinX(0), mMinY(0), mMaxX(0), mMaxY(0), mX(0), mY(0),
-        mButtonState(0) {
+        mButtonState(0), mOwnerThread(pthread_self()), mUsedByOtherThread(false) {
+    }
+
+    bool wasUsedByOtherThread() const {
+        return mUsedByOtherThread;
     }
 
     void setBounds(float minX, float minY, float maxX, float maxY) {
@@ -69,11 +75,13 @@ public:
     }
 
     virtual void setPosition(float x, float y) {
+        checkThread();
         mX = x;
         mY = y;
     }
 
     virtual void setButtonState(int32_t buttonState) {
+        checkThread();
         mButtonState = buttonState;
     }
 
@@ -96,6 +104,7 @@ private:
     }
 
     virtual void move(float deltaX, float deltaY) {
+        checkThread();
         mX += deltaX;
         if (mX < mMinX) mX = mMinX;
         if (mX > mMaxX) mX = mMaxX;
@@ -105,9 +114,17 @@ private:
     }
 
     virtual void fade(Transition transition) {
+        checkThread();
     }
 
     virtual void unfade(Transition transition) {
+        checkThread();
+    }
+
+    void checkThread() {
+        if (!pthread_equal(pthread_self(), mOwnerThread)) {
+            mUsedByOtherThread = true;
+        }
     }
 
     virtual void setPresentation(Presentation presentation) {
@@ -324,6 +341,7 @@ class FakeEventHub : public EventHubInterface {
     KeyedVector<int32_t, Device*> mDevices;
     Vector<String8> mExcludedDevices;
     List<RawEvent> mEvents;
+    size_t mMaxEventsPerRead;
 
 protected:
     virtual ~FakeEventHub() {
@@ -333,7 +351,11 @@ protected:
     }
 
 public:
-    FakeEventHub() { }
+    FakeEventHub() : mMaxEventsPerRead(1) { }
+
+    void setMaxEventsPerRead(size_t maxEventsPerRead) {
+        mMaxEventsPerRead = maxEventsPerRead;
+    }
 
     void addDevice(int32_t deviceId, const String8& name, uint32_t classes) {
         Device* device = new Device(classes);
@@ -549,13 +571,12 @@ private:
     }
 
     virtual size_t getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSize) {
-        if (mEvents.empty()) {
-            return 0;
+        size_t count = 0;
+        while (!mEvents.empty() && count < bufferSize && count < mMaxEventsPerRead) {
+            buffer[count++] = *mEvents.begin();
+            mEvents.erase(mEvents.begin());
         }
-
-        *buffer = *mEvents.begin();
-        mEvents.erase(mEvents.begin());
-        return 1;
+        return count;
     }
 
     virtual int32_t getScanCodeState(int32_t deviceId, int32_t scanCode) const {
@@ -1169,6 +1190,193 @@ TEST_F(InputReaderTest, LoopOnce_ForwardsRawEventsToMappers) {
     ASSERT_EQ(1, event.value);
 }
 
+TEST_F(InputReaderTest, LoopOnce_StampsReadAndCookTimesOnCookedEvents) {
+    addDevice(1, String8("keyboard"), INPUT_DEVICE_CLASS_KEYBOARD, NULL);
+    mFakeEventHub->addKey(1, KEY_A, 0, AKEYCODE_A, 0);
+
+    nsecs_t before = systemTime(SYSTEM_TIME_MONOTONIC);
+    mFakeEventHub->enqueueEvent(ARBITRARY_TIME, 1, EV_KEY, KEY_A, 1);
+    mReader->loopOnce();
+    nsecs_t after = systemTime(SYSTEM_TIME_MONOTONIC);
+
+    NotifyKeyArgs args;
+    ASSERT_NO_FATAL_FAILURE(mFakeListener->assertNotifyKeyWasCalled(&args));
+    ASSERT_EQ(ARBITRARY_TIME, args.eventTime);
+    ASSERT_EQ(AKEYCODE_A, args.keyCode);
+    ASSERT_GE(args.readTime, before);
+    ASSERT_GE(args.cookTime, args.readTime);
+    ASSERT_LE(args.cookTime, after);
+}
+
+TEST_F(InputReaderTest, LoopOnce_WithDeviceWorkers_PreservesEventOrderAcrossDevices) {
+    const int32_t SWITCH_DEVICE_COUNT = 32;
+    const int32_t KEYBOARD_DEVICE_ID = SWITCH_DEVICE_COUNT + 1;
+    const int32_t ROUND_COUNT = 50;
+    const int32_t REPORTS_PER_ROUND = 48;
+
+    mReader->setDeviceWorkerCount(4);
+    for (int32_t deviceId = 1; deviceId <= SWITCH_DEVICE_COUNT; deviceId++) {
+        addDevice(deviceId, String8("switch"), INPUT_DEVICE_CLASS_SWITCH, NULL);
+    }
+    addDevice(KEYBOARD_DEVICE_ID, String8("keyboard"), INPUT_DEVICE_CLASS_KEYBOARD, NULL);
+    mFakeEventHub->addKey(KEYBOARD_DEVICE_ID, KEY_A, 0, AKEYCODE_A, 0);
+    mFakeEventHub->setMaxEventsPerRead(256);
+
+    // Each round interleaves reports from many devices in a single read, including
+    // several non-adjacent reports from the same device and keys that are processed
+    // on the reader thread.  The event time identifies each report.
+    uint32_t seed = 1;
+    bool keyDown = false;
+    for (int32_t round = 0; round < ROUND_COUNT; round++) {
+        Vector<nsecs_t> expectedSwitchTimes;
+        Vector<nsecs_t> expectedKeyTimes;
+        for (int32_t i = 0; i < REPORTS_PER_ROUND; i++) {
+            nsecs_t when = ARBITRARY_TIME + round * 1000 + i;
+            seed = seed * 1103515245 + 12345;
+            if (i % 8 == 7) {
+                keyDown = !keyDown;
+                mFakeEventHub->enqueueEvent(when, KEYBOARD_DEVICE_ID, EV_KEY, KEY_A, keyDown);
+                mFakeEventHub->enqueueEvent(when, KEYBOARD_DEVICE_ID, EV_SYN, SYN_REPORT, 0);
+                expectedKeyTimes.push(when);
+            } else {
+                int32_t deviceId = 1 + int32_t((seed >> 16) % SWITCH_DEVICE_COUNT);
+                mFakeEventHub->enqueueEvent(when, deviceId, EV_SW, SW_LID, i & 1);
+                mFakeEventHub->enqueueEvent(when, deviceId, EV_SYN, SYN_REPORT, 0);
+                expectedSwitchTimes.push(when);
+            }
+        }
+
+        mReader->loopOnce();
+        ASSERT_NO_FATAL_FAILURE(mFakeEventHub->assertQueueIsEmpty());
+
+        for (size_t i = 0; i < expectedSwitchTimes.size(); i++) {
+            NotifySwitchArgs args;
+            ASSERT_NO_FATAL_FAILURE(mFakeListener->assertNotifySwitchWasCalled(&args));
+            ASSERT_EQ(expectedSwitchTimes[i], args.eventTime)
+                    << "Switch " << i << " of round " << round << " is out of order.";
+        }
+        for (size_t i = 0; i < expectedKeyTimes.size(); i++) {
+            NotifyKeyArgs args;
+            ASSERT_NO_FATAL_FAILURE(mFakeListener->assertNotifyKeyWasCalled(&args));
+            ASSERT_EQ(expectedKeyTimes[i], args.eventTime)
+                    << "Key " << i << " of round " << round << " is out of order.";
+        }
+    }
+    ASSERT_NO_FATAL_FAILURE(mFakeListener->assertNotifyKeyWasNotCalled());
+}
+
+TEST_F(InputReaderTest, LoopOnce_WithDeviceWorkers_AppliesMetaStateInReadOrder) {
+    const int32_t CURSOR_DEVICE_COUNT = 8;
+    const int32_t KEYBOARD_DEVICE_ID = CURSOR_DEVICE_COUNT + 1;
+    const int32_t ROUND_COUNT = 50;
+    const int32_t REPORTS_PER_ROUND = 48;
+
+    mReader->setDeviceWorkerCount(4);
+    PropertyMap cursorConfiguration;
+    cursorConfiguration.addProperty(String8("cursor.mode"), String8("navigation"));
+    for (int32_t deviceId = 1; deviceId <= CURSOR_DEVICE_COUNT; deviceId++) {
+        addDevice(deviceId, String8("trackball"), INPUT_DEVICE_CLASS_CURSOR,
+                &cursorConfiguration);
+    }
+    addDevice(KEYBOARD_DEVICE_ID, String8("keyboard"), INPUT_DEVICE_CLASS_KEYBOARD, NULL);
+    mFakeEventHub->addKey(KEYBOARD_DEVICE_ID, KEY_LEFTSHIFT, 0, AKEYCODE_SHIFT_LEFT, 0);
+    mFakeEventHub->setMaxEventsPerRead(256);
+
+    // Shift is toggled between trackball reports within the same read.  Every motion
+    // event must carry the meta state in effect when its report was read, not the
+    // state left behind by keys that were read after it.
+    uint32_t seed = 1;
+    bool shiftDown = false;
+    for (int32_t round = 0; round < ROUND_COUNT; round++) {
+        Vector<nsecs_t> expectedMotionTimes;
+        Vector<int32_t> expectedMetaStates;
+        size_t expectedKeyCount = 0;
+        for (int32_t i = 0; i < REPORTS_PER_ROUND; i++) {
+            nsecs_t when = ARBITRARY_TIME + round * 1000 + i;
+            seed = seed * 1103515245 + 12345;
+            if ((seed >> 16) % 5 == 0) {
+                shiftDown = !shiftDown;
+                mFakeEventHub->enqueueEvent(when, KEYBOARD_DEVICE_ID,
+                        EV_KEY, KEY_LEFTSHIFT, shiftDown);
+                mFakeEventHub->enqueueEvent(when, KEYBOARD_DEVICE_ID, EV_SYN, SYN_REPORT, 0);
+                expectedKeyCount += 1;
+            } else {
+                int32_t deviceId = 1 + int32_t((seed >> 20) % CURSOR_DEVICE_COUNT);
+                mFakeEventHub->enqueueEvent(when, deviceId, EV_REL, REL_X, 1);
+                mFakeEventHub->enqueueEvent(when, deviceId, EV_SYN, SYN_REPORT, 0);
+                expectedMotionTimes.push(when);
+                expectedMetaStates.push(shiftDown
+                        ? AMETA_SHIFT_ON | AMETA_SHIFT_LEFT_ON : AMETA_NONE);
+            }
+        }
+
+        mReader->loopOnce();
+        ASSERT_NO_FATAL_FAILURE(mFakeEventHub->assertQueueIsEmpty());
+
+        for (size_t i = 0; i < expectedMotionTimes.size(); i++) {
+            NotifyMotionArgs args;
+            ASSERT_NO_FATAL_FAILURE(mFakeListener->assertNotifyMotionWasCalled(&args));
+            ASSERT_EQ(expectedMotionTimes[i], args.eventTime)
+                    << "Motion " << i << " of round " << round << " is out of order.";
+            ASSERT_EQ(expectedMetaStates[i], args.metaState)
+                    << "Motion " << i << " of round " << round << " has the wrong meta state.";
+        }
+        for (size_t i = 0; i < expectedKeyCount; i++) {
+            ASSERT_NO_FATAL_FAILURE(mFakeListener->assertNotifyKeyWasCalled());
+        }
+    }
+    ASSERT_NO_FATAL_FAILURE(mFakeListener->assertNotifyMotionWasNotCalled());
+    ASSERT_NO_FATAL_FAILURE(mFakeListener->assertNotifyKeyWasNotCalled());
+}
+
+TEST_F(InputReaderTest, LoopOnce_WithDeviceWorkers_KeepsPointerControllerOnReaderThread) {
+    const int32_t MOUSE_DEVICE_COUNT = 8;
+    const int32_t SWITCH_DEVICE_ID = MOUSE_DEVICE_COUNT + 1;
+    const int32_t ROUND_COUNT = 20;
+    const int32_t REPORTS_PER_ROUND = 48;
+
+    // Every mouse shares the same pointer controller, like in the system.
+    sp<FakePointerController> pointerController = new FakePointerController();
+    pointerController->setBounds(0, 0, 10000, 10000);
+    mReader->setDeviceWorkerCount(4);
+    for (int32_t deviceId = 1; deviceId <= MOUSE_DEVICE_COUNT; deviceId++) {
+        mFakePolicy->setPointerController(deviceId, pointerController);
+        addDevice(deviceId, String8("mouse"), INPUT_DEVICE_CLASS_CURSOR, NULL);
+    }
+    addDevice(SWITCH_DEVICE_ID, String8("switch"), INPUT_DEVICE_CLASS_SWITCH, NULL);
+    mFakeEventHub->setMaxEventsPerRead(256);
+
+    uint32_t seed = 1;
+    for (int32_t round = 0; round < ROUND_COUNT; round++) {
+        size_t expectedMotionCount = 0;
+        for (int32_t i = 0; i < REPORTS_PER_ROUND; i++) {
+            nsecs_t when = ARBITRARY_TIME + round * 1000 + i;
+            seed = seed * 1103515245 + 12345;
+            if (i % 4 == 3) {
+                mFakeEventHub->enqueueEvent(when, SWITCH_DEVICE_ID, EV_SW, SW_LID, i & 1);
+                mFakeEventHub->enqueueEvent(when, SWITCH_DEVICE_ID, EV_SYN, SYN_REPORT, 0);
+            } else {
+                int32_t deviceId = 1 + int32_t((seed >> 16) % MOUSE_DEVICE_COUNT);
+                mFakeEventHub->enqueueEvent(when, deviceId, EV_REL, REL_X, 1);
+                mFakeEventHub->enqueueEvent(when, deviceId, EV_SYN, SYN_REPORT, 0);
+                expectedMotionCount += 1;
+            }
+        }
+
+        mReader->loopOnce();
+        ASSERT_NO_FATAL_FAILURE(mFakeEventHub->assertQueueIsEmpty());
+
+        for (size_t i = 0; i < expectedMotionCount; i++) {
+            ASSERT_NO_FATAL_FAILURE(mFakeListener->assertNotifyMotionWasCalled());
+        }
+    }
+
+    ASSERT_FALSE(pointerController->wasUsedByOtherThread());
+    float x, y;
+    pointerController->getPosition(&x, &y);
+    ASSERT_GT(x, 0);
+}
+
 
 // --- InputDeviceTest ---
 
@@ -4425,6 +4633,148 @@ TEST_F(MultiTouchInputMapperTest, Process_NormalMultiTouchGesture_WithSlots) {
     ASSERT_NO_FATAL_FAILURE(mFakeListener->assertNotifyMotionWasNotCalled());
 }
 
+TEST_F(MultiTouchInputMapperTest, Process_WithoutTrackingIds_GreedyAssignmentSwapsFastPointers) {
+    MultiTouchInputMapper* mapper = new MultiTouchInputMapper(mDevice);
+    addConfigurationProperty("touch.deviceType", "touchScreen");
+    prepareDisplay(DISPLAY_ORIENTATION_0);
+    prepareAxes(POSITION);
+    addMapperAndConfigure(mapper);
+
+    NotifyMotionArgs motionArgs;
+
+    // Two fingers down.
+    processPosition(mapper, 100, 300);
+    processMTSync(mapper);
+    processPosition(mapper, 200, 300);
+    processMTSync(mapper);
+    processSync(mapper);
+    ASSERT_NO_FATAL_FAILURE(mFakeListener->assertNotifyMotionWasCalled(&motionArgs));
+    ASSERT_NO_FATAL_FAILURE(mFakeListener->assertNotifyMotionWasCalled(&motionArgs));
+
+    // Both fingers move right by 90.  The first finger ends up closer to where the
+    // second finger was than to where it started, so it steals the second finger's id.
+    processPosition(mapper, 190, 300);
+    processMTSync(mapper);
+    processPosition(mapper, 290, 300);
+    processMTSync(mapper);
+    processSync(mapper);
+    ASSERT_NO_FATAL_FAILURE(mFakeListener->assertNotifyMotionWasCalled(&motionArgs));
+    ASSERT_EQ(AMOTION_EVENT_ACTION_MOVE, motionArgs.action);
+    ASSERT_EQ(size_t(2), motionArgs.pointerCount);
+    ASSERT_EQ(0, motionArgs.pointerProperties[0].id);
+    ASSERT_NO_FATAL_FAILURE(assertPointerCoords(motionArgs.pointerCoords[0],
+            toDisplayX(290), toDisplayY(300), 1, 0, 0, 0, 0, 0, 0, 0));
+    ASSERT_EQ(1, motionArgs.pointerProperties[1].id);
+    ASSERT_NO_FATAL_FAILURE(assertPointerCoords(motionArgs.pointerCoords[1],
+            toDisplayX(190), toDisplayY(300), 1, 0, 0, 0, 0, 0, 0, 0));
+}
+
+TEST_F(MultiTouchInputMapperTest, Process_WithoutTrackingIds_OptimalAssignmentKeepsFastPointerIds) {
+    MultiTouchInputMapper* mapper = new MultiTouchInputMapper(mDevice);
+    addConfigurationProperty("touch.deviceType", "touchScreen");
+    addConfigurationProperty("touch.pointerIdAssignment", "optimal");
+    prepareDisplay(DISPLAY_ORIENTATION_0);
+    prepareAxes(POSITION);
+    addMapperAndConfigure(mapper);
+
+    NotifyMotionArgs motionArgs;
+
+    // Two fingers down.
+    processPosition(mapper, 100, 300);
+    processMTSync(mapper);
+    processPosition(mapper, 200, 300);
+    processMTSync(mapper);
+    processSync(mapper);
+    ASSERT_NO_FATAL_FAILURE(mFakeListener->assertNotifyMotionWasCalled(&motionArgs));
+    ASSERT_NO_FATAL_FAILURE(mFakeListener->assertNotifyMotionWasCalled(&motionArgs));
+
+    // Both fingers move right by 90 and keep their ids.
+    processPosition(mapper, 190, 300);
+    processMTSync(mapper);
+    processPosition(mapper, 290, 300);
+    processMTSync(mapper);
+    processSync(mapper);
+    ASSERT_NO_FATAL_FAILURE(mFakeListener->assertNotifyMotionWasCalled(&motionArgs));
+    ASSERT_EQ(AMOTION_EVENT_ACTION_MOVE, motionArgs.action);
+    ASSERT_EQ(size_t(2), motionArgs.pointerCount);
+    ASSERT_EQ(0, motionArgs.pointerProperties[0].id);
+    ASSERT_NO_FATAL_FAILURE(assertPointerCoords(motionArgs.pointerCoords[0],
+            toDisplayX(190), toDisplayY(300), 1, 0, 0, 0, 0, 0, 0, 0));
+    ASSERT_EQ(1, motionArgs.pointerProperties[1].id);
+    ASSERT_NO_FATAL_FAILURE(assertPointerCoords(motionArgs.pointerCoords[1],
+            toDisplayX(290), toDisplayY(300), 1, 0, 0, 0, 0, 0, 0, 0));
+
+    // A third finger goes down while the others keep moving.
+    processPosition(mapper, 600, 600);
+    processMTSync(mapper);
+    processPosition(mapper, 280, 300);
+    processMTSync(mapper);
+    processPosition(mapper, 380, 300);
+    processMTSync(mapper);
+    processSync(mapper);
+    ASSERT_NO_FATAL_FAILURE(mFakeListener->assertNotifyMotionWasCalled(&motionArgs));
+    ASSERT_EQ(AMOTION_EVENT_ACTION_MOVE, motionArgs.action);
+    ASSERT_NO_FATAL_FAILURE(mFakeListener->assertNotifyMotionWasCalled(&motionArgs));
+    ASSERT_EQ(AMOTION_EVENT_ACTION_POINTER_DOWN | (2 << AMOTION_EVENT_ACTION_POINTER_INDEX_SHIFT),
+            motionArgs.action);
+    ASSERT_EQ(size_t(3), motionArgs.pointerCount);
+    ASSERT_EQ(0, motionArgs.pointerProperties[0].id);
+    ASSERT_NO_FATAL_FAILURE(assertPointerCoords(motionArgs.pointerCoords[0],
+            toDisplayX(280), toDisplayY(300), 1, 0, 0, 0, 0, 0, 0, 0));
+    ASSERT_EQ(1, motionArgs.pointerProperties[1].id);
+    ASSERT_NO_FATAL_FAILURE(assertPointerCoords(motionArgs.pointerCoords[1],
+            toDisplayX(380), toDisplayY(300), 1, 0, 0, 0, 0, 0, 0, 0));
+    ASSERT_EQ(2, motionArgs.pointerProperties[2].id);
+    ASSERT_NO_FATAL_FAILURE(assertPointerCoords(motionArgs.pointerCoords[2],
+            toDisplayX(600), toDisplayY(600), 1, 0, 0, 0, 0, 0, 0, 0));
+}
+
+TEST_F(MultiTouchInputMapperTest, Process_WithoutTrackingIds_OptimalAssignmentRespectsToolTypes) {
+    MultiTouchInputMapper* mapper = new MultiTouchInputMapper(mDevice);
+    addConfigurationProperty("touch.deviceType", "touchScreen");
+    addConfigurationProperty("touch.pointerIdAssignment", "optimal");
+    prepareDisplay(DISPLAY_ORIENTATION_0);
+    prepareAxes(POSITION | TOOL_TYPE);
+    addMapperAndConfigure(mapper);
+
+    NotifyMotionArgs motionArgs;
+
+    // A finger and a stylus down next to each other.
+    processPosition(mapper, 100, 300);
+    processToolType(mapper, MT_TOOL_FINGER);
+    processMTSync(mapper);
+    processPosition(mapper, 120, 300);
+    processToolType(mapper, MT_TOOL_PEN);
+    processMTSync(mapper);
+    processSync(mapper);
+    ASSERT_NO_FATAL_FAILURE(mFakeListener->assertNotifyMotionWasCalled(&motionArgs));
+    ASSERT_NO_FATAL_FAILURE(mFakeListener->assertNotifyMotionWasCalled(&motionArgs));
+    ASSERT_EQ(size_t(2), motionArgs.pointerCount);
+    ASSERT_EQ(AMOTION_EVENT_TOOL_TYPE_FINGER, motionArgs.pointerProperties[0].toolType);
+    ASSERT_EQ(AMOTION_EVENT_TOOL_TYPE_STYLUS, motionArgs.pointerProperties[1].toolType);
+
+    // They cross over.  Each pointer is closer to where the other one was but ids
+    // must follow the tool type.
+    processPosition(mapper, 125, 300);
+    processToolType(mapper, MT_TOOL_FINGER);
+    processMTSync(mapper);
+    processPosition(mapper, 95, 300);
+    processToolType(mapper, MT_TOOL_PEN);
+    processMTSync(mapper);
+    processSync(mapper);
+    ASSERT_NO_FATAL_FAILURE(mFakeListener->assertNotifyMotionWasCalled(&motionArgs));
+    ASSERT_EQ(AMOTION_EVENT_ACTION_MOVE, motionArgs.action);
+    ASSERT_EQ(size_t(2), motionArgs.pointerCount);
+    ASSERT_EQ(0, motionArgs.pointerProperties[0].id);
+    ASSERT_EQ(AMOTION_EVENT_TOOL_TYPE_FINGER, motionArgs.pointerProperties[0].toolType);
+    ASSERT_NO_FATAL_FAILURE(assertPointerCoords(motionArgs.pointerCoords[0],
+            toDisplayX(125), toDisplayY(300), 1, 0, 0, 0, 0, 0, 0, 0));
+    ASSERT_EQ(1, motionArgs.pointerProperties[1].id);
+    ASSERT_EQ(AMOTION_EVENT_TOOL_TYPE_STYLUS, motionArgs.pointerProperties[1].toolType);
+    ASSERT_NO_FATAL_FAILURE(assertPointerCoords(motionArgs.pointerCoords[1],
+            toDisplayX(95), toDisplayY(300), 1, 0, 0, 0, 0, 0, 0, 0));
+}
+
 TEST_F(MultiTouchInputMapperTest, Process_AllAxes_WithDefaultCalibration) {
     MultiTouchInputMapper* mapper = new MultiTouchInputMapper(mDevice);
     addConfigurationProperty("touch.deviceType", "touchScreen");
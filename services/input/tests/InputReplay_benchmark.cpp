@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Replays an input trace recorded by RecordingEventHub through the InputReader and
+ * InputDispatcher and reports throughput and per-event latency.
+ *
+ * Usage: InputReplay_benchmark [--paced] [--display WxH] <trace file>
+ *
+ * Traces are recorded on a device by setting the debug.input.trace system property
+ * to a writable path before the system server starts.
+ */
+
+#include "../InputTrace.h"
+#include "InputBenchmarkHelpers.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace android;
+
+static void usage(const char* program) {
+    fprintf(stderr, "Usage: %s [--paced] [--display WxH] <trace file>\n", program);
+}
+
+int main(int argc, char** argv) {
+    bool paced = false;
+    int32_t width = 1080;
+    int32_t height = 1920;
+    const char* tracePath = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--paced")) {
+            paced = true;
+        } else if (!strcmp(argv[i], "--display") && i + 1 < argc) {
+            if (sscanf(argv[++i], "%dx%d", &width, &height) != 2) {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (argv[i][0] != '-' && !tracePath) {
+            tracePath = argv[i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!tracePath) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    InputTraceReader trace;
+    if (trace.load(String8(tracePath))) {
+        fprintf(stderr, "Could not load trace '%s'.\n", tracePath);
+        return 1;
+    }
+
+    sp<ReplayEventHub> eventHub = new ReplayEventHub(trace, paced);
+    sp<BenchmarkDispatcherPolicy> dispatcherPolicy = new BenchmarkDispatcherPolicy();
+    sp<BenchmarkReaderPolicy> readerPolicy = new BenchmarkReaderPolicy(width, height);
+    sp<InputDispatcher> dispatcher = new InputDispatcher(dispatcherPolicy);
+    sp<InputReader> reader = new InputReader(eventHub, readerPolicy, dispatcher);
+
+    // A single full screen window receives everything.
+    sp<InputChannel> serverChannel, clientChannel;
+    InputChannel::openInputChannelPair(String8("replay"), serverChannel, clientChannel);
+    sp<InputApplicationHandle> application = new BenchmarkApplicationHandle();
+    sp<InputWindowHandle> window = new BenchmarkWindowHandle(application, serverChannel,
+            String8("replay"), 0, 0, width, height, 1, true /*hasFocus*/);
+    dispatcher->registerInputChannel(serverChannel, window, false /*monitor*/);
+    Vector<sp<InputWindowHandle> > windows;
+    windows.push(window);
+    dispatcher->setFocusedApplication(application);
+    dispatcher->setInputWindows(windows);
+    dispatcher->setInputDispatchMode(true /*enabled*/, false /*frozen*/);
+
+    sp<BenchmarkConsumerThread> consumer = new BenchmarkConsumerThread(clientChannel);
+    sp<InputDispatcherThread> dispatcherThread = new InputDispatcherThread(dispatcher);
+    consumer->run("replay-consumer", PRIORITY_URGENT_DISPLAY);
+    dispatcherThread->run("replay-dispatcher", PRIORITY_URGENT_DISPLAY);
+
+    // Run the reader on this thread so that we can time each iteration.
+    BenchmarkLatencyStats readerStats;
+    size_t rawEventCount = trace.getEvents().size();
+    nsecs_t startTime = systemTime(SYSTEM_TIME_MONOTONIC);
+    while (!eventHub->isFinished()) {
+        size_t deliveredBatches = eventHub->getBatchDeliveryTimes().size();
+        reader->loopOnce();
+        nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+        const Vector<nsecs_t>& deliveryTimes = eventHub->getBatchDeliveryTimes();
+        if (deliveryTimes.size() > deliveredBatches) {
+            readerStats.add(now - deliveryTimes.top());
+        }
+    }
+    nsecs_t readerDoneTime = systemTime(SYSTEM_TIME_MONOTONIC);
+
+    // Give the dispatcher and consumer time to drain.
+    size_t lastCount = size_t(-1);
+    while (consumer->getEventCount() != lastCount) {
+        lastCount = consumer->getEventCount();
+        usleep(200 * 1000);
+    }
+    nsecs_t endTime = consumer->getLastEventTime();
+
+    dispatcherThread->requestExit();
+    consumer->requestExit();
+    dispatcher->unregisterInputChannel(serverChannel);
+    dispatcherThread->join();
+    consumer->join();
+
+    float readerSeconds = (readerDoneTime - startTime) * 0.000000001f;
+    float totalSeconds = (endTime > startTime ? endTime - startTime : 0) * 0.000000001f;
+    printf("Trace: %s (%d devices, %d batches, %d raw events)\n", tracePath,
+            trace.getDevices().size(), trace.getBatches().size(), rawEventCount);
+    printf("Mode: %s, display %dx%d\n", paced ? "paced" : "unpaced", width, height);
+    printf("Reader: %0.3fs, %0.1f raw events/s\n", readerSeconds,
+            readerSeconds > 0 ? rawEventCount / readerSeconds : 0.0f);
+    printf("Delivered: %d events in %0.3fs, %0.1f events/s\n", consumer->getEventCount(),
+            totalSeconds, totalSeconds > 0 ? consumer->getEventCount() / totalSeconds : 0.0f);
+    readerStats.print("Reader latency per batch (getEvents -> dispatcher enqueue)");
+    consumer->getLatencyStats().print("End-to-end latency (event time -> consumer)");
+    return 0;
+}
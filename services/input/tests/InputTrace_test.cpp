@@ -0,0 +1,288 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../InputTrace.h"
+
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace android {
+
+// An arbitrary device id.
+static const int32_t DEVICE_ID = 3;
+
+// An arbitrary time value.
+static const nsecs_t ARBITRARY_TIME = 1000000000LL;
+
+static RawEvent makeEvent(nsecs_t when, int32_t deviceId, int32_t type,
+        int32_t code, int32_t value) {
+    RawEvent event;
+    event.when = when;
+    event.deviceId = deviceId;
+    event.type = type;
+    event.code = code;
+    event.value = value;
+    return event;
+}
+
+
+// --- InputTraceTest ---
+
+class InputTraceTest : public testing::Test {
+protected:
+    String8 mPath;
+
+    virtual void SetUp() {
+        const char* tmpDir = getenv("TMPDIR");
+        mPath.setTo(tmpDir ? tmpDir : "/data/local/tmp");
+        mPath.append("/InputTrace_test.trace");
+    }
+
+    virtual void TearDown() {
+        unlink(mPath.string());
+    }
+
+    void writeTouchDevice(InputTraceWriter& writer) {
+        InputTraceDevice device;
+        device.id = DEVICE_ID;
+        device.classes = INPUT_DEVICE_CLASS_TOUCH | INPUT_DEVICE_CLASS_TOUCH_MT;
+        device.identifier.name = "touch";
+        device.identifier.descriptor = "0123456789abcdef";
+        device.identifier.vendor = 0x18d1;
+        device.configuration.addProperty(String8("touch.deviceType"), String8("touchScreen"));
+
+        InputTraceDevice::AxisState axis;
+        axis.info.valid = true;
+        axis.info.minValue = 0;
+        axis.info.maxValue = 1079;
+        axis.info.flat = 0;
+        axis.info.fuzz = 0;
+        axis.info.resolution = 0;
+        axis.value = 0;
+        axis.hasMapping = false;
+        device.absoluteAxes.add(ABS_MT_POSITION_X, axis);
+
+        InputTraceDevice::KeyInfo key;
+        key.keyCode = AKEYCODE_UNKNOWN;
+        key.flags = 0;
+        key.down = false;
+        device.keysByScanCode.add(BTN_TOUCH, key);
+
+        writer.writeDevice(device);
+    }
+};
+
+TEST_F(InputTraceTest, WriteAndLoad_PreservesDevicesBatchesAndEvents) {
+    InputTraceWriter writer;
+    ASSERT_EQ(OK, writer.open(mPath));
+
+    writeTouchDevice(writer);
+    RawEvent batch1[] = {
+        makeEvent(ARBITRARY_TIME, DEVICE_ID, EventHubInterface::DEVICE_ADDED, 0, 0),
+        makeEvent(ARBITRARY_TIME, 0, EventHubInterface::FINISHED_DEVICE_SCAN, 0, 0),
+    };
+    writer.writeEvents(ARBITRARY_TIME + 10, batch1, 2);
+
+    RawEvent batch2[] = {
+        makeEvent(ARBITRARY_TIME + 1000, DEVICE_ID, EV_ABS, ABS_MT_POSITION_X, 540),
+        makeEvent(ARBITRARY_TIME + 1000, DEVICE_ID, EV_ABS, ABS_MT_POSITION_Y, -7),
+        makeEvent(ARBITRARY_TIME + 1000, DEVICE_ID, EV_SYN, SYN_REPORT, 0),
+    };
+    writer.writeEvents(ARBITRARY_TIME + 2000, batch2, 3);
+    ASSERT_EQ(size_t(5), writer.getEventCount());
+    writer.close();
+
+    InputTraceReader reader;
+    ASSERT_EQ(OK, reader.load(mPath));
+
+    ASSERT_EQ(size_t(1), reader.getDevices().size());
+    const InputTraceDevice& device = reader.getDevices().itemAt(0);
+    ASSERT_EQ(DEVICE_ID, device.id);
+    ASSERT_EQ(uint32_t(INPUT_DEVICE_CLASS_TOUCH | INPUT_DEVICE_CLASS_TOUCH_MT), device.classes);
+    ASSERT_STREQ("touch", device.identifier.name.string());
+    ASSERT_STREQ("0123456789abcdef", device.identifier.descriptor.string());
+    ASSERT_EQ(0x18d1, device.identifier.vendor);
+    String8 deviceType;
+    ASSERT_TRUE(device.configuration.tryGetProperty(String8("touch.deviceType"), deviceType));
+    ASSERT_STREQ("touchScreen", deviceType.string());
+    ASSERT_EQ(1079, device.absoluteAxes.valueFor(ABS_MT_POSITION_X).info.maxValue);
+    ASSERT_GE(device.keysByScanCode.indexOfKey(BTN_TOUCH), 0);
+
+    ASSERT_EQ(size_t(2), reader.getBatches().size());
+    const InputTraceReader::Batch& first = reader.getBatches().itemAt(0);
+    ASSERT_EQ(ARBITRARY_TIME + 10, first.readTime);
+    ASSERT_EQ(size_t(2), first.eventCount);
+    ASSERT_EQ(size_t(1), first.deviceCount);
+    const InputTraceReader::Batch& second = reader.getBatches().itemAt(1);
+    ASSERT_EQ(ARBITRARY_TIME + 2000, second.readTime);
+    ASSERT_EQ(size_t(3), second.eventCount);
+    ASSERT_EQ(size_t(0), second.deviceCount);
+
+    ASSERT_EQ(size_t(5), reader.getEvents().size());
+    const RawEvent& event = reader.getEvents().itemAt(3);
+    ASSERT_EQ(ARBITRARY_TIME + 1000, event.when);
+    ASSERT_EQ(DEVICE_ID, event.deviceId);
+    ASSERT_EQ(EV_ABS, event.type);
+    ASSERT_EQ(ABS_MT_POSITION_Y, event.code);
+    ASSERT_EQ(-7, event.value);
+}
+
+TEST_F(InputTraceTest, Load_WhenFileIsNotATrace_ReturnsError) {
+    FILE* file = fopen(mPath.string(), "wb");
+    ASSERT_TRUE(file != NULL);
+    fputs("not a trace", file);
+    fclose(file);
+
+    InputTraceReader reader;
+    ASSERT_NE(OK, reader.load(mPath));
+}
+
+TEST_F(InputTraceTest, ReplayEventHub_ReturnsBatchesInOrderWithRebasedTimes) {
+    InputTraceWriter writer;
+    ASSERT_EQ(OK, writer.open(mPath));
+    writeTouchDevice(writer);
+    RawEvent batch1[] = {
+        makeEvent(ARBITRARY_TIME, DEVICE_ID, EventHubInterface::DEVICE_ADDED, 0, 0),
+    };
+    writer.writeEvents(ARBITRARY_TIME, batch1, 1);
+    RawEvent batch2[] = {
+        makeEvent(ARBITRARY_TIME + 500, DEVICE_ID, EV_ABS, ABS_MT_POSITION_X, 100),
+        makeEvent(ARBITRARY_TIME + 500, DEVICE_ID, EV_KEY, BTN_TOUCH, 1),
+        makeEvent(ARBITRARY_TIME + 500, DEVICE_ID, EV_SYN, SYN_REPORT, 0),
+    };
+    writer.writeEvents(ARBITRARY_TIME + 500, batch2, 3);
+    writer.close();
+
+    InputTraceReader reader;
+    ASSERT_EQ(OK, reader.load(mPath));
+    sp<ReplayEventHub> eventHub = new ReplayEventHub(reader, false /*paced*/);
+
+    RawEvent buffer[2];
+    ASSERT_EQ(size_t(1), eventHub->getEvents(-1, buffer, 2));
+    ASSERT_EQ(EventHubInterface::DEVICE_ADDED, buffer[0].type);
+    ASSERT_EQ(uint32_t(INPUT_DEVICE_CLASS_TOUCH | INPUT_DEVICE_CLASS_TOUCH_MT),
+            eventHub->getDeviceClasses(DEVICE_ID));
+
+    // The second batch does not fit in the buffer so it is split.
+    nsecs_t before = systemTime(SYSTEM_TIME_MONOTONIC);
+    ASSERT_EQ(size_t(2), eventHub->getEvents(-1, buffer, 2));
+    nsecs_t after = systemTime(SYSTEM_TIME_MONOTONIC);
+    ASSERT_GE(buffer[0].when, before);
+    ASSERT_LE(buffer[0].when, after);
+    ASSERT_EQ(ABS_MT_POSITION_X, buffer[0].code);
+    ASSERT_FALSE(eventHub->isFinished());
+    ASSERT_EQ(size_t(1), eventHub->getEvents(-1, buffer, 2));
+    ASSERT_EQ(SYN_REPORT, buffer[0].code);
+    ASSERT_TRUE(eventHub->isFinished());
+    ASSERT_EQ(size_t(0), eventHub->getEvents(0, buffer, 2));
+
+    // Replayed events update the device state visible to the mappers.
+    int32_t value;
+    ASSERT_EQ(OK, eventHub->getAbsoluteAxisValue(DEVICE_ID, ABS_MT_POSITION_X, &value));
+    ASSERT_EQ(100, value);
+    ASSERT_EQ(AKEY_STATE_DOWN, eventHub->getScanCodeState(DEVICE_ID, BTN_TOUCH));
+    ASSERT_TRUE(eventHub->hasScanCode(DEVICE_ID, BTN_TOUCH));
+
+    ASSERT_EQ(size_t(2), eventHub->getBatchDeliveryTimes().size());
+}
+
+TEST_F(InputTraceTest, ReplayEventHub_RestoresSwitchesAndKeyCharacterMapUntilRemoved) {
+    sp<KeyCharacterMap> map;
+    ASSERT_EQ(OK, KeyCharacterMap::loadContents(String8("keyboard.kcm"),
+            "type FULL\n"
+            "key A {\n"
+            "    label: 'A'\n"
+            "    base: 'a'\n"
+            "    shift: 'A'\n"
+            "}\n",
+            KeyCharacterMap::FORMAT_BASE, &map));
+
+    InputTraceDevice device;
+    device.id = DEVICE_ID;
+    device.classes = INPUT_DEVICE_CLASS_KEYBOARD | INPUT_DEVICE_CLASS_ALPHAKEY;
+    device.identifier.name = "keyboard";
+    device.switchStates.add(SW_LID, AKEY_STATE_UP);
+    device.hasKeyCharacterMap = true;
+    map->getCompiledWords(&device.keyCharacterMap);
+
+    InputTraceWriter writer;
+    ASSERT_EQ(OK, writer.open(mPath));
+    writer.writeDevice(device);
+    RawEvent batch1[] = {
+        makeEvent(ARBITRARY_TIME, DEVICE_ID, EventHubInterface::DEVICE_ADDED, 0, 0),
+    };
+    writer.writeEvents(ARBITRARY_TIME, batch1, 1);
+    RawEvent batch2[] = {
+        makeEvent(ARBITRARY_TIME + 500, DEVICE_ID, EV_SW, SW_LID, 1),
+        makeEvent(ARBITRARY_TIME + 500, DEVICE_ID, EV_SYN, SYN_REPORT, 0),
+    };
+    writer.writeEvents(ARBITRARY_TIME + 500, batch2, 2);
+    RawEvent batch3[] = {
+        makeEvent(ARBITRARY_TIME + 1000, DEVICE_ID, EventHubInterface::DEVICE_REMOVED, 0, 0),
+    };
+    writer.writeEvents(ARBITRARY_TIME + 1000, batch3, 1);
+    writer.close();
+
+    InputTraceReader reader;
+    ASSERT_EQ(OK, reader.load(mPath));
+    sp<ReplayEventHub> eventHub = new ReplayEventHub(reader, false /*paced*/);
+
+    RawEvent buffer[2];
+    ASSERT_EQ(size_t(1), eventHub->getEvents(-1, buffer, 2));
+    ASSERT_EQ(AKEY_STATE_UP, eventHub->getSwitchState(DEVICE_ID, SW_LID));
+    sp<KeyCharacterMap> replayedMap = eventHub->getKeyCharacterMap(DEVICE_ID);
+    ASSERT_TRUE(replayedMap != NULL);
+    ASSERT_EQ(KeyCharacterMap::KEYBOARD_TYPE_FULL, replayedMap->getKeyboardType());
+    ASSERT_EQ(char16_t('A'), replayedMap->getCharacter(AKEYCODE_A, AMETA_SHIFT_ON));
+    ASSERT_EQ(char16_t('a'), replayedMap->getCharacter(AKEYCODE_A, 0));
+
+    ASSERT_EQ(size_t(2), eventHub->getEvents(-1, buffer, 2));
+    ASSERT_EQ(AKEY_STATE_DOWN, eventHub->getSwitchState(DEVICE_ID, SW_LID));
+
+    // A removed device is forgotten, like EventHub does.
+    ASSERT_EQ(size_t(1), eventHub->getEvents(-1, buffer, 2));
+    ASSERT_EQ(EventHubInterface::DEVICE_REMOVED, buffer[0].type);
+    ASSERT_EQ(uint32_t(0), eventHub->getDeviceClasses(DEVICE_ID));
+    ASSERT_EQ(AKEY_STATE_UNKNOWN, eventHub->getSwitchState(DEVICE_ID, SW_LID));
+    ASSERT_TRUE(eventHub->getKeyCharacterMap(DEVICE_ID) == NULL);
+}
+
+TEST_F(InputTraceTest, ReplayEventHub_WhenFinished_BlocksUntilTimeoutOrWake) {
+    InputTraceWriter writer;
+    ASSERT_EQ(OK, writer.open(mPath));
+    writeTouchDevice(writer);
+    writer.close();
+
+    InputTraceReader reader;
+    ASSERT_EQ(OK, reader.load(mPath));
+    sp<ReplayEventHub> eventHub = new ReplayEventHub(reader, false /*paced*/);
+    ASSERT_TRUE(eventHub->isFinished());
+
+    // An exhausted trace waits out the timeout rather than returning immediately.
+    RawEvent buffer[2];
+    nsecs_t before = systemTime(SYSTEM_TIME_MONOTONIC);
+    ASSERT_EQ(size_t(0), eventHub->getEvents(20, buffer, 2));
+    ASSERT_GE(systemTime(SYSTEM_TIME_MONOTONIC) - before, milliseconds_to_nanoseconds(15));
+
+    // A pending wake makes the next call return at once, even with an infinite timeout.
+    eventHub->wake();
+    before = systemTime(SYSTEM_TIME_MONOTONIC);
+    ASSERT_EQ(size_t(0), eventHub->getEvents(-1, buffer, 2));
+    ASSERT_LT(systemTime(SYSTEM_TIME_MONOTONIC) - before, milliseconds_to_nanoseconds(1000));
+}
+
+} // namespace android
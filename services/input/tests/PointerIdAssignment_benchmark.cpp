@@ -0,0 +1,280 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Compares the pointer id assignment strategies of the TouchInputMapper on a
+ * synthetic trace of a multitouch screen that does not report tracking ids.
+ *
+ * Usage: PointerIdAssignment_benchmark [--pointers N] [--frames N] [--speed PX]
+ *
+ * The fingers sweep back and forth across the screen at different speeds so they
+ * cross each other frequently, and each frame reports them in a random order.
+ * Every finger reports a distinct pressure so the benchmark can tell which finger
+ * each pointer id belongs to and count how often an id jumps to another finger.
+ */
+
+#include "../InputTrace.h"
+#include "InputBenchmarkHelpers.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace android;
+
+static const int32_t DEVICE_ID = 1;
+static const int32_t DISPLAY_WIDTH = 1920;
+static const int32_t DISPLAY_HEIGHT = 1080;
+static const int32_t RAW_PRESSURE_MAX = 255;
+static const nsecs_t FRAME_INTERVAL = 8333333LL; // 120Hz
+
+
+// --- PointerIdListener ---
+
+/* Counts the number of times that a pointer id is reassigned to a different finger. */
+class PointerIdListener : public InputListenerInterface {
+public:
+    PointerIdListener() : mMotionCount(0), mSwapCount(0) { }
+
+    inline size_t getMotionCount() const { return mMotionCount; }
+    inline size_t getSwapCount() const { return mSwapCount; }
+
+    virtual void notifyConfigurationChanged(const NotifyConfigurationChangedArgs* args) { }
+    virtual void notifyKey(const NotifyKeyArgs* args) { }
+    virtual void notifySwitch(const NotifySwitchArgs* args) { }
+    virtual void notifyDeviceReset(const NotifyDeviceResetArgs* args) { }
+
+    virtual void notifyMotion(const NotifyMotionArgs* args) {
+        mMotionCount += 1;
+
+        for (uint32_t i = 0; i < args->pointerCount; i++) {
+            int32_t id = args->pointerProperties[i].id;
+            float pressure = args->pointerCoords[i].getAxisValue(AMOTION_EVENT_AXIS_PRESSURE);
+            int32_t finger = int32_t(floorf(pressure * RAW_PRESSURE_MAX + 0.5f)) - 1;
+
+            ssize_t index = mFingerForId.indexOfKey(id);
+            if (index < 0) {
+                mFingerForId.add(id, finger);
+            } else if (mFingerForId.valueAt(index) != finger) {
+                mSwapCount += 1;
+                mFingerForId.replaceValueAt(index, finger);
+            }
+        }
+
+        int32_t action = args->action & AMOTION_EVENT_ACTION_MASK;
+        if (action == AMOTION_EVENT_ACTION_UP || action == AMOTION_EVENT_ACTION_CANCEL) {
+            mFingerForId.clear();
+        } else if (action == AMOTION_EVENT_ACTION_POINTER_UP) {
+            int32_t index = (args->action & AMOTION_EVENT_ACTION_POINTER_INDEX_MASK)
+                    >> AMOTION_EVENT_ACTION_POINTER_INDEX_SHIFT;
+            mFingerForId.removeItem(args->pointerProperties[index].id);
+        }
+    }
+
+protected:
+    virtual ~PointerIdListener() { }
+
+private:
+    size_t mMotionCount;
+    size_t mSwapCount;
+    KeyedVector<int32_t, int32_t> mFingerForId;
+};
+
+
+// --- Trace synthesis ---
+
+static RawEvent makeEvent(nsecs_t when, int32_t type, int32_t code, int32_t value) {
+    RawEvent event;
+    event.when = when;
+    event.deviceId = DEVICE_ID;
+    event.type = type;
+    event.code = code;
+    event.value = value;
+    return event;
+}
+
+static void addAxis(InputTraceDevice& device, int32_t axis, int32_t minValue, int32_t maxValue) {
+    InputTraceDevice::AxisState state;
+    state.info.valid = true;
+    state.info.minValue = minValue;
+    state.info.maxValue = maxValue;
+    state.info.flat = 0;
+    state.info.fuzz = 0;
+    state.info.resolution = 0;
+    state.value = 0;
+    state.hasMapping = false;
+    device.absoluteAxes.add(axis, state);
+}
+
+static status_t writeTrace(const String8& path, const char* strategy,
+        uint32_t pointerCount, uint32_t frameCount, float speed) {
+    InputTraceWriter writer;
+    status_t status = writer.open(path);
+    if (status) {
+        return status;
+    }
+
+    InputTraceDevice device;
+    device.id = DEVICE_ID;
+    device.classes = INPUT_DEVICE_CLASS_TOUCH | INPUT_DEVICE_CLASS_TOUCH_MT;
+    device.identifier.name = "Synthetic Touch Panel";
+    device.configuration.addProperty(String8("touch.deviceType"), String8("touchScreen"));
+    device.configuration.addProperty(String8("touch.pointerIdAssignment"), String8(strategy));
+    addAxis(device, ABS_MT_POSITION_X, 0, DISPLAY_WIDTH - 1);
+    addAxis(device, ABS_MT_POSITION_Y, 0, DISPLAY_HEIGHT - 1);
+    addAxis(device, ABS_MT_PRESSURE, 0, RAW_PRESSURE_MAX);
+    device.inputProperties.push(INPUT_PROP_DIRECT);
+    writer.writeDevice(device);
+
+    nsecs_t when = FRAME_INTERVAL;
+    RawEvent added[] = {
+        makeEvent(when, EventHubInterface::DEVICE_ADDED, 0, 0),
+        makeEvent(when, EventHubInterface::FINISHED_DEVICE_SCAN, 0, 0),
+    };
+    added[1].deviceId = 0;
+    writer.writeEvents(when, added, 2);
+
+    // The same seed is used for every strategy so they all see the same motion.
+    srand48(1);
+    float x[MAX_POINTERS], y[MAX_POINTERS], vx[MAX_POINTERS], vy[MAX_POINTERS];
+    for (uint32_t i = 0; i < pointerCount; i++) {
+        x[i] = (i + 0.5f) * DISPLAY_WIDTH / pointerCount;
+        y[i] = DISPLAY_HEIGHT * (0.25f + 0.5f * drand48());
+        vx[i] = speed * (drand48() * 2.0f - 1.0f);
+        vy[i] = speed * 0.25f * (drand48() * 2.0f - 1.0f);
+    }
+
+    Vector<RawEvent> events;
+    uint32_t order[MAX_POINTERS];
+    for (uint32_t frame = 0; frame < frameCount; frame++) {
+        when += FRAME_INTERVAL;
+
+        // Devices without tracking ids report contacts in no particular order.
+        for (uint32_t i = 0; i < pointerCount; i++) {
+            order[i] = i;
+        }
+        for (uint32_t i = pointerCount - 1; i > 0; i--) {
+            uint32_t j = uint32_t(lrand48() % (i + 1));
+            uint32_t temp = order[i];
+            order[i] = order[j];
+            order[j] = temp;
+        }
+
+        events.clear();
+        for (uint32_t k = 0; k < pointerCount; k++) {
+            uint32_t i = order[k];
+            events.push(makeEvent(when, EV_ABS, ABS_MT_POSITION_X, int32_t(x[i])));
+            events.push(makeEvent(when, EV_ABS, ABS_MT_POSITION_Y, int32_t(y[i])));
+            events.push(makeEvent(when, EV_ABS, ABS_MT_PRESSURE, int32_t(i + 1)));
+            events.push(makeEvent(when, EV_SYN, SYN_MT_REPORT, 0));
+        }
+        events.push(makeEvent(when, EV_SYN, SYN_REPORT, 0));
+        writer.writeEvents(when, events.array(), events.size());
+
+        for (uint32_t i = 0; i < pointerCount; i++) {
+            x[i] += vx[i];
+            y[i] += vy[i];
+            if (x[i] < 0 || x[i] >= DISPLAY_WIDTH) {
+                vx[i] = -vx[i];
+                x[i] += 2 * vx[i];
+            }
+            if (y[i] < 0 || y[i] >= DISPLAY_HEIGHT) {
+                vy[i] = -vy[i];
+                y[i] += 2 * vy[i];
+            }
+        }
+    }
+
+    // All fingers up.
+    when += FRAME_INTERVAL;
+    RawEvent up[] = {
+        makeEvent(when, EV_SYN, SYN_MT_REPORT, 0),
+        makeEvent(when, EV_SYN, SYN_REPORT, 0),
+    };
+    writer.writeEvents(when, up, 2);
+    writer.close();
+    return OK;
+}
+
+static bool runStrategy(const String8& path, const char* strategy,
+        uint32_t pointerCount, uint32_t frameCount, float speed) {
+    if (writeTrace(path, strategy, pointerCount, frameCount, speed)) {
+        fprintf(stderr, "Could not write trace '%s'.\n", path.string());
+        return false;
+    }
+
+    InputTraceReader trace;
+    if (trace.load(path)) {
+        fprintf(stderr, "Could not load trace '%s'.\n", path.string());
+        return false;
+    }
+
+    sp<ReplayEventHub> eventHub = new ReplayEventHub(trace, false /*paced*/);
+    sp<BenchmarkReaderPolicy> policy = new BenchmarkReaderPolicy(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+    sp<PointerIdListener> listener = new PointerIdListener();
+    sp<InputReader> reader = new InputReader(eventHub, policy, listener);
+
+    BenchmarkLatencyStats frameStats;
+    while (!eventHub->isFinished()) {
+        nsecs_t startTime = systemTime(SYSTEM_TIME_MONOTONIC);
+        reader->loopOnce();
+        frameStats.add(systemTime(SYSTEM_TIME_MONOTONIC) - startTime);
+    }
+
+    printf("%s: %d motion events, %d id swaps\n", strategy,
+            listener->getMotionCount(), listener->getSwapCount());
+    frameStats.print("  Reader time per frame");
+    return true;
+}
+
+static void usage(const char* program) {
+    fprintf(stderr, "Usage: %s [--pointers N] [--frames N] [--speed PX]\n", program);
+}
+
+int main(int argc, char** argv) {
+    uint32_t pointerCount = 10;
+    uint32_t frameCount = 5000;
+    float speed = 40.0f;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--pointers") && i + 1 < argc) {
+            pointerCount = uint32_t(atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--frames") && i + 1 < argc) {
+            frameCount = uint32_t(atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--speed") && i + 1 < argc) {
+            speed = float(atof(argv[++i]));
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (pointerCount < 1 || pointerCount > MAX_POINTERS || frameCount < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    const char* tmpDir = getenv("TMPDIR");
+    String8 path(tmpDir ? tmpDir : "/data/local/tmp");
+    path.append("/PointerIdAssignment_benchmark.trace");
+
+    printf("%d pointers, %d frames, speed %0.1f px/frame\n", pointerCount, frameCount, speed);
+    bool ok = runStrategy(path, "greedy", pointerCount, frameCount, speed)
+            && runStrategy(path, "optimal", pointerCount, frameCount, speed);
+    unlink(path.string());
+    return ok ? 0 : 1;
+}
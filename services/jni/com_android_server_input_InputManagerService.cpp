@@ -28,13 +28,16 @@
 #include "JNIHelp.h"
 #include "jni.h"
 #include <limits.h>
+#include <stdlib.h>
 #include <android_runtime/AndroidRuntime.h>
 
+#include <cutils/properties.h>
 #include <utils/Log.h>
 #include <utils/Looper.h>
 #include <utils/threads.h>
 
 #include <input/InputManager.h>
+#include <input/InputTrace.h>
 #include <input/PointerController.h>
 #include <input/SpriteController.h>
 
@@ -281,7 +284,14 @@ NativeInputManager::NativeInputManager(jobject contextObj,
         mLocked.stylusIconEnabled = false;
     }
 
-    sp<EventHub> eventHub = new EventHub();
+    sp<EventHubInterface> eventHub = new EventHub();
+
+    // Record the raw input event stream for offline replay if requested.
+    char tracePath[PROPERTY_VALUE_MAX];
+    if (property_get("debug.input.trace", tracePath, NULL) > 0) {
+        eventHub = new RecordingEventHub(eventHub, String8(tracePath));
+    }
+
     mInputManager = new InputManager(eventHub, this, this);
 }
 
@@ -618,6 +628,15 @@ void NativeInputManager::getDispatcherConfiguration(InputDispatcherConfiguration
     if (!checkAndClearExceptionFromCallback(env, "getKeyRepeatDelay")) {
         outConfig->keyRepeatDelay = milliseconds_to_nanoseconds(keyRepeatDelay);
     }
+
+    char value[PROPERTY_VALUE_MAX];
+    if (property_get("input.motion_coalescing", value, NULL) > 0) {
+        outConfig->motionCoalescingEnabled = atoi(value) != 0;
+    }
+    if (property_get("input.motion_coalescing_history", value, NULL) > 0) {
+        int maxHistory = atoi(value);
+        outConfig->motionCoalescingMaxHistory = maxHistory > 0 ? maxHistory : 0;
+    }
 }
 
 bool NativeInputManager::isKeyRepeatEnabled() {
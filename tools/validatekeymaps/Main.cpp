@@ -16,6 +16,7 @@
 
 #include <androidfw/KeyCharacterMap.h>
 #include <androidfw/KeyLayoutMap.h>
+#include <androidfw/KeymapCache.h>
 #include <androidfw/VirtualKeyMap.h>
 #include <utils/PropertyMap.h>
 #include <utils/String8.h>
@@ -28,6 +29,13 @@ using namespace android;
 
 static const char* gProgName = "validatekeymaps";
 
+// The directory in which to write compiled keymaps, or NULL if none.
+static const char* gCompiledDir = NULL;
+
+// The directory in which the source files will be installed on the device, or NULL
+// if the source files are named by their paths as given.
+static const char* gDeviceDir = NULL;
+
 enum FileType {
     FILETYPE_UNKNOWN,
     FILETYPE_KEYLAYOUT,
@@ -41,9 +49,13 @@ static void usage() {
     fprintf(stderr, "Keymap Validation Tool\n\n");
     fprintf(stderr, "Usage:\n");
     fprintf(stderr,
-        " %s [*.kl] [*.kcm] [*.idc] [virtualkeys.*] [...]\n"
+        " %s [-c <dir>] [-d <dir>] [*.kl] [*.kcm] [*.idc] [virtualkeys.*] [...]\n"
         "   Validates the specified key layouts, key character maps, \n"
-        "   input device configurations, or virtual key definitions.\n\n",
+        "   input device configurations, or virtual key definitions.\n\n"
+        "   -c <dir>  Writes the compiled form of each valid key layout and\n"
+        "             key character map to the given directory.\n"
+        "   -d <dir>  The directory in which the source files will be installed\n"
+        "             on the device, used to name the compiled keymaps.\n\n",
         gProgName);
 }
 
@@ -68,6 +80,17 @@ static FileType getFileType(const char* filename) {
     return FILETYPE_UNKNOWN;
 }
 
+static String8 getCompiledPath(const char* filename) {
+    String8 devicePath;
+    if (gDeviceDir) {
+        devicePath.setTo(gDeviceDir);
+        devicePath.appendPath(String8(filename).getPathLeaf());
+    } else {
+        devicePath.setTo(filename);
+    }
+    return getCompiledKeymapPath(String8(gCompiledDir), devicePath);
+}
+
 static bool validateFile(const char* filename) {
     fprintf(stdout, "Validating file '%s'...\n", filename);
 
@@ -84,6 +107,13 @@ static bool validateFile(const char* filename) {
             fprintf(stderr, "Error %d parsing key layout file.\n\n", status);
             return false;
         }
+        if (gCompiledDir) {
+            status = map->writeCompiled(getCompiledPath(filename), String8(filename));
+            if (status) {
+                fprintf(stderr, "Error %d writing compiled key layout file.\n\n", status);
+                return false;
+            }
+        }
         break;
     }
 
@@ -95,6 +125,14 @@ static bool validateFile(const char* filename) {
             fprintf(stderr, "Error %d parsing key character map file.\n\n", status);
             return false;
         }
+        if (gCompiledDir) {
+            status = map->writeCompiled(getCompiledPath(filename), String8(filename));
+            if (status) {
+                fprintf(stderr, "Error %d writing compiled key character map file.\n\n",
+                        status);
+                return false;
+            }
+        }
         break;
     }
 
@@ -131,8 +169,25 @@ int main(int argc, const char** argv) {
         return 1;
     }
 
+    int first = 1;
+    while (first < argc && argv[first][0] == '-') {
+        if (!strcmp(argv[first], "-c") && first + 1 < argc) {
+            gCompiledDir = argv[first + 1];
+        } else if (!strcmp(argv[first], "-d") && first + 1 < argc) {
+            gDeviceDir = argv[first + 1];
+        } else {
+            usage();
+            return 1;
+        }
+        first += 2;
+    }
+    if (first >= argc) {
+        usage();
+        return 1;
+    }
+
     int result = 0;
-    for (int i = 1; i < argc; i++) {
+    for (int i = first; i < argc; i++) {
         if (!validateFile(argv[i])) {
             result = 1;
         }